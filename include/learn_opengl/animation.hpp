@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "glm/ext/matrix_float4x4.hpp"
+#include "glm/ext/vector_float3.hpp"
+#include "glm/ext/vector_float4.hpp"
+#include "learn_opengl/job_system.hpp"
+#include "learn_opengl/mesh.hpp"
+#include "learn_opengl/shader.hpp"
+
+// Texture unit of the bone palette, above the virtual texture pages.
+const unsigned int BONE_PALETTE_UNIT = 8;
+// Texels per bone matrix in the palette texture, one per column.
+const unsigned int BONE_PALETTE_TEXELS = 4;
+// Instances evaluated per job.
+const unsigned int ANIMATION_INSTANCE_GRAIN = 16;
+// Skinned meshes are culled with their bind pose bounds grown by this much around the center, since
+// the pose is only known on the GPU.
+const float        SKINNED_BOUNDS_SCALE = 2.0f;
+// Used for clips that do not say, as Assimp's own evaluator does.
+const double       DEFAULT_TICKS_PER_SECOND = 25.0;
+
+// Joint hierarchy of a model, joints are the scene nodes so a parent always comes before its children.
+// Bones are the joints the meshes are skinned to, each with the matrix from the mesh into the joint's
+// bind pose, and index the palette.
+struct Skeleton
+{
+    std::vector<int>          parents;     // -1 for roots
+    std::vector<glm::mat4>    bind_locals; // Used for joints no channel of the clip animates
+    std::vector<unsigned int> bone_joints;
+    std::vector<glm::mat4>    bone_offsets;
+};
+
+// Keys of one joint, times in seconds ascending. Every channel has at least one key of each kind.
+struct AnimationChannel
+{
+    unsigned int           joint;
+    std::vector<float>     position_times;
+    std::vector<glm::vec3> positions;
+    std::vector<float>     rotation_times;
+    std::vector<glm::vec4> rotations; // Quaternions, xyzw
+    std::vector<float>     scale_times;
+    std::vector<glm::vec3> scales;
+};
+
+struct AnimationClip
+{
+    std::string                   name;
+    float                         duration; // Seconds, the clip loops
+    std::vector<AnimationChannel> channels;
+};
+
+struct AnimationStats
+{
+    unsigned int instance_count;
+    unsigned int bone_count;
+    double       evaluate_milliseconds;
+    std::size_t  key_searches; // Key lookups, three per channel per instance
+    std::size_t  key_hits;     // Lookups answered by the cached key or the one after it
+};
+
+// Blends the four influences' matrices per vertex and transforms the position and normal, 4 lanes at a
+// time. The CPU path, and the reference the GPU path is checked against. p_out may not alias
+// p_vertices. Needs no GL.
+void skin_vertices(const Vertex* p_vertices, const SkinWeights* p_weights, std::size_t p_count,
+                   const glm::mat4* p_palette, Vertex* p_out);
+
+// Poses many instances of one skeleton, each playing a clip from its own start time. Every instance
+// remembers the key it last sampled per channel, so a frame usually steps forward at most one key
+// instead of searching. Instances are evaluated in chunks of ANIMATION_INSTANCE_GRAIN on the job
+// system, interpolation and the hierarchy with SSE. Needs no GL.
+class AnimationPlayer
+{
+  public:
+    // Both must outlive the player.
+    AnimationPlayer(const Skeleton& p_skeleton, const std::vector<AnimationClip>& p_clips);
+
+    // Instance i plays clip i modulo the clip count, offset by a random start from p_seed.
+    void set_instance_count(unsigned int p_count, unsigned int p_seed = 1);
+    // Poses every instance at p_time seconds. Serial on the calling thread when p_jobs is null, the
+    // palettes do not depend on the thread count.
+    void update(double p_time, JobSystem* p_jobs);
+
+    unsigned int get_instance_count() const;
+    unsigned int get_bone_count() const;
+    // get_bone_count() matrices per instance, instance after instance.
+    const std::vector<glm::mat4>& get_palettes() const;
+    AnimationStats                get_stats() const;
+
+  private:
+    const Skeleton&                   skeleton;
+    const std::vector<AnimationClip>& clips;
+    unsigned int                      instance_count;
+    unsigned int                      key_stride; // Cached keys per instance, three per channel of the longest clip
+    std::vector<unsigned int>         instance_clips;
+    std::vector<float>                start_times;
+    std::vector<std::uint32_t>        cached_keys;
+    std::vector<glm::mat4>            palettes;
+    AnimationStats                    stats;
+
+    // Instances [p_begin, p_end), adding their lookups to the counters.
+    void evaluate(double p_time, std::size_t p_begin, std::size_t p_end, std::size_t& p_key_searches,
+                  std::size_t& p_key_hits);
+};
+
+// GPU half: the palettes in a buffer texture of RGBA32F texels, BONE_PALETTE_TEXELS per matrix, read
+// by shaders/include/skinning.glsl. GL thread only.
+class BonePalette
+{
+  public:
+    BonePalette();
+    ~BonePalette();
+    BonePalette(const BonePalette&)            = delete;
+    BonePalette& operator=(const BonePalette&) = delete;
+
+    // Orphans the buffer, so this never waits on last frame's draws.
+    void upload(const std::vector<glm::mat4>& p_palettes);
+    void bind(Shader& p_shader) const;
+
+  private:
+    unsigned int buffer;
+    unsigned int texture;
+    std::size_t  capacity; // Bytes
+    std::size_t  max_texels;
+};
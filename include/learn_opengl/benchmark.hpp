@@ -0,0 +1,7 @@
+#pragma once
+
+#include <string>
+
+// CPU-only benchmarks. Run with `main --bench <name>` or `main --bench all`; no window or GL
+// context is created. Returns the process exit code.
+int run_benchmark(const std::string& name);
@@ -15,6 +15,19 @@ enum CameraMovement
     DOWN
 };
 
+const int CAMERA_MOVEMENT_COUNT = 6;
+
+// The part of the camera that changes from tick to tick, used to interpolate between fixed simulation steps.
+struct CameraState
+{
+    glm::vec3 camera_position;
+    float     yaw;
+    float     pitch;
+    float     fov;
+};
+
+CameraState interpolate_camera_state(const CameraState& p_from, const CameraState& p_to, float p_alpha);
+
 class Camera
 {
   public:
@@ -58,6 +71,8 @@ class Camera
     void process_mouse_movement(float p_x_offset, float p_y_offset, GLboolean p_constrain_pitch = true);
     void process_mouse_scroll(float p_y_offset);
     void reset_fov();
+    CameraState get_state() const;
+    void set_state(const CameraState& p_state);
 
   private:
     void update_camera_vectors();
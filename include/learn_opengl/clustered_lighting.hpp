@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "glm/ext/matrix_float4x4.hpp"
+#include "glm/ext/vector_float3.hpp"
+#include "glm/ext/vector_float4.hpp"
+#include "learn_opengl/shader.hpp"
+#include "learn_opengl/shader_preprocessor.hpp"
+
+// Cluster grid over the view frustum: screen tiles times exponentially spaced depth slices.
+const unsigned int CLUSTER_TILES_X = 16;
+const unsigned int CLUSTER_TILES_Y = 9;
+const unsigned int CLUSTER_SLICES  = 24;
+const unsigned int CLUSTER_COUNT   = CLUSTER_TILES_X * CLUSTER_TILES_Y * CLUSTER_SLICES;
+
+// Light indices are uploaded as 16-bit, extra lights are ignored.
+const unsigned int MAX_CLUSTERED_LIGHTS = 65535;
+
+// Texels per light in the light buffer texture.
+const unsigned int CLUSTER_LIGHT_TEXELS = 3;
+
+enum LightType
+{
+    LIGHT_POINT,
+    LIGHT_SPOT
+};
+
+struct Light
+{
+    LightType type;
+    glm::vec3 position;
+    float     radius; // No contribution past this distance, also the culling sphere
+    glm::vec3 color;
+    float     intensity;
+    glm::vec3 direction; // Spot only
+    float     spot_cos_inner;
+    float     spot_cos_outer;
+};
+
+struct LightBinningStats
+{
+    unsigned int light_count;
+    unsigned int index_count;
+    unsigned int occupied_clusters;
+    unsigned int max_cluster_lights;
+    double       bin_milliseconds;
+};
+
+// CPU half of clustered lighting: builds view-space cluster bounds from the projection and assigns
+// lights to clusters each frame, 4 lights per SIMD test, one job per depth slice. Needs no GL.
+class LightClusterer
+{
+  public:
+    LightClusterer();
+
+    // Rebuilds the cluster bounds, only when the projection changed.
+    void build_clusters(const glm::mat4& p_projection);
+    void bin_lights(const std::vector<Light>& p_lights, const glm::mat4& p_view);
+
+    // (offset, count) into get_light_indices() per cluster, x fastest, then y, then slice.
+    const std::vector<std::uint32_t>& get_cluster_ranges() const;
+    const std::vector<std::uint16_t>& get_light_indices() const;
+    // CLUSTER_LIGHT_TEXELS view-space texels per light, laid out for the shader.
+    const std::vector<glm::vec4>& get_gpu_lights() const;
+
+    float             get_near_plane() const;
+    float             get_far_plane() const;
+    LightBinningStats get_stats() const;
+
+  private:
+    glm::mat4 projection;
+    float     near_plane;
+    float     far_plane;
+
+    std::vector<glm::vec3> cluster_min;
+    std::vector<glm::vec3> cluster_max;
+    std::vector<float>     slice_near;
+    std::vector<float>     slice_far;
+
+    // View-space culling spheres, padded to a multiple of 4 with spheres that never pass.
+    std::vector<float> light_x;
+    std::vector<float> light_y;
+    std::vector<float> light_z;
+    std::vector<float> light_radius;
+
+    std::vector<std::vector<std::uint16_t>> slice_indices;
+    std::vector<std::uint32_t>              cluster_ranges;
+    std::vector<std::uint16_t>              light_indices;
+    std::vector<glm::vec4>                  gpu_lights;
+
+    LightBinningStats stats;
+};
+
+// GL half: streams the binning result into buffer textures and binds them for shaders compiled with
+// get_shader_defines(). GL thread only.
+class ClusteredLighting
+{
+  public:
+    ClusteredLighting();
+    ~ClusteredLighting();
+    ClusteredLighting(const ClusteredLighting&)            = delete;
+    ClusteredLighting& operator=(const ClusteredLighting&) = delete;
+
+    void update(const std::vector<Light>& p_lights, const glm::mat4& p_view, const glm::mat4& p_projection);
+    // Uses texture units p_first_unit to p_first_unit + 2.
+    void bind(Shader& p_shader, int p_viewport_width, int p_viewport_height, unsigned int p_first_unit) const;
+
+    LightBinningStats get_stats() const;
+
+    static ShaderDefines get_shader_defines();
+
+  private:
+    enum
+    {
+        LIGHT_BUFFER,
+        RANGE_BUFFER,
+        INDEX_BUFFER,
+        BUFFER_COUNT
+    };
+
+    void upload(unsigned int p_buffer, const void* p_data, std::size_t p_bytes);
+
+    LightClusterer clusterer;
+    unsigned int   buffers[BUFFER_COUNT];
+    unsigned int   textures[BUFFER_COUNT];
+    std::size_t    capacities[BUFFER_COUNT];
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+
+#include "learn_opengl/fullscreen_quad.hpp"
+#include "learn_opengl/shader.hpp"
+
+const float        DYNAMIC_RESOLUTION_MIN_SCALE = 0.5f;
+const float        DYNAMIC_RESOLUTION_MAX_SCALE = 1.0f;
+// No change while the GPU time is within this fraction of the target.
+const float        DYNAMIC_RESOLUTION_DEADBAND  = 0.05f;
+// Largest scale change per adjustment, so one slow frame cannot halve the resolution.
+const float        DYNAMIC_RESOLUTION_MAX_STEP  = 0.05f;
+const unsigned int DYNAMIC_RESOLUTION_HISTORY   = 600;
+
+struct ResolutionSample
+{
+    std::uint64_t frame_index;
+    double        gpu_milliseconds;
+    float         scale; // Scale chosen after this measurement
+};
+
+// CPU half: picks the render scale from measured GPU times. The cost of the scaled passes is assumed
+// to follow the pixel count, so the scale moves by the square root of target / measured. After each
+// change it waits p_settle_samples measurements, since timer results arrive a few frames late and
+// would otherwise still describe the old scale. Needs no GL.
+class ResolutionController
+{
+  public:
+    ResolutionController(double p_target_milliseconds, unsigned int p_settle_samples);
+
+    // Returns the new scale.
+    float update(std::uint64_t p_frame_index, double p_gpu_milliseconds);
+
+    float  get_scale() const;
+    double get_target_milliseconds() const;
+    // Oldest first, at most DYNAMIC_RESOLUTION_HISTORY entries.
+    const std::deque<ResolutionSample>& get_history() const;
+    bool   write_csv(const std::string& p_path) const;
+
+  private:
+    double                       target_milliseconds;
+    unsigned int                 settle_samples;
+    unsigned int                 samples_since_change;
+    float                        scale;
+    std::deque<ResolutionSample> history;
+};
+
+// GL half: renders the 3D passes into an offscreen target at the controller's scale and stretches
+// the result over the window with the "quad" program (shaders/quad_*.glsl). The target is allocated
+// at full output size and only its lower-left corner is used, so scale changes never reallocate.
+// GL thread only.
+class DynamicResolution
+{
+  public:
+    DynamicResolution(double p_target_milliseconds, unsigned int p_settle_samples);
+    ~DynamicResolution();
+    DynamicResolution(const DynamicResolution&)            = delete;
+    DynamicResolution& operator=(const DynamicResolution&) = delete;
+
+    // Binds the target and sets the viewport for a p_output_width x p_output_height window.
+    void begin(int p_output_width, int p_output_height);
+    // Back to the default framebuffer, upscales the target with p_quad_shader.
+    void end(Shader& p_quad_shader);
+    // Feeds the GPU time of the scaled passes, the new scale applies from the next begin().
+    void update(std::uint64_t p_frame_index, double p_gpu_milliseconds);
+
+    int                         get_render_width() const;
+    int                         get_render_height() const;
+    const ResolutionController& get_controller() const;
+
+  private:
+    void resize(int p_width, int p_height);
+
+    ResolutionController controller;
+    unsigned int         framebuffer;
+    unsigned int         color_texture;
+    unsigned int         depth_renderbuffer;
+    FullscreenQuad       quad;
+    int                  target_width;
+    int                  target_height;
+    int                  render_width;
+    int                  render_height;
+    int                  output_width;
+    int                  output_height;
+};
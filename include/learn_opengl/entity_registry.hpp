@@ -0,0 +1,201 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "glm/ext/matrix_float4x4.hpp"
+#include "glm/ext/vector_float3.hpp"
+#include "learn_opengl/frame_pipeline.hpp"
+#include "learn_opengl/frustum.hpp"
+#include "learn_opengl/scene_graph.hpp"
+
+// Low 24 bits index the entity slot, the high 8 bits are a generation so stale handles can be detected.
+using Entity = std::uint32_t;
+
+const Entity        ENTITY_NONE = 0xFFFFFFFF;
+const std::uint32_t ENTITY_INDEX_MASK = 0x00FFFFFF;
+const std::uint32_t ENTITY_GENERATION_SHIFT = 24;
+
+inline std::uint32_t entity_index(Entity p_entity)
+{
+    return p_entity & ENTITY_INDEX_MASK;
+}
+
+struct TransformComponent
+{
+    unsigned int node; // Node in EntityRegistry::scene_graph
+};
+
+struct RenderableComponent
+{
+    unsigned int vao;
+    unsigned int vertices_count;
+    unsigned int texture_id;
+    GLenum       texture_target;
+    unsigned int texture_slot; // TextureArraySet slot, TEXTURE_SLOT_NONE for plain textures
+};
+
+// Marks an entity as selected. Entities sharing an id are outlined as one shape.
+struct SelectionComponent
+{
+    unsigned int selection_id; // 1 to SELECTION_MAX_ID, see SelectionOutline
+};
+
+struct BoundsComponent
+{
+    glm::vec3 local_center;
+    float     local_radius;
+    glm::vec3 world_center;
+    float     world_radius;
+};
+
+struct VisibilityComponent
+{
+    bool enabled;
+    bool in_frustum;
+};
+
+// Sparse set: components are packed in a dense array (iterated linearly by systems), and a sparse
+// array maps an entity index to its dense slot for O(1) lookup. Removal swaps the last element in.
+template <typename T>
+class ComponentPool
+{
+  public:
+    // Adding a component the entity already has overwrites it in place.
+    T& add(Entity p_entity, const T& p_component)
+    {
+        if (has(p_entity))
+        {
+            T& component = get(p_entity);
+            component    = p_component;
+            return component;
+        }
+
+        std::uint32_t index = entity_index(p_entity);
+        if (index >= sparse.size())
+        {
+            sparse.resize(index + 1, INVALID_SLOT);
+        }
+
+        sparse[index] = (std::uint32_t) dense_entities.size();
+        dense_entities.push_back(p_entity);
+        dense_components.push_back(p_component);
+
+        return dense_components.back();
+    }
+
+    void remove(Entity p_entity)
+    {
+        if (!has(p_entity))
+        {
+            return;
+        }
+
+        std::uint32_t slot = sparse[entity_index(p_entity)];
+        std::uint32_t last = (std::uint32_t) dense_entities.size() - 1;
+
+        dense_entities[slot] = dense_entities[last];
+        dense_components[slot] = dense_components[last];
+        sparse[entity_index(dense_entities[slot])] = slot;
+
+        dense_entities.pop_back();
+        dense_components.pop_back();
+        sparse[entity_index(p_entity)] = INVALID_SLOT;
+    }
+
+    bool has(Entity p_entity) const
+    {
+        std::uint32_t index = entity_index(p_entity);
+        return index < sparse.size() && sparse[index] != INVALID_SLOT && dense_entities[sparse[index]] == p_entity;
+    }
+
+    T& get(Entity p_entity)
+    {
+        return dense_components[sparse[entity_index(p_entity)]];
+    }
+
+    const T& get(Entity p_entity) const
+    {
+        return dense_components[sparse[entity_index(p_entity)]];
+    }
+
+    // Reorders the dense arrays by entity index. Pools that share entities then line up, so
+    // iterating one pool and looking up another walks both arrays front to back.
+    void sort_by_entity()
+    {
+        std::vector<std::uint32_t> order(dense_entities.size());
+        for (std::uint32_t i = 0; i < order.size(); i++)
+        {
+            order[i] = i;
+        }
+
+        std::sort(order.begin(), order.end(), [this](std::uint32_t a, std::uint32_t b)
+                  { return entity_index(dense_entities[a]) < entity_index(dense_entities[b]); });
+
+        std::vector<Entity> sorted_entities(order.size());
+        std::vector<T>      sorted_components(order.size());
+        for (std::uint32_t i = 0; i < order.size(); i++)
+        {
+            sorted_entities[i] = dense_entities[order[i]];
+            sorted_components[i] = dense_components[order[i]];
+            sparse[entity_index(sorted_entities[i])] = i;
+        }
+
+        dense_entities.swap(sorted_entities);
+        dense_components.swap(sorted_components);
+    }
+
+    void reserve(std::size_t p_count)
+    {
+        dense_entities.reserve(p_count);
+        dense_components.reserve(p_count);
+    }
+
+    std::size_t   size() const { return dense_entities.size(); }
+    const Entity* entities() const { return dense_entities.data(); }
+    T*            components() { return dense_components.data(); }
+    const T*      components() const { return dense_components.data(); }
+
+  private:
+    static constexpr std::uint32_t INVALID_SLOT = 0xFFFFFFFF;
+
+    std::vector<std::uint32_t> sparse;
+    std::vector<Entity>        dense_entities;
+    std::vector<T>             dense_components;
+};
+
+class EntityRegistry
+{
+  public:
+    ComponentPool<TransformComponent>  transforms;
+    ComponentPool<RenderableComponent> renderables;
+    ComponentPool<BoundsComponent>     bounds;
+    ComponentPool<VisibilityComponent> visibility;
+    ComponentPool<SelectionComponent>  selections;
+    SceneGraph                         scene_graph;
+
+    Entity create_entity();
+    // The entity's scene graph node is not reclaimed, the graph is append-only.
+    void   destroy_entity(Entity p_entity);
+    bool   is_alive(Entity p_entity) const;
+    void   reserve(std::size_t p_count);
+    void   compact();
+
+    // Convenience for the common case: a transformed, drawable object with a bounding sphere.
+    Entity create_render_object(const glm::mat4& p_local_matrix, const RenderableComponent& p_renderable,
+                                const glm::vec3& p_bounds_center, float p_bounds_radius);
+
+  private:
+    std::vector<std::uint8_t>  generations;
+    std::vector<std::uint32_t> free_indices;
+};
+
+// Systems. They walk the dense component arrays and split large ones across the job system.
+void update_transforms(EntityRegistry& p_registry);
+void cull_entities(EntityRegistry& p_registry, const Frustum& p_frustum);
+void submit_renderables(const EntityRegistry& p_registry, FramePacket& p_packet);
+void submit_selections(const EntityRegistry& p_registry, FramePacket& p_packet);
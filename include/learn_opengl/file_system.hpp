@@ -1,20 +1,75 @@
 #pragma once
 
-#include <string>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "learn_opengl/mapped_file.hpp"
+
+// Read-only bytes of one file, pointing straight into a memory mapping (no copy). Keeps the
+// mapping alive for as long as the view exists.
+class FileView
+{
+  public:
+    FileView();
 
+    bool                           is_valid() const;
+    const unsigned char*           data() const;
+    std::size_t                    size() const;
+    std::span<const unsigned char> bytes() const;
+    std::string_view               text() const;
+
+  private:
+    friend class FileSystem;
+
+    std::shared_ptr<MappedFile> mapping;
+    const unsigned char*        view_data;
+    std::size_t                 view_size;
+};
+
+// Virtual file system rooted at the project directory. Paths are relative to the root
+// ("shaders/vertex.glsl"). By default files are read loose from disk; mount_pack() switches to a
+// single memory-mapped archive built with build_pack(), falling back to loose files for anything
+// the archive does not contain.
 class FileSystem
 {
   public:
     static FileSystem&    get_instance();
+    FileSystem(const FileSystem&) = delete;
+    FileSystem&           operator=(const FileSystem&) = delete;
     std::filesystem::path get_root_path() const;
     std::filesystem::path get_path(const std::string path) const;
     void                  set_root_marker(const std::string root_marker);
 
+    bool         mount_pack(const std::filesystem::path& pack_path);
+    void         unmount_pack();
+    bool         exists(const std::string& path) const;
+    FileView     read_file(const std::string& path) const;
+    unsigned int get_files_opened() const;
+
+    // Packs every file under the given root-relative directories into one archive.
+    static bool build_pack(const std::filesystem::path& root, const std::vector<std::string>& directories,
+                           const std::filesystem::path& output);
+
   private:
     FileSystem();
     void find_root();
+    bool find_pack_entry(const std::string& path, std::uint64_t& offset, std::uint64_t& size) const;
 
     std::filesystem::path project_root;
     std::string           root_marker;
+
+    std::shared_ptr<MappedFile> pack;
+    const std::uint32_t*        pack_buckets;
+    const unsigned char*        pack_entries;
+    const char*                 pack_strings;
+    std::uint32_t               pack_bucket_count;
+
+    mutable std::atomic<unsigned int> files_opened;
 };
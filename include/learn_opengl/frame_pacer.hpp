@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vector>
+
+#include <glad/glad.h>
+
+const unsigned int DEFAULT_FRAMES_IN_FLIGHT = 2;
+const unsigned int MAX_FRAMES_IN_FLIGHT     = 8;
+const unsigned int LATENCY_HISTORY_SIZE     = 600;
+
+struct LatencyPercentiles
+{
+    unsigned int sample_count;
+    double       p50;
+    double       p90;
+    double       p99;
+    double       max;
+};
+
+// The last LATENCY_HISTORY_SIZE samples in milliseconds, oldest overwritten first. Needs no GL.
+class LatencyHistory
+{
+  public:
+    LatencyHistory();
+
+    void               add(double p_milliseconds);
+    LatencyPercentiles get_percentiles() const;
+
+  private:
+    std::vector<double> samples;
+    unsigned int        next;
+};
+
+// Caps how many frames the CPU may queue ahead of the GPU. A fence goes in after every swap, and
+// before building frame N the CPU waits for the fence of frame N - frames_in_flight. Without it the
+// driver picks how far to run ahead, and every queued frame is a frame of input latency.
+// GL thread only.
+class FramePacer
+{
+  public:
+    explicit FramePacer(unsigned int p_frames_in_flight = DEFAULT_FRAMES_IN_FLIGHT);
+    ~FramePacer();
+    FramePacer(const FramePacer&)            = delete;
+    FramePacer& operator=(const FramePacer&) = delete;
+
+    // Blocks until fewer than frames_in_flight frames are queued. Call before the frame's first GL command.
+    void wait_for_slot();
+    // Call right after the swap.
+    void end_frame();
+
+    unsigned int get_frames_in_flight() const;
+    // Time the last wait_for_slot() spent blocked, 0 if the GPU was already done.
+    double       get_last_wait_milliseconds() const;
+
+  private:
+    GLsync       fences[MAX_FRAMES_IN_FLIGHT];
+    unsigned int frames_in_flight;
+    unsigned int current;
+    double       last_wait_milliseconds;
+};
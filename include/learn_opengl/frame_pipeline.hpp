@@ -0,0 +1,116 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "glm/ext/matrix_float4x4.hpp"
+#include "glm/ext/vector_float3.hpp"
+#include "learn_opengl/camera.hpp"
+
+// One draw call worth of state. The model matrices live in FramePacket::instance_transforms,
+// starting at first_instance.
+struct DrawCommand
+{
+    unsigned int vao;
+    unsigned int vertices_count;
+    unsigned int texture_id;
+    GLenum       texture_target;
+    unsigned int texture_slot; // TextureArraySet slot, TEXTURE_SLOT_NONE for plain textures
+    unsigned int first_instance;
+    unsigned int instance_count;
+};
+
+// A selected object, drawn again into the selection mask by SelectionOutline.
+struct SelectionDraw
+{
+    unsigned int vao;
+    unsigned int vertices_count;
+    unsigned int selection_id;
+    glm::mat4    model_matrix;
+};
+
+// One mirror's reflection for this frame, see MirrorSystem. Its draws are mirror_draws[first_draw,
+// first_draw + draw_count), with their matrices in instance_transforms like the main draws.
+struct MirrorView
+{
+    unsigned int  mirror;
+    bool          visible; // Hidden mirrors carry no draws and keep no target
+    glm::mat4     model_matrix; // Unit quad to the mirror's rectangle
+    glm::mat4     view;
+    glm::mat4     projection; // Near plane on the mirror
+    int           target_width;
+    int           target_height;
+    int           scissor[4]; // x, y, width, height in the target, what the mirror covers on screen
+    std::uint64_t signature; // Changes whenever any of the above or the draws change
+    unsigned int  first_draw;
+    unsigned int  draw_count;
+};
+
+// Everything the render stage needs to draw one frame. Built by the simulation stage and
+// treated as immutable once submitted.
+struct FramePacket
+{
+    std::uint64_t frame_index;
+    double        simulation_time;
+
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec3 camera_position;
+    int       viewport_width;
+    int       viewport_height;
+
+    // The camera view and projection were built from, and when its input was sampled. The render
+    // stage may re-aim it with newer input (late latching).
+    Camera                                camera;
+    std::chrono::steady_clock::time_point input_time;
+
+    std::vector<DrawCommand>   draws;
+    std::vector<glm::mat4>     instance_transforms;
+    std::vector<SelectionDraw> selection_draws;
+    std::vector<MirrorView>    mirror_views;
+    std::vector<DrawCommand>   mirror_draws;
+
+    void clear();
+    void add_draw(unsigned int p_vao, unsigned int p_vertices_count, unsigned int p_texture_id,
+                  GLenum p_texture_target, unsigned int p_texture_slot, const glm::mat4& p_model_matrix);
+};
+
+// Fixed ring of frame packets shared between the simulation thread (producer) and the render
+// thread (consumer). The producer blocks once it is max_frames_ahead packets ahead of the renderer,
+// and packets are recycled so their vectors keep their capacity.
+class FramePipeline
+{
+  public:
+    explicit FramePipeline(unsigned int p_max_frames_ahead = 2);
+
+    FramePacket*       begin_build();
+    void               submit();
+    const FramePacket* acquire();
+    void               release();
+    void               stop();
+    bool               is_stopped();
+
+  private:
+    enum SlotState
+    {
+        SLOT_FREE,
+        SLOT_BUILDING,
+        SLOT_READY,
+        SLOT_RENDERING
+    };
+
+    std::vector<FramePacket> packets;
+    std::vector<SlotState>   slot_states;
+    unsigned int             write_index;
+    unsigned int             read_index;
+    std::uint64_t            next_frame_index;
+    bool                     stopped;
+
+    std::mutex              mutex;
+    std::condition_variable slot_changed;
+};
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glad/glad.h>
+
+const unsigned int DEFAULT_READBACK_LATENCY = 3; // Frames between a copy and its map
+const unsigned int MAX_READBACK_LATENCY     = 8;
+// Images waiting for the worker. Further frames are dropped rather than piling up memory.
+const unsigned int READBACK_MAX_QUEUED      = 8;
+// Largest per-channel difference (0-255) a pixel may have and still match its golden image.
+const int          DEFAULT_GOLDEN_TOLERANCE = 2;
+
+// One frame's pixels, rows bottom-up as GL returns them.
+struct ReadbackImage
+{
+    std::uint64_t             frame_index;
+    int                       width;
+    int                       height;
+    std::vector<std::uint8_t> color; // RGBA8
+    std::vector<float>        depth; // Empty unless depth readback is on
+};
+
+struct ImageComparison
+{
+    bool        size_matches;
+    int         max_difference;
+    std::size_t differing_pixels; // Pixels with a channel off by more than the tolerance
+};
+
+// Writes p_pixels (RGBA8, rows bottom-up) as a PNG with stored deflate blocks: no compression, but
+// no dependency and a fraction of the encoding time. Needs no GL.
+bool            write_png(const std::string& p_path, int p_width, int p_height, const std::uint8_t* p_pixels);
+// p_golden is compared in the same bottom-up order. Needs no GL.
+ImageComparison compare_images(const ReadbackImage& p_image, const std::vector<std::uint8_t>& p_golden,
+                               int p_golden_width, int p_golden_height, int p_tolerance);
+
+struct ReadbackWorkerStats
+{
+    std::uint64_t images_written;
+    std::uint64_t images_dropped; // Queue was full, or the size changed under a raw video
+    std::uint64_t golden_compared;
+    std::uint64_t golden_failed; // Over the tolerance, or no golden image to compare with
+};
+
+// CPU half: encodes, dumps or compares frames on its own thread, so the render thread only pays for
+// a copy. Frames are handed over with submit() and their buffers come back through acquire_buffer().
+// Needs no GL.
+class ReadbackWorker
+{
+  public:
+    ReadbackWorker();
+    ~ReadbackWorker();
+    ReadbackWorker(const ReadbackWorker&)            = delete;
+    ReadbackWorker& operator=(const ReadbackWorker&) = delete;
+
+    // Empty strings turn an output off. PNGs are <dir>/frame_<index>.png, the raw video is RGBA8
+    // frames back to back, top-down, and golden images are looked up with the PNG naming.
+    void set_png_directory(const std::string& p_directory);
+    void set_raw_video(const std::string& p_path);
+    void set_golden_directory(const std::string& p_directory, int p_tolerance);
+
+    // A recycled image to fill, so steady capture allocates nothing.
+    ReadbackImage acquire_buffer();
+    // Returns false and recycles p_image when the queue is full.
+    bool          submit(ReadbackImage&& p_image);
+    // Blocks until every submitted image has been processed.
+    void          flush();
+
+    ReadbackWorkerStats get_stats();
+    // Size of the raw video's frames, so it can be converted with ffmpeg. Read after flush().
+    int                 get_raw_width() const;
+    int                 get_raw_height() const;
+
+  private:
+    void run();
+    void process(const ReadbackImage& p_image);
+
+    std::string   png_directory;
+    std::string   raw_path;
+    std::ofstream raw_file;
+    int           raw_width;
+    int           raw_height;
+    std::string   golden_directory;
+    int           golden_tolerance;
+
+    std::deque<ReadbackImage>  queue;
+    std::vector<ReadbackImage> free_images;
+    std::vector<std::uint8_t>  flipped_rows;
+    bool                       busy;
+    bool                       stopping;
+    ReadbackWorkerStats        stats;
+
+    std::mutex              mutex;
+    std::condition_variable changed;
+    std::thread             thread;
+};
+
+struct FrameReadbackStats
+{
+    std::uint64_t frames_copied;
+    std::uint64_t frames_delivered;
+    std::uint64_t stalls;            // A slot's fence was not signaled when the ring came back to it
+    double        last_milliseconds; // Render thread time spent in the last capture()
+    double        max_milliseconds;
+};
+
+// GL half: copies framebuffer 0 into a ring of p_latency pixel pack buffers with glReadPixels, which
+// returns at once because the destination is a buffer. Each copy gets a fence and is mapped once it
+// has signaled, at the latest when the ring comes back to its slot, then handed to the worker. Depth
+// is framebuffer 0's, which dynamic resolution leaves empty. GL thread only.
+class FrameReadback
+{
+  public:
+    FrameReadback(ReadbackWorker& p_worker, unsigned int p_latency = DEFAULT_READBACK_LATENCY,
+                  bool p_read_depth = false);
+    ~FrameReadback();
+    FrameReadback(const FrameReadback&)            = delete;
+    FrameReadback& operator=(const FrameReadback&) = delete;
+
+    // Call after the frame's last draw, before the swap. Delivers the copies whose fences signaled,
+    // then starts this frame's.
+    void capture(std::uint64_t p_frame_index, int p_width, int p_height);
+    // Waits for every copy still in flight and delivers it.
+    void finish();
+
+    FrameReadbackStats get_stats() const;
+
+  private:
+    struct Slot
+    {
+        unsigned int  color_buffer;
+        unsigned int  depth_buffer;
+        GLsync        fence;
+        std::uint64_t frame_index;
+        int           width;
+        int           height;
+        std::size_t   capacity; // Pixels the buffers were allocated for
+    };
+
+    // With p_wait false, returns false if the copy is not done yet.
+    bool deliver(Slot& p_slot, bool p_wait);
+
+    ReadbackWorker&    worker;
+    std::vector<Slot>  slots;
+    unsigned int       next_slot;
+    bool               read_depth;
+    FrameReadbackStats stats;
+};
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "glm/ext/matrix_float4x4.hpp"
+#include "glm/ext/vector_float3.hpp"
+#include "glm/ext/vector_float4.hpp"
+
+enum FrustumPlane
+{
+    FRUSTUM_LEFT,
+    FRUSTUM_RIGHT,
+    FRUSTUM_BOTTOM,
+    FRUSTUM_TOP,
+    FRUSTUM_NEAR,
+    FRUSTUM_FAR
+};
+
+// Six inward-facing planes (xyz = normal, w = distance), a point p is inside when dot(n, p) + w >= 0.
+struct Frustum
+{
+    glm::vec4 planes[6];
+};
+
+Frustum make_frustum(const glm::mat4& p_view_projection);
+bool    sphere_in_frustum(const Frustum& p_frustum, const glm::vec3& p_center, float p_radius);
+bool    aabb_in_frustum(const Frustum& p_frustum, const glm::vec3& p_min, const glm::vec3& p_max);
+// Sphere enclosing an object-space box after p_matrix, scaled by the matrix's largest axis scale.
+void    get_bounding_sphere(const glm::mat4& p_matrix, const glm::vec3& p_min, const glm::vec3& p_max,
+                            glm::vec3& p_center, float& p_radius);
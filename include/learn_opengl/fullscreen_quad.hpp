@@ -0,0 +1,18 @@
+#pragma once
+
+// Two triangles covering clip space with texture coordinates, the input of shaders/quad_vertex.glsl.
+// Shared by the fullscreen passes. GL thread only.
+class FullscreenQuad
+{
+  public:
+    FullscreenQuad();
+    ~FullscreenQuad();
+    FullscreenQuad(const FullscreenQuad&)            = delete;
+    FullscreenQuad& operator=(const FullscreenQuad&) = delete;
+
+    void draw() const;
+
+  private:
+    unsigned int vao;
+    unsigned int vbo;
+};
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "glm/ext/matrix_float4x4.hpp"
+#include "glm/ext/vector_float3.hpp"
+
+const char          GL_CAPTURE_MAGIC[4]  = {'L', 'O', 'G', 'C'};
+const std::uint32_t GL_CAPTURE_VERSION   = 2;
+const std::uint32_t GL_CAPTURE_NO_RESULT = 0xFFFFFFFF;
+
+// Capture file layout: GlCaptureHeader, then commands until the end of the file. Every command is
+// a GlCaptureCommand followed by `size` payload bytes: 32-bit arguments in call order, then an
+// optional blob (buffer contents, texture pixels, shader source, uniform names).
+struct GlCaptureHeader
+{
+    char          magic[4];
+    std::uint32_t version;
+    std::uint32_t first_frame;
+    std::uint32_t frame_count;
+    std::uint64_t command_bytes;
+};
+
+struct GlCaptureCommand
+{
+    std::uint16_t opcode;
+    std::uint16_t reserved;
+    std::uint32_t size;
+};
+
+enum GlCaptureOpcode : std::uint16_t
+{
+    // Markers written by the engine, not GL calls
+    CAPTURE_FRAME_BEGIN,
+    CAPTURE_FRAME_END,
+    CAPTURE_PASS_BEGIN,
+
+    // Object lifetime
+    CAPTURE_GEN_BUFFERS,
+    CAPTURE_DELETE_BUFFERS,
+    CAPTURE_GEN_TEXTURES,
+    CAPTURE_DELETE_TEXTURES,
+    CAPTURE_GEN_VERTEX_ARRAYS,
+    CAPTURE_DELETE_VERTEX_ARRAYS,
+    CAPTURE_GEN_FRAMEBUFFERS,
+    CAPTURE_DELETE_FRAMEBUFFERS,
+    CAPTURE_GEN_RENDERBUFFERS,
+    CAPTURE_DELETE_RENDERBUFFERS,
+    CAPTURE_CREATE_SHADER,
+    CAPTURE_DELETE_SHADER,
+    CAPTURE_SHADER_SOURCE,
+    CAPTURE_COMPILE_SHADER,
+    CAPTURE_CREATE_PROGRAM,
+    CAPTURE_DELETE_PROGRAM,
+    CAPTURE_ATTACH_SHADER,
+    CAPTURE_LINK_PROGRAM,
+    CAPTURE_GET_UNIFORM_LOCATION,
+
+    // Bindings and fixed-function state
+    CAPTURE_BIND_BUFFER,
+    CAPTURE_BIND_TEXTURE,
+    CAPTURE_BIND_VERTEX_ARRAY,
+    CAPTURE_BIND_FRAMEBUFFER,
+    CAPTURE_BIND_RENDERBUFFER,
+    CAPTURE_ACTIVE_TEXTURE,
+    CAPTURE_USE_PROGRAM,
+    CAPTURE_ENABLE,
+    CAPTURE_DISABLE,
+    CAPTURE_DEPTH_FUNC,
+    CAPTURE_DEPTH_MASK,
+    CAPTURE_COLOR_MASK,
+    CAPTURE_CLEAR_COLOR,
+    CAPTURE_VIEWPORT,
+    CAPTURE_BLEND_FUNC,
+    CAPTURE_CULL_FACE,
+    CAPTURE_PIXEL_STORE,
+    CAPTURE_STENCIL_FUNC,
+    CAPTURE_STENCIL_OP,
+    CAPTURE_STENCIL_MASK,
+
+    // Resource contents and layout
+    CAPTURE_BUFFER_DATA,
+    CAPTURE_BUFFER_SUB_DATA,
+    CAPTURE_TEX_IMAGE_2D,
+    CAPTURE_TEX_IMAGE_3D,
+    CAPTURE_TEX_SUB_IMAGE_2D,
+    CAPTURE_TEX_PARAMETER_I,
+    CAPTURE_GENERATE_MIPMAP,
+    CAPTURE_TEX_BUFFER,
+    CAPTURE_VERTEX_ATTRIB_POINTER,
+    CAPTURE_VERTEX_ATTRIB_I_POINTER,
+    CAPTURE_VERTEX_ATTRIB_DIVISOR,
+    CAPTURE_ENABLE_VERTEX_ATTRIB_ARRAY,
+    CAPTURE_DISABLE_VERTEX_ATTRIB_ARRAY,
+    CAPTURE_FRAMEBUFFER_TEXTURE_2D,
+    CAPTURE_FRAMEBUFFER_RENDERBUFFER,
+    CAPTURE_RENDERBUFFER_STORAGE,
+
+    // Uniforms, locations are the captured ones and get remapped on replay
+    CAPTURE_UNIFORM_1I,
+    CAPTURE_UNIFORM_1F,
+    CAPTURE_UNIFORM_2FV,
+    CAPTURE_UNIFORM_3FV,
+    CAPTURE_UNIFORM_4FV,
+    CAPTURE_UNIFORM_MATRIX_3FV,
+    CAPTURE_UNIFORM_MATRIX_4FV,
+
+    // Work
+    CAPTURE_CLEAR,
+    CAPTURE_DRAW_ARRAYS,
+    CAPTURE_DRAW_ELEMENTS,
+    CAPTURE_DRAW_ARRAYS_INSTANCED,
+    CAPTURE_DRAW_ELEMENTS_INSTANCED,
+
+    // Appended rather than grouped above, so existing opcodes keep their values and older captures
+    // still replay
+    CAPTURE_SCISSOR,
+    CAPTURE_BIND_BUFFER_RANGE,
+    CAPTURE_UNIFORM_BLOCK_BINDING,
+    CAPTURE_MULTI_DRAW_ELEMENTS,
+
+    CAPTURE_OPCODE_COUNT
+};
+
+// Records the GL calls the engine makes, with the data they upload, by swapping glad's function
+// pointers for recording wrappers. Recording starts before any object exists, so the file carries
+// everything needed to rebuild state. Frames before the range keep their state changes but drop
+// their draws and clears, since those only touch pixels the range redraws anyway. Indices and
+// vertex attribute pointers are assumed to be buffer offsets, never client memory. GL thread only.
+class GlCapture
+{
+  public:
+    static GlCapture& get_instance();
+    GlCapture(const GlCapture&)            = delete;
+    GlCapture& operator=(const GlCapture&) = delete;
+
+    // Call right after the GL loader, before the first GL object is created.
+    void start(const std::string& p_path, unsigned int p_first_frame, unsigned int p_frame_count);
+    bool is_recording() const;
+
+    void begin_frame(const glm::mat4& p_view, const glm::mat4& p_projection, const glm::vec3& p_camera_position,
+                     int p_viewport_width, int p_viewport_height);
+    // Starts a named pass, the replay times every pass separately.
+    void mark_pass(const char* p_name);
+    // Writes the file and unhooks once the last captured frame ends.
+    void end_frame();
+
+    // Used by the recording wrappers.
+    void begin_command(GlCaptureOpcode p_opcode);
+    void write_word(std::uint32_t p_word);
+    void write_float(float p_value);
+    void write_u64(std::uint64_t p_value);
+    void write_blob(const void* p_data, std::size_t p_size);
+    void end_command();
+    bool is_in_range() const;
+    int  get_unpack_alignment() const;
+    void set_unpack_alignment(int p_alignment);
+
+  private:
+    GlCapture();
+    void install_hooks();
+    void remove_hooks();
+    bool write_file();
+
+    std::string                path;
+    unsigned int               first_frame;
+    unsigned int               frame_count;
+    unsigned int               current_frame;
+    bool                       recording;
+    int                        unpack_alignment;
+    std::vector<unsigned char> stream;
+    std::size_t                command_start;
+    bool                       command_skipped;
+};
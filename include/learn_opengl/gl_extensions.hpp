@@ -0,0 +1,45 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// GL 4.3 enums and entry points used by the optional GPU-driven paths. The bundled glad loader is
+// generated for 3.3 core only, so these are declared here and loaded by load_gl_extensions().
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+#ifndef GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT
+#define GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT 0x00000001
+#endif
+#ifndef GL_COMMAND_BARRIER_BIT
+#define GL_COMMAND_BARRIER_BIT 0x00000040
+#endif
+#ifndef GL_SHADER_STORAGE_BARRIER_BIT
+#define GL_SHADER_STORAGE_BARRIER_BIT 0x00002000
+#endif
+
+typedef void(APIENTRYP PFN_DISPATCH_COMPUTE)(GLuint p_groups_x, GLuint p_groups_y, GLuint p_groups_z);
+typedef void(APIENTRYP PFN_MEMORY_BARRIER)(GLbitfield p_barriers);
+typedef void(APIENTRYP PFN_MULTI_DRAW_ELEMENTS_INDIRECT)(GLenum p_mode, GLenum p_type, const void* p_indirect,
+                                                         GLsizei p_draw_count, GLsizei p_stride);
+
+struct GlExtensions
+{
+    // Context version, as reported by the driver rather than the version that was asked for.
+    int  major_version;
+    int  minor_version;
+    bool has_gl43; // Every pointer below is set
+
+    PFN_DISPATCH_COMPUTE             dispatch_compute;
+    PFN_MEMORY_BARRIER               memory_barrier;
+    PFN_MULTI_DRAW_ELEMENTS_INDIRECT multi_draw_elements_indirect;
+};
+
+// Call once after gladLoadGLLoader with the same loader. Returns whether the 4.3 paths can be used.
+bool                load_gl_extensions(GLADloadproc p_loader);
+const GlExtensions& get_gl_extensions();
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <string>
+
+// Replays a file written by GlCapture in a hidden window, into an offscreen framebuffer, so runs do
+// not depend on the desktop or vsync. Everything before the captured range is executed once to
+// rebuild state, then the range is played p_repeats times with a GPU timer per marked pass. Prints
+// per-pass timings and a hash of the final image, which is identical between runs on the same
+// driver. Run with `main --replay <file>`. Returns the process exit code.
+int run_replay(const std::string& p_path, unsigned int p_repeats);
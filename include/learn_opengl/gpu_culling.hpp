@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "glm/ext/matrix_float4x4.hpp"
+#include "learn_opengl/model.hpp"
+#include "learn_opengl/shader.hpp"
+
+// Threads per compute work group in shaders/cull_compute.glsl.
+const unsigned int GPU_CULLING_GROUP_SIZE = 64;
+
+struct GpuCullingStats
+{
+    unsigned int instance_count;
+    unsigned int item_count; // Instances times meshes, one culling thread each
+    unsigned int command_count;
+    unsigned int draw_calls; // Indirect draws issued per frame, one per material
+};
+
+// GPU-driven drawing of many instances of one Model (GL 4.3+, see load_gl_extensions()). The meshes
+// are copied into one vertex and one index buffer at construction. Each frame a compute shader
+// tests every (instance, mesh) pair against the frustum and appends survivors to per-mesh draw
+// commands, which are drawn with one glMultiDrawElementsIndirect per material. The CPU cost per
+// frame does not depend on the number of instances. Use Model::draw_instances() on 3.3 contexts.
+class GpuCulling
+{
+  public:
+    explicit GpuCulling(Model& p_model);
+    ~GpuCulling();
+    GpuCulling(const GpuCulling&)            = delete;
+    GpuCulling& operator=(const GpuCulling&) = delete;
+
+    // Instances are static until the next call, which re-uploads everything.
+    void set_instances(const std::vector<glm::mat4>& p_instances);
+    // p_shader must be a permutation of the "model_indirect" program.
+    void draw(Shader& p_shader, const glm::mat4& p_view, const glm::mat4& p_projection);
+
+    GpuCullingStats get_stats() const;
+
+  private:
+    // Matches DrawElementsIndirectCommand and the DrawCommand struct in the compute shader.
+    struct DrawCommand
+    {
+        std::uint32_t count;
+        std::uint32_t instance_count;
+        std::uint32_t first_index;
+        std::int32_t  base_vertex;
+        std::uint32_t base_instance;
+    };
+
+    // Matches CullItem in the compute shader (std430).
+    struct CullItem
+    {
+        float         sphere[4]; // World-space center and radius
+        std::uint32_t command;
+        std::uint32_t padding[3];
+    };
+
+    // Run of commands sharing a material, drawn by one indirect call.
+    struct MaterialBatch
+    {
+        unsigned int material; // ID in the model's MaterialTable
+        unsigned int first_command;
+        unsigned int command_count;
+    };
+
+    enum
+    {
+        VERTEX_BUFFER,
+        INDEX_BUFFER,
+        TRANSFORM_BUFFER,
+        ITEM_BUFFER,
+        COMMAND_BUFFER,
+        VISIBLE_BUFFER,
+        BUFFER_COUNT
+    };
+
+    void upload(unsigned int p_buffer, unsigned int p_target, const void* p_data, std::size_t p_bytes);
+
+    Model&                     model;
+    Shader                     cull_shader;
+    unsigned int               vao;
+    unsigned int               buffers[BUFFER_COUNT];
+    std::vector<unsigned int>  command_meshes; // Mesh index of each command, grouped by material
+    std::vector<DrawCommand>   commands;       // Reset template, instance counts at zero
+    std::vector<MaterialBatch> batches;
+    unsigned int               instance_count;
+    unsigned int               item_count;
+};
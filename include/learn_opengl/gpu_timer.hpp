@@ -0,0 +1,30 @@
+#pragma once
+
+const unsigned int GPU_TIMER_LATENCY = 3;
+
+// Measures GPU time between begin() and end() with GL_TIME_ELAPSED queries. Results are read a few
+// frames later from a ring of queries, so reading never stalls the pipeline. Only one timer can be
+// running at a time (GL does not nest elapsed-time queries).
+class GpuTimer
+{
+  public:
+    GpuTimer();
+    ~GpuTimer();
+    GpuTimer(const GpuTimer&)            = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+
+    void begin();
+    void end();
+
+    // Most recent finished measurement, 0 until the first one is available.
+    double       get_milliseconds() const;
+    // Counts finished measurements, so callers can tell a new result from the previous one.
+    unsigned int get_result_count() const;
+
+  private:
+    unsigned int queries[GPU_TIMER_LATENCY];
+    bool         pending[GPU_TIMER_LATENCY];
+    unsigned int current;
+    double       last_milliseconds;
+    unsigned int result_count;
+};
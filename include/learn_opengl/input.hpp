@@ -0,0 +1,38 @@
+#pragma once
+
+#include <mutex>
+
+#include "learn_opengl/camera.hpp"
+
+// Input gathered on the window thread since the last time the simulation consumed it.
+struct InputSnapshot
+{
+    bool  movement[CAMERA_MOVEMENT_COUNT];
+    float mouse_x_offset;
+    float mouse_y_offset;
+    float scroll_y_offset;
+    bool  reset_fov;
+    int   framebuffer_width;
+    int   framebuffer_height;
+};
+
+// GLFW callbacks must run on the main thread while the camera lives on the simulation thread,
+// so input is accumulated here and handed over as a snapshot.
+class InputState
+{
+  public:
+    InputState(int p_framebuffer_width, int p_framebuffer_height);
+
+    void          set_movement(CameraMovement p_direction, bool p_pressed);
+    void          add_mouse_movement(float p_x_offset, float p_y_offset);
+    void          add_mouse_scroll(float p_y_offset);
+    void          request_fov_reset();
+    void          set_framebuffer_size(int p_width, int p_height);
+    InputSnapshot consume();
+    // The input not consumed yet, left in place for the simulation.
+    InputSnapshot peek();
+
+  private:
+    std::mutex    mutex;
+    InputSnapshot pending;
+};
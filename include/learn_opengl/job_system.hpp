@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+enum JobAffinity
+{
+    JOB_ANY_THREAD,
+    JOB_MAIN_THREAD // For work that touches the GL context, only run by run_main_thread_jobs()/wait() on main
+};
+
+struct Job
+{
+    std::function<void()> function;
+    std::shared_ptr<Job>  parent;
+    JobAffinity           affinity;
+
+    // 1 for the job itself plus one per unfinished child. The job is finished when this reaches 0.
+    std::atomic<int> unfinished;
+};
+
+using JobHandle = std::shared_ptr<Job>;
+
+struct JobCounters
+{
+    std::uint64_t jobs_executed;
+    std::uint64_t main_thread_jobs_executed;
+    std::uint64_t steal_attempts;
+    std::uint64_t steals;
+    std::uint64_t lock_contentions;
+};
+
+// Work-stealing scheduler. Every worker owns a deque, pops its own work from the back and steals
+// from the front of the others when it runs dry. Threads that wait() on a job help execute work
+// instead of blocking.
+class JobSystem
+{
+  public:
+    static JobSystem& get_instance();
+
+    explicit JobSystem(unsigned int p_worker_count);
+    ~JobSystem();
+
+    JobHandle create_job(std::function<void()> p_function, const JobHandle& p_parent = nullptr,
+                         JobAffinity p_affinity = JOB_ANY_THREAD);
+    void      run(const JobHandle& p_job);
+    void      wait(const JobHandle& p_job);
+    bool      is_finished(const JobHandle& p_job) const;
+
+    // Splits [p_begin, p_end) into chunks of at most p_grain_size and blocks until all are done.
+    void parallel_for(std::size_t p_begin, std::size_t p_end, std::size_t p_grain_size,
+                      const std::function<void(std::size_t begin, std::size_t end)>& p_body);
+
+    void         run_main_thread_jobs();
+    unsigned int get_worker_count() const;
+    JobCounters  get_counters() const;
+    void         reset_counters();
+
+  private:
+    struct WorkQueue
+    {
+        std::deque<JobHandle> jobs;
+        std::mutex            mutex;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread>                workers;
+    WorkQueue                               main_queue;
+    std::thread::id                         main_thread_id;
+    std::atomic<unsigned int>               next_queue;
+
+    std::atomic<bool>       stopping;
+    std::atomic<int>        pending_jobs;
+    std::mutex              sleep_mutex;
+    std::condition_variable wake_up;
+
+    std::atomic<std::uint64_t> jobs_executed;
+    std::atomic<std::uint64_t> main_thread_jobs_executed;
+    std::atomic<std::uint64_t> steal_attempts;
+    std::atomic<std::uint64_t> steals;
+    std::atomic<std::uint64_t> lock_contentions;
+
+    void      worker_loop(unsigned int p_index);
+    int       current_worker_index() const;
+    JobHandle pop_local(int p_worker_index);
+    JobHandle steal(int p_thief_index);
+    JobHandle pop_main_thread_job();
+    JobHandle find_job();
+    void      execute(const JobHandle& p_job);
+    void      finish(const JobHandle& p_job);
+    void      lock_queue(std::unique_lock<std::mutex>& p_lock);
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+// Read-only memory mapping of a whole file. Unmapped on destruction.
+class MappedFile
+{
+  public:
+    MappedFile();
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool                 open(const std::filesystem::path& p_path);
+    void                 close();
+    bool                 is_open() const;
+    const unsigned char* data() const;
+    std::size_t          size() const;
+
+  private:
+    const unsigned char* mapped_data;
+    std::size_t          mapped_size;
+    bool                 opened;
+#if defined(_WIN32)
+    void* file_handle;
+    void* mapping_handle;
+#endif
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "glm/ext/vector_float4.hpp"
+#include "learn_opengl/shader.hpp"
+
+// Texture unit of each material sampler, the same in every program. The units above are taken by the
+// virtual texture pages (see virtual_texture.hpp).
+enum MaterialSampler
+{
+    MATERIAL_SAMPLER_DIFFUSE,
+    MATERIAL_SAMPLER_SPECULAR,
+    MATERIAL_SAMPLER_COUNT
+};
+
+// Uniform buffer binding point of MaterialBlock in shaders/include/material.glsl.
+const unsigned int MATERIAL_BLOCK_BINDING = 0;
+
+const unsigned int MATERIAL_NONE = ~0u;
+
+// Matches MaterialBlock (std140).
+struct MaterialParameters
+{
+    glm::vec4     diffuse_color;  // Used where there is no diffuse map, alpha is the opacity
+    glm::vec4     specular_color; // w is the shininess
+    std::uint32_t has_diffuse_map;
+    std::uint32_t has_specular_map;
+    std::uint32_t padding[2];
+};
+
+struct Material
+{
+    unsigned int       textures[MATERIAL_SAMPLER_COUNT]; // 0 where the material has no such map
+    unsigned int       virtual_texture;                  // VIRTUAL_TEXTURE_NONE unless the diffuse map streams
+    MaterialParameters parameters;
+};
+
+struct MaterialBindStats
+{
+    unsigned int material_binds;
+    unsigned int skipped_binds; // The material was still bound from the previous draw
+    unsigned int texture_binds;
+};
+
+// Materials resolved at load time. Every material's parameters sit in one uniform buffer, so binding one
+// is a buffer range and the textures that differ from the previous material, with no uniform lookups.
+// GL thread only.
+class MaterialTable
+{
+  public:
+    MaterialTable();
+    ~MaterialTable();
+    MaterialTable(const MaterialTable&)            = delete;
+    MaterialTable& operator=(const MaterialTable&) = delete;
+
+    // Returns the material's ID. Call upload() once every material is in.
+    unsigned int    add(const Material& p_material);
+    void            upload();
+    const Material& get(unsigned int p_material) const;
+    unsigned int    get_count() const;
+
+    // Points p_shader's samplers at their units and its MaterialBlock at MATERIAL_BLOCK_BINDING. Both are
+    // program state, so the work happens on the first call per program.
+    void prepare(Shader& p_shader);
+    // Forgets what is bound, call before a run of draws since other code may have used the units since.
+    void reset_bindings();
+    // False when p_material was already bound and nothing changed.
+    bool bind(unsigned int p_material);
+
+    // Since the last reset_bindings().
+    MaterialBindStats get_stats() const;
+
+  private:
+    std::vector<Material>     materials;
+    unsigned int              buffer;
+    std::size_t               stride; // Bytes between materials, a multiple of the range offset alignment
+    std::vector<unsigned int> prepared_programs;
+    unsigned int              bound_material;
+    unsigned int              bound_textures[MATERIAL_SAMPLER_COUNT];
+    MaterialBindStats         stats;
+};
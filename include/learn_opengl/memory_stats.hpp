@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+struct MemoryUsage
+{
+    std::size_t resident_bytes;
+    std::size_t peak_resident_bytes;
+};
+
+// Resident set size of the process, zeros where the platform query is not implemented.
+MemoryUsage get_memory_usage();
+std::string format_bytes(std::size_t p_bytes);
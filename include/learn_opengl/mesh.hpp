@@ -1,18 +1,31 @@
 #pragma once
 
-#include "learn_opengl/shader.hpp"
 #include <glm/ext/vector_float3.hpp>
 #include <glm/ext/vector_float2.hpp>
 #include <glm/glm.hpp>
+#include "learn_opengl/meshlet.hpp"
+#include <cstdint>
 #include <string>
 #include <vector>
 struct Vertex
 {
     glm::vec3 position;
-    glm::vec2 normal;
+    glm::vec3 normal;
     glm::vec2 tex_coords;
 };
 
+// Bone indices are stored in a byte.
+const unsigned int MAX_SKELETON_BONES  = 256;
+const unsigned int MAX_BONE_INFLUENCES = 4;
+
+// The strongest influences of a vertex, a second vertex stream beside Vertex. Weights are in 255ths
+// and sum to 255, unused slots have a zero weight.
+struct SkinWeights
+{
+    std::uint8_t bones[MAX_BONE_INFLUENCES];
+    std::uint8_t weights[MAX_BONE_INFLUENCES];
+};
+
 struct Texture
 {
     unsigned int id;
@@ -23,15 +36,47 @@ struct Texture
 class Mesh
 {
   public:
+    // Empty after upload when the mesh was created GPU-only.
     std::vector<Vertex>       vertices;
     std::vector<unsigned int> indices;
-    std::vector<Texture>      textures;
+    unsigned int              material; // ID in the owning model's MaterialTable
+    // Ranges of the indices, kept even when the CPU geometry is released.
+    std::vector<Meshlet>      meshlets;
+    // Empty for meshes without bones, and after upload when the mesh was created GPU-only.
+    std::vector<SkinWeights>  skin_weights;
+
+    // Object-space bounding box, kept even when the CPU geometry is released.
+    glm::vec3 bounds_min;
+    glm::vec3 bounds_max;
 
-    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures);
-    void draw(Shader& shader);
+    Mesh(std::vector<Vertex>&& vertices, std::vector<unsigned int>&& indices, unsigned int p_material,
+         bool gpu_only = false);
+    // Geometry only, the owner binds the material first (see MaterialTable::bind()).
+    void         draw();
+    // Index ranges in bytes, as cull_meshlets() lists them, in one glMultiDrawElements.
+    void         draw_ranges(const MeshletDrawList& p_draws);
+    // Draws p_vertices, e.g. skinned on the CPU, from a streaming buffer beside the static one.
+    void         draw_streamed(const std::vector<Vertex>& p_vertices);
+    // Uploads the weights as attributes 3 (bone indices) and 4 (weights) of the mesh's vertex array.
+    void         set_skin_weights(std::vector<SkinWeights>&& p_weights);
+    bool         is_skinned() const;
+    unsigned int get_index_count() const;
+    unsigned int get_vertex_count() const;
+    // GL buffers holding the vertices and indices, valid even after release_cpu_geometry().
+    unsigned int get_vertex_buffer() const;
+    unsigned int get_index_buffer() const;
+    void         release_cpu_geometry();
+    // Deletes the GL objects. Not a destructor because meshes are moved around during import.
+    void         destroy();
 
   private:
     unsigned int VAO, VBO, EBO;
+    unsigned int weight_buffer;
+    unsigned int stream_VAO, stream_VBO; // Created by the first draw_streamed()
+    unsigned int index_count;
+    unsigned int vertex_count;
 
     void setup_mesh();
+    void setup_vertex_attributes();
+    void compute_bounds();
 };
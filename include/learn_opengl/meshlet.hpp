@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "glm/ext/matrix_float4x4.hpp"
+#include "glm/ext/vector_float3.hpp"
+#include "learn_opengl/frustum.hpp"
+
+struct Vertex;
+
+// Triangles per meshlet. A run of similarly facing triangles is split into equal meshlets of at most
+// this many, so only runs shorter than half of it give smaller ones.
+const unsigned int MESHLET_MAX_TRIANGLES = 128;
+// Normal cones wider than acos(this) are never back-facing as a whole, those meshlets skip the test.
+const float        MESHLET_MIN_CONE_DOT  = 0.1f;
+
+// A contiguous range of a mesh's indices with its bounds, all in object space.
+struct Meshlet
+{
+    glm::vec3    center;
+    float        radius;
+    glm::vec3    cone_axis;   // Average face normal
+    float        cone_cutoff; // Sine of the widest angle to the axis, 1 when the cone test never culls
+    unsigned int first_index;
+    unsigned int index_count;
+};
+
+// Surviving index ranges, neighbours merged, ready for glMultiDrawElements.
+struct MeshletDrawList
+{
+    std::vector<int>         counts; // GLsizei
+    std::vector<const void*> offsets;
+};
+
+struct MeshletCullStats
+{
+    std::size_t  meshlets_tested;
+    std::size_t  frustum_culled;
+    std::size_t  cone_culled;    // Facing away from the camera
+    std::size_t  mesh_triangles; // Of every mesh that passed the per-mesh test, what drawing them whole submits
+    std::size_t  triangles_submitted;
+    unsigned int draw_calls;
+};
+
+// Reorders p_indices so each meshlet is one contiguous range, and fills p_meshlets. Triangles are
+// grouped by the axis their face normal leans to most, then along a Morton curve through their
+// centroids, which keeps both the spheres and the cones tight. Needs no GL.
+void build_meshlets(const Vertex* p_vertices, std::vector<unsigned int>& p_indices, std::vector<Meshlet>& p_meshlets);
+
+// Appends the ranges of the meshlets inside p_frustum that face p_camera_position (world space) after
+// p_model_matrix. The cone test follows the winding, so it only drops what GL_CULL_FACE with GL_BACK
+// would, and is skipped for mirroring matrices. Needs no GL.
+void cull_meshlets(const std::vector<Meshlet>& p_meshlets, const glm::mat4& p_model_matrix, const Frustum& p_frustum,
+                   const glm::vec3& p_camera_position, MeshletDrawList& p_draws, MeshletCullStats& p_stats);
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "glm/ext/matrix_float4x4.hpp"
+#include "glm/ext/vector_float3.hpp"
+#include "glm/ext/vector_float4.hpp"
+#include "learn_opengl/entity_registry.hpp"
+#include "learn_opengl/frame_pipeline.hpp"
+#include "learn_opengl/frustum.hpp"
+#include "learn_opengl/fullscreen_quad.hpp"
+#include "learn_opengl/shader.hpp"
+
+const float DEFAULT_MIRROR_RESOLUTION_SCALE = 0.5f;
+const float MIRROR_MIN_RESOLUTION_SCALE     = 0.1f;
+// Mirrors covering fewer pixels than this are not worth a reflection.
+const float DEFAULT_MIRROR_MIN_SCREEN_PIXELS = 32.0f * 32.0f;
+// Extra texels rendered around the mirror's rectangle, so bilinear filtering at its edge reads valid texels.
+const int   MIRROR_SCISSOR_MARGIN = 2;
+
+// A flat rectangular mirror, reflecting what is on the side its normal points to.
+struct Mirror
+{
+    glm::vec3 center;
+    glm::vec3 normal;
+    glm::vec3 up;
+    float     half_width;
+    float     half_height;
+    float     resolution_scale; // Of the reflection target relative to the viewport
+};
+
+// The reflected view is the real scene seen from the camera mirrored through the plane, limited to
+// the pyramid from the mirrored eye through the mirror's edges. Needs no GL.
+Frustum make_mirror_frustum(const glm::vec3& p_mirrored_eye, const glm::vec3 p_corners[4],
+                            const glm::vec4& p_mirror_plane, float p_far_distance);
+// Moves the near plane of p_projection onto p_view_plane (view space), so nothing behind the mirror
+// is drawn into the reflection (Lengyel's oblique near plane).
+glm::mat4 make_oblique_projection(const glm::mat4& p_projection, const glm::vec4& p_view_plane);
+
+// CPU half, runs in the scene builder on the simulation thread: decides which mirrors are worth a
+// reflection this frame, culls the scene for each one and signs the result so the renderer can tell
+// whether anything changed.
+class MirrorSystem
+{
+  public:
+    MirrorSystem();
+
+    unsigned int add(const Mirror& p_mirror);
+    void         set_min_screen_pixels(float p_pixels);
+
+    // Needs the packet's camera fields and the registry's world bounds to be up to date.
+    void submit(const EntityRegistry& p_registry, FramePacket& p_packet) const;
+
+    const std::vector<Mirror>& get_mirrors() const;
+
+  private:
+    std::vector<Mirror> mirrors;
+    float               min_screen_pixels;
+};
+
+struct MirrorStats
+{
+    unsigned int mirror_count;
+    unsigned int rendered; // Reflections redrawn this frame
+    unsigned int reused;   // Visible, nothing changed, last target kept
+    unsigned int skipped;  // Off-screen, facing away or too small
+    unsigned int pool_targets;
+    std::size_t  pool_bytes;
+};
+
+// Draws the scene for one reflection, with the view's matrices into the bound target.
+using MirrorSceneDrawer = std::function<void(const MirrorView& p_view)>;
+
+// GL half: keeps one pooled render target per visible mirror and redraws it only when its view's
+// signature changed. Mirrors that drop out hand their target back to the pool for others of the same
+// size. GL thread only.
+class MirrorRenderer
+{
+  public:
+    MirrorRenderer();
+    ~MirrorRenderer();
+    MirrorRenderer(const MirrorRenderer&)            = delete;
+    MirrorRenderer& operator=(const MirrorRenderer&) = delete;
+
+    // Leaves framebuffer 0 bound.
+    void update(const FramePacket& p_packet, const MirrorSceneDrawer& p_draw_scene);
+    // Draws the visible mirrors with p_shader, a permutation of the "mirror" program.
+    void draw(const FramePacket& p_packet, Shader& p_shader, const glm::mat4& p_view);
+
+    MirrorStats get_stats() const;
+
+  private:
+    struct RenderTarget
+    {
+        unsigned int framebuffer;
+        unsigned int color_texture;
+        unsigned int depth_renderbuffer;
+        int          width;
+        int          height;
+        bool         in_use;
+    };
+
+    struct MirrorState
+    {
+        int           target; // Index into pool, -1 for none
+        std::uint64_t signature;
+        bool          valid;
+    };
+
+    int  acquire_target(int p_width, int p_height);
+    void release_target(MirrorState& p_state);
+
+    std::vector<RenderTarget> pool;
+    std::vector<MirrorState>  states;
+    FullscreenQuad            quad;
+    MirrorStats               stats;
+};
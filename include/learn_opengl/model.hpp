@@ -1,28 +1,130 @@
 #pragma once
 
+#include "learn_opengl/animation.hpp"
+#include "learn_opengl/frustum.hpp"
+#include "learn_opengl/job_system.hpp"
+#include "learn_opengl/material.hpp"
 #include "learn_opengl/mesh.hpp"
+#include "learn_opengl/meshlet.hpp"
+#include "learn_opengl/scene_graph.hpp"
 #include "learn_opengl/shader.hpp"
 #include <assimp/material.h>
 #include <assimp/mesh.h>
 #include <assimp/scene.h>
+#include <glm/ext/matrix_float4x4.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <cstddef>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+// Vertices converted per job, so a single large mesh still spreads over the workers.
+const unsigned int MESH_IMPORT_VERTEX_GRAIN = 16384;
+
+class VirtualTextureSystem;
+
+// One mesh converted from Assimp, before any GL object exists.
+struct MeshData
+{
+    unsigned int              source_mesh; // Index into aiScene::mMeshes
+    unsigned int              node;        // Node it is attached to, in the model's scene graph
+    std::vector<Vertex>       vertices;
+    std::vector<unsigned int> indices;
+    std::vector<Meshlet>      meshlets;    // Built after conversion, reordering the indices
+};
+
+struct ModelImportStats
+{
+    unsigned int mesh_count;
+    std::size_t  vertex_count;
+    unsigned int threads;
+    double       convert_milliseconds; // Geometry conversion, spread over the job system
+    std::size_t  meshlet_count;
+    double       meshlet_milliseconds; // Clustering, one job per mesh
+    double       upload_milliseconds;  // Textures and buffers, serialized on the GL thread
+};
+
+// Fills p_meshes[i] from p_scene_meshes[p_meshes[i].source_mesh]: indices one job per mesh, vertices in
+// chunks of MESH_IMPORT_VERTEX_GRAIN, converted with SSE shuffles straight into the pre-sized arrays.
+// Runs serially on the calling thread when p_jobs is null, the bytes do not depend on the thread
+// count. Needs no GL.
+void convert_meshes(aiMesh* const* p_scene_meshes, std::vector<MeshData>& p_meshes, JobSystem* p_jobs);
+
 class Model
 {
   public:
-    Model(const char* path);
+    // With p_gpu_only the meshes drop their vertices and indices once uploaded, keeping only bounds.
+    // With p_virtual_textures the diffuse maps are streamed through it instead of loaded whole.
+    Model(const char* path, bool p_gpu_only = false, VirtualTextureSystem* p_virtual_textures = NULL);
+    ~Model();
+    Model(const Model&) = delete;
+    Model& operator=(const Model&) = delete;
 
-    void         draw(Shader& shader);
+    // Sets the "model" uniform of every mesh to p_model_matrix times the mesh's node transform. Meshes go
+    // in material order, so neighbours sharing a material skip the rebind.
+    void         draw(Shader& shader, const glm::mat4& p_model_matrix = glm::mat4(1.0f));
+    // Draws the model once per instance matrix, skipping meshes whose bounds are outside p_frustum. Each
+    // mesh is drawn for every instance before the next, so a material is bound once per call. Returns
+    // the number of draw calls issued.
+    unsigned int draw_instances(Shader& shader, const std::vector<glm::mat4>& p_instances, const Frustum& p_frustum);
+    // draw_instances() with every mesh that passes narrowed down by cull_meshlets(), its surviving ranges
+    // in one glMultiDrawElements. The cone test drops what GL_CULL_FACE would, so draw with it enabled.
+    unsigned int draw_meshlets(Shader& shader, const std::vector<glm::mat4>& p_instances, const Frustum& p_frustum,
+                               const glm::vec3& p_camera_position);
+    // draw_instances() posed by p_player, instance i with palette i. Skinned meshes are placed by their
+    // palette, so "model" is the instance matrix alone, and culled with grown bind pose bounds. With
+    // p_palette they are skinned on the GPU (the SKINNING permutation), without it on the CPU into a
+    // streaming buffer, which needs the CPU geometry.
+    unsigned int draw_animated(Shader& shader, const std::vector<glm::mat4>& p_instances, const Frustum& p_frustum,
+                               const AnimationPlayer& p_player, const BonePalette* p_palette);
     unsigned int texture_from_file(const char* path, const std::string& directory, bool gamma = false);
+    // Bytes still held by the meshes' CPU-side vertex and index arrays.
+    std::size_t  get_cpu_geometry_bytes() const;
+
+    const std::vector<Mesh>& get_meshes() const;
+    MaterialTable&           get_materials();
+    // Model-space transform of a mesh, from the node it was attached to.
+    glm::mat4                get_mesh_matrix(unsigned int p_mesh);
+    const ModelImportStats&  get_import_stats() const;
+    // Of the last draw_meshlets() call.
+    const MeshletCullStats&  get_meshlet_stats() const;
+
+    const Skeleton&                   get_skeleton() const;
+    const std::vector<AnimationClip>& get_clips() const;
+    // Whether any mesh has bones and the file has clips to play.
+    bool                              is_animated() const;
 
   private:
     std::vector<Texture> textures_loaded;
-    std::vector<Mesh>    meshes;
-    std::string          directory;
+    std::vector<Mesh>         meshes;
+    std::vector<unsigned int> mesh_nodes;
+    std::vector<unsigned int> draw_order;      // Mesh indices sorted by material
+    MaterialTable             materials;
+    std::vector<unsigned int> scene_materials; // Material ID per aiScene material, MATERIAL_NONE until used
+    SceneGraph                nodes;
+    std::string               directory;
+    bool                      gpu_only;
+    VirtualTextureSystem*     virtual_textures;
+    ModelImportStats          import_stats;
+    MeshletDrawList           meshlet_draws; // Reused by every draw_meshlets() call
+    MeshletCullStats          meshlet_stats;
+
+    Skeleton                                      skeleton;
+    std::vector<AnimationClip>                    clips;
+    std::unordered_map<std::string, unsigned int> joint_names;      // Scene node per aiNode name
+    std::vector<Vertex>                           skinned_vertices; // Reused by the CPU path of draw_animated()
 
     void                 load_model(std::string path);
-    void                 process_node(aiNode* node, const aiScene* scene);
-    Mesh                 process_mesh(aiMesh* mesh, const aiScene* scene);
+    void                 process_node(aiNode* node, unsigned int parent_node, std::vector<MeshData>& p_meshes);
+    Mesh                 process_mesh(MeshData& p_data, const aiScene* scene);
+    unsigned int         load_material(const aiScene* scene, unsigned int p_scene_material);
     std::vector<Texture> load_material_textures(aiMaterial* mat, aiTextureType type, std::string type_name);
+    void                 begin_draw(Shader& shader);
+    void                 bind_material(Shader& shader, unsigned int p_material);
+
+    // Palette indices of the mesh's bones, strongest four per vertex.
+    std::vector<SkinWeights> load_bones(const aiMesh* mesh, unsigned int p_mesh_node);
+    // Index of the bone, added unless an equal one exists, MAX_SKELETON_BONES when the palette is full.
+    unsigned int             add_bone(unsigned int p_joint, const glm::mat4& p_offset);
+    void                     load_animations(const aiScene* scene);
 };
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+
+enum ResourceCategory
+{
+    RESOURCE_BUFFER,
+    RESOURCE_TEXTURE,
+    RESOURCE_RENDERBUFFER,
+    RESOURCE_FRAMEBUFFER,
+    RESOURCE_VERTEX_ARRAY,
+    RESOURCE_CPU_GEOMETRY, // CPU copies of uploaded geometry, keyed by the owning VAO
+    RESOURCE_CATEGORY_COUNT
+};
+
+struct ResourceRecord
+{
+    ResourceCategory category;
+    unsigned int     gl_name;
+    std::size_t      bytes;
+    std::string      owner;
+};
+
+// Tracks every GL object the engine creates with its size, category and owning asset, so VRAM use
+// can be queried, budgeted and checked for leaks. Call track() next to glGen* and untrack() next to
+// glDelete*.
+class ResourceRegistry
+{
+  public:
+    static ResourceRegistry& get_instance();
+
+    void track(ResourceCategory p_category, unsigned int p_gl_name, std::size_t p_bytes, const std::string& p_owner);
+    void track(ResourceCategory p_category, unsigned int p_gl_name, std::size_t p_bytes);
+    void untrack(ResourceCategory p_category, unsigned int p_gl_name);
+
+    std::size_t get_total_bytes() const;
+    std::size_t get_category_bytes(ResourceCategory p_category) const;
+    std::size_t get_owner_bytes(const std::string& p_owner) const;
+    std::size_t get_resource_count() const;
+
+    // Prints a warning the first time a category goes over its budget. 0 means unlimited.
+    void set_budget(ResourceCategory p_category, std::size_t p_bytes);
+
+    void print_summary(std::ostream& p_out) const;
+    void print_frame_line(std::ostream& p_out) const;
+    bool dump_json(const std::string& p_path) const;
+    // Lists what is still alive, call at shutdown once everything should have been deleted.
+    void report_leaks(std::ostream& p_out) const;
+
+    // Owner assigned by the two-argument track() on this thread, e.g. the model being imported.
+    static void        set_current_owner(const std::string& p_owner);
+    static std::string get_current_owner();
+
+  private:
+    ResourceRegistry();
+
+    mutable std::mutex                                mutex;
+    std::unordered_map<std::uint64_t, ResourceRecord> records;
+    std::size_t                                       category_bytes[RESOURCE_CATEGORY_COUNT];
+    std::size_t                                       budgets[RESOURCE_CATEGORY_COUNT];
+    bool                                              budget_warned[RESOURCE_CATEGORY_COUNT];
+};
+
+// Sets the current owner for the lifetime of the scope.
+class ResourceOwnerScope
+{
+  public:
+    explicit ResourceOwnerScope(const std::string& p_owner);
+    ~ResourceOwnerScope();
+
+  private:
+    std::string previous_owner;
+};
+
+const char* get_resource_category_name(ResourceCategory p_category);
+
+// Estimated VRAM for an 8-bit-per-channel 2D image, including the full mip chain when p_mipmapped.
+// RGB is counted as RGBA since that is how drivers usually store it.
+std::size_t get_texture_bytes(int p_width, int p_height, int p_channels, bool p_mipmapped);
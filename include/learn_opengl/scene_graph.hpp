@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "glm/ext/matrix_float4x4.hpp"
+#include "glm/ext/vector_float3.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+const unsigned int SCENE_NODE_NONE = 0xFFFFFFFF;
+
+// Transform hierarchy stored as parallel arrays indexed by node. Nodes are only ever appended and a
+// parent must exist before its children, so parents always come first (topological order).
+// Changing a local transform marks the node dirty; update_world_transforms() then recomputes only
+// the dirty subtrees.
+class SceneGraph
+{
+  public:
+    SceneGraph();
+
+    unsigned int add_node(unsigned int p_parent, const glm::vec3& p_position, const glm::quat& p_rotation,
+                          const glm::vec3& p_scale);
+    unsigned int add_node(unsigned int p_parent, const glm::mat4& p_local_matrix);
+    void         reserve(unsigned int p_node_count);
+    void         clear();
+
+    void set_local_position(unsigned int p_node, const glm::vec3& p_position);
+    void set_local_rotation(unsigned int p_node, const glm::quat& p_rotation);
+    void set_local_scale(unsigned int p_node, const glm::vec3& p_scale);
+
+    // Returns how many nodes had their world matrix recomputed.
+    unsigned int update_world_transforms();
+
+    unsigned int     get_node_count() const;
+    unsigned int     get_parent(unsigned int p_node) const;
+    const glm::vec3& get_local_position(unsigned int p_node) const;
+    const glm::quat& get_local_rotation(unsigned int p_node) const;
+    const glm::vec3& get_local_scale(unsigned int p_node) const;
+    const glm::mat4& get_world_matrix(unsigned int p_node) const;
+
+  private:
+    std::vector<unsigned int> parent;
+    std::vector<unsigned int> first_child;
+    std::vector<unsigned int> next_sibling;
+
+    std::vector<glm::vec3> local_position;
+    std::vector<glm::quat> local_rotation;
+    std::vector<glm::vec3> local_scale;
+    std::vector<glm::mat4> local_matrix;
+    std::vector<glm::mat4> world_matrix;
+
+    std::vector<std::uint8_t>  local_dirty;
+    std::vector<std::uint32_t> updated_in_pass;
+    std::vector<unsigned int>  dirty_nodes;
+    std::vector<unsigned int>  traversal_stack;
+    std::uint32_t              update_pass;
+
+    void         mark_dirty(unsigned int p_node);
+    unsigned int update_subtree(unsigned int p_root);
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+
+#include "glm/ext/matrix_float4x4.hpp"
+#include "glm/ext/vector_float4.hpp"
+#include "learn_opengl/frame_pipeline.hpp"
+#include "learn_opengl/fullscreen_quad.hpp"
+#include "learn_opengl/gpu_timer.hpp"
+#include "learn_opengl/shader.hpp"
+
+// The mask is R8, 0 meaning not selected.
+const unsigned int SELECTION_MAX_ID      = 255;
+const float        DEFAULT_OUTLINE_WIDTH = 3.0f;
+const float        MAX_OUTLINE_WIDTH     = 64.0f;
+
+struct SelectionOutlineStats
+{
+    unsigned int selected_draws;
+    unsigned int flood_passes;
+    double       gpu_milliseconds; // The whole feature, mask included
+};
+
+// Screen-space selection outlines. Selected objects are drawn into an id mask, a jump flood finds
+// the nearest selected texel for every texel in log2(width) fullscreen passes, and one more
+// fullscreen pass blends the outline wherever that distance is within the width. Only the mask
+// pass depends on the selection, and it writes nothing but ids. The outlines are not hidden by the
+// scene. GL thread only.
+class SelectionOutline
+{
+  public:
+    SelectionOutline();
+    ~SelectionOutline();
+    SelectionOutline(const SelectionOutline&)            = delete;
+    SelectionOutline& operator=(const SelectionOutline&) = delete;
+
+    // In pixels, up to MAX_OUTLINE_WIDTH.
+    void set_width(float p_width);
+    void set_color(const glm::vec4& p_color);
+
+    // Outlines p_draws over the default framebuffer, which is p_width x p_height.
+    void draw(const std::vector<SelectionDraw>& p_draws, const glm::mat4& p_view, const glm::mat4& p_projection,
+              int p_width, int p_height);
+
+    SelectionOutlineStats get_stats() const;
+
+  private:
+    void resize(int p_width, int p_height);
+
+    Shader         mask_shader;
+    Shader         seed_shader;
+    Shader         flood_shader;
+    Shader         composite_shader;
+    FullscreenQuad quad;
+    GpuTimer       timer;
+
+    unsigned int mask_framebuffer;
+    unsigned int mask_texture;
+    unsigned int seed_framebuffers[2];
+    unsigned int seed_textures[2];
+    int          width;
+    int          height;
+
+    float        outline_width;
+    glm::vec4    outline_color;
+    unsigned int last_draws;
+    unsigned int last_flood_passes;
+};
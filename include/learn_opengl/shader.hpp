@@ -4,19 +4,31 @@
 
 #include "glm/ext/matrix_float3x3.hpp"
 #include "glm/ext/matrix_float4x4.hpp"
+#include "glm/ext/vector_float2.hpp"
 #include "glm/ext/vector_float3.hpp"
+#include "glm/ext/vector_float4.hpp"
+#include "learn_opengl/shader_preprocessor.hpp"
 
 class Shader
 {
   public:
     unsigned int ID;
     Shader(const char* vertex_path, const char* fragment_path);
+    Shader(const char* vertex_path, const char* fragment_path, const ShaderDefines& defines);
+    // Compute-only program, needs a GL 4.3 context (see gl_extensions.hpp).
+    Shader(const char* compute_path, const ShaderDefines& defines);
 
     void use();
     void setBool(const std::string& name, bool value) const;
     void setInt(const std::string& name, int value) const;
     void setFloat(const std::string& name, float value) const;
+    void setVec2(const std::string& name, glm::vec2 value) const;
     void setVec3(const std::string& name, glm::vec3 value) const;
+    void setVec4(const std::string& name, glm::vec4 value) const;
     void setMat3(const std::string& name, glm::mat3 value) const;
     void setMat4(const std::string& name, glm::mat4 value) const;
+
+    // Totals over every program built so far, including the link.
+    static unsigned int get_programs_compiled();
+    static double       get_compile_milliseconds();
 };
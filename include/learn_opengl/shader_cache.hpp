@@ -0,0 +1,42 @@
+#pragma once
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+
+#include "learn_opengl/shader.hpp"
+#include "learn_opengl/shader_preprocessor.hpp"
+
+// Named shader programs whose define permutations are compiled lazily on first use, then reused.
+// Hot paths can request a specialized variant (e.g. {"ALPHA_TEST"}) and get its dead branches
+// stripped at compile time instead of branching on a uniform. GL thread only.
+class ShaderCache
+{
+  public:
+    static ShaderCache& get_instance();
+    ShaderCache(const ShaderCache&)            = delete;
+    ShaderCache& operator=(const ShaderCache&) = delete;
+
+    void    register_program(const std::string& p_name, const std::string& p_vertex_path,
+                             const std::string& p_fragment_path);
+    Shader* get(const std::string& p_name, const ShaderDefines& p_defines = ShaderDefines());
+
+    unsigned int get_permutation_count() const;
+    void         print_stats(std::ostream& p_out) const;
+    // Deletes every cached program, call before the context goes away.
+    void         clear();
+
+  private:
+    ShaderCache();
+
+    struct ShaderProgramSource
+    {
+        std::string vertex_path;
+        std::string fragment_path;
+    };
+
+    std::unordered_map<std::string, ShaderProgramSource>     programs;
+    std::unordered_map<std::string, std::unique_ptr<Shader>> permutations;
+    unsigned int                                             cache_hits;
+};
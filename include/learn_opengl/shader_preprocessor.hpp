@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+struct ShaderDefine
+{
+    std::string name;
+    std::string value;
+};
+
+typedef std::vector<ShaderDefine> ShaderDefines;
+
+struct PreprocessedShader
+{
+    bool        success;
+    std::string source;
+    // Source string numbers used in the emitted #line directives, so compile errors reading "2(14)"
+    // mean line 14 of files[2].
+    std::vector<std::string> files;
+};
+
+// Expands #include "file" (relative to the including file, then to shaders/) and injects the
+// defines right after #version. Each file is included at most once per stage.
+PreprocessedShader preprocess_shader(const std::string& p_path, const ShaderDefines& p_defines);
+
+// Order-independent key of a define set, e.g. "ALPHA_TEST;MAX_LIGHTS=16".
+std::string get_shader_defines_key(const ShaderDefines& p_defines);
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <algorithm>
+
+#include "glm/ext/matrix_float4x4.hpp"
+#include "glm/ext/vector_float3.hpp"
+#include "glm/gtc/type_ptr.hpp"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define LEARN_OPENGL_SSE 1
+#endif
+
+// p_out = p_a * p_b for column-major matrices, 4 lanes at a time. p_out may alias either input.
+inline void mat4_multiply(const glm::mat4& p_a, const glm::mat4& p_b, glm::mat4& p_out)
+{
+#ifdef LEARN_OPENGL_SSE
+    const float* a = glm::value_ptr(p_a);
+    const float* b = glm::value_ptr(p_b);
+    float*       out = glm::value_ptr(p_out);
+
+    __m128 a0 = _mm_loadu_ps(a + 0);
+    __m128 a1 = _mm_loadu_ps(a + 4);
+    __m128 a2 = _mm_loadu_ps(a + 8);
+    __m128 a3 = _mm_loadu_ps(a + 12);
+
+    for (int i = 0; i < 4; i++)
+    {
+        // Column i of the result is A's columns weighted by column i of B.
+        __m128 column = _mm_mul_ps(a0, _mm_set1_ps(b[i * 4 + 0]));
+        column = _mm_add_ps(column, _mm_mul_ps(a1, _mm_set1_ps(b[i * 4 + 1])));
+        column = _mm_add_ps(column, _mm_mul_ps(a2, _mm_set1_ps(b[i * 4 + 2])));
+        column = _mm_add_ps(column, _mm_mul_ps(a3, _mm_set1_ps(b[i * 4 + 3])));
+        _mm_storeu_ps(out + i * 4, column);
+    }
+#else
+    p_out = p_a * p_b;
+#endif
+}
+
+// Tests 4 spheres (SoA) against one AABB. Bit i of the result is set when sphere i
+// touches the box.
+inline unsigned int spheres_intersect_aabb(const float* p_x, const float* p_y, const float* p_z,
+                                           const float* p_radius, const glm::vec3& p_min, const glm::vec3& p_max)
+{
+#ifdef LEARN_OPENGL_SSE
+    const __m128 zero = _mm_setzero_ps();
+
+    // Distance from the center to the box along each axis, 0 when inside the slab.
+    __m128 x = _mm_loadu_ps(p_x);
+    __m128 dx = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(p_min.x), x), zero),
+                           _mm_max_ps(_mm_sub_ps(x, _mm_set1_ps(p_max.x)), zero));
+    __m128 y = _mm_loadu_ps(p_y);
+    __m128 dy = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(p_min.y), y), zero),
+                           _mm_max_ps(_mm_sub_ps(y, _mm_set1_ps(p_max.y)), zero));
+    __m128 z = _mm_loadu_ps(p_z);
+    __m128 dz = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(p_min.z), z), zero),
+                           _mm_max_ps(_mm_sub_ps(z, _mm_set1_ps(p_max.z)), zero));
+
+    __m128 distance_squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+    __m128 radius = _mm_loadu_ps(p_radius);
+    return (unsigned int) _mm_movemask_ps(_mm_cmple_ps(distance_squared, _mm_mul_ps(radius, radius)));
+#else
+    unsigned int mask = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        float dx = std::max(p_min.x - p_x[i], 0.0f) + std::max(p_x[i] - p_max.x, 0.0f);
+        float dy = std::max(p_min.y - p_y[i], 0.0f) + std::max(p_y[i] - p_max.y, 0.0f);
+        float dz = std::max(p_min.z - p_z[i], 0.0f) + std::max(p_z[i] - p_max.z, 0.0f);
+        if (dx * dx + dy * dy + dz * dz <= p_radius[i] * p_radius[i])
+        {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+#endif
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+
+#include "glm/ext/matrix_float4x4.hpp"
+#include "learn_opengl/camera.hpp"
+#include "learn_opengl/frame_pipeline.hpp"
+#include "learn_opengl/input.hpp"
+
+// Appends the scene's draws to a packet, seen through the (possibly interpolated) camera.
+using SceneBuilder = std::function<void(FramePacket& packet, Camera& camera)>;
+
+// The simulation/build stage. Runs on its own thread, owns the camera and produces frame packets
+// for the render stage. In fixed timestep mode the camera is advanced in ticks of tick_seconds and
+// the packet is built from the state interpolated between the last two ticks.
+class Simulation
+{
+  public:
+    Simulation(Camera& p_camera, InputState& p_input, FramePipeline& p_pipeline);
+    ~Simulation();
+
+    void set_scene_builder(SceneBuilder p_builder);
+    void set_fixed_timestep(bool p_enabled, double p_tick_seconds = 1.0 / 60.0);
+    void start();
+    void stop();
+
+  private:
+    Camera&        camera;
+    InputState&    input;
+    FramePipeline& pipeline;
+    SceneBuilder   scene_builder;
+
+    bool   fixed_timestep;
+    double tick_seconds;
+
+    std::thread       thread;
+    std::atomic<bool> running;
+
+    void run();
+    void apply_input(const InputSnapshot& p_input, float p_delta_time, bool p_apply_deltas);
+    void build_packet(FramePacket& p_packet, const CameraState& p_state, double p_time,
+                      std::chrono::steady_clock::time_point p_input_time);
+};
+
+// Re-aims the packet's camera with the mouse movement that arrived since the packet was built and
+// returns the new view matrix. Only the orientation is latched: moving the camera would also need
+// the culling redone. The movement stays pending, so the simulation still applies it.
+glm::mat4 get_late_latched_view(const FramePacket& p_packet, InputState& p_input);
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "glm/ext/matrix_float4x4.hpp"
+#include "glm/ext/vector_float3.hpp"
+#include "learn_opengl/frustum.hpp"
+#include "learn_opengl/shader.hpp"
+
+// Quads along a chunk side at the finest level, each coarser level halves them.
+const int   TERRAIN_CHUNK_QUADS   = 32;
+const int   TERRAIN_LOD_COUNT     = 4;
+const float TERRAIN_CHUNK_SIZE    = 16.0f;
+// Height samples along a chunk side on disk, with a one-sample border shared with the neighbours so
+// the normals along the seams match.
+const int   TERRAIN_CHUNK_SAMPLES = TERRAIN_CHUNK_QUADS + 3;
+// Heights are stored as 16-bit fractions of this range above the base.
+const float TERRAIN_BASE_HEIGHT   = -0.5f;
+const float TERRAIN_HEIGHT_RANGE  = 12.0f;
+// Skirts hang this far below each chunk's edges and hide the cracks between neighbours at different levels.
+const float TERRAIN_SKIRT_DEPTH   = 1.0f;
+// A chunk drops one level per this much distance from the camera to its bounds.
+const float TERRAIN_LOD_DISTANCE  = 24.0f;
+
+const float        DEFAULT_TERRAIN_RADIUS        = 96.0f;
+const unsigned int DEFAULT_TERRAIN_LOADERS       = 2;
+// Chunks are only evicted this far outside the radius, so moving along a border does not reload them.
+const float        TERRAIN_EVICTION_MARGIN       = TERRAIN_CHUNK_SIZE;
+const unsigned int TERRAIN_MAX_UPLOADS_PER_FRAME = 4;
+
+struct TerrainVertex
+{
+    glm::vec3 position; // World space
+    glm::vec3 normal;
+};
+
+// Vertices of one chunk: the full-resolution grid, row by row, then a skirt vertex under each edge
+// vertex. Every level indexes into the same vertices, so one shared index buffer serves all chunks.
+const std::size_t TERRAIN_CHUNK_VERTICES =
+        (std::size_t) (TERRAIN_CHUNK_QUADS + 1) * (TERRAIN_CHUNK_QUADS + 1) + 4 * (TERRAIN_CHUNK_QUADS + 1);
+
+struct TerrainChunk
+{
+    int                        x;
+    int                        z;
+    std::vector<TerrainVertex> vertices;
+    float                      min_height;
+    float                      max_height;
+    bool                       from_disk;
+    double                     load_milliseconds; // From the request to the vertices being ready
+};
+
+std::int64_t get_terrain_chunk_key(int p_x, int p_z);
+std::string  get_terrain_chunk_name(int p_x, int p_z);
+// Procedural heights for a chunk, quantized exactly like the files so both sources agree on the seams.
+void         generate_terrain_heights(int p_x, int p_z, std::vector<std::uint16_t>& p_heights);
+// Height of the generated chunks' mesh at (x, z), bilinear between its vertices. Needs no GL.
+float        get_generated_terrain_height(float p_x, float p_z);
+// Writes generated chunks within p_chunk_radius chunks of the origin, for streaming from disk.
+bool         write_terrain_chunks(const std::filesystem::path& p_directory, int p_chunk_radius);
+
+// Indices of every level back to back, into the vertex layout above, and where each level starts.
+void        build_terrain_indices(std::vector<std::uint16_t>& p_indices, std::size_t p_first_index[TERRAIN_LOD_COUNT],
+                                  std::size_t p_index_count[TERRAIN_LOD_COUNT]);
+int         select_terrain_lod(const glm::vec3& p_camera_position, const glm::vec3& p_min, const glm::vec3& p_max);
+std::size_t get_terrain_lod_triangles(int p_lod);
+
+struct TerrainStreamerStats
+{
+    std::uint64_t requested;
+    std::uint64_t loaded_from_disk;
+    std::uint64_t generated; // No file for the chunk, or no terrain directory
+    std::uint64_t cancelled; // Left the radius before it was loaded
+    std::uint64_t evicted;
+    std::size_t   queued;
+    std::size_t   resident; // Taken by the renderer and not evicted yet
+    std::size_t   max_resident;
+    double        last_load_milliseconds;
+    double        mean_load_milliseconds;
+    double        max_load_milliseconds;
+};
+
+// CPU half: keeps the chunks within a radius of the camera loaded. Loader threads read a chunk's
+// heights from <directory>/chunk_<x>_<z>.r16 (or generate them) and build its vertices, nearest
+// chunks first; everything past the radius is cancelled or evicted, so memory follows the radius and
+// not the distance travelled. Needs no GL.
+class TerrainStreamer
+{
+  public:
+    TerrainStreamer(const std::filesystem::path& p_directory, float p_radius = DEFAULT_TERRAIN_RADIUS,
+                    unsigned int p_loader_count = DEFAULT_TERRAIN_LOADERS);
+    ~TerrainStreamer();
+    TerrainStreamer(const TerrainStreamer&)            = delete;
+    TerrainStreamer& operator=(const TerrainStreamer&) = delete;
+
+    // Requests what entered the radius around p_position and reports the keys of resident chunks that left it.
+    void update(const glm::vec3& p_position, std::vector<std::int64_t>& p_evicted);
+    // Hands over at most p_max_chunks loaded chunks, which become resident.
+    void take_loaded(std::vector<TerrainChunk>& p_chunks, std::size_t p_max_chunks);
+    // Gives a chunk's vertex storage back once it has been uploaded.
+    void recycle(TerrainChunk&& p_chunk);
+    // Nothing queued, loading or waiting to be taken.
+    bool is_idle();
+
+    float                get_radius() const;
+    TerrainStreamerStats get_stats();
+
+  private:
+    enum ChunkState
+    {
+        CHUNK_QUEUED,
+        CHUNK_LOADING,
+        CHUNK_LOADED,
+        CHUNK_RESIDENT
+    };
+
+    struct Request
+    {
+        int                                   x;
+        int                                   z;
+        std::chrono::steady_clock::time_point requested;
+    };
+
+    void run();
+    void load(const Request& p_request, TerrainChunk& p_chunk, std::vector<std::uint16_t>& p_heights) const;
+
+    std::filesystem::path directory;
+    float                 radius;
+    glm::vec3             position;
+
+    std::unordered_map<std::int64_t, ChunkState> chunks;
+    std::deque<Request>                          queue;
+    std::vector<TerrainChunk>                    loaded;
+    std::vector<TerrainChunk>                    free_chunks;
+    std::size_t                                  loading;
+    double                                       total_load_milliseconds;
+    bool                                         stopping;
+    TerrainStreamerStats                         stats;
+
+    std::mutex               mutex;
+    std::condition_variable  changed;
+    std::vector<std::thread> loaders;
+};
+
+struct TerrainStats
+{
+    std::size_t   gpu_chunks;
+    std::size_t   pooled_chunks; // Buffers of evicted chunks, kept for the next ones
+    std::uint64_t gpu_bytes;
+    std::size_t   visible_chunks;
+    std::size_t   triangles;
+    std::size_t   lod_chunks[TERRAIN_LOD_COUNT];
+};
+
+// GL half: uploads the streamer's chunks into pooled vertex buffers, all sharing one index buffer with
+// every level, and draws the visible ones at the level their distance asks for. GL thread only.
+class TerrainRenderer
+{
+  public:
+    explicit TerrainRenderer(TerrainStreamer& p_streamer);
+    ~TerrainRenderer();
+    TerrainRenderer(const TerrainRenderer&)            = delete;
+    TerrainRenderer& operator=(const TerrainRenderer&) = delete;
+
+    // Frees what left the radius and uploads a few of the chunks that finished loading.
+    void update(const glm::vec3& p_camera_position);
+    void draw(Shader& p_shader, const glm::mat4& p_view, const glm::mat4& p_projection,
+              const glm::vec3& p_camera_position);
+
+    TerrainStats get_stats() const;
+
+  private:
+    struct GpuChunk
+    {
+        unsigned int vao;
+        unsigned int vbo;
+        glm::vec3    min;
+        glm::vec3    max;
+    };
+
+    GpuChunk create_chunk();
+
+    TerrainStreamer&                           streamer;
+    unsigned int                               index_buffer;
+    std::size_t                                first_index[TERRAIN_LOD_COUNT];
+    std::size_t                                index_count[TERRAIN_LOD_COUNT];
+    std::unordered_map<std::int64_t, GpuChunk> gpu_chunks;
+    std::vector<GpuChunk>                      pool;
+    std::vector<TerrainChunk>                  uploads;
+    std::vector<std::int64_t>                  evicted;
+    TerrainStats                               stats;
+};
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "glm/ext/vector_float4.hpp"
+
+// Textures up to TEXTURE_ATLAS_MAX_SIZE on both edges are packed into TEXTURE_ATLAS_SIZE pages,
+// each surrounded by TEXTURE_ATLAS_GUTTER edge-replicated texels so the first mip levels do not
+// bleed into their neighbours.
+const unsigned int TEXTURE_ATLAS_SIZE     = 1024;
+const unsigned int TEXTURE_ATLAS_MAX_SIZE = 512;
+const unsigned int TEXTURE_ATLAS_GUTTER   = 4;
+
+const unsigned int TEXTURE_SLOT_NONE = 0xFFFFFFFF;
+
+// Where a texture ended up after packing.
+struct TextureSlot
+{
+    unsigned int array;
+    unsigned int layer;
+    glm::vec4    uv_rect; // xy offset and zw scale of the texture inside the layer
+};
+
+// RGBA8 layers of one size, laid out back to back as glTexImage3D expects them.
+struct TextureArrayImage
+{
+    int                        width;
+    int                        height;
+    int                        layers;
+    std::vector<unsigned char> pixels;
+};
+
+// CPU half: groups RGBA8 images of the same size into array layers and packs small ones into atlas
+// pages, which then join the array of their size. Needs no GL.
+class TextureArrayPacker
+{
+  public:
+    TextureArrayPacker();
+
+    // Returns the slot index, valid once pack() ran.
+    unsigned int add(int p_width, int p_height, std::vector<unsigned char>&& p_rgba);
+    void         pack();
+    // Frees the input images and the packed arrays, the slots stay.
+    void         clear_pixels();
+
+    const std::vector<TextureSlot>&       get_slots() const;
+    const std::vector<TextureArrayImage>& get_arrays() const;
+    unsigned int                          get_atlas_page_count() const;
+
+  private:
+    struct SourceImage
+    {
+        int                        width;
+        int                        height;
+        std::vector<unsigned char> rgba;
+    };
+
+    // Placement inside an atlas page, before the pages are assigned to an array.
+    struct AtlasPlacement
+    {
+        unsigned int page;
+        int          x;
+        int          y;
+    };
+
+    unsigned int find_or_add_array(int p_width, int p_height);
+    void         copy_with_gutter(const SourceImage& p_image, unsigned char* p_layer, int p_layer_width, int p_x,
+                                  int p_y, int p_gutter) const;
+
+    std::vector<SourceImage>       images;
+    std::vector<TextureSlot>       slots;
+    std::vector<TextureArrayImage> arrays;
+    unsigned int                   atlas_pages;
+};
+
+// GL half: decodes image files into a packer and uploads the result as GL_TEXTURE_2D_ARRAY
+// textures. Shaders sample slots through shaders/include/texture_arrays.glsl. GL thread only.
+class TextureArraySet
+{
+  public:
+    TextureArraySet();
+    ~TextureArraySet();
+    TextureArraySet(const TextureArraySet&)            = delete;
+    TextureArraySet& operator=(const TextureArraySet&) = delete;
+
+    // Returns TEXTURE_SLOT_NONE if the file could not be decoded.
+    unsigned int add_file(const std::string& p_path);
+    // Packs, uploads and drops the CPU copies. Slots added afterwards are not supported.
+    void         upload();
+
+    const TextureSlot& get_slot(unsigned int p_slot) const;
+    unsigned int       get_array_texture(unsigned int p_array) const;
+    unsigned int       get_array_count() const;
+    unsigned int       get_slot_count() const;
+    unsigned int       get_atlas_page_count() const;
+
+  private:
+    TextureArrayPacker        packer;
+    std::vector<unsigned int> textures;
+};
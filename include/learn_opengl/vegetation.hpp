@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "glm/ext/matrix_float4x4.hpp"
+#include "glm/ext/vector_float3.hpp"
+#include "learn_opengl/frustum.hpp"
+#include "learn_opengl/shader.hpp"
+
+const float         VEGETATION_CELL_SIZE             = 8.0f;
+const float         DEFAULT_VEGETATION_AREA          = 160.0f; // Side of the square scattered over
+const std::uint32_t DEFAULT_VEGETATION_SEED          = 1234;
+// Cells nearer than this draw every instance, the share then falls linearly to nothing at the fade end.
+const float         VEGETATION_FULL_DENSITY_DISTANCE = 24.0f;
+const float         VEGETATION_FADE_END_DISTANCE     = 90.0f;
+
+struct GrassInstance
+{
+    glm::vec3 position; // Base of the billboard, on the surface
+    float     height;
+    float     width;
+    float     tint; // Brightness, so the field is not uniform
+};
+
+// Instances of one cell are consecutive and in random order, so any prefix of them is an even
+// thinning of the whole cell.
+struct VegetationCell
+{
+    glm::vec3     min;
+    glm::vec3     max;
+    std::uint32_t first_instance;
+    std::uint32_t instance_count;
+};
+
+struct VegetationDraw
+{
+    std::uint32_t first_instance;
+    std::uint32_t instance_count;
+};
+
+struct VegetationStats
+{
+    std::size_t instance_count;
+    std::size_t cell_count;
+    std::size_t visible_cells;
+    std::size_t drawn_instances;
+    double      scatter_milliseconds;
+    double      select_milliseconds;
+};
+
+// Height of the surface at (x, z).
+using VegetationSurface = std::function<float(float p_x, float p_z)>;
+
+// CPU half: scatters instances over a surface, bins them into a grid of cells and picks the visible
+// cells with their share of instances for the camera. Needs no GL.
+class VegetationField
+{
+  public:
+    VegetationField();
+
+    // Replaces any previous scatter with p_count instances spread evenly over the square of side
+    // p_size around p_center.
+    void scatter(unsigned int p_count, const glm::vec3& p_center, float p_size, const VegetationSurface& p_surface,
+                 std::uint32_t p_seed = DEFAULT_VEGETATION_SEED);
+    // Cells in the frustum and within the fade distance, nearest first for the depth test.
+    void select(const Frustum& p_frustum, const glm::vec3& p_camera_position, std::vector<VegetationDraw>& p_draws);
+
+    const std::vector<GrassInstance>&  get_instances() const;
+    const std::vector<VegetationCell>& get_cells() const;
+    VegetationStats                    get_stats() const;
+
+  private:
+    std::vector<GrassInstance>                     instances;
+    std::vector<VegetationCell>                    cells;
+    std::vector<std::pair<float, VegetationDraw>> visible; // Distance to the camera, for the sort
+    VegetationStats                                stats;
+};
+
+// GL half: one static instance buffer, drawn per visible cell by pointing the instance attributes at
+// the cell's range. With the depth prepass the alpha test only runs in a depth-only pass; the color
+// pass then has no discard and no depth writes, tests GL_EQUAL and keeps early-Z. GL thread only.
+class VegetationRenderer
+{
+  public:
+    VegetationRenderer(VegetationField& p_field, unsigned int p_texture);
+    ~VegetationRenderer();
+    VegetationRenderer(const VegetationRenderer&)            = delete;
+    VegetationRenderer& operator=(const VegetationRenderer&) = delete;
+
+    // p_prepass_shader is only used when p_depth_prepass is set, p_shader alpha-tests without it.
+    void draw(Shader& p_shader, Shader* p_prepass_shader, bool p_depth_prepass, const glm::mat4& p_view,
+              const glm::mat4& p_projection, const glm::vec3& p_camera_position);
+
+    unsigned int get_draw_calls() const;
+
+  private:
+    void draw_cells(Shader& p_shader, const glm::mat4& p_view, const glm::mat4& p_projection);
+
+    VegetationField&            field;
+    unsigned int                texture;
+    unsigned int                vao;
+    unsigned int                quad_buffer;
+    unsigned int                instance_buffer;
+    std::vector<VegetationDraw> draws;
+    unsigned int                draw_calls;
+};
@@ -0,0 +1,237 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "learn_opengl/mapped_file.hpp"
+#include "learn_opengl/shader.hpp"
+
+// Texels of image per tile side, and of neighbouring image copied around it so bilinear filtering at a
+// tile's edge reads the right texels. A page of the physical texture holds one tile with its border.
+const int          VT_TILE_SIZE              = 128;
+const int          VT_TILE_BORDER            = 1;
+const int          VT_PAGE_SIZE              = VT_TILE_SIZE + 2 * VT_TILE_BORDER;
+const std::size_t  VT_PAGE_BYTES             = (std::size_t) VT_PAGE_SIZE * VT_PAGE_SIZE * 4;
+const unsigned int DEFAULT_VT_PAGES_PER_SIDE = 32; // 4160^2 texels, enough for a 1080p view
+const unsigned int VT_MAX_PAGES_PER_SIDE     = 64;
+// The feedback shader writes tile coordinates and the texture into 8-bit channels.
+const int          VT_MAX_TILES_PER_SIDE     = 256;
+const unsigned int VT_MAX_TEXTURES           = 255;
+// The feedback pass renders at this fraction of the viewport in each direction.
+const int          VT_FEEDBACK_DIVISOR       = 8;
+const unsigned int VT_FEEDBACK_SLOTS         = 3; // Copies in flight before one is dropped unread
+const unsigned int VT_MAX_UPLOADS_PER_FRAME  = 16;
+// Tiles waiting for the loader. A feedback pass replaces the whole queue, so this only bounds a burst.
+const std::size_t  VT_MAX_QUEUED             = 256;
+// Texture units of the pages and the indirection, above those the meshes bind their textures to.
+const unsigned int VT_PHYSICAL_UNIT          = 6;
+const unsigned int VT_INDIRECTION_UNIT       = 7;
+
+const unsigned int VIRTUAL_TEXTURE_NONE = ~0u;
+
+// Cooked file: this header, then every tile of mip 0 row by row from the bottom, then mip 1 and so
+// on. Each tile is VT_PAGE_SIZE^2 RGBA8 texels, its border wrapping around the image.
+struct VirtualTextureHeader
+{
+    char          magic[4]; // "VTX1"
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t tile_size;
+    std::uint32_t tile_border;
+    std::uint32_t mip_count; // Down to the first level that fits one tile
+};
+
+struct VirtualTextureInfo
+{
+    int width;
+    int height;
+    int mip_count;
+    // Indirection entries along a side at mip 0, a power of two so every GL mip level of the
+    // indirection texture covers the tiles of the matching image level.
+    int         tiles_side;
+    std::size_t first_tile[32]; // Per mip, into the file's tiles
+    int         tiles_x[32];
+    int         tiles_y[32];
+};
+
+bool get_virtual_texture_info(const VirtualTextureHeader& p_header, VirtualTextureInfo& p_info);
+// p_pixels is RGBA8, rows in the order the runtime loader leaves them. Needs no GL.
+bool cook_virtual_texture(const std::uint8_t* p_pixels, int p_width, int p_height,
+                          const std::filesystem::path& p_output);
+bool cook_virtual_texture_file(const std::filesystem::path& p_image, const std::filesystem::path& p_output);
+
+// Key of one tile: texture, mip and tile coordinates at that mip.
+std::uint64_t make_virtual_tile_key(unsigned int p_texture, int p_mip, int p_x, int p_y);
+
+struct VirtualTile
+{
+    std::uint64_t             key;
+    int                       page; // Physical page, set when the tile is taken
+    std::vector<std::uint8_t> texels;
+};
+
+struct VirtualTextureStats
+{
+    unsigned int  texture_count;
+    std::uint64_t virtual_bytes;  // Every mip of every texture, as plain textures would take
+    std::uint64_t physical_bytes; // Fixed by the page count
+    unsigned int  page_count;
+    unsigned int  resident_pages;
+    std::size_t   requested_tiles; // In the last feedback, with the coarser levels they fall back to
+    std::size_t   missing_tiles;
+    std::size_t   queued_tiles;
+    std::uint64_t loaded_tiles;
+    std::uint64_t evicted_tiles;
+    std::uint64_t cache_full; // Tiles that found every page in use by the current frame
+};
+
+// CPU half: the cooked files, the LRU cache deciding which tiles hold the pages and the indirection
+// tables pointing each tile at its page, or at the nearest coarser resident one. A loader thread reads
+// missing tiles from the memory-mapped files. Needs no GL.
+class VirtualTextureCache
+{
+  public:
+    explicit VirtualTextureCache(unsigned int p_pages_per_side = DEFAULT_VT_PAGES_PER_SIDE);
+    ~VirtualTextureCache();
+    VirtualTextureCache(const VirtualTextureCache&)            = delete;
+    VirtualTextureCache& operator=(const VirtualTextureCache&) = delete;
+
+    // Its coarsest tile is loaded right away and pinned, so every lookup finds something.
+    unsigned int              add_texture(const std::filesystem::path& p_cooked_path);
+    const VirtualTextureInfo& get_info(unsigned int p_texture) const;
+
+    // p_texels are the feedback pass's RGBA8 output. Resident tiles are marked used this frame, missing
+    // ones and the coarser levels above them replace the load queue, coarsest first.
+    void process_feedback(const std::uint8_t* p_texels, std::size_t p_texel_count);
+    // Gives up to p_max_tiles loaded tiles a page each, evicting the least recently used tiles.
+    void take_loaded(std::vector<VirtualTile>& p_tiles, std::size_t p_max_tiles);
+    void recycle(VirtualTile&& p_tile);
+    void end_frame();
+
+    // RGBA8 entries of one indirection level: page x, page y, the mip the page holds, 255 once valid.
+    const std::vector<std::uint32_t>& get_indirection(unsigned int p_texture, int p_mip) const;
+    // Region of a level changed since the last call, false when none did.
+    bool take_dirty_region(unsigned int p_texture, int p_mip, int p_region[4]);
+    // Nothing queued, loading or waiting to be taken.
+    bool is_idle();
+
+    unsigned int        get_pages_per_side() const;
+    VirtualTextureStats get_stats();
+
+  private:
+    struct Texture
+    {
+        std::unique_ptr<MappedFile>             file;
+        VirtualTextureInfo                      info;
+        std::vector<std::vector<std::uint32_t>> indirection;
+        std::vector<std::vector<std::int32_t>>  pages; // Per mip and tile, -1 when not resident
+        std::vector<std::array<int, 4>>         dirty; // Per mip: min x, min y, max x, max y (exclusive)
+    };
+
+    void                run();
+    const std::uint8_t* get_tile_data(std::uint64_t p_key) const;
+    // Least recently used page, -1 when every page was used this frame.
+    int                 allocate_page();
+    void                assign_page(int p_page, std::uint64_t p_key);
+    void                touch_page(int p_page);
+    void                unlink_page(int p_page);
+    void                set_resident(std::uint64_t p_key, std::int32_t p_page);
+    // Recomputes one entry and, when it changed, the finer entries inheriting it.
+    void                update_indirection(unsigned int p_texture, int p_mip, int p_x, int p_y);
+
+    unsigned int         pages_per_side;
+    std::vector<Texture> textures;
+
+    // Least recently used page at the head. Pinned pages are not in the list.
+    std::vector<std::uint64_t> page_keys;
+    std::vector<std::uint64_t> page_frames; // Frame the page was last used in
+    std::vector<int>           page_prev;
+    std::vector<int>           page_next;
+    std::vector<bool>          page_pinned;
+    int                        lru_head;
+    int                        lru_tail;
+    std::uint64_t              frame;
+
+    std::unordered_map<std::uint64_t, int> resident;
+    std::unordered_set<std::uint64_t>      pending; // Queued, loading or loaded but not taken
+    std::vector<std::uint64_t>             needed;
+    std::deque<std::uint64_t>              queue;
+    std::vector<VirtualTile>               loaded;
+    std::vector<VirtualTile>               pinned_uploads; // Coarsest tiles read by add_texture()
+    std::vector<VirtualTile>               free_tiles;
+    std::size_t                            loading;
+    bool                                   stopping;
+    VirtualTextureStats                    stats;
+
+    std::mutex              mutex;
+    std::condition_variable changed;
+    std::thread             loader;
+};
+
+// GL half: the physical page texture, one indirection texture per virtual texture, and the feedback
+// pass, read back through a ring of pixel pack buffers so it never stalls. Resident memory is the page
+// texture plus the small indirection textures, whatever the size or number of virtual textures. GL
+// thread only.
+class VirtualTextureSystem
+{
+  public:
+    explicit VirtualTextureSystem(unsigned int p_pages_per_side = DEFAULT_VT_PAGES_PER_SIDE);
+    ~VirtualTextureSystem();
+    VirtualTextureSystem(const VirtualTextureSystem&)            = delete;
+    VirtualTextureSystem& operator=(const VirtualTextureSystem&) = delete;
+
+    // p_path is root-relative. The image is cooked into <path>.vtex beside it when that file is missing,
+    // delete it to cook again.
+    unsigned int add(const std::string& p_path);
+
+    // Draw the virtual-textured geometry with the VIRTUAL_TEXTURE_FEEDBACK shader in between. Leaves
+    // framebuffer 0 bound, the caller sets its own viewport again.
+    void begin_feedback(int p_viewport_width, int p_viewport_height);
+    void end_feedback();
+    // Hands the oldest finished feedback to the cache, then uploads loaded tiles and indirection changes.
+    void update();
+    // Sets the sampling uniforms of the model shader's VIRTUAL_TEXTURES permutation, VIRTUAL_TEXTURE_NONE
+    // makes it sample the mesh's plain diffuse map. Between begin_feedback() and end_feedback() the mip
+    // selection is biased for the smaller target.
+    void bind(Shader& p_shader, unsigned int p_texture) const;
+
+    VirtualTextureCache& get_cache();
+
+  private:
+    struct FeedbackSlot
+    {
+        unsigned int buffer;
+        GLsync       fence;
+        int          width;
+        int          height;
+        std::size_t  capacity; // Bytes the buffer was allocated for
+    };
+
+    VirtualTextureCache       cache;
+    unsigned int              physical_texture;
+    int                       physical_size;
+    std::vector<unsigned int> indirection_textures;
+    unsigned int              feedback_framebuffer;
+    unsigned int              feedback_color;
+    unsigned int              feedback_depth;
+    int                       feedback_width;
+    int                       feedback_height;
+    bool                      feedback_active;
+    std::vector<FeedbackSlot> feedback_slots;
+    unsigned int              next_feedback_slot;
+    std::vector<std::uint8_t> feedback_texels;
+    std::vector<VirtualTile>  uploads;
+};
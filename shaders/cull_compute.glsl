@@ -0,0 +1,62 @@
+#version 430 core
+
+// One thread per (instance, mesh) item. Items outside the frustum are dropped, survivors are
+// appended to their mesh's draw command, whose instance count the indirect draw then reads.
+layout(local_size_x = 64) in;
+
+struct DrawCommand
+{
+    uint count;
+    uint instance_count;
+    uint first_index;
+    int  base_vertex;
+    uint base_instance;
+};
+
+struct CullItem
+{
+    vec4 sphere; // World-space center and radius
+    uint command;
+    uint padding[3];
+};
+
+layout(std430, binding = 1) readonly buffer CullItems
+{
+    CullItem items[];
+};
+
+layout(std430, binding = 2) buffer DrawCommands
+{
+    DrawCommand commands[];
+};
+
+layout(std430, binding = 3) writeonly buffer VisibleItems
+{
+    uint visible_items[];
+};
+
+// Inward-facing world-space planes, see make_frustum().
+uniform vec4 planes[6];
+uniform uint item_count;
+
+void main()
+{
+    uint item = gl_GlobalInvocationID.x;
+    if (item >= item_count)
+    {
+        return;
+    }
+
+    vec4 sphere = items[item].sphere;
+    for (int i = 0; i < 6; i++)
+    {
+        if (dot(planes[i].xyz, sphere.xyz) + planes[i].w < -sphere.w)
+        {
+            return;
+        }
+    }
+
+    uint command = items[item].command;
+    uint slot    = atomicAdd(commands[command].instance_count, 1u);
+    visible_items[commands[command].base_instance + slot] = item;
+}
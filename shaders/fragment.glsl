@@ -4,10 +4,41 @@ in vec2 TexCoords;
 
 out vec4 FragColor;
 
+#ifdef TEXTURE_ARRAYS
+#include "include/texture_arrays.glsl"
+#else
 uniform sampler2D texture1;
+#endif
+
+#ifdef CLUSTERED_LIGHTING
+#include "include/clustered_lighting.glsl"
+
+in vec3 ViewPosition;
+
+uniform float ambient_strength;
+#endif
+
+#ifndef ALPHA_CUTOFF
+#define ALPHA_CUTOFF 0.1f
+#endif
 
 void main()
 {
+#ifdef TEXTURE_ARRAYS
+    vec4 tex_color = sample_texture_slot(TexCoords);
+#else
     vec4 tex_color = texture(texture1, TexCoords);
+#endif
+#ifdef ALPHA_TEST
+    if (tex_color.a < ALPHA_CUTOFF)
+    {
+        discard;
+    }
+#endif
+#ifdef CLUSTERED_LIGHTING
+    // The scene meshes carry no normals, flat ones from the position derivatives are enough here.
+    vec3 normal = normalize(cross(dFdx(ViewPosition), dFdy(ViewPosition)));
+    tex_color.rgb = tex_color.rgb * ambient_strength + shade_clustered_lights(tex_color.rgb, ViewPosition, normal);
+#endif
     FragColor = tex_color;
 }
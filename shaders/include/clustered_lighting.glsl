@@ -0,0 +1,42 @@
+// Clustered forward lighting, see ClusteredLighting. The CLUSTER_* sizes are injected as defines.
+uniform samplerBuffer  cluster_lights;        // CLUSTER_LIGHT_TEXELS view-space texels per light
+uniform usamplerBuffer cluster_ranges;        // (offset, count) into cluster_light_indices
+uniform usamplerBuffer cluster_light_indices;
+
+uniform vec2  cluster_tile_size;
+uniform float cluster_depth_scale;
+uniform float cluster_depth_bias;
+
+uint get_cluster_index(vec3 view_position)
+{
+    uvec2 tile  = min(uvec2(gl_FragCoord.xy / cluster_tile_size), uvec2(CLUSTER_TILES_X - 1u, CLUSTER_TILES_Y - 1u));
+    uint  slice = uint(max(log(-view_position.z) * cluster_depth_scale + cluster_depth_bias, 0.0f));
+    slice       = min(slice, CLUSTER_SLICES - 1u);
+    return tile.x + CLUSTER_TILES_X * (tile.y + CLUSTER_TILES_Y * slice);
+}
+
+// Diffuse light from every point and spot light of this fragment's cluster, all in view space.
+vec3 shade_clustered_lights(vec3 albedo, vec3 view_position, vec3 view_normal)
+{
+    uvec2 range  = texelFetch(cluster_ranges, int(get_cluster_index(view_position))).xy;
+    vec3  result = vec3(0.0f);
+
+    for (uint i = 0u; i < range.y; i++)
+    {
+        int  light           = int(texelFetch(cluster_light_indices, int(range.x + i)).r) * CLUSTER_LIGHT_TEXELS;
+        vec4 position_radius = texelFetch(cluster_lights, light);
+        vec4 color_inner     = texelFetch(cluster_lights, light + 1);
+        vec4 direction_outer = texelFetch(cluster_lights, light + 2);
+
+        vec3  to_light  = position_radius.xyz - view_position;
+        float distance  = length(to_light);
+        vec3  direction = to_light / max(distance, 0.0001f);
+
+        float falloff = clamp(1.0f - distance / position_radius.w, 0.0f, 1.0f);
+        float spot    = smoothstep(direction_outer.w, color_inner.w, dot(-direction, direction_outer.xyz));
+
+        result += albedo * color_inner.rgb * max(dot(view_normal, direction), 0.0f) * falloff * falloff * spot;
+    }
+
+    return result;
+}
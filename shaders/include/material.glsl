@@ -0,0 +1,23 @@
+// Materials, see MaterialTable. The samplers sit at fixed units set once per program, the parameters
+// in the range of the shared uniform buffer bound for the current material.
+struct Material
+{
+    sampler2D texture_diffuse1;
+    sampler2D texture_specular1;
+};
+
+uniform Material material;
+
+layout(std140) uniform MaterialBlock
+{
+    vec4  diffuse_color;  // Used where there is no diffuse map, alpha is the opacity
+    vec4  specular_color; // w is the shininess
+    uint  has_diffuse_map;
+    uint  has_specular_map;
+};
+
+vec4 sample_material_diffuse(vec2 uv)
+{
+    vec4 diffuse = has_diffuse_map != 0u ? texture(material.texture_diffuse1, uv) : vec4(diffuse_color.rgb, 1.0f);
+    return vec4(diffuse.rgb, diffuse.a * diffuse_color.a);
+}
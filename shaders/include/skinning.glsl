@@ -0,0 +1,22 @@
+// Bone palette skinning, see BonePalette. Every instance's palette sits in one buffer texture, four
+// texels (columns) per matrix, and the draw says where its instance starts.
+layout(location = 3) in uvec4 aBoneIds;
+layout(location = 4) in vec4 aBoneWeights; // Sums to 1
+
+uniform samplerBuffer bone_palette;
+// First texel of the instance's palette, negative for meshes without bones.
+uniform int bone_offset;
+
+mat4 get_bone_matrix(uint bone)
+{
+    int texel = bone_offset + int(bone) * 4;
+    return mat4(texelFetch(bone_palette, texel + 0), texelFetch(bone_palette, texel + 1),
+                texelFetch(bone_palette, texel + 2), texelFetch(bone_palette, texel + 3));
+}
+
+// Model-space matrix of the vertex, the influences blended.
+mat4 get_skin_matrix()
+{
+    return get_bone_matrix(aBoneIds.x) * aBoneWeights.x + get_bone_matrix(aBoneIds.y) * aBoneWeights.y +
+           get_bone_matrix(aBoneIds.z) * aBoneWeights.z + get_bone_matrix(aBoneIds.w) * aBoneWeights.w;
+}
@@ -0,0 +1,13 @@
+// Texture array slots, see TextureArraySet. Atlased textures wrap inside their rectangle of the layer,
+// whole-layer textures have a (0, 0, 1, 1) rectangle.
+uniform sampler2DArray texture1;
+uniform float          texture_layer;
+uniform vec4           texture_rect; // xy offset and zw scale inside the layer
+
+vec4 sample_texture_slot(vec2 uv)
+{
+    vec2 atlas_uv = texture_rect.xy + fract(uv) * texture_rect.zw;
+    // Gradients of the unwrapped coordinates, so fract() does not pick the smallest mip at the seams.
+    return textureGrad(texture1, vec3(atlas_uv, texture_layer), dFdx(uv) * texture_rect.zw,
+                       dFdy(uv) * texture_rect.zw);
+}
@@ -0,0 +1,4 @@
+// Per-draw object transform and per-frame camera matrices shared by the scene vertex shaders.
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
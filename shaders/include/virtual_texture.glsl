@@ -0,0 +1,56 @@
+// Virtual texturing, see VirtualTextureSystem. Tiles live in pages of one physical texture, and each
+// texture's indirection pyramid points every tile at its page, or at the nearest coarser one resident.
+uniform sampler2D vt_physical;
+uniform sampler2D vt_indirection; // RGBA8: page x, page y, the mip the page holds, 255 once valid
+uniform vec4      vt_texture;     // Width, height, coarsest mip, texture id. Zero for no virtual texture
+uniform vec3      vt_page;        // Tile size, border and physical texture size, in texels
+uniform float     vt_lod_bias;
+
+// Nearest mip, as GL_LINEAR_MIPMAP_NEAREST picks it. Always taking the finer one would ask for up to
+// four times the tiles.
+float get_virtual_texture_mip(vec2 uv)
+{
+    vec2  texels = uv * vt_texture.xy;
+    vec2  dx     = dFdx(texels);
+    vec2  dy     = dFdy(texels);
+    float lod    = 0.5f * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8f)) + vt_lod_bias;
+    return floor(clamp(lod, 0.0f, vt_texture.z) + 0.5f);
+}
+
+// Texels of the image along each side at a mip, as the cooker sized them.
+vec2 get_virtual_texture_size(float mip)
+{
+    return max(floor(vt_texture.xy / exp2(mip)), vec2(1.0f));
+}
+
+// Bilinear from the finest resident tile. Pages carry a border, so the filter never reads a neighbour.
+vec4 sample_virtual_texture(vec2 uv)
+{
+    float mip     = get_virtual_texture_mip(uv);
+    vec2  wrapped = fract(uv);
+    ivec2 tile    = ivec2(wrapped * get_virtual_texture_size(mip) / vt_page.x);
+    vec4  entry   = floor(texelFetch(vt_indirection, tile, int(mip)) * 255.0f + 0.5f);
+    if (entry.a < 255.0f)
+    {
+        return vec4(0.5f, 0.5f, 0.5f, 1.0f);
+    }
+
+    // A coarser entry is read at its own level, which has fewer texels across the same uv.
+    vec2 texel    = wrapped * get_virtual_texture_size(entry.b);
+    vec2 in_tile  = texel - floor(texel / vt_page.x) * vt_page.x;
+    vec2 physical = entry.xy * (vt_page.x + 2.0f * vt_page.y) + vt_page.y + in_tile;
+    return textureLod(vt_physical, physical / vt_page.z, 0.0f);
+}
+
+// The tile this fragment would like, for VirtualTextureCache::process_feedback(). Alpha zero is no texture.
+vec4 get_virtual_texture_feedback(vec2 uv)
+{
+    if (vt_texture.x == 0.0f)
+    {
+        return vec4(0.0f);
+    }
+
+    float mip  = get_virtual_texture_mip(uv);
+    ivec2 tile = ivec2(fract(uv) * get_virtual_texture_size(mip) / vt_page.x);
+    return vec4(vec2(tile), mip, vt_texture.w + 1.0f) / 255.0f;
+}
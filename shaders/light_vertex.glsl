@@ -3,9 +3,7 @@ layout (location = 0) in vec3 aPos;
 
 out vec2 TexCoord;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "include/transforms.glsl"
 
 void main()
 {
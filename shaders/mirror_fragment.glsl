@@ -3,6 +3,7 @@
 out vec4 FragColor;
 
 in vec2 TexCoords;
+in vec4 ReflectionPosition;
 
 uniform sampler2D screen_texture;
 
@@ -17,7 +18,7 @@ void main()
     }
     else
     {
-        vec4 color = texture(screen_texture, TexCoords);
-        FragColor = color;
+        vec2 reflection_uv = ReflectionPosition.xy / ReflectionPosition.w * 0.5f + 0.5f;
+        FragColor = texture(screen_texture, reflection_uv);
     }
 }
@@ -1,12 +1,21 @@
 #version 330 core
 
+// The unit quad of FullscreenQuad, placed on the mirror by model.
 layout(location = 0) in vec2 aPos;
 layout(location = 1) in vec2 aTexCoords;
 
+#include "include/transforms.glsl"
+
+// Camera of the reflection, the target is looked up where it projects the mirror's surface.
+uniform mat4 reflection_view_projection;
+
 out vec2 TexCoords;
+out vec4 ReflectionPosition;
 
 void main()
 {
-    gl_Position = vec4(aPos.x, aPos.y, 0.0f, 1.0f);
+    vec4 world_position = model * vec4(aPos, 0.0f, 1.0f);
+    gl_Position = projection * view * world_position;
     TexCoords = aTexCoords;
+    ReflectionPosition = reflection_view_projection * world_position;
 }
@@ -0,0 +1,37 @@
+#version 330 core
+
+in vec2 TexCoords;
+
+out vec4 FragColor;
+
+#include "include/material.glsl"
+
+#if defined(VIRTUAL_TEXTURES) || defined(VIRTUAL_TEXTURE_FEEDBACK)
+#include "include/virtual_texture.glsl"
+#endif
+
+#ifndef ALPHA_CUTOFF
+#define ALPHA_CUTOFF 0.1f
+#endif
+
+void main()
+{
+#ifdef VIRTUAL_TEXTURE_FEEDBACK
+    FragColor = get_virtual_texture_feedback(TexCoords);
+#else
+#ifdef VIRTUAL_TEXTURES
+    // Meshes whose diffuse map is not virtual keep sampling it whole, see VirtualTextureSystem::bind().
+    vec4 diffuse = vt_texture.x > 0.0f ? sample_virtual_texture(TexCoords) * vec4(1.0f, 1.0f, 1.0f, diffuse_color.a)
+                                       : sample_material_diffuse(TexCoords);
+#else
+    vec4 diffuse = sample_material_diffuse(TexCoords);
+#endif
+#ifdef ALPHA_TEST
+    if (diffuse.a < ALPHA_CUTOFF)
+    {
+        discard;
+    }
+#endif
+    FragColor = diffuse;
+#endif
+}
@@ -0,0 +1,23 @@
+#version 430 core
+
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec3 aNormal;
+layout(location = 2) in vec2 aTexCoords;
+// Culling output, stepped per instance from the command's base instance.
+layout(location = 3) in uint aItem;
+
+#include "include/transforms.glsl"
+
+// Per-item model matrices written by GpuCulling::set_instances(), replacing the "model" uniform.
+layout(std430, binding = 0) readonly buffer ItemTransforms
+{
+    mat4 item_transforms[];
+};
+
+out vec2 TexCoords;
+
+void main()
+{
+    gl_Position = projection * view * item_transforms[aItem] * vec4(aPos, 1.0f);
+    TexCoords = aTexCoords;
+}
@@ -0,0 +1,26 @@
+#version 330 core
+
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec3 aNormal;
+layout(location = 2) in vec2 aTexCoords;
+
+#include "include/transforms.glsl"
+#ifdef SKINNING
+#include "include/skinning.glsl"
+#endif
+
+out vec2 TexCoords;
+
+void main()
+{
+    vec4 position = vec4(aPos, 1.0f);
+#ifdef SKINNING
+    // "model" is then the instance alone, the palette already places the mesh in the model.
+    if (bone_offset >= 0)
+    {
+        position = get_skin_matrix() * position;
+    }
+#endif
+    gl_Position = projection * view * model * position;
+    TexCoords = aTexCoords;
+}
@@ -0,0 +1,34 @@
+#version 330 core
+
+// Blends the outline over the frame: texels outside the selection within outline_width of the
+// nearest selected texel, with a one texel soft edge.
+out vec4 FragColor;
+
+#define NO_SEED 65535u
+
+uniform sampler2D  selection_mask;
+uniform usampler2D seeds;
+uniform float      outline_width;
+uniform vec4       outline_color;
+
+void main()
+{
+    ivec2 position = ivec2(gl_FragCoord.xy);
+    if (texelFetch(selection_mask, position, 0).r > 0.0f)
+    {
+        discard;
+    }
+
+    uvec2 seed = texelFetch(seeds, position, 0).xy;
+    if (seed.x == NO_SEED)
+    {
+        discard;
+    }
+
+    float coverage = clamp(outline_width + 0.5f - distance(vec2(seed), vec2(position)), 0.0f, 1.0f);
+    if (coverage <= 0.0f)
+    {
+        discard;
+    }
+    FragColor = vec4(outline_color.rgb, outline_color.a * coverage);
+}
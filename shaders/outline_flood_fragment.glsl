@@ -0,0 +1,56 @@
+#version 330 core
+
+// Jump flood over the selection mask. Every texel ends up holding the coordinates of the nearest
+// selected texel, or NO_SEED. OUTLINE_SEED builds the first image from the mask, the other passes
+// look at 9 texels step apart and keep the closest seed they point to.
+out uvec2 nearest_seed;
+
+#define NO_SEED 65535u
+
+#ifdef OUTLINE_SEED
+uniform sampler2D selection_mask;
+
+void main()
+{
+    bool selected = texelFetch(selection_mask, ivec2(gl_FragCoord.xy), 0).r > 0.0f;
+    nearest_seed  = selected ? uvec2(gl_FragCoord.xy) : uvec2(NO_SEED);
+}
+#else
+uniform usampler2D seeds;
+uniform int        step_size;
+
+void main()
+{
+    ivec2 position = ivec2(gl_FragCoord.xy);
+    ivec2 size     = textureSize(seeds, 0);
+
+    uvec2 best          = uvec2(NO_SEED);
+    float best_distance = 1e20f;
+    for (int y = -1; y <= 1; y++)
+    {
+        for (int x = -1; x <= 1; x++)
+        {
+            ivec2 neighbour = position + ivec2(x, y) * step_size;
+            if (any(lessThan(neighbour, ivec2(0))) || any(greaterThanEqual(neighbour, size)))
+            {
+                continue;
+            }
+
+            uvec2 seed = texelFetch(seeds, neighbour, 0).xy;
+            if (seed.x == NO_SEED)
+            {
+                continue;
+            }
+
+            vec2  offset   = vec2(seed) - vec2(position);
+            float seed_distance = dot(offset, offset);
+            if (seed_distance < best_distance)
+            {
+                best          = seed;
+                best_distance = seed_distance;
+            }
+        }
+    }
+    nearest_seed = best;
+}
+#endif
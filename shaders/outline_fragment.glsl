@@ -2,7 +2,10 @@
 
 out vec4 FragColor;
 
+// 1 to SELECTION_MAX_ID, written to an R8 mask where 0 means not selected.
+uniform float selection_id;
+
 void main()
 {
-    FragColor = vec4(1.0f, 1.0f, 1.0f, 1.0f);
+    FragColor = vec4(selection_id / 255.0f, 0.0f, 0.0f, 1.0f);
 }
@@ -7,6 +7,12 @@ in vec2 TexCoords;
 uniform sampler2D screen_texture;
 uniform float screen_height;
 uniform float screen_width;
+// Part of screen_texture holding the image, (1, 1) when all of it does.
+uniform vec2 uv_scale;
+
+#ifndef SHARPEN_STRENGTH
+#define SHARPEN_STRENGTH 0.5f
+#endif
 
 void main()
 {
@@ -27,15 +33,29 @@ void main()
             vec2(offset_w, -offset_h) // Bottom right
         );
 
+#ifdef SHARPEN
+    // Unsharp mask over the bilinear result, gives back some of the detail lost to upscaling.
+    float kernel[9] = float[](
+            0.0f, -SHARPEN_STRENGTH, 0.0f,
+            -SHARPEN_STRENGTH, 1.0f + 4.0f * SHARPEN_STRENGTH, -SHARPEN_STRENGTH,
+            0.0f, -SHARPEN_STRENGTH, 0.0f
+        );
+#else
     float kernel[9] = float[](
             0.0f, 0.0f, 0.0f,
             0.0f, 1.0f, 0.0f,
             0.0f, 0.0f, 0.0f
         );
+#endif
+
+    // Clamped half a texel inside the used part so the filter never reads what lies beyond it.
+    vec2 uv_min = vec2(0.5f * offset_w, 0.5f * offset_h);
+    vec2 uv_max = uv_scale - uv_min;
 
     vec3 sample_texture[9];
     for (int i = 0; i < 9; i++) {
-        sample_texture[i] = vec3(texture(screen_texture, TexCoords.st + offsets[i]));
+        vec2 uv = clamp(TexCoords.st * uv_scale + offsets[i], uv_min, uv_max);
+        sample_texture[i] = vec3(texture(screen_texture, uv));
     }
 
     vec3 color = vec3(0.0f);
@@ -43,5 +63,5 @@ void main()
         color += sample_texture[i] * kernel[i];
     }
 
-    FragColor = vec4(color, 1.0f);
+    FragColor = vec4(max(color, vec3(0.0f)), 1.0f);
 }
@@ -0,0 +1,22 @@
+#version 330 core
+
+out vec4 FragColor;
+
+in vec3 WorldPosition;
+in vec3 Normal;
+
+// Grass on the flats and low ground, rock on the slopes, snow near the top of the height range.
+const vec3 GRASS_COLOR = vec3(0.28f, 0.42f, 0.18f);
+const vec3 ROCK_COLOR  = vec3(0.42f, 0.38f, 0.34f);
+const vec3 SNOW_COLOR  = vec3(0.9f, 0.92f, 0.95f);
+const vec3 SUN_DIRECTION = vec3(0.36f, 0.8f, 0.48f);
+
+void main()
+{
+    vec3 normal = normalize(Normal);
+    vec3 color = mix(ROCK_COLOR, GRASS_COLOR, smoothstep(0.7f, 0.9f, normal.y));
+    color = mix(color, SNOW_COLOR, smoothstep(7.0f, 9.0f, WorldPosition.y) * smoothstep(0.5f, 0.8f, normal.y));
+
+    float diffuse = max(dot(normal, normalize(SUN_DIRECTION)), 0.0f);
+    FragColor = vec4(color * (0.3f + 0.7f * diffuse), 1.0f);
+}
@@ -0,0 +1,18 @@
+#version 330 core
+
+// TerrainVertex, already in world space.
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec3 aNormal;
+
+#include "include/transforms.glsl"
+
+out vec3 WorldPosition;
+out vec3 Normal;
+
+void main()
+{
+    vec4 world_position = model * vec4(aPos, 1.0f);
+    gl_Position = projection * view * world_position;
+    WorldPosition = world_position.xyz;
+    Normal = mat3(model) * aNormal;
+}
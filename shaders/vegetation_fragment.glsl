@@ -0,0 +1,26 @@
+#version 330 core
+
+in vec2 TexCoords;
+in float Tint;
+
+out vec4 FragColor;
+
+uniform sampler2D texture1;
+
+#ifndef ALPHA_CUTOFF
+#define ALPHA_CUTOFF 0.5f
+#endif
+
+void main()
+{
+    vec4 tex_color = texture(texture1, TexCoords);
+    // Without it the depth test happens before the shader runs. The color pass after a depth prepass
+    // leaves it out, the prepass already discarded these fragments.
+#ifdef ALPHA_TEST
+    if (tex_color.a < ALPHA_CUTOFF)
+    {
+        discard;
+    }
+#endif
+    FragColor = vec4(tex_color.rgb * Tint, 1.0f);
+}
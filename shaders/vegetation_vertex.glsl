@@ -0,0 +1,23 @@
+#version 330 core
+
+layout(location = 0) in vec2 aCorner;   // x across the billboard in [-0.5, 0.5], y up it in [0, 1]
+layout(location = 2) in vec4 aInstance; // Base position, height
+layout(location = 3) in vec2 aShape;    // Width, tint
+
+#include "include/transforms.glsl"
+
+// The color pass tests GL_EQUAL against the prepass depth, so both must compute exactly the same position.
+invariant gl_Position;
+
+out vec2 TexCoords;
+out float Tint;
+
+void main()
+{
+    // Turned around the vertical axis to face the camera, using the view's right vector.
+    vec3 right = normalize(vec3(view[0][0], 0.0f, view[2][0]));
+    vec3 world_position = aInstance.xyz + right * (aCorner.x * aShape.x) + vec3(0.0f, aCorner.y * aInstance.w, 0.0f);
+    gl_Position = projection * view * model * vec4(world_position, 1.0f);
+    TexCoords = vec2(aCorner.x + 0.5f, aCorner.y);
+    Tint = aShape.y;
+}
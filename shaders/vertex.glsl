@@ -3,14 +3,19 @@
 layout(location = 0) in vec3 aPos;
 layout(location = 1) in vec2 aTexCoords;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "include/transforms.glsl"
 
 out vec2 TexCoords;
+#ifdef CLUSTERED_LIGHTING
+out vec3 ViewPosition;
+#endif
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0f);
+    vec4 view_position = view * model * vec4(aPos, 1.0f);
+    gl_Position = projection * view_position;
     TexCoords = aTexCoords;
+#ifdef CLUSTERED_LIGHTING
+    ViewPosition = view_position.xyz;
+#endif
 }
@@ -0,0 +1,392 @@
+#include "learn_opengl/animation.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "glm/ext/matrix_float4x4.hpp"
+#include "glm/ext/vector_float3.hpp"
+#include "glm/ext/vector_float4.hpp"
+#include "glm/geometric.hpp"
+#include "glm/gtc/type_ptr.hpp"
+#include "learn_opengl/job_system.hpp"
+#include "learn_opengl/mesh.hpp"
+#include "learn_opengl/resource_registry.hpp"
+#include "learn_opengl/shader.hpp"
+#include "learn_opengl/simd_math.hpp"
+
+namespace
+{
+// Cached keys per channel: position, rotation, scale.
+const unsigned int KEYS_PER_CHANNEL = 3;
+
+const std::size_t MIN_PALETTE_BYTES = 64 * sizeof(glm::mat4);
+
+#ifdef LEARN_OPENGL_SSE
+// Dot product of the 4 lanes, in every lane.
+__m128 dot4(__m128 p_a, __m128 p_b)
+{
+    __m128 products = _mm_mul_ps(p_a, p_b);
+    __m128 pairs    = _mm_add_ps(products, _mm_shuffle_ps(products, products, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_add_ps(pairs, _mm_shuffle_ps(pairs, pairs, _MM_SHUFFLE(1, 0, 3, 2)));
+}
+#endif
+
+// Index of the last key at or before p_time, 0 before the first. Tries the cached key and the one after
+// it before searching, and leaves the answer in p_cached.
+std::uint32_t find_key(const std::vector<float>& p_times, float p_time, std::uint32_t& p_cached, std::size_t& p_hits)
+{
+    std::uint32_t last   = (std::uint32_t) p_times.size() - 1;
+    auto          covers = [&p_times, p_time, last](std::uint32_t k)
+    { return k <= last && (k == 0 || p_times[k] <= p_time) && (k == last || p_time < p_times[k + 1]); };
+
+    if (covers(p_cached))
+    {
+        p_hits++;
+        return p_cached;
+    }
+    if (covers(p_cached + 1))
+    {
+        p_hits++;
+        return ++p_cached;
+    }
+
+    std::uint32_t after = (std::uint32_t) (std::upper_bound(p_times.begin(), p_times.end(), p_time) - p_times.begin());
+    p_cached            = after == 0 ? 0 : after - 1;
+    return p_cached;
+}
+
+// Weight of key k + 1 against key k at p_time, 0 past the last key.
+float get_blend(const std::vector<float>& p_times, std::uint32_t p_key, float p_time)
+{
+    if (p_key + 1 >= p_times.size())
+    {
+        return 0.0f;
+    }
+    float span = p_times[p_key + 1] - p_times[p_key];
+    return span > 0.0f ? std::clamp((p_time - p_times[p_key]) / span, 0.0f, 1.0f) : 0.0f;
+}
+
+// Normalized lerp along the shorter arc. Close enough to slerp between keys a frame or so apart.
+glm::vec4 nlerp(const glm::vec4& p_a, const glm::vec4& p_b, float p_blend)
+{
+#ifdef LEARN_OPENGL_SSE
+    __m128 a    = _mm_loadu_ps(&p_a.x);
+    __m128 b    = _mm_loadu_ps(&p_b.x);
+    float  sign = _mm_cvtss_f32(dot4(a, b)) < 0.0f ? -1.0f : 1.0f;
+
+    __m128 q = _mm_add_ps(_mm_mul_ps(a, _mm_set1_ps(1.0f - p_blend)), _mm_mul_ps(b, _mm_set1_ps(sign * p_blend)));
+    q        = _mm_div_ps(q, _mm_sqrt_ps(dot4(q, q)));
+
+    glm::vec4 result;
+    _mm_storeu_ps(&result.x, q);
+    return result;
+#else
+    float sign = glm::dot(p_a, p_b) < 0.0f ? -1.0f : 1.0f;
+    return glm::normalize(p_a * (1.0f - p_blend) + p_b * (sign * p_blend));
+#endif
+}
+
+// Translation * rotation * scale, p_rotation a unit quaternion (xyzw).
+void compose(const glm::vec3& p_position, const glm::vec4& p_rotation, const glm::vec3& p_scale, glm::mat4& p_out)
+{
+    float x = p_rotation.x, y = p_rotation.y, z = p_rotation.z, w = p_rotation.w;
+    float xx = 2.0f * x * x, yy = 2.0f * y * y, zz = 2.0f * z * z;
+    float xy = 2.0f * x * y, xz = 2.0f * x * z, yz = 2.0f * y * z;
+    float wx = 2.0f * w * x, wy = 2.0f * w * y, wz = 2.0f * w * z;
+
+    p_out[0] = glm::vec4(1.0f - yy - zz, xy + wz, xz - wy, 0.0f) * p_scale.x;
+    p_out[1] = glm::vec4(xy - wz, 1.0f - xx - zz, yz + wx, 0.0f) * p_scale.y;
+    p_out[2] = glm::vec4(xz + wy, yz - wx, 1.0f - xx - yy, 0.0f) * p_scale.z;
+    p_out[3] = glm::vec4(p_position, 1.0f);
+}
+} // namespace
+
+static_assert(sizeof(Vertex) == 8 * sizeof(float), "skin_vertices writes a Vertex as two 4-float stores");
+
+void skin_vertices(const Vertex* p_vertices, const SkinWeights* p_weights, std::size_t p_count,
+                   const glm::mat4* p_palette, Vertex* p_out)
+{
+    for (std::size_t v = 0; v < p_count; v++)
+    {
+        const Vertex&      vertex  = p_vertices[v];
+        const SkinWeights& weights = p_weights[v];
+
+#ifdef LEARN_OPENGL_SSE
+        // Columns of the blended matrix.
+        __m128 c0 = _mm_setzero_ps();
+        __m128 c1 = _mm_setzero_ps();
+        __m128 c2 = _mm_setzero_ps();
+        __m128 c3 = _mm_setzero_ps();
+        for (unsigned int k = 0; k < MAX_BONE_INFLUENCES; k++)
+        {
+            if (weights.weights[k] == 0)
+            {
+                continue;
+            }
+            __m128       weight = _mm_set1_ps(weights.weights[k] * (1.0f / 255.0f));
+            const float* bone   = glm::value_ptr(p_palette[weights.bones[k]]);
+            c0                  = _mm_add_ps(c0, _mm_mul_ps(_mm_loadu_ps(bone + 0), weight));
+            c1                  = _mm_add_ps(c1, _mm_mul_ps(_mm_loadu_ps(bone + 4), weight));
+            c2                  = _mm_add_ps(c2, _mm_mul_ps(_mm_loadu_ps(bone + 8), weight));
+            c3                  = _mm_add_ps(c3, _mm_mul_ps(_mm_loadu_ps(bone + 12), weight));
+        }
+
+        __m128 position = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(vertex.position.x)),
+                                                _mm_mul_ps(c1, _mm_set1_ps(vertex.position.y))),
+                                     _mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(vertex.position.z)), c3));
+        // The palette is affine, so the w lane of the normal stays 0.
+        __m128 normal = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(vertex.normal.x)),
+                                              _mm_mul_ps(c1, _mm_set1_ps(vertex.normal.y))),
+                                   _mm_mul_ps(c2, _mm_set1_ps(vertex.normal.z)));
+        __m128 length_squared = dot4(normal, normal);
+        if (_mm_cvtss_f32(length_squared) > 0.0f)
+        {
+            normal = _mm_div_ps(normal, _mm_sqrt_ps(length_squared));
+        }
+        __m128 tex_coords = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*) &vertex.tex_coords.x);
+
+        // {px py pz nx} {ny nz u v}
+        __m128 z_and_nx = _mm_shuffle_ps(position, normal, _MM_SHUFFLE(0, 0, 2, 2));
+        float* out      = &p_out[v].position.x;
+        _mm_storeu_ps(out, _mm_shuffle_ps(position, z_and_nx, _MM_SHUFFLE(2, 0, 1, 0)));
+        _mm_storeu_ps(out + 4, _mm_shuffle_ps(normal, tex_coords, _MM_SHUFFLE(1, 0, 2, 1)));
+#else
+        glm::mat4 skin(0.0f);
+        for (unsigned int k = 0; k < MAX_BONE_INFLUENCES; k++)
+        {
+            skin += p_palette[weights.bones[k]] * (weights.weights[k] * (1.0f / 255.0f));
+        }
+
+        glm::vec3 normal    = glm::vec3(skin * glm::vec4(vertex.normal, 0.0f));
+        float     length    = glm::length(normal);
+        p_out[v].position   = glm::vec3(skin * glm::vec4(vertex.position, 1.0f));
+        p_out[v].normal     = length > 0.0f ? normal / length : normal;
+        p_out[v].tex_coords = vertex.tex_coords;
+#endif
+    }
+}
+
+AnimationPlayer::AnimationPlayer(const Skeleton& p_skeleton, const std::vector<AnimationClip>& p_clips)
+    : skeleton(p_skeleton), clips(p_clips)
+{
+    instance_count = 0;
+    key_stride     = 0;
+    for (const AnimationClip& clip : clips)
+    {
+        key_stride = std::max(key_stride, (unsigned int) clip.channels.size() * KEYS_PER_CHANNEL);
+    }
+    stats = AnimationStats();
+}
+
+void AnimationPlayer::set_instance_count(unsigned int p_count, unsigned int p_seed)
+{
+    instance_count = p_count;
+    instance_clips.resize(p_count);
+    start_times.resize(p_count);
+    cached_keys.assign((std::size_t) p_count * key_stride, 0);
+    palettes.resize((std::size_t) p_count * get_bone_count());
+
+    std::mt19937 random(p_seed);
+    for (unsigned int i = 0; i < p_count; i++)
+    {
+        instance_clips[i] = clips.empty() ? 0 : i % (unsigned int) clips.size();
+        float duration    = clips.empty() ? 0.0f : clips[instance_clips[i]].duration;
+        start_times[i]    = std::uniform_real_distribution<float>(0.0f, std::max(duration, 0.0f))(random);
+    }
+}
+
+void AnimationPlayer::update(double p_time, JobSystem* p_jobs)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    std::atomic<std::size_t> key_searches(0);
+    std::atomic<std::size_t> key_hits(0);
+    auto                     body = [this, p_time, &key_searches, &key_hits](std::size_t p_begin, std::size_t p_end)
+    {
+        std::size_t searches = 0;
+        std::size_t hits     = 0;
+        evaluate(p_time, p_begin, p_end, searches, hits);
+        key_searches += searches;
+        key_hits += hits;
+    };
+
+    if (p_jobs)
+    {
+        p_jobs->parallel_for(0, instance_count, ANIMATION_INSTANCE_GRAIN, body);
+    }
+    else
+    {
+        body(0, instance_count);
+    }
+
+    stats.instance_count        = instance_count;
+    stats.bone_count            = get_bone_count();
+    stats.key_searches          = key_searches;
+    stats.key_hits              = key_hits;
+    stats.evaluate_milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+                                          .count();
+}
+
+void AnimationPlayer::evaluate(double p_time, std::size_t p_begin, std::size_t p_end, std::size_t& p_key_searches,
+                               std::size_t& p_key_hits)
+{
+    std::size_t            joint_count = skeleton.parents.size();
+    unsigned int           bone_count  = get_bone_count();
+    std::vector<glm::mat4> locals(joint_count);
+    std::vector<glm::mat4> globals(joint_count);
+
+    for (std::size_t i = p_begin; i < p_end; i++)
+    {
+        std::copy(skeleton.bind_locals.begin(), skeleton.bind_locals.end(), locals.begin());
+
+        if (!clips.empty())
+        {
+            const AnimationClip& clip = clips[instance_clips[i]];
+            float                time = clip.duration > 0.0f
+                                                ? (float) std::fmod(p_time + start_times[i], (double) clip.duration)
+                                                : 0.0f;
+
+            std::uint32_t* keys = &cached_keys[i * key_stride];
+            for (const AnimationChannel& channel : clip.channels)
+            {
+                std::uint32_t p = find_key(channel.position_times, time, keys[0], p_key_hits);
+                std::uint32_t r = find_key(channel.rotation_times, time, keys[1], p_key_hits);
+                std::uint32_t s = find_key(channel.scale_times, time, keys[2], p_key_hits);
+                keys += KEYS_PER_CHANNEL;
+                p_key_searches += KEYS_PER_CHANNEL;
+
+                // The last key has no next one, get_blend() is 0 there.
+                std::uint32_t p_next = std::min(p + 1, (std::uint32_t) channel.positions.size() - 1);
+                std::uint32_t r_next = std::min(r + 1, (std::uint32_t) channel.rotations.size() - 1);
+                std::uint32_t s_next = std::min(s + 1, (std::uint32_t) channel.scales.size() - 1);
+
+                glm::vec3 position = glm::mix(channel.positions[p], channel.positions[p_next],
+                                              get_blend(channel.position_times, p, time));
+                glm::vec4 rotation = nlerp(channel.rotations[r], channel.rotations[r_next],
+                                           get_blend(channel.rotation_times, r, time));
+                glm::vec3 scale    = glm::mix(channel.scales[s], channel.scales[s_next],
+                                              get_blend(channel.scale_times, s, time));
+                compose(position, rotation, scale, locals[channel.joint]);
+            }
+        }
+
+        // Parents come first, so one pass resolves the hierarchy.
+        for (std::size_t j = 0; j < joint_count; j++)
+        {
+            int parent = skeleton.parents[j];
+            if (parent < 0)
+            {
+                globals[j] = locals[j];
+            }
+            else
+            {
+                mat4_multiply(globals[parent], locals[j], globals[j]);
+            }
+        }
+
+        glm::mat4* palette = &palettes[i * bone_count];
+        for (unsigned int b = 0; b < bone_count; b++)
+        {
+            mat4_multiply(globals[skeleton.bone_joints[b]], skeleton.bone_offsets[b], palette[b]);
+        }
+    }
+}
+
+unsigned int AnimationPlayer::get_instance_count() const
+{
+    return instance_count;
+}
+
+unsigned int AnimationPlayer::get_bone_count() const
+{
+    return (unsigned int) skeleton.bone_joints.size();
+}
+
+const std::vector<glm::mat4>& AnimationPlayer::get_palettes() const
+{
+    return palettes;
+}
+
+AnimationStats AnimationPlayer::get_stats() const
+{
+    return stats;
+}
+
+BonePalette::BonePalette()
+{
+    capacity = MIN_PALETTE_BYTES;
+
+    GLint max_size = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_size);
+    max_texels = (std::size_t) max_size;
+
+    glGenBuffers(1, &buffer);
+    glGenTextures(1, &texture);
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferData(GL_TEXTURE_BUFFER, capacity, NULL, GL_STREAM_DRAW);
+    glBindTexture(GL_TEXTURE_BUFFER, texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    ResourceRegistry& registry = ResourceRegistry::get_instance();
+    registry.track(RESOURCE_BUFFER, buffer, capacity, "bone_palette");
+    // The storage is the buffer's, the texture only views it.
+    registry.track(RESOURCE_TEXTURE, texture, 0, "bone_palette");
+}
+
+BonePalette::~BonePalette()
+{
+    ResourceRegistry& registry = ResourceRegistry::get_instance();
+    registry.untrack(RESOURCE_BUFFER, buffer);
+    registry.untrack(RESOURCE_TEXTURE, texture);
+    glDeleteTextures(1, &texture);
+    glDeleteBuffers(1, &buffer);
+}
+
+void BonePalette::upload(const std::vector<glm::mat4>& p_palettes)
+{
+    std::size_t bytes = p_palettes.size() * sizeof(glm::mat4);
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+
+    if (bytes > capacity)
+    {
+        // Grow geometrically so a slowly rising instance count does not reallocate every frame.
+        capacity = std::max(capacity * 2, bytes);
+
+        ResourceRegistry& registry = ResourceRegistry::get_instance();
+        registry.untrack(RESOURCE_BUFFER, buffer);
+        registry.track(RESOURCE_BUFFER, buffer, capacity, "bone_palette");
+
+        if (p_palettes.size() * BONE_PALETTE_TEXELS > max_texels)
+        {
+            std::cout << "ERROR::BONE_PALETTE::TOO_LARGE\n"
+                      << p_palettes.size() << " matrices, the texture buffer holds " << max_texels / BONE_PALETTE_TEXELS
+                      << std::endl;
+        }
+    }
+
+    glBufferData(GL_TEXTURE_BUFFER, capacity, NULL, GL_STREAM_DRAW);
+    if (bytes > 0)
+    {
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, p_palettes.data());
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void BonePalette::bind(Shader& p_shader) const
+{
+    glActiveTexture(GL_TEXTURE0 + BONE_PALETTE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, texture);
+    glActiveTexture(GL_TEXTURE0);
+    p_shader.setInt("bone_palette", BONE_PALETTE_UNIT);
+}
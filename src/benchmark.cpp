@@ -0,0 +1,1117 @@
+#include "learn_opengl/benchmark.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <assimp/mesh.h>
+#include <glad/glad.h>
+
+#include "glm/ext/matrix_clip_space.hpp"
+#include "glm/ext/matrix_float4x4.hpp"
+#include "glm/ext/matrix_transform.hpp"
+#include "glm/ext/vector_float3.hpp"
+#include "glm/gtc/quaternion.hpp"
+#include "glm/trigonometric.hpp"
+#include "learn_opengl/animation.hpp"
+#include "learn_opengl/clustered_lighting.hpp"
+#include "learn_opengl/entity_registry.hpp"
+#include "learn_opengl/frame_pipeline.hpp"
+#include "learn_opengl/frustum.hpp"
+#include "learn_opengl/job_system.hpp"
+#include "learn_opengl/mesh.hpp"
+#include "learn_opengl/meshlet.hpp"
+#include "learn_opengl/model.hpp"
+#include "learn_opengl/scene_graph.hpp"
+#include "learn_opengl/terrain.hpp"
+#include "learn_opengl/texture_array.hpp"
+#include "learn_opengl/vegetation.hpp"
+#include "learn_opengl/virtual_texture.hpp"
+
+struct BenchmarkEntry
+{
+    const char* name;
+    int (*function)();
+};
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static int bench_job_system()
+{
+    const std::size_t ITEM_COUNT = 1 << 20;
+    const std::size_t GRAIN_SIZE = 1024;
+    const int         REPEATS = 10;
+
+    std::vector<float> values(ITEM_COUNT);
+    unsigned int       max_threads = std::max(1u, std::thread::hardware_concurrency());
+    double             single_thread_ms = 0.0;
+
+    std::cout << "job_system: parallel_for over " << ITEM_COUNT << " items, grain " << GRAIN_SIZE << std::endl;
+    std::cout << "threads      ms  speedup   steals  steal_rate  contentions" << std::endl;
+
+    // The calling thread helps in parallel_for, so N threads means N - 1 workers.
+    for (unsigned int threads = 1; threads <= max_threads; threads++)
+    {
+        JobSystem jobs(threads - 1);
+
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < REPEATS; r++)
+        {
+            jobs.parallel_for(0, ITEM_COUNT, GRAIN_SIZE,
+                              [&values](std::size_t begin, std::size_t end)
+                              {
+                                  for (std::size_t i = begin; i < end; i++)
+                                  {
+                                      float x = (float) i * 0.001f;
+                                      values[i] = std::sqrt(std::abs(std::sin(x) * std::cos(x * 0.5f))) + x;
+                                  }
+                              });
+        }
+        double ms = elapsed_ms(start) / REPEATS;
+
+        if (threads == 1)
+        {
+            single_thread_ms = ms;
+        }
+
+        JobCounters counters = jobs.get_counters();
+        double      steal_rate =
+                counters.steal_attempts == 0 ? 0.0 : (double) counters.steals / (double) counters.steal_attempts;
+
+        std::cout << std::setw(7) << threads << std::setw(8) << std::fixed << std::setprecision(2) << ms
+                  << std::setw(9) << single_thread_ms / ms << std::setw(9) << counters.steals << std::setw(12)
+                  << steal_rate << std::setw(13) << counters.lock_contentions << std::endl;
+    }
+
+    return 0;
+}
+
+static int bench_scene_graph()
+{
+    const unsigned int NODE_COUNTS[] = {1 << 14, 1 << 18, 1 << 20};
+    const unsigned int CHANGED_COUNTS[] = {1, 64, 4096};
+    const unsigned int BRANCHING = 4;
+    const int          REPEATS = 20;
+
+    std::cout << "scene_graph: 4-ary tree, moving leaves (and the root for a full update)" << std::endl;
+    std::cout << "   nodes  changed   updated   us/update  ns/updated" << std::endl;
+
+    for (unsigned int node_count : NODE_COUNTS)
+    {
+        SceneGraph graph;
+        graph.reserve(node_count);
+        graph.add_node(SCENE_NODE_NONE, glm::vec3(0.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f));
+        for (unsigned int i = 1; i < node_count; i++)
+        {
+            graph.add_node((i - 1) / BRANCHING, glm::vec3(1.0f, 0.0f, 0.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
+                           glm::vec3(1.0f));
+        }
+        graph.update_world_transforms();
+
+        unsigned int first_leaf = (node_count - 1) / BRANCHING + 1;
+        unsigned int leaf_count = node_count - first_leaf;
+
+        auto report = [&](unsigned int changed, const std::vector<unsigned int>& moved)
+        {
+            unsigned int updated = 0;
+            auto         start = std::chrono::steady_clock::now();
+            for (int r = 0; r < REPEATS; r++)
+            {
+                for (unsigned int node : moved)
+                {
+                    graph.set_local_position(node, glm::vec3((float) r, 0.0f, 0.0f));
+                }
+                updated = graph.update_world_transforms();
+            }
+            double us = elapsed_ms(start) * 1000.0 / REPEATS;
+
+            std::cout << std::setw(8) << node_count << std::setw(9) << changed << std::setw(10) << updated
+                      << std::setw(12) << std::fixed << std::setprecision(2) << us << std::setw(12)
+                      << us * 1000.0 / std::max(1u, updated) << std::endl;
+        };
+
+        for (unsigned int changed : CHANGED_COUNTS)
+        {
+            std::vector<unsigned int> moved;
+            for (unsigned int i = 0; i < changed; i++)
+            {
+                moved.push_back(first_leaf + (unsigned int) ((std::size_t) i * leaf_count / changed));
+            }
+            report(changed, moved);
+        }
+
+        report(1, std::vector<unsigned int>{0});
+    }
+
+    return 0;
+}
+
+static int bench_entities()
+{
+    const unsigned int ENTITY_COUNT = 1000000;
+    const unsigned int GRID_SIZE = 1000;
+    const int          REPEATS = 10;
+
+    EntityRegistry registry;
+    registry.reserve(ENTITY_COUNT);
+
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < ENTITY_COUNT; i++)
+    {
+        glm::vec3           position((float) (i % GRID_SIZE) * 2.0f, 0.0f, (float) (i / GRID_SIZE) * 2.0f);
+        RenderableComponent renderable = {1 + i % 4, 36, 1 + i % 3, GL_TEXTURE_2D, TEXTURE_SLOT_NONE};
+        registry.create_render_object(glm::translate(glm::mat4(1.0f), position), renderable, glm::vec3(0.0f), 0.87f);
+    }
+    double create_ms = elapsed_ms(start);
+
+    start = std::chrono::steady_clock::now();
+    update_transforms(registry);
+    double first_update_ms = elapsed_ms(start);
+
+    // Looking over a corner of the grid so roughly a sixth of it survives culling.
+    glm::mat4 view = glm::lookAt(glm::vec3(-10.0f, 50.0f, -10.0f), glm::vec3(500.0f, 0.0f, 500.0f),
+                                 glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+    Frustum   frustum = make_frustum(projection * view);
+
+    double update_ms = 0.0;
+    double cull_ms = 0.0;
+    double submit_ms = 0.0;
+
+    FramePacket packet;
+    for (int r = 0; r < REPEATS; r++)
+    {
+        start = std::chrono::steady_clock::now();
+        update_transforms(registry);
+        update_ms += elapsed_ms(start);
+
+        start = std::chrono::steady_clock::now();
+        cull_entities(registry, frustum);
+        cull_ms += elapsed_ms(start);
+
+        packet.clear();
+        start = std::chrono::steady_clock::now();
+        submit_renderables(registry, packet);
+        submit_ms += elapsed_ms(start);
+    }
+
+    auto print_row = [](const char* label, double ms)
+    {
+        std::cout << std::setw(22) << label << std::setw(10) << std::fixed << std::setprecision(2) << ms
+                  << std::setw(12) << (double) ENTITY_COUNT / (ms * 1000.0) << std::endl;
+    };
+
+    std::cout << "entities: " << ENTITY_COUNT << " render objects, " << JobSystem::get_instance().get_worker_count()
+              << " workers" << std::endl;
+    std::cout << "                system        ms  M entity/s" << std::endl;
+    print_row("create", create_ms);
+    print_row("first transform update", first_update_ms);
+    print_row("transform update", update_ms / REPEATS);
+    print_row("cull", cull_ms / REPEATS);
+    print_row("render submission", submit_ms / REPEATS);
+    std::cout << "visible instances " << packet.instance_transforms.size() << " in " << packet.draws.size()
+              << " draws" << std::endl;
+
+    return 0;
+}
+
+// CPU binning only: benchmarks run before any GL context exists, so the shading cost of 16 to 4096
+// lights is not measured here. The lights per fragment columns are the proxy for it.
+static int bench_clustered_lighting()
+{
+    const unsigned int LIGHT_COUNTS[] = {16, 64, 256, 1024, 4096};
+    const int          REPEATS = 50;
+
+    glm::mat4 view =
+            glm::lookAt(glm::vec3(0.0f, 2.0f, 0.0f), glm::vec3(0.0f, 2.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+
+    std::cout << "clustered_lighting: " << CLUSTER_TILES_X << "x" << CLUSTER_TILES_Y << "x" << CLUSTER_SLICES
+              << " clusters, lights spread over the view volume past 5 units" << std::endl;
+    std::cout << " lights   bin_ms   indices  occupied  max/cluster  avg/cluster  naive/clustered" << std::endl;
+
+    for (unsigned int light_count : LIGHT_COUNTS)
+    {
+        std::mt19937                          random(light_count);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+        std::vector<Light> lights(light_count);
+        for (Light& light : lights)
+        {
+            light.type = LIGHT_POINT;
+            light.position = glm::vec3(-40.0f + 80.0f * unit(random), -8.0f + 20.0f * unit(random),
+                                       -5.0f - 95.0f * unit(random));
+            light.radius = 2.0f + 4.0f * unit(random);
+            light.color = glm::vec3(1.0f);
+            light.intensity = 1.0f;
+            light.direction = glm::vec3(0.0f, -1.0f, 0.0f);
+            light.spot_cos_inner = 1.0f;
+            light.spot_cos_outer = 1.0f;
+        }
+
+        LightClusterer clusterer;
+        clusterer.build_clusters(projection);
+        clusterer.bin_lights(lights, view);
+
+        double bin_ms = 0.0;
+        for (int r = 0; r < REPEATS; r++)
+        {
+            clusterer.bin_lights(lights, view);
+            bin_ms += clusterer.get_stats().bin_milliseconds;
+        }
+        bin_ms /= REPEATS;
+
+        // Lights a fragment loops over: all of them in plain forward, its cluster's list here.
+        LightBinningStats stats = clusterer.get_stats();
+        double            per_cluster =
+                stats.occupied_clusters == 0 ? 0.0 : (double) stats.index_count / stats.occupied_clusters;
+
+        std::cout << std::setw(7) << light_count << std::setw(9) << std::fixed << std::setprecision(3) << bin_ms
+                  << std::setw(10) << stats.index_count << std::setw(10) << stats.occupied_clusters << std::setw(13)
+                  << stats.max_cluster_lights << std::setw(13) << std::setprecision(2) << per_cluster << std::setw(17)
+                  << (per_cluster == 0.0 ? 0.0 : light_count / per_cluster) << std::endl;
+    }
+
+    std::cout << "GPU shading cost is not benchmarked; --lights N with F3 shows the scene pass time for one count"
+              << std::endl;
+
+    return 0;
+}
+
+// The field-by-field conversion Model used before convert_meshes, kept as the reference output.
+static void convert_mesh_reference(const aiMesh* p_mesh, MeshData& p_out)
+{
+    p_out.vertices.resize(p_mesh->mNumVertices);
+    for (unsigned int i = 0; i < p_mesh->mNumVertices; i++)
+    {
+        Vertex& vertex = p_out.vertices[i];
+        vertex.position = glm::vec3(p_mesh->mVertices[i].x, p_mesh->mVertices[i].y, p_mesh->mVertices[i].z);
+        const aiVector3D* normals = p_mesh->mNormals;
+        vertex.normal = normals ? glm::vec3(normals[i].x, normals[i].y, normals[i].z) : glm::vec3(0.0f, 0.0f, 0.0f);
+        vertex.tex_coords = p_mesh->mTextureCoords[0]
+                                    ? glm::vec2(p_mesh->mTextureCoords[0][i].x, p_mesh->mTextureCoords[0][i].y)
+                                    : glm::vec2(0.0f, 0.0f);
+    }
+
+    p_out.indices.clear();
+    for (unsigned int i = 0; i < p_mesh->mNumFaces; i++)
+    {
+        for (unsigned int j = 0; j < p_mesh->mFaces[i].mNumIndices; j++)
+        {
+            p_out.indices.push_back(p_mesh->mFaces[i].mIndices[j]);
+        }
+    }
+}
+
+static bool same_bytes(const std::vector<MeshData>& p_a, const std::vector<MeshData>& p_b)
+{
+    for (std::size_t m = 0; m < p_a.size(); m++)
+    {
+        std::size_t vertex_bytes = p_a[m].vertices.size() * sizeof(Vertex);
+        std::size_t index_bytes = p_a[m].indices.size() * sizeof(unsigned int);
+        if (p_a[m].vertices.size() != p_b[m].vertices.size() || p_a[m].indices.size() != p_b[m].indices.size() ||
+            std::memcmp(p_a[m].vertices.data(), p_b[m].vertices.data(), vertex_bytes) != 0 ||
+            std::memcmp(p_a[m].indices.data(), p_b[m].indices.data(), index_bytes) != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int bench_mesh_import()
+{
+    // A few large meshes and many small ones, some without normals or texture coordinates.
+    const unsigned int MESH_COUNT = 96;
+    const unsigned int LARGE_VERTEX_COUNT = 1 << 18;
+    const unsigned int SMALL_VERTEX_COUNT = 3000;
+    const int          REPEATS = 5;
+
+    std::mt19937                          random(42);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    // Arrays live in the vectors below, the meshes only point into them.
+    std::vector<aiMesh>                  source(MESH_COUNT);
+    std::vector<std::vector<aiVector3D>> positions(MESH_COUNT), normals(MESH_COUNT), tex_coords(MESH_COUNT);
+    std::vector<std::vector<unsigned int>> face_indices(MESH_COUNT);
+    std::vector<std::vector<aiFace>>       faces(MESH_COUNT);
+    std::vector<aiMesh*>                   scene_meshes(MESH_COUNT);
+    std::size_t                            vertex_total = 0;
+
+    for (unsigned int m = 0; m < MESH_COUNT; m++)
+    {
+        unsigned int vertex_count = m % 16 == 0 ? LARGE_VERTEX_COUNT : SMALL_VERTEX_COUNT + m;
+        unsigned int face_count = vertex_count / 3;
+        vertex_total += vertex_count;
+
+        positions[m].resize(vertex_count);
+        normals[m].resize(vertex_count);
+        tex_coords[m].resize(vertex_count);
+        for (unsigned int i = 0; i < vertex_count; i++)
+        {
+            positions[m][i] = aiVector3D(unit(random), unit(random), unit(random));
+            normals[m][i] = aiVector3D(unit(random), unit(random), unit(random));
+            tex_coords[m][i] = aiVector3D(unit(random), unit(random), 0.0f);
+        }
+
+        face_indices[m].resize(face_count * 3);
+        faces[m].resize(face_count);
+        for (unsigned int f = 0; f < face_count; f++)
+        {
+            for (unsigned int j = 0; j < 3; j++)
+            {
+                face_indices[m][f * 3 + j] = (unsigned int) ((unit(random) * 0.5f + 0.5f) * (vertex_count - 1));
+            }
+            faces[m][f].mNumIndices = 3;
+            faces[m][f].mIndices = &face_indices[m][f * 3];
+        }
+
+        aiMesh& mesh = source[m];
+        mesh.mNumVertices = vertex_count;
+        mesh.mNumFaces = face_count;
+        mesh.mVertices = positions[m].data();
+        mesh.mNormals = m % 5 == 4 ? nullptr : normals[m].data();
+        mesh.mTextureCoords[0] = m % 7 == 6 ? nullptr : tex_coords[m].data();
+        mesh.mFaces = faces[m].data();
+        scene_meshes[m] = &mesh;
+    }
+
+    std::vector<MeshData> reference(MESH_COUNT);
+    for (unsigned int m = 0; m < MESH_COUNT; m++)
+    {
+        convert_mesh_reference(scene_meshes[m], reference[m]);
+    }
+
+    auto make_output = []()
+    {
+        std::vector<MeshData> meshes(MESH_COUNT);
+        for (unsigned int m = 0; m < MESH_COUNT; m++)
+        {
+            meshes[m].source_mesh = m;
+            meshes[m].node = 0;
+        }
+        return meshes;
+    };
+
+    std::cout << "mesh_import: " << MESH_COUNT << " meshes, " << vertex_total << " vertices, output compared byte "
+              << "for byte with the field-by-field conversion" << std::endl;
+    std::cout << "threads      ms  speedup  M vertex/s  identical" << std::endl;
+
+    // Thread count 0 is the serial path, convert_meshes without a job system.
+    int          result = 0;
+    unsigned int max_threads = std::max(1u, std::thread::hardware_concurrency());
+    double       serial_ms = 0.0;
+    for (unsigned int threads = 0; threads <= max_threads; threads++)
+    {
+        JobSystem jobs(threads > 0 ? threads - 1 : 0);
+
+        double ms = 0.0;
+        bool   identical = true;
+        for (int r = 0; r < REPEATS; r++)
+        {
+            std::vector<MeshData> meshes = make_output();
+            auto                  start = std::chrono::steady_clock::now();
+            convert_meshes(scene_meshes.data(), meshes, threads > 0 ? &jobs : nullptr);
+            ms += elapsed_ms(start);
+            identical = identical && same_bytes(meshes, reference);
+        }
+        ms /= REPEATS;
+
+        if (threads == 0)
+        {
+            serial_ms = ms;
+        }
+        if (!identical)
+        {
+            result = 1;
+        }
+
+        std::cout << std::setw(7) << (threads == 0 ? std::string("serial") : std::to_string(threads)) << std::setw(8)
+                  << std::fixed << std::setprecision(2) << ms << std::setw(9) << serial_ms / ms << std::setw(12)
+                  << vertex_total / (ms * 1000.0) << std::setw(11) << (identical ? "yes" : "NO") << std::endl;
+    }
+
+    // Owned by the vectors above, not by aiMesh and aiFace, which would delete[] them.
+    for (std::vector<aiFace>& mesh_faces : faces)
+    {
+        for (aiFace& face : mesh_faces)
+        {
+            face.mNumIndices = 0;
+            face.mIndices = nullptr;
+        }
+    }
+    for (aiMesh& mesh : source)
+    {
+        mesh.mVertices = nullptr;
+        mesh.mNormals = nullptr;
+        mesh.mTextureCoords[0] = nullptr;
+        mesh.mFaces = nullptr;
+        mesh.mNumFaces = 0;
+    }
+
+    if (result != 0)
+    {
+        std::cout << "ERROR::BENCHMARK::MESH_IMPORT_MISMATCH" << std::endl;
+    }
+    return result;
+}
+
+// Flies over the terrain at a fixed speed with real frame pacing, so the loaders have as much time as they
+// would in the window. The first chunks come from disk, the rest are generated.
+static int bench_terrain()
+{
+    const unsigned int LOADER_COUNTS[] = {1, 2, 4};
+    const int          FRAMES          = 240;
+    const double       FRAME_MS        = 1000.0 / 60.0;
+    const float        SPEED           = 60.0f; // Units per second
+    const int          DISK_RADIUS     = 4;     // Chunks written to disk around the origin
+
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "learn_opengl_terrain_bench";
+    if (!write_terrain_chunks(directory, DISK_RADIUS))
+    {
+        return 1;
+    }
+
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+    float     reach      = DEFAULT_TERRAIN_RADIUS + TERRAIN_EVICTION_MARGIN;
+    std::cout << "terrain: " << FRAMES << " frames at " << SPEED << " units/s, radius " << DEFAULT_TERRAIN_RADIUS
+              << ", at most ~" << (int) (3.14159f * reach * reach / (TERRAIN_CHUNK_SIZE * TERRAIN_CHUNK_SIZE))
+              << " chunks resident" << std::endl;
+    std::cout << " loaders  disk  generated  cancelled  evicted  max_resident  load_ms(mean/p95/max)  "
+                 "update_ms  triangles(mean/max)  full_res"
+              << std::endl;
+
+    for (unsigned int loader_count : LOADER_COUNTS)
+    {
+        TerrainStreamer streamer(directory, DEFAULT_TERRAIN_RADIUS, loader_count);
+
+        std::unordered_map<std::int64_t, std::pair<glm::vec3, glm::vec3>> resident;
+        std::vector<std::int64_t>                                        evicted;
+        std::vector<TerrainChunk>                                        uploads;
+        std::vector<double>                                              latencies;
+        double                                                           update_ms     = 0.0;
+        std::size_t                                                      triangles     = 0;
+        std::size_t                                                      max_triangles = 0;
+        std::size_t                                                      full_res      = 0;
+
+        auto next_frame = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < FRAMES; frame++)
+        {
+            glm::vec3 position = glm::vec3(frame * SPEED / 60.0f, 6.0f, 0.0f);
+            glm::mat4 view     = glm::lookAt(position, position + glm::vec3(1.0f, -0.2f, 0.0f), glm::vec3(0, 1, 0));
+
+            // What TerrainRenderer::update does, minus the GL.
+            auto start = std::chrono::steady_clock::now();
+            evicted.clear();
+            streamer.update(position, evicted);
+            for (std::int64_t key : evicted)
+            {
+                resident.erase(key);
+            }
+            uploads.clear();
+            streamer.take_loaded(uploads, TERRAIN_MAX_UPLOADS_PER_FRAME);
+            for (TerrainChunk& chunk : uploads)
+            {
+                glm::vec3 min = glm::vec3(chunk.x * TERRAIN_CHUNK_SIZE, chunk.min_height, chunk.z * TERRAIN_CHUNK_SIZE);
+                glm::vec3 max = min + glm::vec3(TERRAIN_CHUNK_SIZE, chunk.max_height - chunk.min_height,
+                                                TERRAIN_CHUNK_SIZE);
+                resident[get_terrain_chunk_key(chunk.x, chunk.z)] = {min, max};
+                latencies.push_back(chunk.load_milliseconds);
+                streamer.recycle(std::move(chunk));
+            }
+            update_ms += elapsed_ms(start);
+
+            Frustum     frustum         = make_frustum(projection * view);
+            std::size_t frame_triangles = 0;
+            for (const auto& entry : resident)
+            {
+                const glm::vec3& min = entry.second.first;
+                const glm::vec3& max = entry.second.second;
+                if (aabb_in_frustum(frustum, min, max))
+                {
+                    frame_triangles += get_terrain_lod_triangles(select_terrain_lod(position, min, max));
+                    full_res += get_terrain_lod_triangles(0);
+                }
+            }
+            triangles += frame_triangles;
+            max_triangles = std::max(max_triangles, frame_triangles);
+
+            next_frame += std::chrono::microseconds((long long) (FRAME_MS * 1000.0));
+            std::this_thread::sleep_until(next_frame);
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+        double p95 = latencies.empty() ? 0.0 : latencies[latencies.size() * 95 / 100];
+
+        TerrainStreamerStats stats = streamer.get_stats();
+        std::cout << std::setw(8) << loader_count << std::setw(6) << stats.loaded_from_disk << std::setw(11)
+                  << stats.generated << std::setw(11) << stats.cancelled << std::setw(9) << stats.evicted
+                  << std::setw(14) << stats.max_resident << std::fixed << std::setprecision(2) << std::setw(10)
+                  << stats.mean_load_milliseconds << "/" << std::setw(6) << p95 << "/" << std::setw(6)
+                  << stats.max_load_milliseconds << std::setw(11) << std::setprecision(3) << update_ms / FRAMES
+                  << std::setw(12) << triangles / FRAMES << "/" << std::setw(8) << max_triangles << std::setw(10)
+                  << full_res / FRAMES << std::endl;
+    }
+
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+
+    std::cout << "load_ms is request to vertices ready, full_res what the drawn chunks would cost without levels"
+              << std::endl;
+    return 0;
+}
+
+// CPU side of the grass: scattering, and per frame the cell selection against testing every instance.
+// The GPU side is in the scene pass time F3 prints with --grass N.
+static int bench_vegetation()
+{
+    const unsigned int INSTANCE_COUNTS[] = {10000, 100000, 250000, 500000, 1000000};
+    const int          VIEWS           = 64;
+
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+
+    std::cout << "vegetation: " << DEFAULT_VEGETATION_AREA << " units square, " << VEGETATION_CELL_SIZE
+              << " unit cells, camera turning at the center" << std::endl;
+    std::cout << " instances  scatter_ms  cells  select_ms  draws  drawn  naive_ms  naive_visible" << std::endl;
+
+    for (unsigned int instance_count : INSTANCE_COUNTS)
+    {
+        VegetationField field;
+        field.scatter(instance_count, glm::vec3(0.0f), DEFAULT_VEGETATION_AREA,
+                      [](float x, float z) { return 0.5f * std::sin(x * 0.1f) * std::cos(z * 0.1f); });
+
+        std::vector<VegetationDraw> draws;
+        double                      select_ms     = 0.0;
+        double                      naive_ms      = 0.0;
+        std::size_t                 draw_count    = 0;
+        std::size_t                 drawn         = 0;
+        std::size_t                 naive_visible = 0;
+        for (int v = 0; v < VIEWS; v++)
+        {
+            float     angle    = 6.2831853f * v / VIEWS;
+            glm::vec3 position = glm::vec3(0.0f, 1.7f, 0.0f);
+            glm::mat4 view     = glm::lookAt(position, position + glm::vec3(std::cos(angle), -0.1f, std::sin(angle)),
+                                             glm::vec3(0.0f, 1.0f, 0.0f));
+            Frustum   frustum  = make_frustum(projection * view);
+
+            auto start = std::chrono::steady_clock::now();
+            field.select(frustum, position, draws);
+            select_ms += elapsed_ms(start);
+            draw_count += draws.size();
+            drawn += field.get_stats().drawn_instances;
+
+            // One test per blade, and no thinning with distance.
+            start = std::chrono::steady_clock::now();
+            for (const GrassInstance& instance : field.get_instances())
+            {
+                glm::vec3 center = instance.position + glm::vec3(0.0f, instance.height * 0.5f, 0.0f);
+                naive_visible += sphere_in_frustum(frustum, center, instance.height * 0.5f) ? 1 : 0;
+            }
+            naive_ms += elapsed_ms(start);
+        }
+
+        VegetationStats stats = field.get_stats();
+        std::cout << std::setw(10) << instance_count << std::fixed << std::setprecision(2) << std::setw(12)
+                  << stats.scatter_milliseconds << std::setw(7) << stats.cell_count << std::setprecision(3)
+                  << std::setw(11) << select_ms / VIEWS << std::setw(7) << draw_count / VIEWS << std::setw(7)
+                  << drawn / VIEWS << std::setw(10) << naive_ms / VIEWS << std::setw(15) << naive_visible / VIEWS
+                  << std::endl;
+    }
+
+    std::cout << "draws is instanced draw calls per frame (visible cells), drawn the instances they cover" << std::endl;
+
+    return 0;
+}
+
+// Streams a cooked 4096^2 texture, registered several times, through the default page cache while the
+// view pans and zooms. Feedback is synthesized for a 1920x1080 view split into one column per
+// texture, and frames are paced so the loader gets the time it would in the window.
+static int bench_virtual_texture()
+{
+    const unsigned int TEXTURE_COUNTS[] = {1, 4, 16};
+    const int          TEXTURE_SIZE     = 4096;
+    const int          FRAMES           = 240;
+    const double       FRAME_MS         = 1000.0 / 60.0;
+    const int          FEEDBACK_WIDTH   = 1920 / VT_FEEDBACK_DIVISOR;
+    const int          FEEDBACK_HEIGHT  = 1080 / VT_FEEDBACK_DIVISOR;
+
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "learn_opengl_vt_bench.vtex";
+    {
+        std::vector<std::uint8_t> pixels((std::size_t) TEXTURE_SIZE * TEXTURE_SIZE * 4);
+        for (int y = 0; y < TEXTURE_SIZE; y++)
+        {
+            for (int x = 0; x < TEXTURE_SIZE; x++)
+            {
+                std::uint8_t* texel = &pixels[((std::size_t) y * TEXTURE_SIZE + x) * 4];
+                texel[0]            = (std::uint8_t) x;
+                texel[1]            = (std::uint8_t) y;
+                texel[2]            = (std::uint8_t) ((x / 64 + y / 64) % 2 * 255);
+                texel[3]            = 255;
+            }
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        if (!cook_virtual_texture(pixels.data(), TEXTURE_SIZE, TEXTURE_SIZE, path))
+        {
+            // A failed write can leave a partial file behind.
+            std::error_code error;
+            std::filesystem::remove(path, error);
+            return 1;
+        }
+        std::cout << "virtual_texture: cooked in " << elapsed_ms(start) << " ms, " << FRAMES << " frames, "
+                  << DEFAULT_VT_PAGES_PER_SIDE * DEFAULT_VT_PAGES_PER_SIDE << " pages" << std::endl;
+    }
+    std::cout << " textures  virtual_mb  resident_mb  hit_rate  loads  evictions  full  read_mb  feedback_ms  "
+                 "blurry_frames"
+              << std::endl;
+
+    int                       result = 0;
+    std::vector<std::uint8_t> feedback((std::size_t) FEEDBACK_WIDTH * FEEDBACK_HEIGHT * 4);
+    std::vector<VirtualTile>  uploads;
+    for (unsigned int texture_count : TEXTURE_COUNTS)
+    {
+        VirtualTextureCache       cache;
+        std::vector<unsigned int> ids;
+        for (unsigned int t = 0; t < texture_count; t++)
+        {
+            ids.push_back(cache.add_texture(path));
+        }
+        if (ids.back() == VIRTUAL_TEXTURE_NONE)
+        {
+            result = 1;
+            break;
+        }
+
+        const VirtualTextureInfo& info        = cache.get_info(ids[0]);
+        int                       column      = std::max(1, FEEDBACK_WIDTH / (int) texture_count);
+        std::size_t               requested   = 0;
+        std::size_t               missing     = 0;
+        int                       blurry      = 0; // Frames with a wanted tile not resident yet
+        double                    feedback_ms = 0.0;
+
+        auto next_frame = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < FRAMES; frame++)
+        {
+            // Zooms from the whole texture down to a twentieth of it across a column and back, panning.
+            float phase = 6.2831853f * frame / FRAMES;
+            float span  = 0.05f + 0.95f * (0.5f + 0.5f * std::cos(phase));
+            float pan_u = 0.3f * std::sin(phase * 2.0f);
+            float pan_v = 0.1f * frame / FRAMES;
+            float scale = span / (column * VT_FEEDBACK_DIVISOR); // uv per full-resolution pixel
+            int   mip   = (int) std::floor(std::log2(std::max(1.0f, scale * TEXTURE_SIZE)) + 0.5f);
+            mip         = std::min(mip, info.mip_count - 1);
+
+            int level = std::max(1, TEXTURE_SIZE >> mip);
+            for (int y = 0; y < FEEDBACK_HEIGHT; y++)
+            {
+                for (int x = 0; x < FEEDBACK_WIDTH; x++)
+                {
+                    unsigned int  t     = std::min((unsigned int) (x / column), texture_count - 1);
+                    float         u     = pan_u + (x % column) * VT_FEEDBACK_DIVISOR * scale;
+                    float         v     = pan_v + y * VT_FEEDBACK_DIVISOR * scale;
+                    std::uint8_t* texel = &feedback[((std::size_t) y * FEEDBACK_WIDTH + x) * 4];
+                    texel[0]            = (std::uint8_t) ((u - std::floor(u)) * level / VT_TILE_SIZE);
+                    texel[1]            = (std::uint8_t) ((v - std::floor(v)) * level / VT_TILE_SIZE);
+                    texel[2]            = (std::uint8_t) mip;
+                    texel[3]            = (std::uint8_t) (ids[t] + 1);
+                }
+            }
+
+            // What VirtualTextureSystem::update does, minus the GL.
+            auto start = std::chrono::steady_clock::now();
+            cache.process_feedback(feedback.data(), (std::size_t) FEEDBACK_WIDTH * FEEDBACK_HEIGHT);
+            uploads.clear();
+            cache.take_loaded(uploads, VT_MAX_UPLOADS_PER_FRAME);
+            for (VirtualTile& tile : uploads)
+            {
+                cache.recycle(std::move(tile));
+            }
+            cache.end_frame();
+            feedback_ms += elapsed_ms(start);
+
+            VirtualTextureStats stats = cache.get_stats();
+            requested += stats.requested_tiles;
+            missing += stats.missing_tiles;
+            blurry += stats.missing_tiles > 0 ? 1 : 0;
+
+            next_frame += std::chrono::microseconds((long long) (FRAME_MS * 1000.0));
+            std::this_thread::sleep_until(next_frame);
+        }
+
+        // The physical pages plus the CPU copy of the indirection, which the GPU holds once more.
+        VirtualTextureStats stats    = cache.get_stats();
+        std::uint64_t       resident = stats.physical_bytes;
+        for (unsigned int id : ids)
+        {
+            for (int level = 0; level < info.mip_count; level++)
+            {
+                resident += 2 * cache.get_indirection(id, level).size() * sizeof(std::uint32_t);
+            }
+        }
+
+        const double MB = 1024.0 * 1024.0;
+        std::cout << std::setw(9) << texture_count << std::fixed << std::setprecision(1) << std::setw(12)
+                  << stats.virtual_bytes / MB << std::setw(13) << resident / MB << std::setprecision(3)
+                  << std::setw(10) << (requested ? 1.0 - (double) missing / requested : 1.0) << std::setw(7)
+                  << stats.loaded_tiles << std::setw(11) << stats.evicted_tiles << std::setw(6) << stats.cache_full
+                  << std::setprecision(1) << std::setw(9) << stats.loaded_tiles * VT_PAGE_BYTES / MB
+                  << std::setprecision(3) << std::setw(13) << feedback_ms / FRAMES << std::setw(15) << blurry
+                  << std::endl;
+    }
+
+    std::error_code error;
+    std::filesystem::remove(path, error);
+
+    std::cout << "hit_rate is wanted tiles already resident, full tiles dropped because every page was in use "
+                 "that frame"
+              << std::endl;
+    return result;
+}
+
+// A sphere, closed so about half of it faces away from any outside view, and a bumpy heightfield seen
+// from above, which mostly faces the camera. Both are clustered, then culled from views orbiting them.
+// Cone-culled meshlets are checked triangle by triangle on every eighth view.
+static int bench_meshlets()
+{
+    const int   RINGS      = 256;
+    const int   SEGMENTS   = 512;
+    const int   VIEWS      = 64;
+    const int   CHECK_STEP = 8;
+    const float PI         = 3.14159265f;
+
+    struct TestMesh
+    {
+        const char*               name;
+        std::vector<Vertex>       vertices;
+        std::vector<unsigned int> indices;
+        float                     distance; // Of the camera from the center
+        float                     height;   // Of the camera above the center
+    };
+
+    // (RINGS + 1) x (SEGMENTS + 1) grid of vertices, two counter-clockwise triangles per cell.
+    auto make_grid_indices = [](std::vector<unsigned int>& p_indices)
+    {
+        for (int r = 0; r < RINGS; r++)
+        {
+            for (int s = 0; s < SEGMENTS; s++)
+            {
+                unsigned int a = r * (SEGMENTS + 1) + s;
+                unsigned int b = a + SEGMENTS + 1;
+                p_indices.insert(p_indices.end(), {a, b, a + 1, a + 1, b, b + 1});
+            }
+        }
+    };
+
+    std::vector<TestMesh> meshes(2);
+    meshes[0] = {"sphere", {}, {}, 3.0f, 1.0f};
+    meshes[1] = {"heightfield", {}, {}, 0.8f, 0.3f};
+    for (int r = 0; r <= RINGS; r++)
+    {
+        for (int s = 0; s <= SEGMENTS; s++)
+        {
+            float     theta = PI * r / RINGS;
+            float     phi   = 2.0f * PI * s / SEGMENTS;
+            glm::vec3 point(std::sin(theta) * std::cos(phi), std::cos(theta), -std::sin(theta) * std::sin(phi));
+            meshes[0].vertices.push_back({point, point, glm::vec2(0.0f)});
+
+            float x = 2.0f * s / SEGMENTS - 1.0f;
+            float z = 2.0f * r / RINGS - 1.0f;
+            float y = 0.05f * std::sin(x * 23.0f) * std::cos(z * 17.0f);
+            meshes[1].vertices.push_back({glm::vec3(x, y, z), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec2(0.0f)});
+        }
+    }
+    make_grid_indices(meshes[0].indices);
+    make_grid_indices(meshes[1].indices);
+
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+
+    std::cout << "meshlets: at most " << MESHLET_MAX_TRIANGLES << " triangles each, " << VIEWS
+              << " views orbiting each mesh, one instance" << std::endl;
+    std::cout << "       mesh  triangles  build_ms  meshlets  min  avg  max  cull_us  frustum  facing_away  "
+              << "submitted  ranges  wrong" << std::endl;
+
+    int result = 0;
+    for (TestMesh& mesh : meshes)
+    {
+        std::size_t          triangle_count = mesh.indices.size() / 3;
+        std::vector<Meshlet> meshlets;
+        auto                 start = std::chrono::steady_clock::now();
+        build_meshlets(mesh.vertices.data(), mesh.indices, meshlets);
+        double build_ms = elapsed_ms(start);
+
+        unsigned int min_triangles = ~0u;
+        unsigned int max_triangles = 0;
+        for (const Meshlet& meshlet : meshlets)
+        {
+            min_triangles = std::min(min_triangles, meshlet.index_count / 3);
+            max_triangles = std::max(max_triangles, meshlet.index_count / 3);
+        }
+
+        MeshletDrawList      draws;
+        MeshletCullStats     stats   = MeshletCullStats();
+        std::size_t          ranges  = 0;
+        std::size_t          wrong   = 0;
+        double               cull_ms = 0.0;
+        std::vector<Meshlet> single(1);
+        for (int v = 0; v < VIEWS; v++)
+        {
+            float     angle   = 2.0f * PI * v / VIEWS;
+            glm::vec3 camera  = glm::vec3(std::cos(angle), 0.0f, std::sin(angle)) * mesh.distance;
+            camera.y          = mesh.height;
+            glm::mat4 view    = glm::lookAt(camera, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+            Frustum   frustum = make_frustum(projection * view);
+
+            draws.counts.clear();
+            draws.offsets.clear();
+            start = std::chrono::steady_clock::now();
+            cull_meshlets(meshlets, glm::mat4(1.0f), frustum, camera, draws, stats);
+            cull_ms += elapsed_ms(start);
+            ranges += draws.counts.size();
+
+            if (v % CHECK_STEP != 0)
+            {
+                continue;
+            }
+
+            // Every triangle of a meshlet dropped for facing away must face away.
+            for (const Meshlet& meshlet : meshlets)
+            {
+                MeshletCullStats check = MeshletCullStats();
+                MeshletDrawList  check_draws;
+                single[0] = meshlet;
+                cull_meshlets(single, glm::mat4(1.0f), frustum, camera, check_draws, check);
+                if (check.cone_culled == 0)
+                {
+                    continue;
+                }
+
+                for (unsigned int i = meshlet.first_index; i < meshlet.first_index + meshlet.index_count; i += 3)
+                {
+                    const glm::vec3& a = mesh.vertices[mesh.indices[i + 0]].position;
+                    const glm::vec3& b = mesh.vertices[mesh.indices[i + 1]].position;
+                    const glm::vec3& c = mesh.vertices[mesh.indices[i + 2]].position;
+                    if (glm::dot(a - camera, glm::cross(b - a, c - a)) < 0.0f)
+                    {
+                        wrong++;
+                    }
+                }
+            }
+        }
+
+        double tested = (double) stats.meshlets_tested;
+        std::cout << std::setw(11) << mesh.name << std::setw(11) << triangle_count << std::fixed
+                  << std::setprecision(2) << std::setw(10) << build_ms << std::setw(10) << meshlets.size()
+                  << std::setw(5) << min_triangles << std::setw(5) << triangle_count / meshlets.size()
+                  << std::setw(5) << max_triangles << std::setw(9) << cull_ms * 1000.0 / VIEWS
+                  << std::setprecision(3) << std::setw(9) << stats.frustum_culled / tested << std::setw(13)
+                  << stats.cone_culled / tested << std::setw(11)
+                  << (double) stats.triangles_submitted / (triangle_count * VIEWS) << std::setw(8) << ranges / VIEWS
+                  << std::setw(7) << wrong << std::endl;
+        result |= wrong > 0 ? 1 : 0;
+    }
+
+    std::cout << "frustum and facing_away are shares of the meshlets, submitted the share of the triangles left for "
+              << "glMultiDrawElements, ranges its draws after merging neighbours" << std::endl;
+
+    return result;
+}
+
+// A 64-joint binary tree skinning a tube, four clips of 30 rotation keys per joint, played by 1 to
+// 10000 instances for a second of 60 Hz frames. Posing runs serially and on the job system, whose
+// palettes must match exactly, and the SSE skinning is checked against plain glm.
+static int bench_animation()
+{
+    const unsigned int INSTANCE_COUNTS[] = {1, 10, 100, 1000, 10000};
+    const unsigned int JOINT_COUNT       = 64;
+    const unsigned int CLIP_COUNT        = 4;
+    const unsigned int ROTATION_KEYS     = 30;
+    const float        CLIP_SECONDS      = 2.0f;
+    const int          FRAMES            = 60;
+    const unsigned int VERTEX_COUNT      = 2048;
+    const float        TOLERANCE         = 1e-4f;
+
+    std::mt19937                          random(7);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    // Joint j hangs off joint (j - 1) / 2, a little further out, the bones' offsets undo the bind pose.
+    Skeleton               skeleton;
+    std::vector<glm::mat4> bind_globals(JOINT_COUNT);
+    for (unsigned int j = 0; j < JOINT_COUNT; j++)
+    {
+        int       parent = j == 0 ? -1 : (int) (j - 1) / 2;
+        glm::mat4 local  = glm::translate(glm::mat4(1.0f), glm::vec3(j % 2 ? 0.1f : -0.1f, 0.2f, 0.0f));
+        bind_globals[j]  = parent < 0 ? local : bind_globals[parent] * local;
+        skeleton.parents.push_back(parent);
+        skeleton.bind_locals.push_back(local);
+        skeleton.bone_joints.push_back(j);
+        skeleton.bone_offsets.push_back(glm::inverse(bind_globals[j]));
+    }
+
+    std::vector<AnimationClip> clips(CLIP_COUNT);
+    for (unsigned int c = 0; c < CLIP_COUNT; c++)
+    {
+        clips[c].name     = "clip " + std::to_string(c);
+        clips[c].duration = CLIP_SECONDS;
+        for (unsigned int j = 0; j < JOINT_COUNT; j++)
+        {
+            glm::vec3 axis = glm::normalize(glm::vec3(unit(random), unit(random), unit(random) + 2.0f));
+
+            AnimationChannel channel;
+            channel.joint          = j;
+            channel.position_times = {0.0f, CLIP_SECONDS};
+            channel.positions      = {glm::vec3(skeleton.bind_locals[j][3]), glm::vec3(skeleton.bind_locals[j][3])};
+            channel.scale_times    = {0.0f};
+            channel.scales         = {glm::vec3(1.0f)};
+            for (unsigned int k = 0; k < ROTATION_KEYS; k++)
+            {
+                float     time  = CLIP_SECONDS * k / (ROTATION_KEYS - 1);
+                glm::quat angle = glm::angleAxis(0.5f * std::sin(time * 3.0f + j), axis);
+                channel.rotation_times.push_back(time);
+                channel.rotations.push_back(glm::vec4(angle.x, angle.y, angle.z, angle.w));
+            }
+            clips[c].channels.push_back(std::move(channel));
+        }
+    }
+
+    // A ring of 32 vertices per level, each weighted to four random bones.
+    std::vector<Vertex>      vertices(VERTEX_COUNT);
+    std::vector<SkinWeights> weights(VERTEX_COUNT);
+    for (unsigned int v = 0; v < VERTEX_COUNT; v++)
+    {
+        float     angle = 6.2831853f * (v % 32) / 32.0f;
+        glm::vec3 normal(std::cos(angle), 0.0f, std::sin(angle));
+        vertices[v] = {normal * 0.3f + glm::vec3(0.0f, 0.02f * (v / 32), 0.0f), normal, glm::vec2(v % 32, v / 32)};
+
+        int sum = 0;
+        for (unsigned int k = 0; k < MAX_BONE_INFLUENCES; k++)
+        {
+            weights[v].bones[k]   = (std::uint8_t) (random() % JOINT_COUNT);
+            weights[v].weights[k] = (std::uint8_t) (k + 1 < MAX_BONE_INFLUENCES ? 20 + random() % 60 : 255 - sum);
+            sum += weights[v].weights[k];
+        }
+    }
+
+    JobSystem& jobs = JobSystem::get_instance();
+    std::cout << "animation: " << JOINT_COUNT << " bones, " << CLIP_COUNT << " clips of " << ROTATION_KEYS
+              << " rotation keys per joint, " << FRAMES << " frames, " << jobs.get_worker_count() + 1
+              << " threads, CPU skinning " << VERTEX_COUNT << " vertices per instance" << std::endl;
+    std::cout << " instances  serial_ms  parallel_ms  us_per_instance  key_hits  palette_mb  skin_ms  mismatches"
+              << std::endl;
+
+    int                 result = 0;
+    std::vector<Vertex> skinned(VERTEX_COUNT);
+    for (unsigned int instance_count : INSTANCE_COUNTS)
+    {
+        AnimationPlayer serial(skeleton, clips);
+        AnimationPlayer parallel(skeleton, clips);
+        serial.set_instance_count(instance_count);
+        parallel.set_instance_count(instance_count);
+
+        double      serial_ms    = 0.0;
+        double      parallel_ms  = 0.0;
+        std::size_t key_searches = 0;
+        std::size_t key_hits     = 0;
+        for (int f = 0; f < FRAMES; f++)
+        {
+            double time = f / 60.0;
+            serial.update(time, NULL);
+            serial_ms += serial.get_stats().evaluate_milliseconds;
+            parallel.update(time, &jobs);
+            parallel_ms += parallel.get_stats().evaluate_milliseconds;
+            key_searches += parallel.get_stats().key_searches;
+            key_hits += parallel.get_stats().key_hits;
+        }
+
+        // Same arithmetic whichever thread runs it, the cached keys only change how they are found.
+        std::size_t mismatches = serial.get_palettes() == parallel.get_palettes() ? 0 : 1;
+
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned int i = 0; i < instance_count; i++)
+        {
+            skin_vertices(vertices.data(), weights.data(), VERTEX_COUNT,
+                          &parallel.get_palettes()[(std::size_t) i * JOINT_COUNT], skinned.data());
+        }
+        double skin_ms = elapsed_ms(start);
+
+        // The last instance's vertices against a plain blend of its matrices.
+        const glm::mat4* palette = &parallel.get_palettes()[(std::size_t) (instance_count - 1) * JOINT_COUNT];
+        for (unsigned int v = 0; v < VERTEX_COUNT; v++)
+        {
+            glm::mat4 skin(0.0f);
+            for (unsigned int k = 0; k < MAX_BONE_INFLUENCES; k++)
+            {
+                skin += palette[weights[v].bones[k]] * (weights[v].weights[k] / 255.0f);
+            }
+            glm::vec3 position = glm::vec3(skin * glm::vec4(vertices[v].position, 1.0f));
+            glm::vec3 normal   = glm::normalize(glm::vec3(skin * glm::vec4(vertices[v].normal, 0.0f)));
+            if (glm::length(position - skinned[v].position) > TOLERANCE ||
+                glm::length(normal - skinned[v].normal) > TOLERANCE || skinned[v].tex_coords != vertices[v].tex_coords)
+            {
+                mismatches++;
+            }
+        }
+
+        double palette_mb = (double) instance_count * JOINT_COUNT * sizeof(glm::mat4) / (1024.0 * 1024.0);
+        std::cout << std::setw(10) << instance_count << std::fixed << std::setprecision(3) << std::setw(11)
+                  << serial_ms / FRAMES << std::setw(13) << parallel_ms / FRAMES << std::setw(17)
+                  << parallel_ms * 1000.0 / FRAMES / instance_count << std::setw(10)
+                  << (double) key_hits / (double) key_searches << std::setw(12) << palette_mb << std::setw(9)
+                  << skin_ms << std::setw(12) << mismatches << std::endl;
+        result |= mismatches > 0 ? 1 : 0;
+    }
+
+    std::cout << "key_hits is the share of key lookups the cache answered, palette_mb what the GPU path uploads per "
+              << "frame, skin_ms one frame of the CPU path" << std::endl;
+
+    return result;
+}
+
+static const BenchmarkEntry BENCHMARKS[] = {
+        {"job_system", bench_job_system},
+        {"scene_graph", bench_scene_graph},
+        {"entities", bench_entities},
+        {"clustered_lighting", bench_clustered_lighting},
+        {"mesh_import", bench_mesh_import},
+        {"terrain", bench_terrain},
+        {"vegetation", bench_vegetation},
+        {"virtual_texture", bench_virtual_texture},
+        {"meshlets", bench_meshlets},
+        {"animation", bench_animation},
+};
+
+int run_benchmark(const std::string& name)
+{
+    int  result = 0;
+    bool found = false;
+
+    for (const BenchmarkEntry& entry : BENCHMARKS)
+    {
+        if (name == "all" || name == entry.name)
+        {
+            found = true;
+            result |= entry.function();
+        }
+    }
+
+    if (!found)
+    {
+        std::cout << "ERROR::BENCHMARK::UNKNOWN_NAME\n" << name << std::endl;
+        return 1;
+    }
+
+    return result;
+}
@@ -156,6 +156,41 @@ void Camera::reset_fov()
     fov = DEFAULT_FOV;
 }
 
+CameraState Camera::get_state() const
+{
+    CameraState state;
+    state.camera_position = camera_position;
+    state.yaw = yaw;
+    state.pitch = pitch;
+    state.fov = fov;
+
+    return state;
+}
+
+void Camera::set_state(const CameraState& p_state)
+{
+    camera_position = p_state.camera_position;
+    yaw = p_state.yaw;
+    pitch = p_state.pitch;
+    fov = p_state.fov;
+
+    update_camera_vectors();
+}
+
+CameraState interpolate_camera_state(const CameraState& p_from, const CameraState& p_to, float p_alpha)
+{
+    CameraState state;
+    state.camera_position = glm::mix(p_from.camera_position, p_to.camera_position, p_alpha);
+    // Yaw is not kept in range, so turn the short way round, with the difference wrapped to [-180, 180).
+    float yaw_delta = p_to.yaw - p_from.yaw;
+    yaw_delta -= 360.0f * glm::floor((yaw_delta + 180.0f) / 360.0f);
+    state.yaw = p_from.yaw + yaw_delta * p_alpha;
+    state.pitch = glm::mix(p_from.pitch, p_to.pitch, p_alpha);
+    state.fov = glm::mix(p_from.fov, p_to.fov, p_alpha);
+
+    return state;
+}
+
 void Camera::update_camera_vectors()
 {
     glm::vec3 direction;
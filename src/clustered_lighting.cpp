@@ -0,0 +1,377 @@
+#include "learn_opengl/clustered_lighting.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "glm/ext/matrix_float3x3.hpp"
+#include "glm/ext/vector_float2.hpp"
+#include "glm/geometric.hpp"
+#include "glm/matrix.hpp"
+#include "learn_opengl/job_system.hpp"
+#include "learn_opengl/resource_registry.hpp"
+#include "learn_opengl/simd_math.hpp"
+
+// Padding spheres sit far away with no radius, so they never touch a cluster.
+static const float PADDING_POSITION = 1e30f;
+
+static const std::size_t MIN_BUFFER_BYTES = 256;
+
+LightClusterer::LightClusterer()
+{
+    projection = glm::mat4(0.0f);
+    near_plane = 0.0f;
+    far_plane  = 0.0f;
+
+    cluster_min.resize(CLUSTER_COUNT);
+    cluster_max.resize(CLUSTER_COUNT);
+    slice_near.resize(CLUSTER_SLICES);
+    slice_far.resize(CLUSTER_SLICES);
+    slice_indices.resize(CLUSTER_SLICES);
+    cluster_ranges.assign(CLUSTER_COUNT * 2, 0);
+
+    stats = {0, 0, 0, 0, 0.0};
+}
+
+void LightClusterer::build_clusters(const glm::mat4& p_projection)
+{
+    if (p_projection == projection)
+    {
+        return;
+    }
+    projection = p_projection;
+
+    // Valid for any OpenGL perspective projection.
+    near_plane = p_projection[3][2] / (p_projection[2][2] - 1.0f);
+    far_plane  = p_projection[3][2] / (p_projection[2][2] + 1.0f);
+
+    for (unsigned int slice = 0; slice < CLUSTER_SLICES; slice++)
+    {
+        slice_near[slice] = near_plane * std::pow(far_plane / near_plane, (float) slice / CLUSTER_SLICES);
+        slice_far[slice]  = near_plane * std::pow(far_plane / near_plane, (float) (slice + 1) / CLUSTER_SLICES);
+    }
+
+    glm::mat4 inverse_projection = glm::inverse(p_projection);
+    for (unsigned int y = 0; y < CLUSTER_TILES_Y; y++)
+    {
+        for (unsigned int x = 0; x < CLUSTER_TILES_X; x++)
+        {
+            // Tile corners on the near plane, each slice is that pyramid cut at two depths.
+            glm::vec3 corners[4];
+            for (int c = 0; c < 4; c++)
+            {
+                float     ndc_x  = -1.0f + 2.0f * (float) (x + (c & 1)) / CLUSTER_TILES_X;
+                float     ndc_y  = -1.0f + 2.0f * (float) (y + (c >> 1)) / CLUSTER_TILES_Y;
+                glm::vec4 corner = inverse_projection * glm::vec4(ndc_x, ndc_y, -1.0f, 1.0f);
+                corners[c]       = glm::vec3(corner) / corner.w;
+            }
+
+            for (unsigned int slice = 0; slice < CLUSTER_SLICES; slice++)
+            {
+                glm::vec3 box_min(PADDING_POSITION);
+                glm::vec3 box_max(-PADDING_POSITION);
+                for (const glm::vec3& corner : corners)
+                {
+                    glm::vec3 near_point = corner * (slice_near[slice] / near_plane);
+                    glm::vec3 far_point  = corner * (slice_far[slice] / near_plane);
+                    box_min              = glm::min(box_min, glm::min(near_point, far_point));
+                    box_max              = glm::max(box_max, glm::max(near_point, far_point));
+                }
+
+                unsigned int cluster = x + CLUSTER_TILES_X * (y + CLUSTER_TILES_Y * slice);
+                cluster_min[cluster] = box_min;
+                cluster_max[cluster] = box_max;
+            }
+        }
+    }
+}
+
+void LightClusterer::bin_lights(const std::vector<Light>& p_lights, const glm::mat4& p_view)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    unsigned int light_count  = (unsigned int) std::min<std::size_t>(p_lights.size(), MAX_CLUSTERED_LIGHTS);
+    unsigned int padded_count = (light_count + 3) & ~3u;
+
+    light_x.resize(padded_count);
+    light_y.resize(padded_count);
+    light_z.resize(padded_count);
+    light_radius.resize(padded_count);
+    gpu_lights.resize(light_count * CLUSTER_LIGHT_TEXELS);
+
+    glm::mat3 view_rotation(p_view);
+    for (unsigned int i = 0; i < light_count; i++)
+    {
+        const Light& light    = p_lights[i];
+        glm::vec3    position = glm::vec3(p_view * glm::vec4(light.position, 1.0f));
+        bool         spot     = light.type == LIGHT_SPOT;
+
+        light_x[i]      = position.x;
+        light_y[i]      = position.y;
+        light_z[i]      = position.z;
+        light_radius[i] = light.radius;
+
+        // Point lights get a cone that accepts every direction, so the shader has no branch.
+        glm::vec4* texels = &gpu_lights[i * CLUSTER_LIGHT_TEXELS];
+        texels[0]         = glm::vec4(position, light.radius);
+        texels[1]         = glm::vec4(light.color * light.intensity, spot ? light.spot_cos_inner : -1.0f);
+        texels[2] = glm::vec4(spot ? glm::normalize(view_rotation * light.direction) : glm::vec3(0.0f, 0.0f, -1.0f),
+                              spot ? light.spot_cos_outer : -2.0f);
+    }
+    for (unsigned int i = light_count; i < padded_count; i++)
+    {
+        light_x[i]      = PADDING_POSITION;
+        light_y[i]      = PADDING_POSITION;
+        light_z[i]      = PADDING_POSITION;
+        light_radius[i] = 0.0f;
+    }
+
+    JobSystem::get_instance().parallel_for(
+            0, CLUSTER_SLICES, 1,
+            [this, light_count](std::size_t begin, std::size_t end)
+            {
+                // Lights overlapping the current slice, reused across frames to avoid allocating.
+                thread_local std::vector<float>         xs, ys, zs, radii;
+                thread_local std::vector<std::uint16_t> ids;
+
+                for (std::size_t slice = begin; slice < end; slice++)
+                {
+                    // View space looks down -z, so the far end of the slice is the smaller z.
+                    float slice_max_z = -slice_near[slice];
+                    float slice_min_z = -slice_far[slice];
+
+                    xs.clear();
+                    ys.clear();
+                    zs.clear();
+                    radii.clear();
+                    ids.clear();
+                    for (unsigned int i = 0; i < light_count; i++)
+                    {
+                        if (light_z[i] - light_radius[i] <= slice_max_z && light_z[i] + light_radius[i] >= slice_min_z)
+                        {
+                            xs.push_back(light_x[i]);
+                            ys.push_back(light_y[i]);
+                            zs.push_back(light_z[i]);
+                            radii.push_back(light_radius[i]);
+                            ids.push_back((std::uint16_t) i);
+                        }
+                    }
+                    while (ids.size() % 4 != 0)
+                    {
+                        xs.push_back(PADDING_POSITION);
+                        ys.push_back(PADDING_POSITION);
+                        zs.push_back(PADDING_POSITION);
+                        radii.push_back(0.0f);
+                        ids.push_back(0);
+                    }
+
+                    std::vector<std::uint16_t>& indices = slice_indices[slice];
+                    indices.clear();
+
+                    unsigned int first_cluster = (unsigned int) slice * CLUSTER_TILES_X * CLUSTER_TILES_Y;
+                    for (unsigned int tile = 0; tile < CLUSTER_TILES_X * CLUSTER_TILES_Y; tile++)
+                    {
+                        unsigned int     cluster = first_cluster + tile;
+                        std::size_t      offset  = indices.size();
+                        const glm::vec3& box_min = cluster_min[cluster];
+                        const glm::vec3& box_max = cluster_max[cluster];
+
+                        for (std::size_t j = 0; j < ids.size(); j += 4)
+                        {
+                            unsigned int mask =
+                                    spheres_intersect_aabb(&xs[j], &ys[j], &zs[j], &radii[j], box_min, box_max);
+                            for (unsigned int lane = 0; mask != 0; lane++, mask >>= 1)
+                            {
+                                if (mask & 1)
+                                {
+                                    indices.push_back(ids[j + lane]);
+                                }
+                            }
+                        }
+
+                        // Offsets are slice-local here, made global once every slice is done.
+                        cluster_ranges[cluster * 2]     = (std::uint32_t) offset;
+                        cluster_ranges[cluster * 2 + 1] = (std::uint32_t) (indices.size() - offset);
+                    }
+                }
+            });
+
+    stats.light_count        = light_count;
+    stats.occupied_clusters  = 0;
+    stats.max_cluster_lights = 0;
+
+    std::size_t total = 0;
+    for (unsigned int slice = 0; slice < CLUSTER_SLICES; slice++)
+    {
+        unsigned int first_cluster = slice * CLUSTER_TILES_X * CLUSTER_TILES_Y;
+        for (unsigned int cluster = first_cluster; cluster < first_cluster + CLUSTER_TILES_X * CLUSTER_TILES_Y;
+             cluster++)
+        {
+            cluster_ranges[cluster * 2] += (std::uint32_t) total;
+
+            std::uint32_t count = cluster_ranges[cluster * 2 + 1];
+            stats.occupied_clusters += count > 0 ? 1 : 0;
+            stats.max_cluster_lights = std::max(stats.max_cluster_lights, count);
+        }
+        total += slice_indices[slice].size();
+    }
+
+    light_indices.resize(total);
+    std::uint16_t* destination = light_indices.data();
+    for (unsigned int slice = 0; slice < CLUSTER_SLICES; slice++)
+    {
+        destination = std::copy(slice_indices[slice].begin(), slice_indices[slice].end(), destination);
+    }
+
+    stats.index_count = (unsigned int) total;
+    stats.bin_milliseconds =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+const std::vector<std::uint32_t>& LightClusterer::get_cluster_ranges() const
+{
+    return cluster_ranges;
+}
+
+const std::vector<std::uint16_t>& LightClusterer::get_light_indices() const
+{
+    return light_indices;
+}
+
+const std::vector<glm::vec4>& LightClusterer::get_gpu_lights() const
+{
+    return gpu_lights;
+}
+
+float LightClusterer::get_near_plane() const
+{
+    return near_plane;
+}
+
+float LightClusterer::get_far_plane() const
+{
+    return far_plane;
+}
+
+LightBinningStats LightClusterer::get_stats() const
+{
+    return stats;
+}
+
+ClusteredLighting::ClusteredLighting()
+{
+    const GLenum formats[BUFFER_COUNT] = {GL_RGBA32F, GL_RG32UI, GL_R16UI};
+
+    glGenBuffers(BUFFER_COUNT, buffers);
+    glGenTextures(BUFFER_COUNT, textures);
+
+    ResourceRegistry& registry = ResourceRegistry::get_instance();
+    for (unsigned int i = 0; i < BUFFER_COUNT; i++)
+    {
+        capacities[i] = MIN_BUFFER_BYTES;
+        glBindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+        glBufferData(GL_TEXTURE_BUFFER, capacities[i], NULL, GL_STREAM_DRAW);
+        glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+        glTexBuffer(GL_TEXTURE_BUFFER, formats[i], buffers[i]);
+
+        registry.track(RESOURCE_BUFFER, buffers[i], capacities[i], "clustered_lighting");
+        // The storage is the buffer's, the texture only views it.
+        registry.track(RESOURCE_TEXTURE, textures[i], 0, "clustered_lighting");
+    }
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+ClusteredLighting::~ClusteredLighting()
+{
+    ResourceRegistry& registry = ResourceRegistry::get_instance();
+    for (unsigned int i = 0; i < BUFFER_COUNT; i++)
+    {
+        registry.untrack(RESOURCE_BUFFER, buffers[i]);
+        registry.untrack(RESOURCE_TEXTURE, textures[i]);
+    }
+    glDeleteTextures(BUFFER_COUNT, textures);
+    glDeleteBuffers(BUFFER_COUNT, buffers);
+}
+
+void ClusteredLighting::update(const std::vector<Light>& p_lights, const glm::mat4& p_view,
+                               const glm::mat4& p_projection)
+{
+    clusterer.build_clusters(p_projection);
+    clusterer.bin_lights(p_lights, p_view);
+
+    const std::vector<glm::vec4>&     lights  = clusterer.get_gpu_lights();
+    const std::vector<std::uint32_t>& ranges  = clusterer.get_cluster_ranges();
+    const std::vector<std::uint16_t>& indices = clusterer.get_light_indices();
+
+    upload(LIGHT_BUFFER, lights.data(), lights.size() * sizeof(glm::vec4));
+    upload(RANGE_BUFFER, ranges.data(), ranges.size() * sizeof(std::uint32_t));
+    upload(INDEX_BUFFER, indices.data(), indices.size() * sizeof(std::uint16_t));
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void ClusteredLighting::upload(unsigned int p_buffer, const void* p_data, std::size_t p_bytes)
+{
+    glBindBuffer(GL_TEXTURE_BUFFER, buffers[p_buffer]);
+
+    if (p_bytes > capacities[p_buffer])
+    {
+        // Grow geometrically so a slowly rising light count does not reallocate every frame.
+        capacities[p_buffer] = std::max(capacities[p_buffer] * 2, p_bytes);
+
+        ResourceRegistry& registry = ResourceRegistry::get_instance();
+        registry.untrack(RESOURCE_BUFFER, buffers[p_buffer]);
+        registry.track(RESOURCE_BUFFER, buffers[p_buffer], capacities[p_buffer], "clustered_lighting");
+    }
+
+    // Orphaning hands the driver fresh storage, so this never waits on last frame's draws.
+    glBufferData(GL_TEXTURE_BUFFER, capacities[p_buffer], NULL, GL_STREAM_DRAW);
+    if (p_bytes > 0)
+    {
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, p_bytes, p_data);
+    }
+}
+
+void ClusteredLighting::bind(Shader& p_shader, int p_viewport_width, int p_viewport_height,
+                             unsigned int p_first_unit) const
+{
+    const char* sampler_names[BUFFER_COUNT] = {"cluster_lights", "cluster_ranges", "cluster_light_indices"};
+
+    float near_plane = clusterer.get_near_plane();
+    float log_ratio  = std::log(clusterer.get_far_plane() / near_plane);
+
+    p_shader.setVec2("cluster_tile_size", glm::vec2((float) p_viewport_width / CLUSTER_TILES_X,
+                                                    (float) p_viewport_height / CLUSTER_TILES_Y));
+    p_shader.setFloat("cluster_depth_scale", CLUSTER_SLICES / log_ratio);
+    p_shader.setFloat("cluster_depth_bias", -(float) CLUSTER_SLICES * std::log(near_plane) / log_ratio);
+
+    for (unsigned int i = 0; i < BUFFER_COUNT; i++)
+    {
+        glActiveTexture(GL_TEXTURE0 + p_first_unit + i);
+        glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+        p_shader.setInt(sampler_names[i], p_first_unit + i);
+    }
+    glActiveTexture(GL_TEXTURE0);
+}
+
+LightBinningStats ClusteredLighting::get_stats() const
+{
+    return clusterer.get_stats();
+}
+
+ShaderDefines ClusteredLighting::get_shader_defines()
+{
+    return {
+            {"CLUSTERED_LIGHTING", ""},
+            {"CLUSTER_TILES_X", std::to_string(CLUSTER_TILES_X) + "u"},
+            {"CLUSTER_TILES_Y", std::to_string(CLUSTER_TILES_Y) + "u"},
+            {"CLUSTER_SLICES", std::to_string(CLUSTER_SLICES) + "u"},
+            {"CLUSTER_LIGHT_TEXELS", std::to_string(CLUSTER_LIGHT_TEXELS)},
+    };
+}
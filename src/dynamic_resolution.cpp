@@ -0,0 +1,207 @@
+#include "learn_opengl/dynamic_resolution.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <glad/glad.h>
+
+#include "glm/ext/vector_float2.hpp"
+#include "learn_opengl/resource_registry.hpp"
+
+ResolutionController::ResolutionController(double p_target_milliseconds, unsigned int p_settle_samples)
+{
+    target_milliseconds  = p_target_milliseconds;
+    settle_samples       = p_settle_samples;
+    samples_since_change = p_settle_samples;
+    scale                = DYNAMIC_RESOLUTION_MAX_SCALE;
+}
+
+float ResolutionController::update(std::uint64_t p_frame_index, double p_gpu_milliseconds)
+{
+    if (p_gpu_milliseconds <= 0.0 || target_milliseconds <= 0.0)
+    {
+        return scale;
+    }
+
+    samples_since_change++;
+    double error = p_gpu_milliseconds / target_milliseconds - 1.0;
+    if (samples_since_change > settle_samples && std::abs(error) > DYNAMIC_RESOLUTION_DEADBAND)
+    {
+        float wanted = scale * (float) std::sqrt(target_milliseconds / p_gpu_milliseconds);
+        wanted       = std::clamp(wanted, scale - DYNAMIC_RESOLUTION_MAX_STEP, scale + DYNAMIC_RESOLUTION_MAX_STEP);
+        wanted       = std::clamp(wanted, DYNAMIC_RESOLUTION_MIN_SCALE, DYNAMIC_RESOLUTION_MAX_SCALE);
+        if (wanted != scale)
+        {
+            scale                = wanted;
+            samples_since_change = 0;
+        }
+    }
+
+    history.push_back({p_frame_index, p_gpu_milliseconds, scale});
+    if (history.size() > DYNAMIC_RESOLUTION_HISTORY)
+    {
+        history.pop_front();
+    }
+    return scale;
+}
+
+float ResolutionController::get_scale() const
+{
+    return scale;
+}
+
+double ResolutionController::get_target_milliseconds() const
+{
+    return target_milliseconds;
+}
+
+const std::deque<ResolutionSample>& ResolutionController::get_history() const
+{
+    return history;
+}
+
+bool ResolutionController::write_csv(const std::string& p_path) const
+{
+    std::ofstream file(p_path);
+    if (!file)
+    {
+        std::cout << "ERROR::DYNAMIC_RESOLUTION::CANNOT_WRITE " << p_path << std::endl;
+        return false;
+    }
+
+    file << "frame,gpu_ms,target_ms,scale\n";
+    for (const ResolutionSample& sample : history)
+    {
+        file << sample.frame_index << "," << sample.gpu_milliseconds << "," << target_milliseconds << ","
+             << sample.scale << "\n";
+    }
+    return true;
+}
+
+DynamicResolution::DynamicResolution(double p_target_milliseconds, unsigned int p_settle_samples) :
+    controller(p_target_milliseconds, p_settle_samples)
+{
+    target_width  = 0;
+    target_height = 0;
+    render_width  = 0;
+    render_height = 0;
+    output_width  = 0;
+    output_height = 0;
+
+    glGenFramebuffers(1, &framebuffer);
+    glGenTextures(1, &color_texture);
+    glGenRenderbuffers(1, &depth_renderbuffer);
+
+    ResourceRegistry::get_instance().track(RESOURCE_FRAMEBUFFER, framebuffer, 0, "dynamic_resolution");
+}
+
+DynamicResolution::~DynamicResolution()
+{
+    ResourceRegistry& registry = ResourceRegistry::get_instance();
+    registry.untrack(RESOURCE_FRAMEBUFFER, framebuffer);
+    registry.untrack(RESOURCE_TEXTURE, color_texture);
+    registry.untrack(RESOURCE_RENDERBUFFER, depth_renderbuffer);
+
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteTextures(1, &color_texture);
+    glDeleteRenderbuffers(1, &depth_renderbuffer);
+}
+
+void DynamicResolution::resize(int p_width, int p_height)
+{
+    target_width  = p_width;
+    target_height = p_height;
+
+    ResourceRegistry& registry = ResourceRegistry::get_instance();
+    registry.untrack(RESOURCE_TEXTURE, color_texture);
+    registry.untrack(RESOURCE_RENDERBUFFER, depth_renderbuffer);
+
+    glBindTexture(GL_TEXTURE_2D, color_texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, p_width, p_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glBindRenderbuffer(GL_RENDERBUFFER, depth_renderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, p_width, p_height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color_texture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth_renderbuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "ERROR::DYNAMIC_RESOLUTION::FRAMEBUFFER_INCOMPLETE" << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    registry.track(RESOURCE_TEXTURE, color_texture, get_texture_bytes(p_width, p_height, 4, false),
+                   "dynamic_resolution");
+    registry.track(RESOURCE_RENDERBUFFER, depth_renderbuffer, (std::size_t) p_width * p_height * 4,
+                   "dynamic_resolution");
+}
+
+void DynamicResolution::begin(int p_output_width, int p_output_height)
+{
+    output_width  = std::max(p_output_width, 1);
+    output_height = std::max(p_output_height, 1);
+    if (output_width != target_width || output_height != target_height)
+    {
+        resize(output_width, output_height);
+    }
+
+    float scale   = controller.get_scale();
+    render_width  = std::max((int) std::lround(output_width * scale), 1);
+    render_height = std::max((int) std::lround(output_height * scale), 1);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, render_width, render_height);
+}
+
+void DynamicResolution::end(Shader& p_quad_shader)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, output_width, output_height);
+    glDisable(GL_DEPTH_TEST);
+
+    // Texel offsets are in units of the whole target, the used corner is mapped through uv_scale.
+    p_quad_shader.use();
+    p_quad_shader.setInt("screen_texture", 0);
+    p_quad_shader.setFloat("screen_width", (float) target_width);
+    p_quad_shader.setFloat("screen_height", (float) target_height);
+    p_quad_shader.setVec2("uv_scale", glm::vec2((float) render_width / target_width,
+                                                (float) render_height / target_height));
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, color_texture);
+    quad.draw();
+
+    glEnable(GL_DEPTH_TEST);
+}
+
+void DynamicResolution::update(std::uint64_t p_frame_index, double p_gpu_milliseconds)
+{
+    controller.update(p_frame_index, p_gpu_milliseconds);
+}
+
+int DynamicResolution::get_render_width() const
+{
+    return render_width;
+}
+
+int DynamicResolution::get_render_height() const
+{
+    return render_height;
+}
+
+const ResolutionController& DynamicResolution::get_controller() const
+{
+    return controller;
+}
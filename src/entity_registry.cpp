@@ -0,0 +1,234 @@
+#include "learn_opengl/entity_registry.hpp"
+
+#include <algorithm>
+#include <cstddef>
+
+#include "glm/ext/matrix_float4x4.hpp"
+#include "glm/ext/vector_float3.hpp"
+#include "glm/ext/vector_float4.hpp"
+#include "glm/geometric.hpp"
+#include "learn_opengl/frame_pipeline.hpp"
+#include "learn_opengl/frustum.hpp"
+#include "learn_opengl/job_system.hpp"
+
+// Below this many components a system runs inline, the job overhead is not worth it.
+const std::size_t SYSTEM_GRAIN_SIZE = 16384;
+
+Entity EntityRegistry::create_entity()
+{
+    std::uint32_t index;
+
+    if (!free_indices.empty())
+    {
+        index = free_indices.back();
+        free_indices.pop_back();
+    }
+    else
+    {
+        index = (std::uint32_t) generations.size();
+        generations.push_back(0);
+    }
+
+    return index | ((std::uint32_t) generations[index] << ENTITY_GENERATION_SHIFT);
+}
+
+void EntityRegistry::destroy_entity(Entity p_entity)
+{
+    if (!is_alive(p_entity))
+    {
+        return;
+    }
+
+    transforms.remove(p_entity);
+    renderables.remove(p_entity);
+    bounds.remove(p_entity);
+    visibility.remove(p_entity);
+    selections.remove(p_entity);
+
+    std::uint32_t index = entity_index(p_entity);
+    generations[index]++;
+    free_indices.push_back(index);
+}
+
+bool EntityRegistry::is_alive(Entity p_entity) const
+{
+    std::uint32_t index = entity_index(p_entity);
+    return index < generations.size() && (p_entity >> ENTITY_GENERATION_SHIFT) == generations[index];
+}
+
+void EntityRegistry::reserve(std::size_t p_count)
+{
+    generations.reserve(p_count);
+    transforms.reserve(p_count);
+    renderables.reserve(p_count);
+    bounds.reserve(p_count);
+    visibility.reserve(p_count);
+    scene_graph.reserve((unsigned int) p_count);
+}
+
+void EntityRegistry::compact()
+{
+    transforms.sort_by_entity();
+    renderables.sort_by_entity();
+    bounds.sort_by_entity();
+    visibility.sort_by_entity();
+    selections.sort_by_entity();
+}
+
+Entity EntityRegistry::create_render_object(const glm::mat4& p_local_matrix, const RenderableComponent& p_renderable,
+                                            const glm::vec3& p_bounds_center, float p_bounds_radius)
+{
+    Entity entity = create_entity();
+
+    TransformComponent transform;
+    transform.node = scene_graph.add_node(SCENE_NODE_NONE, p_local_matrix);
+    transforms.add(entity, transform);
+
+    renderables.add(entity, p_renderable);
+
+    BoundsComponent entity_bounds;
+    entity_bounds.local_center = p_bounds_center;
+    entity_bounds.local_radius = p_bounds_radius;
+    entity_bounds.world_center = p_bounds_center;
+    entity_bounds.world_radius = p_bounds_radius;
+    bounds.add(entity, entity_bounds);
+
+    VisibilityComponent entity_visibility;
+    entity_visibility.enabled = true;
+    entity_visibility.in_frustum = true;
+    visibility.add(entity, entity_visibility);
+
+    return entity;
+}
+
+void update_transforms(EntityRegistry& p_registry)
+{
+    p_registry.scene_graph.update_world_transforms();
+
+    const Entity*    entities = p_registry.bounds.entities();
+    BoundsComponent* bounds = p_registry.bounds.components();
+
+    JobSystem::get_instance().parallel_for(
+            0, p_registry.bounds.size(), SYSTEM_GRAIN_SIZE,
+            [&](std::size_t begin, std::size_t end)
+            {
+                for (std::size_t i = begin; i < end; i++)
+                {
+                    if (!p_registry.transforms.has(entities[i]))
+                    {
+                        continue;
+                    }
+
+                    unsigned int     node = p_registry.transforms.get(entities[i]).node;
+                    const glm::mat4& world = p_registry.scene_graph.get_world_matrix(node);
+
+                    float scale = std::max(glm::length(glm::vec3(world[0])),
+                                           std::max(glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2]))));
+
+                    bounds[i].world_center = glm::vec3(world * glm::vec4(bounds[i].local_center, 1.0f));
+                    bounds[i].world_radius = bounds[i].local_radius * scale;
+                }
+            });
+}
+
+void cull_entities(EntityRegistry& p_registry, const Frustum& p_frustum)
+{
+    const Entity*        entities = p_registry.visibility.entities();
+    VisibilityComponent* visibility = p_registry.visibility.components();
+
+    JobSystem::get_instance().parallel_for(
+            0, p_registry.visibility.size(), SYSTEM_GRAIN_SIZE,
+            [&](std::size_t begin, std::size_t end)
+            {
+                for (std::size_t i = begin; i < end; i++)
+                {
+                    if (!p_registry.bounds.has(entities[i]))
+                    {
+                        visibility[i].in_frustum = true;
+                        continue;
+                    }
+
+                    const BoundsComponent& entity_bounds = p_registry.bounds.get(entities[i]);
+                    visibility[i].in_frustum =
+                            sphere_in_frustum(p_frustum, entity_bounds.world_center, entity_bounds.world_radius);
+                }
+            });
+}
+
+void submit_renderables(const EntityRegistry& p_registry, FramePacket& p_packet)
+{
+    const Entity*              entities = p_registry.renderables.entities();
+    const RenderableComponent* renderables = p_registry.renderables.components();
+
+    for (std::size_t i = 0; i < p_registry.renderables.size(); i++)
+    {
+        Entity entity = entities[i];
+        // Without a transform there is nowhere to draw it.
+        if (!p_registry.transforms.has(entity))
+        {
+            continue;
+        }
+
+        if (p_registry.visibility.has(entity))
+        {
+            const VisibilityComponent& entity_visibility = p_registry.visibility.get(entity);
+            if (!entity_visibility.enabled || !entity_visibility.in_frustum)
+            {
+                continue;
+            }
+        }
+
+        const RenderableComponent& renderable = renderables[i];
+        const glm::mat4&           world = p_registry.scene_graph.get_world_matrix(p_registry.transforms.get(entity).node);
+
+        // Consecutive entities with the same mesh and texture (slot) become instances of one draw.
+        if (!p_packet.draws.empty())
+        {
+            DrawCommand& last = p_packet.draws.back();
+            if (last.vao == renderable.vao && last.vertices_count == renderable.vertices_count &&
+                last.texture_id == renderable.texture_id && last.texture_target == renderable.texture_target &&
+                last.texture_slot == renderable.texture_slot)
+            {
+                last.instance_count++;
+                p_packet.instance_transforms.push_back(world);
+                continue;
+            }
+        }
+
+        p_packet.add_draw(renderable.vao, renderable.vertices_count, renderable.texture_id, renderable.texture_target,
+                          renderable.texture_slot, world);
+    }
+}
+
+void submit_selections(const EntityRegistry& p_registry, FramePacket& p_packet)
+{
+    const Entity*             entities = p_registry.selections.entities();
+    const SelectionComponent* selections = p_registry.selections.components();
+
+    for (std::size_t i = 0; i < p_registry.selections.size(); i++)
+    {
+        Entity entity = entities[i];
+        if (!p_registry.renderables.has(entity) || !p_registry.transforms.has(entity))
+        {
+            continue;
+        }
+
+        // Culled objects would not show an outline anyway.
+        if (p_registry.visibility.has(entity))
+        {
+            const VisibilityComponent& entity_visibility = p_registry.visibility.get(entity);
+            if (!entity_visibility.enabled || !entity_visibility.in_frustum)
+            {
+                continue;
+            }
+        }
+
+        const RenderableComponent& renderable = p_registry.renderables.get(entity);
+        SelectionDraw              draw;
+        draw.vao = renderable.vao;
+        draw.vertices_count = renderable.vertices_count;
+        draw.selection_id = selections[i].selection_id;
+        draw.model_matrix = p_registry.scene_graph.get_world_matrix(p_registry.transforms.get(entity).node);
+        p_packet.selection_draws.push_back(draw);
+    }
+}
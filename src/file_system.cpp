@@ -1,8 +1,97 @@
 #include "learn_opengl/file_system.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <memory>
 #include <stdexcept>
 #include <string>
+#include <vector>
+
+// Pack layout: header, hash buckets (entry index or PACK_EMPTY_BUCKET, linear probing), entries,
+// path strings, then the file contents each aligned to PACK_DATA_ALIGNMENT.
+const char          PACK_MAGIC[4] = {'L', 'O', 'P', 'K'};
+const std::uint32_t PACK_VERSION = 1;
+const std::uint32_t PACK_EMPTY_BUCKET = 0xFFFFFFFF;
+const std::uint64_t PACK_DATA_ALIGNMENT = 16;
+
+struct PackHeader
+{
+    char          magic[4];
+    std::uint32_t version;
+    std::uint32_t entry_count;
+    std::uint32_t bucket_count;
+    std::uint64_t entries_offset;
+    std::uint64_t strings_offset;
+};
+
+struct PackEntry
+{
+    std::uint64_t hash;
+    std::uint64_t offset;
+    std::uint64_t size;
+    std::uint32_t path_offset;
+    std::uint32_t path_length;
+};
+
+static std::string normalize_path(const std::string& p_path)
+{
+    std::string normalized = p_path;
+    std::replace(normalized.begin(), normalized.end(), '\\', '/');
+
+    while (normalized.rfind("./", 0) == 0)
+    {
+        normalized.erase(0, 2);
+    }
+
+    return normalized;
+}
+
+static std::uint64_t hash_path(const std::string& p_path)
+{
+    // FNV-1a
+    std::uint64_t hash = 14695981039346656037ull;
+    for (char c : p_path)
+    {
+        hash ^= (unsigned char) c;
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+FileView::FileView()
+{
+    view_data = nullptr;
+    view_size = 0;
+}
+
+bool FileView::is_valid() const
+{
+    return mapping != nullptr;
+}
+
+const unsigned char* FileView::data() const
+{
+    return view_data;
+}
+
+std::size_t FileView::size() const
+{
+    return view_size;
+}
+
+std::span<const unsigned char> FileView::bytes() const
+{
+    return std::span<const unsigned char>(view_data, view_size);
+}
+
+std::string_view FileView::text() const
+{
+    return std::string_view((const char*) view_data, view_size);
+}
 
 FileSystem& FileSystem::get_instance()
 {
@@ -18,6 +107,12 @@ void FileSystem::set_root_marker(const std::string p_root_marker)
 
 FileSystem::FileSystem()
 {
+    pack_buckets = nullptr;
+    pack_entries = nullptr;
+    pack_strings = nullptr;
+    pack_bucket_count = 0;
+    files_opened = 0;
+
     find_root();
 }
 
@@ -46,13 +141,253 @@ std::filesystem::path FileSystem::get_root_path() const
 
 std::filesystem::path FileSystem::get_path(const std::string path) const
 {
-    std::filesystem::path p(path);
-    std::filesystem::path full_path = project_root / p;
+    // No existence check here: it costs a stat per lookup and read_file() reports missing files anyway.
+    return project_root / std::filesystem::path(path);
+}
+
+bool FileSystem::mount_pack(const std::filesystem::path& pack_path)
+{
+    std::shared_ptr<MappedFile> mapping = std::make_shared<MappedFile>();
+    if (!mapping->open(pack_path))
+    {
+        std::cout << "ERROR::FILESYSTEM::PACK::OPEN_FAILED\n" << pack_path << std::endl;
+        return false;
+    }
+    files_opened++;
+
+    PackHeader header;
+    if (mapping->size() < sizeof(PackHeader))
+    {
+        std::cout << "ERROR::FILESYSTEM::PACK::TRUNCATED\n" << pack_path << std::endl;
+        return false;
+    }
+    std::memcpy(&header, mapping->data(), sizeof(PackHeader));
+
+    std::uint64_t buckets_end = sizeof(PackHeader) + (std::uint64_t) header.bucket_count * sizeof(std::uint32_t);
+    std::uint64_t entries_end = header.entries_offset + (std::uint64_t) header.entry_count * sizeof(PackEntry);
+
+    bool is_valid = std::memcmp(header.magic, PACK_MAGIC, 4) == 0 && header.version == PACK_VERSION &&
+                    header.bucket_count != 0 && (header.bucket_count & (header.bucket_count - 1)) == 0 &&
+                    buckets_end <= header.entries_offset && header.entries_offset <= header.strings_offset &&
+                    entries_end <= header.strings_offset && header.strings_offset <= mapping->size();
+    if (!is_valid)
+    {
+        std::cout << "ERROR::FILESYSTEM::PACK::INVALID_HEADER\n" << pack_path << std::endl;
+        return false;
+    }
+
+    // Checked once here so lookups can trust every bucket, path and file range.
+    const unsigned char* buckets = mapping->data() + sizeof(PackHeader);
+    for (std::uint32_t i = 0; i < header.bucket_count; i++)
+    {
+        std::uint32_t entry_index;
+        std::memcpy(&entry_index, buckets + (std::size_t) i * sizeof(std::uint32_t), sizeof(entry_index));
+        if (entry_index != PACK_EMPTY_BUCKET && entry_index >= header.entry_count)
+        {
+            std::cout << "ERROR::FILESYSTEM::PACK::INVALID_ENTRY\n" << pack_path << std::endl;
+            return false;
+        }
+    }
+
+    std::uint64_t strings_size = mapping->size() - header.strings_offset;
+    for (std::uint32_t i = 0; i < header.entry_count; i++)
+    {
+        PackEntry entry;
+        std::memcpy(&entry, mapping->data() + header.entries_offset + (std::size_t) i * sizeof(PackEntry),
+                    sizeof(PackEntry));
+
+        bool is_entry_valid = (std::uint64_t) entry.path_offset + entry.path_length <= strings_size &&
+                              entry.offset <= mapping->size() && entry.size <= mapping->size() - entry.offset;
+        if (!is_entry_valid)
+        {
+            std::cout << "ERROR::FILESYSTEM::PACK::INVALID_ENTRY\n" << pack_path << std::endl;
+            return false;
+        }
+    }
+
+    pack = mapping;
+    pack_buckets = (const std::uint32_t*) (pack->data() + sizeof(PackHeader));
+    pack_entries = pack->data() + header.entries_offset;
+    pack_strings = (const char*) (pack->data() + header.strings_offset);
+    pack_bucket_count = header.bucket_count;
+
+    std::cout << "Mounted " << pack_path << " (" << header.entry_count << " files)" << std::endl;
+    return true;
+}
+
+void FileSystem::unmount_pack()
+{
+    // Views handed out earlier keep their own reference to the mapping.
+    pack.reset();
+    pack_buckets = nullptr;
+    pack_entries = nullptr;
+    pack_strings = nullptr;
+    pack_bucket_count = 0;
+}
+
+bool FileSystem::find_pack_entry(const std::string& path, std::uint64_t& offset, std::uint64_t& size) const
+{
+    if (!pack)
+    {
+        return false;
+    }
+
+    std::uint64_t hash = hash_path(path);
+    std::uint32_t mask = pack_bucket_count - 1;
+
+    for (std::uint32_t probe = 0; probe < pack_bucket_count; probe++)
+    {
+        std::uint32_t entry_index = pack_buckets[(hash + probe) & mask];
+        if (entry_index == PACK_EMPTY_BUCKET)
+        {
+            return false;
+        }
+
+        PackEntry entry;
+        std::memcpy(&entry, pack_entries + (std::size_t) entry_index * sizeof(PackEntry), sizeof(PackEntry));
+
+        if (entry.hash == hash && entry.path_length == path.size() &&
+            std::memcmp(pack_strings + entry.path_offset, path.data(), path.size()) == 0)
+        {
+            offset = entry.offset;
+            size = entry.size;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool FileSystem::exists(const std::string& path) const
+{
+    std::uint64_t offset, size;
+    if (find_pack_entry(normalize_path(path), offset, size))
+    {
+        return true;
+    }
+
+    return std::filesystem::exists(get_path(path));
+}
+
+FileView FileSystem::read_file(const std::string& path) const
+{
+    FileView view;
+
+    std::uint64_t offset, size;
+    if (find_pack_entry(normalize_path(path), offset, size))
+    {
+        view.mapping = pack;
+        view.view_data = pack->data() + offset;
+        view.view_size = (std::size_t) size;
+        return view;
+    }
 
-    if (!std::filesystem::exists(full_path))
+    // Absolute paths go straight to disk, relative ones are resolved against the root.
+    std::filesystem::path       full_path = std::filesystem::path(path).is_absolute() ? std::filesystem::path(path)
+                                                                                             : get_path(path);
+    std::shared_ptr<MappedFile> mapping = std::make_shared<MappedFile>();
+    if (!mapping->open(full_path))
     {
         std::cout << "ERROR::FILESYSTEM::PATH::PATH_NOT_FOUND\n" << full_path << std::endl;
+        return view;
+    }
+    files_opened++;
+
+    view.mapping = mapping;
+    view.view_data = mapping->data();
+    view.view_size = mapping->size();
+    return view;
+}
+
+unsigned int FileSystem::get_files_opened() const
+{
+    return files_opened;
+}
+
+bool FileSystem::build_pack(const std::filesystem::path& root, const std::vector<std::string>& directories,
+                            const std::filesystem::path& output)
+{
+    std::vector<std::string> paths;
+    for (const std::string& directory : directories)
+    {
+        for (const auto& item : std::filesystem::recursive_directory_iterator(root / directory))
+        {
+            if (item.is_regular_file())
+            {
+                paths.push_back(std::filesystem::relative(item.path(), root).generic_string());
+            }
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+
+    std::uint32_t bucket_count = 2;
+    while (bucket_count < paths.size() * 2)
+    {
+        bucket_count *= 2;
+    }
+
+    PackHeader header;
+    std::memcpy(header.magic, PACK_MAGIC, 4);
+    header.version = PACK_VERSION;
+    header.entry_count = (std::uint32_t) paths.size();
+    header.bucket_count = bucket_count;
+    header.entries_offset = sizeof(PackHeader) + (std::uint64_t) bucket_count * sizeof(std::uint32_t);
+    header.strings_offset = header.entries_offset + paths.size() * sizeof(PackEntry);
+
+    std::vector<std::uint32_t> buckets(bucket_count, PACK_EMPTY_BUCKET);
+    std::vector<PackEntry>     entries(paths.size());
+    std::string                strings;
+
+    for (std::uint32_t i = 0; i < paths.size(); i++)
+    {
+        entries[i].hash = hash_path(paths[i]);
+        entries[i].size = std::filesystem::file_size(root / paths[i]);
+        entries[i].path_offset = (std::uint32_t) strings.size();
+        entries[i].path_length = (std::uint32_t) paths[i].size();
+        strings += paths[i];
+
+        std::uint32_t bucket = (std::uint32_t) (entries[i].hash & (bucket_count - 1));
+        while (buckets[bucket] != PACK_EMPTY_BUCKET)
+        {
+            bucket = (bucket + 1) & (bucket_count - 1);
+        }
+        buckets[bucket] = i;
+    }
+
+    std::uint64_t data_offset = header.strings_offset + strings.size();
+    for (PackEntry& entry : entries)
+    {
+        data_offset = (data_offset + PACK_DATA_ALIGNMENT - 1) & ~(PACK_DATA_ALIGNMENT - 1);
+        entry.offset = data_offset;
+        data_offset += entry.size;
+    }
+
+    std::ofstream out(output, std::ios::binary);
+    if (!out)
+    {
+        std::cout << "ERROR::FILESYSTEM::PACK::WRITE_FAILED\n" << output << std::endl;
+        return false;
+    }
+
+    out.write((const char*) &header, sizeof(header));
+    out.write((const char*) buckets.data(), buckets.size() * sizeof(std::uint32_t));
+    out.write((const char*) entries.data(), entries.size() * sizeof(PackEntry));
+    out.write(strings.data(), strings.size());
+
+    for (std::uint32_t i = 0; i < paths.size(); i++)
+    {
+        std::uint64_t position = (std::uint64_t) out.tellp();
+        std::string   padding(entries[i].offset - position, '\0');
+        out.write(padding.data(), padding.size());
+
+        // Streaming an empty file would set failbit on the output.
+        if (entries[i].size > 0)
+        {
+            std::ifstream in(root / paths[i], std::ios::binary);
+            out << in.rdbuf();
+        }
     }
 
-    return full_path;
+    std::cout << "Packed " << paths.size() << " files into " << output << std::endl;
+    return (bool) out;
 }
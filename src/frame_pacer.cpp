@@ -0,0 +1,123 @@
+#include "learn_opengl/frame_pacer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+#include <glad/glad.h>
+
+// How long one glClientWaitSync call may block before we check again, in nanoseconds.
+const GLuint64 FENCE_WAIT_STEP_NS = 100000000;
+
+LatencyHistory::LatencyHistory()
+{
+    samples.reserve(LATENCY_HISTORY_SIZE);
+    next = 0;
+}
+
+void LatencyHistory::add(double p_milliseconds)
+{
+    if (samples.size() < LATENCY_HISTORY_SIZE)
+    {
+        samples.push_back(p_milliseconds);
+        return;
+    }
+
+    samples[next] = p_milliseconds;
+    next          = (next + 1) % LATENCY_HISTORY_SIZE;
+}
+
+LatencyPercentiles LatencyHistory::get_percentiles() const
+{
+    LatencyPercentiles percentiles = {(unsigned int) samples.size(), 0.0, 0.0, 0.0, 0.0};
+    if (samples.empty())
+    {
+        return percentiles;
+    }
+
+    // Nearest rank on a sorted copy, a few hundred doubles at most.
+    std::vector<double> sorted = samples;
+    std::sort(sorted.begin(), sorted.end());
+    auto rank = [&sorted](double p_fraction)
+    { return sorted[std::min((std::size_t) (p_fraction * sorted.size()), sorted.size() - 1)]; };
+
+    percentiles.p50 = rank(0.50);
+    percentiles.p90 = rank(0.90);
+    percentiles.p99 = rank(0.99);
+    percentiles.max = sorted.back();
+    return percentiles;
+}
+
+FramePacer::FramePacer(unsigned int p_frames_in_flight)
+{
+    frames_in_flight       = std::clamp(p_frames_in_flight, 1u, MAX_FRAMES_IN_FLIGHT);
+    current                = 0;
+    last_wait_milliseconds = 0.0;
+    for (unsigned int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        fences[i] = NULL;
+    }
+}
+
+FramePacer::~FramePacer()
+{
+    for (unsigned int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        if (fences[i])
+        {
+            glDeleteSync(fences[i]);
+        }
+    }
+}
+
+void FramePacer::wait_for_slot()
+{
+    last_wait_milliseconds = 0.0;
+
+    // The slot about to be reused holds the fence of the oldest frame still allowed in flight.
+    GLsync fence = fences[current];
+    if (!fence)
+    {
+        return;
+    }
+
+    auto       start  = std::chrono::steady_clock::now();
+    GLbitfield flags  = GL_SYNC_FLUSH_COMMANDS_BIT;
+    GLenum     result = GL_TIMEOUT_EXPIRED;
+    while (result == GL_TIMEOUT_EXPIRED)
+    {
+        result = glClientWaitSync(fence, flags, FENCE_WAIT_STEP_NS);
+        flags  = 0;
+    }
+    if (result == GL_WAIT_FAILED)
+    {
+        std::cout << "ERROR::FRAME_PACER::WAIT_FAILED" << std::endl;
+    }
+    auto end               = std::chrono::steady_clock::now();
+    last_wait_milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+
+    glDeleteSync(fence);
+    fences[current] = NULL;
+}
+
+void FramePacer::end_frame()
+{
+    if (fences[current])
+    {
+        glDeleteSync(fences[current]);
+    }
+    fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    current         = (current + 1) % frames_in_flight;
+}
+
+unsigned int FramePacer::get_frames_in_flight() const
+{
+    return frames_in_flight;
+}
+
+double FramePacer::get_last_wait_milliseconds() const
+{
+    return last_wait_milliseconds;
+}
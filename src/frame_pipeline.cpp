@@ -0,0 +1,109 @@
+#include "learn_opengl/frame_pipeline.hpp"
+
+#include <mutex>
+
+void FramePacket::clear()
+{
+    draws.clear();
+    instance_transforms.clear();
+    selection_draws.clear();
+    mirror_views.clear();
+    mirror_draws.clear();
+}
+
+void FramePacket::add_draw(unsigned int p_vao, unsigned int p_vertices_count, unsigned int p_texture_id,
+                           GLenum p_texture_target, unsigned int p_texture_slot, const glm::mat4& p_model_matrix)
+{
+    DrawCommand draw;
+    draw.vao = p_vao;
+    draw.vertices_count = p_vertices_count;
+    draw.texture_id = p_texture_id;
+    draw.texture_target = p_texture_target;
+    draw.texture_slot = p_texture_slot;
+    draw.first_instance = (unsigned int) instance_transforms.size();
+    draw.instance_count = 1;
+
+    draws.push_back(draw);
+    instance_transforms.push_back(p_model_matrix);
+}
+
+FramePipeline::FramePipeline(unsigned int p_max_frames_ahead)
+{
+    // One slot is always being rendered, the rest are how far the simulation may run ahead.
+    unsigned int slot_count = p_max_frames_ahead < 1 ? 2 : p_max_frames_ahead + 1;
+
+    packets.resize(slot_count);
+    slot_states.assign(slot_count, SLOT_FREE);
+    write_index = 0;
+    read_index = 0;
+    next_frame_index = 0;
+    stopped = false;
+}
+
+FramePacket* FramePipeline::begin_build()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    slot_changed.wait(lock, [this] { return stopped || slot_states[write_index] == SLOT_FREE; });
+
+    if (stopped)
+    {
+        return nullptr;
+    }
+
+    slot_states[write_index] = SLOT_BUILDING;
+
+    FramePacket* packet = &packets[write_index];
+    packet->clear();
+    packet->frame_index = next_frame_index++;
+
+    return packet;
+}
+
+void FramePipeline::submit()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        slot_states[write_index] = SLOT_READY;
+        write_index = (write_index + 1) % packets.size();
+    }
+    slot_changed.notify_all();
+}
+
+const FramePacket* FramePipeline::acquire()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    slot_changed.wait(lock, [this] { return stopped || slot_states[read_index] == SLOT_READY; });
+
+    if (stopped)
+    {
+        return nullptr;
+    }
+
+    slot_states[read_index] = SLOT_RENDERING;
+    return &packets[read_index];
+}
+
+void FramePipeline::release()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        slot_states[read_index] = SLOT_FREE;
+        read_index = (read_index + 1) % packets.size();
+    }
+    slot_changed.notify_all();
+}
+
+void FramePipeline::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopped = true;
+    }
+    slot_changed.notify_all();
+}
+
+bool FramePipeline::is_stopped()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return stopped;
+}
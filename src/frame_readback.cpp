@@ -0,0 +1,548 @@
+#include "learn_opengl/frame_readback.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include "learn_opengl/resource_registry.hpp"
+
+// How long one glClientWaitSync call may block before we check again, in nanoseconds.
+const GLuint64 READBACK_WAIT_STEP_NS = 100000000;
+// Largest stored deflate block.
+const std::size_t DEFLATE_STORED_BLOCK = 65535;
+
+static std::array<std::uint32_t, 256> make_crc_table()
+{
+    std::array<std::uint32_t, 256> table;
+    for (std::uint32_t i = 0; i < 256; i++)
+    {
+        std::uint32_t c = i;
+        for (int k = 0; k < 8; k++)
+        {
+            c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        table[i] = c;
+    }
+    return table;
+}
+
+static std::uint32_t png_crc(const std::uint8_t* p_data, std::size_t p_size, std::uint32_t p_crc)
+{
+    static const std::array<std::uint32_t, 256> table = make_crc_table();
+
+    std::uint32_t crc = ~p_crc;
+    for (std::size_t i = 0; i < p_size; i++)
+    {
+        crc = table[(crc ^ p_data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static void put_u32(std::vector<std::uint8_t>& p_out, std::uint32_t p_value)
+{
+    p_out.push_back((std::uint8_t) (p_value >> 24));
+    p_out.push_back((std::uint8_t) (p_value >> 16));
+    p_out.push_back((std::uint8_t) (p_value >> 8));
+    p_out.push_back((std::uint8_t) p_value);
+}
+
+static void write_chunk(std::ofstream& p_file, const char* p_type, const std::vector<std::uint8_t>& p_data)
+{
+    std::vector<std::uint8_t> header;
+    put_u32(header, (std::uint32_t) p_data.size());
+    header.insert(header.end(), p_type, p_type + 4);
+
+    std::uint32_t crc = png_crc(header.data() + 4, 4, 0);
+    crc               = png_crc(p_data.data(), p_data.size(), crc);
+
+    std::vector<std::uint8_t> footer;
+    put_u32(footer, crc);
+
+    p_file.write((const char*) header.data(), (std::streamsize) header.size());
+    p_file.write((const char*) p_data.data(), (std::streamsize) p_data.size());
+    p_file.write((const char*) footer.data(), (std::streamsize) footer.size());
+}
+
+bool write_png(const std::string& p_path, int p_width, int p_height, const std::uint8_t* p_pixels)
+{
+    std::ofstream file(p_path, std::ios::binary);
+    if (!file)
+    {
+        std::cout << "ERROR::READBACK::CANNOT_WRITE " << p_path << std::endl;
+        return false;
+    }
+
+    const std::uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    file.write((const char*) signature, sizeof(signature));
+
+    // 8-bit RGBA, no interlacing.
+    std::vector<std::uint8_t> header;
+    put_u32(header, (std::uint32_t) p_width);
+    put_u32(header, (std::uint32_t) p_height);
+    header.insert(header.end(), {8, 6, 0, 0, 0});
+    write_chunk(file, "IHDR", header);
+
+    // Scanlines top-down, each behind a 0 (no filter) byte, in a zlib stream of stored blocks.
+    std::size_t row_bytes = (std::size_t) p_width * 4;
+    std::size_t raw_size  = (row_bytes + 1) * p_height;
+
+    std::vector<std::uint8_t> raw;
+    raw.reserve(raw_size);
+    for (int y = p_height - 1; y >= 0; y--)
+    {
+        raw.push_back(0);
+        raw.insert(raw.end(), p_pixels + row_bytes * y, p_pixels + row_bytes * (y + 1));
+    }
+
+    std::vector<std::uint8_t> zlib;
+    zlib.reserve(raw_size + raw_size / DEFLATE_STORED_BLOCK * 5 + 16);
+    zlib.push_back(0x78);
+    zlib.push_back(0x01);
+    std::size_t offset = 0;
+    do
+    {
+        std::size_t   size     = std::min(DEFLATE_STORED_BLOCK, raw_size - offset);
+        bool          last     = offset + size == raw_size;
+        std::uint16_t length   = (std::uint16_t) size;
+        std::uint16_t inverted = (std::uint16_t) ~length;
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back((std::uint8_t) length);
+        zlib.push_back((std::uint8_t) (length >> 8));
+        zlib.push_back((std::uint8_t) inverted);
+        zlib.push_back((std::uint8_t) (inverted >> 8));
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + size);
+        offset += size;
+    } while (offset < raw_size);
+
+    std::uint32_t a = 1, b = 0;
+    for (std::uint8_t byte : raw)
+    {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    put_u32(zlib, (b << 16) | a);
+    write_chunk(file, "IDAT", zlib);
+    write_chunk(file, "IEND", std::vector<std::uint8_t>());
+
+    return (bool) file;
+}
+
+ImageComparison compare_images(const ReadbackImage& p_image, const std::vector<std::uint8_t>& p_golden,
+                               int p_golden_width, int p_golden_height, int p_tolerance)
+{
+    ImageComparison comparison = {false, 0, 0};
+    if (p_image.width != p_golden_width || p_image.height != p_golden_height ||
+        p_golden.size() != p_image.color.size())
+    {
+        return comparison;
+    }
+
+    comparison.size_matches = true;
+    for (std::size_t i = 0; i < p_image.color.size(); i += 4)
+    {
+        int difference = 0;
+        for (std::size_t c = 0; c < 4; c++)
+        {
+            difference = std::max(difference, std::abs((int) p_image.color[i + c] - (int) p_golden[i + c]));
+        }
+        comparison.max_difference = std::max(comparison.max_difference, difference);
+        if (difference > p_tolerance)
+        {
+            comparison.differing_pixels++;
+        }
+    }
+    return comparison;
+}
+
+ReadbackWorker::ReadbackWorker()
+{
+    raw_width        = 0;
+    raw_height       = 0;
+    golden_tolerance = DEFAULT_GOLDEN_TOLERANCE;
+    busy             = false;
+    stopping         = false;
+    stats            = ReadbackWorkerStats();
+    thread           = std::thread(&ReadbackWorker::run, this);
+}
+
+ReadbackWorker::~ReadbackWorker()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    thread.join();
+}
+
+void ReadbackWorker::set_png_directory(const std::string& p_directory)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    png_directory = p_directory;
+}
+
+void ReadbackWorker::set_raw_video(const std::string& p_path)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    raw_path = p_path;
+    raw_file.close();
+    if (!raw_path.empty())
+    {
+        raw_file.open(raw_path, std::ios::binary);
+        if (!raw_file)
+        {
+            std::cout << "ERROR::READBACK::CANNOT_WRITE " << raw_path << std::endl;
+        }
+    }
+}
+
+void ReadbackWorker::set_golden_directory(const std::string& p_directory, int p_tolerance)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    golden_directory = p_directory;
+    golden_tolerance = p_tolerance;
+}
+
+ReadbackImage ReadbackWorker::acquire_buffer()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (free_images.empty())
+    {
+        return ReadbackImage();
+    }
+
+    ReadbackImage image = std::move(free_images.back());
+    free_images.pop_back();
+    return image;
+}
+
+bool ReadbackWorker::submit(ReadbackImage&& p_image)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (queue.size() >= READBACK_MAX_QUEUED)
+        {
+            stats.images_dropped++;
+            free_images.push_back(std::move(p_image));
+            return false;
+        }
+        queue.push_back(std::move(p_image));
+    }
+    changed.notify_all();
+    return true;
+}
+
+void ReadbackWorker::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this] { return queue.empty() && !busy; });
+    if (raw_file.is_open())
+    {
+        raw_file.flush();
+    }
+}
+
+ReadbackWorkerStats ReadbackWorker::get_stats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+int ReadbackWorker::get_raw_width() const
+{
+    return raw_width;
+}
+
+int ReadbackWorker::get_raw_height() const
+{
+    return raw_height;
+}
+
+void ReadbackWorker::run()
+{
+    // Golden PNGs are top-down, flipped on load to the bottom-up order of the readback.
+    stbi_set_flip_vertically_on_load_thread(1);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        changed.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (queue.empty())
+        {
+            return;
+        }
+
+        ReadbackImage image = std::move(queue.front());
+        queue.pop_front();
+        busy = true;
+
+        // The outputs are set up before capture starts, and only this thread writes the files.
+        lock.unlock();
+        process(image);
+        lock.lock();
+
+        free_images.push_back(std::move(image));
+        busy = false;
+        changed.notify_all();
+    }
+}
+
+void ReadbackWorker::process(const ReadbackImage& p_image)
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "frame_%06llu.png", (unsigned long long) p_image.frame_index);
+
+    if (!png_directory.empty() && write_png(png_directory + "/" + name, p_image.width, p_image.height,
+                                            p_image.color.data()))
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.images_written++;
+    }
+
+    if (raw_file.is_open())
+    {
+        if (raw_width == 0)
+        {
+            raw_width  = p_image.width;
+            raw_height = p_image.height;
+        }
+
+        // A raw stream has no per-frame header, so every frame must keep the first one's size.
+        if (p_image.width != raw_width || p_image.height != raw_height)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stats.images_dropped++;
+        }
+        else
+        {
+            std::size_t row_bytes = (std::size_t) p_image.width * 4;
+            flipped_rows.resize(p_image.color.size());
+            for (int y = 0; y < p_image.height; y++)
+            {
+                std::memcpy(&flipped_rows[row_bytes * y], &p_image.color[row_bytes * (p_image.height - 1 - y)],
+                            row_bytes);
+            }
+            raw_file.write((const char*) flipped_rows.data(), (std::streamsize) flipped_rows.size());
+        }
+    }
+
+    if (!golden_directory.empty())
+    {
+        std::string    path = golden_directory + "/" + name;
+        int            width, height, channels;
+        unsigned char* data   = stbi_load(path.c_str(), &width, &height, &channels, 4);
+        bool           passed = false;
+        if (!data)
+        {
+            std::cout << "ERROR::READBACK::NO_GOLDEN_IMAGE " << path << std::endl;
+        }
+        else
+        {
+            std::vector<std::uint8_t> golden(data, data + (std::size_t) width * height * 4);
+            stbi_image_free(data);
+
+            ImageComparison comparison = compare_images(p_image, golden, width, height, golden_tolerance);
+            passed = comparison.size_matches && comparison.differing_pixels == 0;
+            if (!passed)
+            {
+                std::cout << "ERROR::READBACK::GOLDEN_MISMATCH " << path << ": "
+                          << (comparison.size_matches ? "" : "size differs, ") << comparison.differing_pixels
+                          << " pixels over tolerance " << golden_tolerance << ", max difference "
+                          << comparison.max_difference << std::endl;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.golden_compared++;
+        if (!passed)
+        {
+            stats.golden_failed++;
+        }
+    }
+}
+
+FrameReadback::FrameReadback(ReadbackWorker& p_worker, unsigned int p_latency, bool p_read_depth) :
+    worker(p_worker)
+{
+    read_depth = p_read_depth;
+    next_slot  = 0;
+    stats      = FrameReadbackStats();
+
+    slots.resize(std::clamp(p_latency, 1u, MAX_READBACK_LATENCY));
+    for (Slot& slot : slots)
+    {
+        glGenBuffers(1, &slot.color_buffer);
+        glGenBuffers(1, &slot.depth_buffer);
+        slot.fence       = NULL;
+        slot.frame_index = 0;
+        slot.width       = 0;
+        slot.height      = 0;
+        slot.capacity    = 0;
+    }
+}
+
+FrameReadback::~FrameReadback()
+{
+    ResourceRegistry& registry = ResourceRegistry::get_instance();
+    for (Slot& slot : slots)
+    {
+        if (slot.fence)
+        {
+            glDeleteSync(slot.fence);
+        }
+        registry.untrack(RESOURCE_BUFFER, slot.color_buffer);
+        registry.untrack(RESOURCE_BUFFER, slot.depth_buffer);
+        glDeleteBuffers(1, &slot.color_buffer);
+        glDeleteBuffers(1, &slot.depth_buffer);
+    }
+}
+
+bool FrameReadback::deliver(Slot& p_slot, bool p_wait)
+{
+    GLenum result = glClientWaitSync(p_slot.fence, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED && !p_wait)
+    {
+        return false;
+    }
+
+    GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    while (result == GL_TIMEOUT_EXPIRED)
+    {
+        result = glClientWaitSync(p_slot.fence, flags, READBACK_WAIT_STEP_NS);
+        flags  = 0;
+    }
+    glDeleteSync(p_slot.fence);
+    p_slot.fence = NULL;
+    if (result == GL_WAIT_FAILED)
+    {
+        std::cout << "ERROR::READBACK::WAIT_FAILED" << std::endl;
+        return true;
+    }
+
+    // The copy is done, so mapping does not wait on the GPU. What is left is a memcpy.
+    std::size_t   pixels = (std::size_t) p_slot.width * p_slot.height;
+    ReadbackImage image  = worker.acquire_buffer();
+    image.frame_index    = p_slot.frame_index;
+    image.width          = p_slot.width;
+    image.height         = p_slot.height;
+    image.color.resize(pixels * 4);
+    image.depth.resize(read_depth ? pixels : 0);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, p_slot.color_buffer);
+    void* color = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr) pixels * 4, GL_MAP_READ_BIT);
+    if (color)
+    {
+        std::memcpy(image.color.data(), color, pixels * 4);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    if (read_depth)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, p_slot.depth_buffer);
+        void* depth = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr) pixels * sizeof(float), GL_MAP_READ_BIT);
+        if (depth)
+        {
+            std::memcpy(image.depth.data(), depth, pixels * sizeof(float));
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    worker.submit(std::move(image));
+    stats.frames_delivered++;
+    return true;
+}
+
+void FrameReadback::capture(std::uint64_t p_frame_index, int p_width, int p_height)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    // Oldest first, and in order: a copy still running means the newer ones are too.
+    for (unsigned int i = 0; i < slots.size(); i++)
+    {
+        Slot& slot = slots[(next_slot + i) % slots.size()];
+        if (slot.fence && !deliver(slot, false))
+        {
+            break;
+        }
+    }
+
+    // Only reached when the GPU is slots.size() frames behind.
+    Slot& slot = slots[next_slot];
+    if (slot.fence)
+    {
+        stats.stalls++;
+        deliver(slot, true);
+    }
+
+    std::size_t pixels = (std::size_t) p_width * p_height;
+    if (pixels > slot.capacity)
+    {
+        ResourceRegistry& registry = ResourceRegistry::get_instance();
+        registry.untrack(RESOURCE_BUFFER, slot.color_buffer);
+        registry.untrack(RESOURCE_BUFFER, slot.depth_buffer);
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.color_buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr) pixels * 4, NULL, GL_STREAM_READ);
+        registry.track(RESOURCE_BUFFER, slot.color_buffer, pixels * 4, "frame_readback");
+        if (read_depth)
+        {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.depth_buffer);
+            glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr) pixels * sizeof(float), NULL, GL_STREAM_READ);
+            registry.track(RESOURCE_BUFFER, slot.depth_buffer, pixels * sizeof(float), "frame_readback");
+        }
+        slot.capacity = pixels;
+    }
+
+    // With a pack buffer bound these only queue the copy, nothing waits for the frame to finish.
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.color_buffer);
+    glReadPixels(0, 0, p_width, p_height, GL_RGBA, GL_UNSIGNED_BYTE, (void*) 0);
+    if (read_depth)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.depth_buffer);
+        glReadPixels(0, 0, p_width, p_height, GL_DEPTH_COMPONENT, GL_FLOAT, (void*) 0);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    slot.fence       = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.frame_index = p_frame_index;
+    slot.width       = p_width;
+    slot.height      = p_height;
+    next_slot        = (next_slot + 1) % slots.size();
+    stats.frames_copied++;
+
+    stats.last_milliseconds =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    stats.max_milliseconds = std::max(stats.max_milliseconds, stats.last_milliseconds);
+}
+
+void FrameReadback::finish()
+{
+    for (unsigned int i = 0; i < slots.size(); i++)
+    {
+        Slot& slot = slots[(next_slot + i) % slots.size()];
+        if (slot.fence)
+        {
+            deliver(slot, true);
+        }
+    }
+}
+
+FrameReadbackStats FrameReadback::get_stats() const
+{
+    return stats;
+}
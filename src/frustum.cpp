@@ -0,0 +1,72 @@
+#include "learn_opengl/frustum.hpp"
+
+#include "glm/ext/matrix_float4x4.hpp"
+#include "glm/ext/vector_float3.hpp"
+#include "glm/ext/vector_float4.hpp"
+#include "glm/common.hpp"
+#include "glm/geometric.hpp"
+
+Frustum make_frustum(const glm::mat4& p_view_projection)
+{
+    // Gribb/Hartmann: each plane is the fourth row of the matrix plus or minus one of the others.
+    const glm::mat4& m = p_view_projection;
+    glm::vec4        row_x(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4        row_y(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4        row_z(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4        row_w(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    Frustum frustum;
+    frustum.planes[FRUSTUM_LEFT] = row_w + row_x;
+    frustum.planes[FRUSTUM_RIGHT] = row_w - row_x;
+    frustum.planes[FRUSTUM_BOTTOM] = row_w + row_y;
+    frustum.planes[FRUSTUM_TOP] = row_w - row_y;
+    frustum.planes[FRUSTUM_NEAR] = row_w + row_z;
+    frustum.planes[FRUSTUM_FAR] = row_w - row_z;
+
+    for (glm::vec4& plane : frustum.planes)
+    {
+        plane /= glm::length(glm::vec3(plane));
+    }
+
+    return frustum;
+}
+
+bool sphere_in_frustum(const Frustum& p_frustum, const glm::vec3& p_center, float p_radius)
+{
+    for (const glm::vec4& plane : p_frustum.planes)
+    {
+        if (glm::dot(glm::vec3(plane), p_center) + plane.w < -p_radius)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool aabb_in_frustum(const Frustum& p_frustum, const glm::vec3& p_min, const glm::vec3& p_max)
+{
+    for (const glm::vec4& plane : p_frustum.planes)
+    {
+        // Test the corner furthest along the plane normal.
+        glm::vec3 corner(plane.x >= 0.0f ? p_max.x : p_min.x, plane.y >= 0.0f ? p_max.y : p_min.y,
+                         plane.z >= 0.0f ? p_max.z : p_min.z);
+
+        if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void get_bounding_sphere(const glm::mat4& p_matrix, const glm::vec3& p_min, const glm::vec3& p_max,
+                         glm::vec3& p_center, float& p_radius)
+{
+    float scale = glm::max(glm::length(glm::vec3(p_matrix[0])),
+                           glm::max(glm::length(glm::vec3(p_matrix[1])), glm::length(glm::vec3(p_matrix[2]))));
+
+    p_center = glm::vec3(p_matrix * glm::vec4((p_min + p_max) * 0.5f, 1.0f));
+    p_radius = glm::length(p_max - p_min) * 0.5f * scale;
+}
@@ -0,0 +1,43 @@
+#include "learn_opengl/fullscreen_quad.hpp"
+
+#include <glad/glad.h>
+
+#include "learn_opengl/resource_registry.hpp"
+
+FullscreenQuad::FullscreenQuad()
+{
+    // Position and texture coordinates.
+    float quad_vertices[] = {
+            -1.0f, 1.0f, 0.0f, 1.0f, -1.0f, -1.0f, 0.0f, 0.0f, 1.0f, -1.0f, 1.0f, 0.0f,
+            -1.0f, 1.0f, 0.0f, 1.0f, 1.0f,  -1.0f, 1.0f, 0.0f, 1.0f, 1.0f,  1.0f, 1.0f,
+    };
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad_vertices), &quad_vertices, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*) 0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*) (2 * sizeof(float)));
+    glBindVertexArray(0);
+
+    ResourceRegistry::get_instance().track(RESOURCE_VERTEX_ARRAY, vao, 0, "fullscreen_quad");
+    ResourceRegistry::get_instance().track(RESOURCE_BUFFER, vbo, sizeof(quad_vertices), "fullscreen_quad");
+}
+
+FullscreenQuad::~FullscreenQuad()
+{
+    ResourceRegistry::get_instance().untrack(RESOURCE_VERTEX_ARRAY, vao);
+    ResourceRegistry::get_instance().untrack(RESOURCE_BUFFER, vbo);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &vbo);
+}
+
+void FullscreenQuad::draw() const
+{
+    glBindVertexArray(vao);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+    glBindVertexArray(0);
+}
@@ -0,0 +1,982 @@
+#include "learn_opengl/gl_capture.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <glad/glad.h>
+
+#include "glm/gtc/type_ptr.hpp"
+
+// Every hooked entry point, as (glad suffix, PFN name). Calls to anything else are not captured.
+#define CAPTURE_HOOKS(HOOK)                                                                                            \
+    HOOK(GenBuffers, GENBUFFERS)                                                                                       \
+    HOOK(DeleteBuffers, DELETEBUFFERS)                                                                                 \
+    HOOK(GenTextures, GENTEXTURES)                                                                                     \
+    HOOK(DeleteTextures, DELETETEXTURES)                                                                               \
+    HOOK(GenVertexArrays, GENVERTEXARRAYS)                                                                             \
+    HOOK(DeleteVertexArrays, DELETEVERTEXARRAYS)                                                                       \
+    HOOK(GenFramebuffers, GENFRAMEBUFFERS)                                                                             \
+    HOOK(DeleteFramebuffers, DELETEFRAMEBUFFERS)                                                                       \
+    HOOK(GenRenderbuffers, GENRENDERBUFFERS)                                                                           \
+    HOOK(DeleteRenderbuffers, DELETERENDERBUFFERS)                                                                     \
+    HOOK(CreateShader, CREATESHADER)                                                                                   \
+    HOOK(DeleteShader, DELETESHADER)                                                                                   \
+    HOOK(ShaderSource, SHADERSOURCE)                                                                                   \
+    HOOK(CompileShader, COMPILESHADER)                                                                                 \
+    HOOK(CreateProgram, CREATEPROGRAM)                                                                                 \
+    HOOK(DeleteProgram, DELETEPROGRAM)                                                                                 \
+    HOOK(AttachShader, ATTACHSHADER)                                                                                   \
+    HOOK(LinkProgram, LINKPROGRAM)                                                                                     \
+    HOOK(GetUniformLocation, GETUNIFORMLOCATION)                                                                       \
+    HOOK(BindBuffer, BINDBUFFER)                                                                                       \
+    HOOK(BindBufferRange, BINDBUFFERRANGE)                                                                             \
+    HOOK(BindTexture, BINDTEXTURE)                                                                                     \
+    HOOK(BindVertexArray, BINDVERTEXARRAY)                                                                             \
+    HOOK(BindFramebuffer, BINDFRAMEBUFFER)                                                                             \
+    HOOK(BindRenderbuffer, BINDRENDERBUFFER)                                                                           \
+    HOOK(ActiveTexture, ACTIVETEXTURE)                                                                                 \
+    HOOK(UseProgram, USEPROGRAM)                                                                                       \
+    HOOK(Enable, ENABLE)                                                                                               \
+    HOOK(Disable, DISABLE)                                                                                             \
+    HOOK(DepthFunc, DEPTHFUNC)                                                                                         \
+    HOOK(DepthMask, DEPTHMASK)                                                                                         \
+    HOOK(ColorMask, COLORMASK)                                                                                         \
+    HOOK(ClearColor, CLEARCOLOR)                                                                                       \
+    HOOK(Viewport, VIEWPORT)                                                                                           \
+    HOOK(Scissor, SCISSOR)                                                                                             \
+    HOOK(BlendFunc, BLENDFUNC)                                                                                         \
+    HOOK(CullFace, CULLFACE)                                                                                           \
+    HOOK(PixelStorei, PIXELSTOREI)                                                                                     \
+    HOOK(StencilFunc, STENCILFUNC)                                                                                     \
+    HOOK(StencilOp, STENCILOP)                                                                                         \
+    HOOK(StencilMask, STENCILMASK)                                                                                     \
+    HOOK(BufferData, BUFFERDATA)                                                                                       \
+    HOOK(BufferSubData, BUFFERSUBDATA)                                                                                 \
+    HOOK(TexImage2D, TEXIMAGE2D)                                                                                       \
+    HOOK(TexImage3D, TEXIMAGE3D)                                                                                       \
+    HOOK(TexSubImage2D, TEXSUBIMAGE2D)                                                                                 \
+    HOOK(TexParameteri, TEXPARAMETERI)                                                                                 \
+    HOOK(GenerateMipmap, GENERATEMIPMAP)                                                                               \
+    HOOK(TexBuffer, TEXBUFFER)                                                                                         \
+    HOOK(VertexAttribPointer, VERTEXATTRIBPOINTER)                                                                     \
+    HOOK(VertexAttribIPointer, VERTEXATTRIBIPOINTER)                                                                   \
+    HOOK(VertexAttribDivisor, VERTEXATTRIBDIVISOR)                                                                     \
+    HOOK(EnableVertexAttribArray, ENABLEVERTEXATTRIBARRAY)                                                             \
+    HOOK(DisableVertexAttribArray, DISABLEVERTEXATTRIBARRAY)                                                           \
+    HOOK(FramebufferTexture2D, FRAMEBUFFERTEXTURE2D)                                                                   \
+    HOOK(FramebufferRenderbuffer, FRAMEBUFFERRENDERBUFFER)                                                             \
+    HOOK(RenderbufferStorage, RENDERBUFFERSTORAGE)                                                                     \
+    HOOK(Uniform1i, UNIFORM1I)                                                                                         \
+    HOOK(Uniform1f, UNIFORM1F)                                                                                         \
+    HOOK(Uniform2fv, UNIFORM2FV)                                                                                       \
+    HOOK(Uniform3fv, UNIFORM3FV)                                                                                       \
+    HOOK(Uniform4fv, UNIFORM4FV)                                                                                       \
+    HOOK(UniformMatrix3fv, UNIFORMMATRIX3FV)                                                                           \
+    HOOK(UniformMatrix4fv, UNIFORMMATRIX4FV)                                                                           \
+    HOOK(UniformBlockBinding, UNIFORMBLOCKBINDING)                                                                     \
+    HOOK(Clear, CLEAR)                                                                                                 \
+    HOOK(DrawArrays, DRAWARRAYS)                                                                                       \
+    HOOK(DrawElements, DRAWELEMENTS)                                                                                   \
+    HOOK(DrawArraysInstanced, DRAWARRAYSINSTANCED)                                                                     \
+    HOOK(DrawElementsInstanced, DRAWELEMENTSINSTANCED)                                                                 \
+    HOOK(MultiDrawElements, MULTIDRAWELEMENTS)
+
+namespace
+{
+#define DECLARE_REAL_FUNCTION(name, upper) PFNGL##upper##PROC name;
+struct RealFunctions
+{
+    CAPTURE_HOOKS(DECLARE_REAL_FUNCTION)
+} real;
+#undef DECLARE_REAL_FUNCTION
+
+void write_argument(GlCapture& p_capture, GLint p_value)
+{
+    p_capture.write_word((std::uint32_t) p_value);
+}
+
+void write_argument(GlCapture& p_capture, GLuint p_value)
+{
+    p_capture.write_word(p_value);
+}
+
+void write_argument(GlCapture& p_capture, GLboolean p_value)
+{
+    p_capture.write_word(p_value);
+}
+
+void write_argument(GlCapture& p_capture, GLfloat p_value)
+{
+    p_capture.write_float(p_value);
+}
+
+void write_argument(GlCapture& p_capture, const void* p_offset)
+{
+    p_capture.write_u64((std::uint64_t) (std::uintptr_t) p_offset);
+}
+
+template <typename... Arguments> void record(GlCaptureOpcode p_opcode, Arguments... p_arguments)
+{
+    GlCapture& capture = GlCapture::get_instance();
+    capture.begin_command(p_opcode);
+    (write_argument(capture, p_arguments), ...);
+    capture.end_command();
+}
+
+void record_names(GlCaptureOpcode p_opcode, GLsizei p_count, const GLuint* p_names)
+{
+    GlCapture& capture = GlCapture::get_instance();
+    capture.begin_command(p_opcode);
+    capture.write_word((std::uint32_t) p_count);
+    for (GLsizei i = 0; i < p_count; i++)
+    {
+        capture.write_word(p_names[i]);
+    }
+    capture.end_command();
+}
+
+void record_uniform_vector(GlCaptureOpcode p_opcode, GLint p_location, GLsizei p_count, const GLfloat* p_values,
+                           std::size_t p_floats_per_element)
+{
+    GlCapture& capture = GlCapture::get_instance();
+    capture.begin_command(p_opcode);
+    capture.write_word((std::uint32_t) p_location);
+    capture.write_word((std::uint32_t) p_count);
+    capture.write_blob(p_values, p_count * p_floats_per_element * sizeof(GLfloat));
+    capture.end_command();
+}
+
+std::size_t get_format_components(GLenum p_format)
+{
+    switch (p_format)
+    {
+    case GL_RG:
+    case GL_RG_INTEGER:
+        return 2;
+    case GL_RGB:
+    case GL_BGR:
+    case GL_RGB_INTEGER:
+        return 3;
+    case GL_RGBA:
+    case GL_BGRA:
+    case GL_RGBA_INTEGER:
+        return 4;
+    default:
+        return 1;
+    }
+}
+
+// Bytes GL reads from client memory for one image. Rows are padded to the unpack alignment, except
+// the last one, which the caller's buffer may end right after.
+std::size_t get_image_bytes(GLsizei p_width, GLsizei p_height, GLenum p_format, GLenum p_type)
+{
+    std::size_t pixel_bytes;
+    switch (p_type)
+    {
+    case GL_UNSIGNED_BYTE:
+    case GL_BYTE:
+        pixel_bytes = get_format_components(p_format);
+        break;
+    case GL_UNSIGNED_SHORT:
+    case GL_SHORT:
+    case GL_HALF_FLOAT:
+        pixel_bytes = get_format_components(p_format) * 2;
+        break;
+    case GL_UNSIGNED_INT_24_8:
+    case GL_UNSIGNED_INT_8_8_8_8:
+    case GL_UNSIGNED_INT_2_10_10_10_REV:
+        pixel_bytes = 4;
+        break;
+    default:
+        pixel_bytes = get_format_components(p_format) * 4;
+        break;
+    }
+
+    std::size_t alignment = (std::size_t) GlCapture::get_instance().get_unpack_alignment();
+    std::size_t row_bytes = (p_width * pixel_bytes + alignment - 1) / alignment * alignment;
+    return p_height > 0 ? row_bytes * (p_height - 1) + p_width * pixel_bytes : 0;
+}
+
+// Wrappers forward to the real entry point, then record what the call did.
+void APIENTRY hook_GenBuffers(GLsizei n, GLuint* buffers)
+{
+    real.GenBuffers(n, buffers);
+    record_names(CAPTURE_GEN_BUFFERS, n, buffers);
+}
+
+void APIENTRY hook_DeleteBuffers(GLsizei n, const GLuint* buffers)
+{
+    real.DeleteBuffers(n, buffers);
+    record_names(CAPTURE_DELETE_BUFFERS, n, buffers);
+}
+
+void APIENTRY hook_GenTextures(GLsizei n, GLuint* textures)
+{
+    real.GenTextures(n, textures);
+    record_names(CAPTURE_GEN_TEXTURES, n, textures);
+}
+
+void APIENTRY hook_DeleteTextures(GLsizei n, const GLuint* textures)
+{
+    real.DeleteTextures(n, textures);
+    record_names(CAPTURE_DELETE_TEXTURES, n, textures);
+}
+
+void APIENTRY hook_GenVertexArrays(GLsizei n, GLuint* arrays)
+{
+    real.GenVertexArrays(n, arrays);
+    record_names(CAPTURE_GEN_VERTEX_ARRAYS, n, arrays);
+}
+
+void APIENTRY hook_DeleteVertexArrays(GLsizei n, const GLuint* arrays)
+{
+    real.DeleteVertexArrays(n, arrays);
+    record_names(CAPTURE_DELETE_VERTEX_ARRAYS, n, arrays);
+}
+
+void APIENTRY hook_GenFramebuffers(GLsizei n, GLuint* framebuffers)
+{
+    real.GenFramebuffers(n, framebuffers);
+    record_names(CAPTURE_GEN_FRAMEBUFFERS, n, framebuffers);
+}
+
+void APIENTRY hook_DeleteFramebuffers(GLsizei n, const GLuint* framebuffers)
+{
+    real.DeleteFramebuffers(n, framebuffers);
+    record_names(CAPTURE_DELETE_FRAMEBUFFERS, n, framebuffers);
+}
+
+void APIENTRY hook_GenRenderbuffers(GLsizei n, GLuint* renderbuffers)
+{
+    real.GenRenderbuffers(n, renderbuffers);
+    record_names(CAPTURE_GEN_RENDERBUFFERS, n, renderbuffers);
+}
+
+void APIENTRY hook_DeleteRenderbuffers(GLsizei n, const GLuint* renderbuffers)
+{
+    real.DeleteRenderbuffers(n, renderbuffers);
+    record_names(CAPTURE_DELETE_RENDERBUFFERS, n, renderbuffers);
+}
+
+GLuint APIENTRY hook_CreateShader(GLenum type)
+{
+    GLuint shader = real.CreateShader(type);
+    record(CAPTURE_CREATE_SHADER, type, shader);
+    return shader;
+}
+
+void APIENTRY hook_DeleteShader(GLuint shader)
+{
+    real.DeleteShader(shader);
+    record(CAPTURE_DELETE_SHADER, shader);
+}
+
+void APIENTRY hook_ShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length)
+{
+    real.ShaderSource(shader, count, string, length);
+
+    std::string source;
+    for (GLsizei i = 0; i < count; i++)
+    {
+        if (length && length[i] >= 0)
+        {
+            source.append(string[i], length[i]);
+        }
+        else
+        {
+            source.append(string[i]);
+        }
+    }
+
+    GlCapture& capture = GlCapture::get_instance();
+    capture.begin_command(CAPTURE_SHADER_SOURCE);
+    capture.write_word(shader);
+    capture.write_blob(source.data(), source.size());
+    capture.end_command();
+}
+
+void APIENTRY hook_CompileShader(GLuint shader)
+{
+    real.CompileShader(shader);
+    record(CAPTURE_COMPILE_SHADER, shader);
+}
+
+GLuint APIENTRY hook_CreateProgram()
+{
+    GLuint program = real.CreateProgram();
+    record(CAPTURE_CREATE_PROGRAM, program);
+    return program;
+}
+
+void APIENTRY hook_DeleteProgram(GLuint program)
+{
+    real.DeleteProgram(program);
+    record(CAPTURE_DELETE_PROGRAM, program);
+}
+
+void APIENTRY hook_AttachShader(GLuint program, GLuint shader)
+{
+    real.AttachShader(program, shader);
+    record(CAPTURE_ATTACH_SHADER, program, shader);
+}
+
+void APIENTRY hook_LinkProgram(GLuint program)
+{
+    real.LinkProgram(program);
+    record(CAPTURE_LINK_PROGRAM, program);
+}
+
+GLint APIENTRY hook_GetUniformLocation(GLuint program, const GLchar* name)
+{
+    GLint location = real.GetUniformLocation(program, name);
+
+    // Locations may differ on another driver, the replay looks the name up again and remaps.
+    GlCapture& capture = GlCapture::get_instance();
+    capture.begin_command(CAPTURE_GET_UNIFORM_LOCATION);
+    capture.write_word(program);
+    capture.write_word((std::uint32_t) location);
+    capture.write_blob(name, std::strlen(name));
+    capture.end_command();
+    return location;
+}
+
+void APIENTRY hook_BindBuffer(GLenum target, GLuint buffer)
+{
+    real.BindBuffer(target, buffer);
+    record(CAPTURE_BIND_BUFFER, target, buffer);
+}
+
+void APIENTRY hook_BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    real.BindBufferRange(target, index, buffer, offset, size);
+
+    GlCapture& capture = GlCapture::get_instance();
+    capture.begin_command(CAPTURE_BIND_BUFFER_RANGE);
+    capture.write_word(target);
+    capture.write_word(index);
+    capture.write_word(buffer);
+    capture.write_u64((std::uint64_t) offset);
+    capture.write_u64((std::uint64_t) size);
+    capture.end_command();
+}
+
+void APIENTRY hook_BindTexture(GLenum target, GLuint texture)
+{
+    real.BindTexture(target, texture);
+    record(CAPTURE_BIND_TEXTURE, target, texture);
+}
+
+void APIENTRY hook_BindVertexArray(GLuint array)
+{
+    real.BindVertexArray(array);
+    record(CAPTURE_BIND_VERTEX_ARRAY, array);
+}
+
+void APIENTRY hook_BindFramebuffer(GLenum target, GLuint framebuffer)
+{
+    real.BindFramebuffer(target, framebuffer);
+    record(CAPTURE_BIND_FRAMEBUFFER, target, framebuffer);
+}
+
+void APIENTRY hook_BindRenderbuffer(GLenum target, GLuint renderbuffer)
+{
+    real.BindRenderbuffer(target, renderbuffer);
+    record(CAPTURE_BIND_RENDERBUFFER, target, renderbuffer);
+}
+
+void APIENTRY hook_ActiveTexture(GLenum texture)
+{
+    real.ActiveTexture(texture);
+    record(CAPTURE_ACTIVE_TEXTURE, texture);
+}
+
+void APIENTRY hook_UseProgram(GLuint program)
+{
+    real.UseProgram(program);
+    record(CAPTURE_USE_PROGRAM, program);
+}
+
+void APIENTRY hook_Enable(GLenum capability)
+{
+    real.Enable(capability);
+    record(CAPTURE_ENABLE, capability);
+}
+
+void APIENTRY hook_Disable(GLenum capability)
+{
+    real.Disable(capability);
+    record(CAPTURE_DISABLE, capability);
+}
+
+void APIENTRY hook_DepthFunc(GLenum func)
+{
+    real.DepthFunc(func);
+    record(CAPTURE_DEPTH_FUNC, func);
+}
+
+void APIENTRY hook_DepthMask(GLboolean flag)
+{
+    real.DepthMask(flag);
+    record(CAPTURE_DEPTH_MASK, flag);
+}
+
+void APIENTRY hook_ColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha)
+{
+    real.ColorMask(red, green, blue, alpha);
+    record(CAPTURE_COLOR_MASK, red, green, blue, alpha);
+}
+
+void APIENTRY hook_ClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+{
+    real.ClearColor(red, green, blue, alpha);
+    record(CAPTURE_CLEAR_COLOR, red, green, blue, alpha);
+}
+
+void APIENTRY hook_Viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    real.Viewport(x, y, width, height);
+    record(CAPTURE_VIEWPORT, x, y, width, height);
+}
+
+void APIENTRY hook_Scissor(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    real.Scissor(x, y, width, height);
+    record(CAPTURE_SCISSOR, x, y, width, height);
+}
+
+void APIENTRY hook_BlendFunc(GLenum sfactor, GLenum dfactor)
+{
+    real.BlendFunc(sfactor, dfactor);
+    record(CAPTURE_BLEND_FUNC, sfactor, dfactor);
+}
+
+void APIENTRY hook_CullFace(GLenum mode)
+{
+    real.CullFace(mode);
+    record(CAPTURE_CULL_FACE, mode);
+}
+
+void APIENTRY hook_PixelStorei(GLenum pname, GLint param)
+{
+    real.PixelStorei(pname, param);
+    if (pname == GL_UNPACK_ALIGNMENT)
+    {
+        GlCapture::get_instance().set_unpack_alignment(param);
+    }
+    record(CAPTURE_PIXEL_STORE, pname, param);
+}
+
+void APIENTRY hook_StencilFunc(GLenum func, GLint ref, GLuint mask)
+{
+    real.StencilFunc(func, ref, mask);
+    record(CAPTURE_STENCIL_FUNC, func, ref, mask);
+}
+
+void APIENTRY hook_StencilOp(GLenum fail, GLenum zfail, GLenum zpass)
+{
+    real.StencilOp(fail, zfail, zpass);
+    record(CAPTURE_STENCIL_OP, fail, zfail, zpass);
+}
+
+void APIENTRY hook_StencilMask(GLuint mask)
+{
+    real.StencilMask(mask);
+    record(CAPTURE_STENCIL_MASK, mask);
+}
+
+void APIENTRY hook_BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+{
+    real.BufferData(target, size, data, usage);
+
+    GlCapture& capture = GlCapture::get_instance();
+    capture.begin_command(CAPTURE_BUFFER_DATA);
+    capture.write_word(target);
+    capture.write_word(usage);
+    capture.write_u64((std::uint64_t) size);
+    capture.write_word(data ? 1 : 0);
+    capture.write_blob(data, data ? (std::size_t) size : 0);
+    capture.end_command();
+}
+
+void APIENTRY hook_BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+{
+    real.BufferSubData(target, offset, size, data);
+
+    GlCapture& capture = GlCapture::get_instance();
+    capture.begin_command(CAPTURE_BUFFER_SUB_DATA);
+    capture.write_word(target);
+    capture.write_u64((std::uint64_t) offset);
+    capture.write_u64((std::uint64_t) size);
+    capture.write_blob(data, (std::size_t) size);
+    capture.end_command();
+}
+
+void APIENTRY hook_TexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+                              GLint border, GLenum format, GLenum type, const void* pixels)
+{
+    real.TexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+
+    GlCapture& capture = GlCapture::get_instance();
+    capture.begin_command(CAPTURE_TEX_IMAGE_2D);
+    capture.write_word(target);
+    capture.write_word((std::uint32_t) level);
+    capture.write_word((std::uint32_t) internalformat);
+    capture.write_word((std::uint32_t) width);
+    capture.write_word((std::uint32_t) height);
+    capture.write_word(format);
+    capture.write_word(type);
+    capture.write_word(pixels ? 1 : 0);
+    capture.write_blob(pixels, pixels ? get_image_bytes(width, height, format, type) : 0);
+    capture.end_command();
+}
+
+void APIENTRY hook_TexImage3D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+                              GLsizei depth, GLint border, GLenum format, GLenum type, const void* pixels)
+{
+    real.TexImage3D(target, level, internalformat, width, height, depth, border, format, type, pixels);
+
+    // Layers follow each other without extra padding, so they read like one image depth times as tall.
+    GlCapture& capture = GlCapture::get_instance();
+    capture.begin_command(CAPTURE_TEX_IMAGE_3D);
+    capture.write_word(target);
+    capture.write_word((std::uint32_t) level);
+    capture.write_word((std::uint32_t) internalformat);
+    capture.write_word((std::uint32_t) width);
+    capture.write_word((std::uint32_t) height);
+    capture.write_word((std::uint32_t) depth);
+    capture.write_word(format);
+    capture.write_word(type);
+    capture.write_word(pixels ? 1 : 0);
+    capture.write_blob(pixels, pixels ? get_image_bytes(width, height * depth, format, type) : 0);
+    capture.end_command();
+}
+
+void APIENTRY hook_TexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width,
+                                 GLsizei height, GLenum format, GLenum type, const void* pixels)
+{
+    real.TexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, pixels);
+
+    GlCapture& capture = GlCapture::get_instance();
+    capture.begin_command(CAPTURE_TEX_SUB_IMAGE_2D);
+    capture.write_word(target);
+    capture.write_word((std::uint32_t) level);
+    capture.write_word((std::uint32_t) xoffset);
+    capture.write_word((std::uint32_t) yoffset);
+    capture.write_word((std::uint32_t) width);
+    capture.write_word((std::uint32_t) height);
+    capture.write_word(format);
+    capture.write_word(type);
+    capture.write_blob(pixels, get_image_bytes(width, height, format, type));
+    capture.end_command();
+}
+
+void APIENTRY hook_TexParameteri(GLenum target, GLenum pname, GLint param)
+{
+    real.TexParameteri(target, pname, param);
+    record(CAPTURE_TEX_PARAMETER_I, target, pname, param);
+}
+
+void APIENTRY hook_GenerateMipmap(GLenum target)
+{
+    real.GenerateMipmap(target);
+    record(CAPTURE_GENERATE_MIPMAP, target);
+}
+
+void APIENTRY hook_TexBuffer(GLenum target, GLenum internalformat, GLuint buffer)
+{
+    real.TexBuffer(target, internalformat, buffer);
+    record(CAPTURE_TEX_BUFFER, target, internalformat, buffer);
+}
+
+void APIENTRY hook_VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride,
+                                       const void* pointer)
+{
+    real.VertexAttribPointer(index, size, type, normalized, stride, pointer);
+    record(CAPTURE_VERTEX_ATTRIB_POINTER, index, size, type, normalized, stride, pointer);
+}
+
+void APIENTRY hook_VertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, const void* pointer)
+{
+    real.VertexAttribIPointer(index, size, type, stride, pointer);
+    record(CAPTURE_VERTEX_ATTRIB_I_POINTER, index, size, type, stride, pointer);
+}
+
+void APIENTRY hook_VertexAttribDivisor(GLuint index, GLuint divisor)
+{
+    real.VertexAttribDivisor(index, divisor);
+    record(CAPTURE_VERTEX_ATTRIB_DIVISOR, index, divisor);
+}
+
+void APIENTRY hook_EnableVertexAttribArray(GLuint index)
+{
+    real.EnableVertexAttribArray(index);
+    record(CAPTURE_ENABLE_VERTEX_ATTRIB_ARRAY, index);
+}
+
+void APIENTRY hook_DisableVertexAttribArray(GLuint index)
+{
+    real.DisableVertexAttribArray(index);
+    record(CAPTURE_DISABLE_VERTEX_ATTRIB_ARRAY, index);
+}
+
+void APIENTRY hook_FramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture,
+                                        GLint level)
+{
+    real.FramebufferTexture2D(target, attachment, textarget, texture, level);
+    record(CAPTURE_FRAMEBUFFER_TEXTURE_2D, target, attachment, textarget, texture, level);
+}
+
+void APIENTRY hook_FramebufferRenderbuffer(GLenum target, GLenum attachment, GLenum renderbuffertarget,
+                                           GLuint renderbuffer)
+{
+    real.FramebufferRenderbuffer(target, attachment, renderbuffertarget, renderbuffer);
+    record(CAPTURE_FRAMEBUFFER_RENDERBUFFER, target, attachment, renderbuffertarget, renderbuffer);
+}
+
+void APIENTRY hook_RenderbufferStorage(GLenum target, GLenum internalformat, GLsizei width, GLsizei height)
+{
+    real.RenderbufferStorage(target, internalformat, width, height);
+    record(CAPTURE_RENDERBUFFER_STORAGE, target, internalformat, width, height);
+}
+
+void APIENTRY hook_Uniform1i(GLint location, GLint v0)
+{
+    real.Uniform1i(location, v0);
+    record(CAPTURE_UNIFORM_1I, location, v0);
+}
+
+void APIENTRY hook_Uniform1f(GLint location, GLfloat v0)
+{
+    real.Uniform1f(location, v0);
+    record(CAPTURE_UNIFORM_1F, location, v0);
+}
+
+void APIENTRY hook_Uniform2fv(GLint location, GLsizei count, const GLfloat* value)
+{
+    real.Uniform2fv(location, count, value);
+    record_uniform_vector(CAPTURE_UNIFORM_2FV, location, count, value, 2);
+}
+
+void APIENTRY hook_Uniform3fv(GLint location, GLsizei count, const GLfloat* value)
+{
+    real.Uniform3fv(location, count, value);
+    record_uniform_vector(CAPTURE_UNIFORM_3FV, location, count, value, 3);
+}
+
+void APIENTRY hook_Uniform4fv(GLint location, GLsizei count, const GLfloat* value)
+{
+    real.Uniform4fv(location, count, value);
+    record_uniform_vector(CAPTURE_UNIFORM_4FV, location, count, value, 4);
+}
+
+void APIENTRY hook_UniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+{
+    real.UniformMatrix3fv(location, count, transpose, value);
+
+    GlCapture& capture = GlCapture::get_instance();
+    capture.begin_command(CAPTURE_UNIFORM_MATRIX_3FV);
+    capture.write_word((std::uint32_t) location);
+    capture.write_word((std::uint32_t) count);
+    capture.write_word(transpose);
+    capture.write_blob(value, count * 9 * sizeof(GLfloat));
+    capture.end_command();
+}
+
+void APIENTRY hook_UniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+{
+    real.UniformMatrix4fv(location, count, transpose, value);
+
+    GlCapture& capture = GlCapture::get_instance();
+    capture.begin_command(CAPTURE_UNIFORM_MATRIX_4FV);
+    capture.write_word((std::uint32_t) location);
+    capture.write_word((std::uint32_t) count);
+    capture.write_word(transpose);
+    capture.write_blob(value, count * 16 * sizeof(GLfloat));
+    capture.end_command();
+}
+
+void APIENTRY hook_UniformBlockBinding(GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding)
+{
+    real.UniformBlockBinding(program, uniformBlockIndex, uniformBlockBinding);
+
+    // Block indices may differ on another driver like uniform locations, so the name is recorded instead.
+    GLchar  name[256];
+    GLsizei length = 0;
+    glGetActiveUniformBlockName(program, uniformBlockIndex, sizeof(name), &length, name);
+
+    GlCapture& capture = GlCapture::get_instance();
+    capture.begin_command(CAPTURE_UNIFORM_BLOCK_BINDING);
+    capture.write_word(program);
+    capture.write_word(uniformBlockBinding);
+    capture.write_blob(name, (std::size_t) length);
+    capture.end_command();
+}
+
+void APIENTRY hook_Clear(GLbitfield mask)
+{
+    real.Clear(mask);
+    record(CAPTURE_CLEAR, mask);
+}
+
+void APIENTRY hook_DrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+    real.DrawArrays(mode, first, count);
+    record(CAPTURE_DRAW_ARRAYS, mode, first, count);
+}
+
+void APIENTRY hook_DrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices)
+{
+    real.DrawElements(mode, count, type, indices);
+    record(CAPTURE_DRAW_ELEMENTS, mode, count, type, indices);
+}
+
+void APIENTRY hook_DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instancecount)
+{
+    real.DrawArraysInstanced(mode, first, count, instancecount);
+    record(CAPTURE_DRAW_ARRAYS_INSTANCED, mode, first, count, instancecount);
+}
+
+void APIENTRY hook_DrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* indices,
+                                         GLsizei instancecount)
+{
+    real.DrawElementsInstanced(mode, count, type, indices, instancecount);
+    record(CAPTURE_DRAW_ELEMENTS_INSTANCED, mode, count, type, indices, instancecount);
+}
+
+void APIENTRY hook_MultiDrawElements(GLenum mode, const GLsizei* count, GLenum type, const void* const* indices,
+                                     GLsizei drawcount)
+{
+    real.MultiDrawElements(mode, count, type, indices, drawcount);
+
+    GlCapture& capture = GlCapture::get_instance();
+    capture.begin_command(CAPTURE_MULTI_DRAW_ELEMENTS);
+    capture.write_word(mode);
+    capture.write_word(type);
+    capture.write_word((std::uint32_t) drawcount);
+    for (GLsizei i = 0; i < drawcount; i++)
+    {
+        capture.write_word((std::uint32_t) count[i]);
+        capture.write_u64((std::uint64_t) (std::uintptr_t) indices[i]);
+    }
+    capture.end_command();
+}
+
+// Only change pixels, which the captured range redraws, so earlier frames can leave them out.
+bool is_pixel_only(GlCaptureOpcode p_opcode)
+{
+    return p_opcode == CAPTURE_CLEAR || p_opcode == CAPTURE_DRAW_ARRAYS || p_opcode == CAPTURE_DRAW_ELEMENTS ||
+           p_opcode == CAPTURE_DRAW_ARRAYS_INSTANCED || p_opcode == CAPTURE_DRAW_ELEMENTS_INSTANCED ||
+           p_opcode == CAPTURE_MULTI_DRAW_ELEMENTS || p_opcode == CAPTURE_PASS_BEGIN;
+}
+} // namespace
+
+GlCapture& GlCapture::get_instance()
+{
+    static GlCapture instance;
+    return instance;
+}
+
+GlCapture::GlCapture()
+{
+    first_frame      = 0;
+    frame_count      = 0;
+    current_frame    = 0;
+    recording        = false;
+    unpack_alignment = 4;
+    command_start    = 0;
+    command_skipped  = false;
+}
+
+void GlCapture::start(const std::string& p_path, unsigned int p_first_frame, unsigned int p_frame_count)
+{
+    if (recording)
+    {
+        return;
+    }
+
+    path          = p_path;
+    first_frame   = p_first_frame;
+    frame_count   = p_frame_count > 0 ? p_frame_count : 1;
+    current_frame = 0;
+    recording     = true;
+    stream.clear();
+    install_hooks();
+
+    std::cout << "Capturing frames " << first_frame << " to " << first_frame + frame_count - 1 << " into " << path
+              << std::endl;
+}
+
+bool GlCapture::is_recording() const
+{
+    return recording;
+}
+
+bool GlCapture::is_in_range() const
+{
+    return current_frame >= first_frame;
+}
+
+void GlCapture::begin_frame(const glm::mat4& p_view, const glm::mat4& p_projection, const glm::vec3& p_camera_position,
+                            int p_viewport_width, int p_viewport_height)
+{
+    if (!recording)
+    {
+        return;
+    }
+
+    begin_command(CAPTURE_FRAME_BEGIN);
+    write_word(current_frame);
+    write_word((std::uint32_t) p_viewport_width);
+    write_word((std::uint32_t) p_viewport_height);
+    write_blob(glm::value_ptr(p_view), 16 * sizeof(float));
+    write_blob(glm::value_ptr(p_projection), 16 * sizeof(float));
+    write_blob(glm::value_ptr(p_camera_position), 3 * sizeof(float));
+    end_command();
+}
+
+void GlCapture::mark_pass(const char* p_name)
+{
+    if (!recording)
+    {
+        return;
+    }
+
+    begin_command(CAPTURE_PASS_BEGIN);
+    write_blob(p_name, std::strlen(p_name));
+    end_command();
+}
+
+void GlCapture::end_frame()
+{
+    if (!recording)
+    {
+        return;
+    }
+
+    begin_command(CAPTURE_FRAME_END);
+    end_command();
+
+    current_frame++;
+    if (current_frame < first_frame + frame_count)
+    {
+        return;
+    }
+
+    remove_hooks();
+    recording = false;
+
+    if (write_file())
+    {
+        std::cout << "Wrote " << frame_count << " frame capture to " << path << " (" << stream.size() / 1024
+                  << " KiB)" << std::endl;
+    }
+    stream.clear();
+    stream.shrink_to_fit();
+}
+
+void GlCapture::begin_command(GlCaptureOpcode p_opcode)
+{
+    command_skipped = !is_in_range() && is_pixel_only(p_opcode);
+    if (command_skipped)
+    {
+        return;
+    }
+
+    GlCaptureCommand command = {p_opcode, 0, 0};
+    command_start            = stream.size();
+    stream.insert(stream.end(), (const unsigned char*) &command, (const unsigned char*) &command + sizeof(command));
+}
+
+void GlCapture::write_word(std::uint32_t p_word)
+{
+    write_blob(&p_word, sizeof(p_word));
+}
+
+void GlCapture::write_float(float p_value)
+{
+    write_blob(&p_value, sizeof(p_value));
+}
+
+void GlCapture::write_u64(std::uint64_t p_value)
+{
+    write_blob(&p_value, sizeof(p_value));
+}
+
+void GlCapture::write_blob(const void* p_data, std::size_t p_size)
+{
+    if (command_skipped || p_size == 0)
+    {
+        return;
+    }
+
+    const unsigned char* bytes = (const unsigned char*) p_data;
+    stream.insert(stream.end(), bytes, bytes + p_size);
+}
+
+void GlCapture::end_command()
+{
+    if (command_skipped)
+    {
+        return;
+    }
+
+    // Payloads are padded to 4 bytes so every command header stays aligned.
+    while ((stream.size() - command_start) % 4 != 0)
+    {
+        stream.push_back(0);
+    }
+
+    std::uint32_t size = (std::uint32_t) (stream.size() - command_start - sizeof(GlCaptureCommand));
+    std::memcpy(&stream[command_start] + offsetof(GlCaptureCommand, size), &size, sizeof(size));
+}
+
+int GlCapture::get_unpack_alignment() const
+{
+    return unpack_alignment;
+}
+
+void GlCapture::set_unpack_alignment(int p_alignment)
+{
+    unpack_alignment = p_alignment;
+}
+
+void GlCapture::install_hooks()
+{
+#define INSTALL_HOOK(name, upper)                                                                                      \
+    real.name      = glad_gl##name;                                                                                    \
+    glad_gl##name = hook_##name;
+    CAPTURE_HOOKS(INSTALL_HOOK)
+#undef INSTALL_HOOK
+}
+
+void GlCapture::remove_hooks()
+{
+#define REMOVE_HOOK(name, upper) glad_gl##name = real.name;
+    CAPTURE_HOOKS(REMOVE_HOOK)
+#undef REMOVE_HOOK
+}
+
+bool GlCapture::write_file()
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+    {
+        std::cout << "ERROR::GL_CAPTURE::FILE_NOT_WRITABLE\n" << path << std::endl;
+        return false;
+    }
+
+    GlCaptureHeader header;
+    std::memcpy(header.magic, GL_CAPTURE_MAGIC, sizeof(header.magic));
+    header.version       = GL_CAPTURE_VERSION;
+    header.first_frame   = first_frame;
+    header.frame_count   = frame_count;
+    header.command_bytes = stream.size();
+
+    file.write((const char*) &header, sizeof(header));
+    file.write((const char*) stream.data(), stream.size());
+    return (bool) file;
+}
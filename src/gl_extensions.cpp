@@ -0,0 +1,36 @@
+#include "learn_opengl/gl_extensions.hpp"
+
+#include <cstddef>
+
+#include <glad/glad.h>
+
+namespace
+{
+GlExtensions extensions = {0, 0, false, NULL, NULL, NULL};
+} // namespace
+
+bool load_gl_extensions(GLADloadproc p_loader)
+{
+    glGetIntegerv(GL_MAJOR_VERSION, &extensions.major_version);
+    glGetIntegerv(GL_MINOR_VERSION, &extensions.minor_version);
+
+    extensions.has_gl43 = false;
+    if (extensions.major_version < 4 || (extensions.major_version == 4 && extensions.minor_version < 3))
+    {
+        return false;
+    }
+
+    extensions.dispatch_compute = (PFN_DISPATCH_COMPUTE) p_loader("glDispatchCompute");
+    extensions.memory_barrier   = (PFN_MEMORY_BARRIER) p_loader("glMemoryBarrier");
+    extensions.multi_draw_elements_indirect =
+            (PFN_MULTI_DRAW_ELEMENTS_INDIRECT) p_loader("glMultiDrawElementsIndirect");
+
+    extensions.has_gl43 =
+            extensions.dispatch_compute && extensions.memory_barrier && extensions.multi_draw_elements_indirect;
+    return extensions.has_gl43;
+}
+
+const GlExtensions& get_gl_extensions()
+{
+    return extensions;
+}
@@ -0,0 +1,1108 @@
+#include "learn_opengl/gl_replay.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "learn_opengl/gl_capture.hpp"
+#include "learn_opengl/mapped_file.hpp"
+
+namespace
+{
+struct ReplayCommand
+{
+    GlCaptureOpcode      opcode;
+    const unsigned char* payload;
+    std::uint32_t        size;
+};
+
+// Reads a command payload front to back. Reading past the end yields zeros and marks it invalid.
+class PayloadReader
+{
+  public:
+    explicit PayloadReader(const ReplayCommand& p_command)
+    {
+        data     = p_command.payload;
+        size     = p_command.size;
+        position = 0;
+        overrun  = false;
+    }
+
+    std::uint32_t word()
+    {
+        std::uint32_t value = 0;
+        read(&value, sizeof(value));
+        return value;
+    }
+
+    GLint integer()
+    {
+        return (GLint) word();
+    }
+
+    GLfloat real()
+    {
+        GLfloat value = 0.0f;
+        read(&value, sizeof(value));
+        return value;
+    }
+
+    std::uint64_t u64()
+    {
+        std::uint64_t value = 0;
+        read(&value, sizeof(value));
+        return value;
+    }
+
+    // Buffer offsets were recorded where GL takes a pointer.
+    const void* offset()
+    {
+        return (const void*) (std::uintptr_t) u64();
+    }
+
+    // Everything left, including the padding after a blob.
+    const unsigned char* rest(std::size_t& p_size)
+    {
+        p_size   = size - position;
+        position = size;
+        return data + size - p_size;
+    }
+
+    std::size_t remaining() const
+    {
+        return size - position;
+    }
+
+    bool is_valid() const
+    {
+        return !overrun;
+    }
+
+  private:
+    void read(void* p_value, std::size_t p_bytes)
+    {
+        if (position + p_bytes > size)
+        {
+            overrun  = true;
+            position = size;
+            return;
+        }
+        std::memcpy(p_value, data + position, p_bytes);
+        position += p_bytes;
+    }
+
+    const unsigned char* data;
+    std::size_t          size;
+    std::size_t          position;
+    bool                 overrun;
+};
+
+struct PassTiming
+{
+    std::string         name;
+    std::vector<double> gpu_milliseconds;
+    unsigned long long  draws;
+};
+
+// Executes captured commands against the current context, translating captured object names and
+// uniform locations into the ones this context handed out.
+class Replayer
+{
+  public:
+    explicit Replayer(GLuint p_framebuffer)
+    {
+        framebuffer     = p_framebuffer;
+        current_program = 0;
+        timing          = false;
+        current_pass    = -1;
+        frame_start     = 0.0;
+    }
+
+    ~Replayer()
+    {
+        if (!query_pool.empty())
+        {
+            glDeleteQueries((GLsizei) query_pool.size(), query_pool.data());
+        }
+    }
+
+    bool execute(const ReplayCommand& p_command);
+
+    // Timing is only wanted for the captured range, not the state rebuild before it.
+    void set_timing(bool p_timing)
+    {
+        timing = p_timing;
+    }
+
+    const std::vector<PassTiming>& get_passes() const
+    {
+        return passes;
+    }
+
+    const std::vector<double>& get_frame_milliseconds() const
+    {
+        return frame_milliseconds;
+    }
+
+  private:
+    enum NameKind
+    {
+        NAME_BUFFER,
+        NAME_TEXTURE,
+        NAME_VERTEX_ARRAY,
+        NAME_FRAMEBUFFER,
+        NAME_RENDERBUFFER,
+        NAME_SHADER,
+        NAME_PROGRAM,
+        NAME_KIND_COUNT
+    };
+
+    GLuint map_name(NameKind p_kind, std::uint32_t p_name) const
+    {
+        if (p_name == 0)
+        {
+            return p_kind == NAME_FRAMEBUFFER ? framebuffer : 0;
+        }
+        std::unordered_map<std::uint32_t, GLuint>::const_iterator it = names[p_kind].find(p_name);
+        return it == names[p_kind].end() ? 0 : it->second;
+    }
+
+    GLint map_location(GLint p_location) const
+    {
+        std::uint64_t key = ((std::uint64_t) current_program << 32) | (std::uint32_t) p_location;
+        std::unordered_map<std::uint64_t, GLint>::const_iterator it = uniform_locations.find(key);
+        return it == uniform_locations.end() ? -1 : it->second;
+    }
+
+    void gen_names(PayloadReader& p_reader, NameKind p_kind, void (*p_gen)(GLsizei, GLuint*));
+    void delete_names(PayloadReader& p_reader, NameKind p_kind, void (*p_delete)(GLsizei, const GLuint*));
+
+    void begin_pass(const std::string& p_name);
+    void end_pass();
+    void begin_frame();
+    void end_frame();
+
+    GLuint                                    framebuffer;
+    std::unordered_map<std::uint32_t, GLuint> names[NAME_KIND_COUNT];
+    std::unordered_map<std::uint64_t, GLint>  uniform_locations;
+    std::uint32_t                             current_program;
+
+    bool                                 timing;
+    std::vector<PassTiming>              passes;
+    std::unordered_map<std::string, int> pass_lookup;
+    int                                  current_pass;
+    std::vector<GLuint>                  query_pool;
+    std::vector<std::pair<int, GLuint>>  frame_queries;
+    double                               frame_start;
+    std::vector<double>                  frame_milliseconds;
+};
+
+// glad's entry points are macros over function pointers, these give gen_names() something to take.
+void gen_buffers(GLsizei n, GLuint* names)
+{
+    glGenBuffers(n, names);
+}
+void gen_textures(GLsizei n, GLuint* names)
+{
+    glGenTextures(n, names);
+}
+void gen_vertex_arrays(GLsizei n, GLuint* names)
+{
+    glGenVertexArrays(n, names);
+}
+void gen_framebuffers(GLsizei n, GLuint* names)
+{
+    glGenFramebuffers(n, names);
+}
+void gen_renderbuffers(GLsizei n, GLuint* names)
+{
+    glGenRenderbuffers(n, names);
+}
+void delete_buffers(GLsizei n, const GLuint* names)
+{
+    glDeleteBuffers(n, names);
+}
+void delete_textures(GLsizei n, const GLuint* names)
+{
+    glDeleteTextures(n, names);
+}
+void delete_vertex_arrays(GLsizei n, const GLuint* names)
+{
+    glDeleteVertexArrays(n, names);
+}
+void delete_framebuffers(GLsizei n, const GLuint* names)
+{
+    glDeleteFramebuffers(n, names);
+}
+void delete_renderbuffers(GLsizei n, const GLuint* names)
+{
+    glDeleteRenderbuffers(n, names);
+}
+
+void Replayer::gen_names(PayloadReader& p_reader, NameKind p_kind, void (*p_gen)(GLsizei, GLuint*))
+{
+    GLsizei count = p_reader.integer();
+    if (count <= 0 || (std::size_t) count > p_reader.remaining() / sizeof(std::uint32_t))
+    {
+        return;
+    }
+
+    std::vector<GLuint> created(count);
+    p_gen(count, created.data());
+    for (GLsizei i = 0; i < count; i++)
+    {
+        names[p_kind][p_reader.word()] = created[i];
+    }
+}
+
+void Replayer::delete_names(PayloadReader& p_reader, NameKind p_kind, void (*p_delete)(GLsizei, const GLuint*))
+{
+    GLsizei             count = p_reader.integer();
+    std::vector<GLuint> deleted;
+    for (GLsizei i = 0; i < count && p_reader.is_valid(); i++)
+    {
+        std::uint32_t name = p_reader.word();
+        GLuint        live = map_name(p_kind, name);
+        if (live != 0 && name != 0)
+        {
+            deleted.push_back(live);
+            names[p_kind].erase(name);
+        }
+    }
+
+    if (!deleted.empty())
+    {
+        p_delete((GLsizei) deleted.size(), deleted.data());
+    }
+}
+
+void Replayer::begin_pass(const std::string& p_name)
+{
+    end_pass();
+
+    std::unordered_map<std::string, int>::iterator it = pass_lookup.find(p_name);
+    if (it == pass_lookup.end())
+    {
+        it = pass_lookup.emplace(p_name, (int) passes.size()).first;
+        passes.push_back({p_name, {}, 0});
+    }
+    current_pass = it->second;
+
+    if (frame_queries.size() == query_pool.size())
+    {
+        GLuint query;
+        glGenQueries(1, &query);
+        query_pool.push_back(query);
+    }
+    GLuint query = query_pool[frame_queries.size()];
+    frame_queries.push_back({current_pass, query});
+    glBeginQuery(GL_TIME_ELAPSED, query);
+}
+
+void Replayer::end_pass()
+{
+    if (current_pass >= 0)
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        current_pass = -1;
+    }
+}
+
+void Replayer::begin_frame()
+{
+    frame_queries.clear();
+    frame_start = glfwGetTime();
+    // Work before the first marker, usually the clear.
+    begin_pass("frame");
+}
+
+void Replayer::end_frame()
+{
+    end_pass();
+
+    // Waiting here keeps frames from overlapping, so every pass is measured in isolation.
+    std::vector<double> pass_milliseconds(passes.size(), -1.0);
+    for (const std::pair<int, GLuint>& query : frame_queries)
+    {
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(query.second, GL_QUERY_RESULT, &nanoseconds);
+        pass_milliseconds[query.first] = std::max(pass_milliseconds[query.first], 0.0) + nanoseconds / 1000000.0;
+    }
+    frame_milliseconds.push_back((glfwGetTime() - frame_start) * 1000.0);
+
+    for (std::size_t i = 0; i < passes.size(); i++)
+    {
+        if (pass_milliseconds[i] >= 0.0)
+        {
+            passes[i].gpu_milliseconds.push_back(pass_milliseconds[i]);
+        }
+    }
+}
+
+bool Replayer::execute(const ReplayCommand& p_command)
+{
+    PayloadReader reader(p_command);
+    std::size_t   blob_size = 0;
+
+    switch (p_command.opcode)
+    {
+    case CAPTURE_FRAME_BEGIN:
+        if (timing)
+        {
+            begin_frame();
+        }
+        break;
+    case CAPTURE_FRAME_END:
+        if (timing)
+        {
+            end_frame();
+        }
+        break;
+    case CAPTURE_PASS_BEGIN:
+        if (timing)
+        {
+            const char* name = (const char*) reader.rest(blob_size);
+            begin_pass(std::string(name, strnlen(name, blob_size)));
+        }
+        break;
+
+    case CAPTURE_GEN_BUFFERS:
+        gen_names(reader, NAME_BUFFER, gen_buffers);
+        break;
+    case CAPTURE_DELETE_BUFFERS:
+        delete_names(reader, NAME_BUFFER, delete_buffers);
+        break;
+    case CAPTURE_GEN_TEXTURES:
+        gen_names(reader, NAME_TEXTURE, gen_textures);
+        break;
+    case CAPTURE_DELETE_TEXTURES:
+        delete_names(reader, NAME_TEXTURE, delete_textures);
+        break;
+    case CAPTURE_GEN_VERTEX_ARRAYS:
+        gen_names(reader, NAME_VERTEX_ARRAY, gen_vertex_arrays);
+        break;
+    case CAPTURE_DELETE_VERTEX_ARRAYS:
+        delete_names(reader, NAME_VERTEX_ARRAY, delete_vertex_arrays);
+        break;
+    case CAPTURE_GEN_FRAMEBUFFERS:
+        gen_names(reader, NAME_FRAMEBUFFER, gen_framebuffers);
+        break;
+    case CAPTURE_DELETE_FRAMEBUFFERS:
+        delete_names(reader, NAME_FRAMEBUFFER, delete_framebuffers);
+        break;
+    case CAPTURE_GEN_RENDERBUFFERS:
+        gen_names(reader, NAME_RENDERBUFFER, gen_renderbuffers);
+        break;
+    case CAPTURE_DELETE_RENDERBUFFERS:
+        delete_names(reader, NAME_RENDERBUFFER, delete_renderbuffers);
+        break;
+
+    case CAPTURE_CREATE_SHADER:
+    {
+        GLenum        type = reader.word();
+        std::uint32_t name = reader.word();
+        names[NAME_SHADER][name] = glCreateShader(type);
+        break;
+    }
+    case CAPTURE_DELETE_SHADER:
+    {
+        std::uint32_t name = reader.word();
+        glDeleteShader(map_name(NAME_SHADER, name));
+        names[NAME_SHADER].erase(name);
+        break;
+    }
+    case CAPTURE_SHADER_SOURCE:
+    {
+        GLuint        shader = map_name(NAME_SHADER, reader.word());
+        const GLchar* source = (const GLchar*) reader.rest(blob_size);
+        GLint         length = (GLint) strnlen(source, blob_size);
+        glShaderSource(shader, 1, &source, &length);
+        break;
+    }
+    case CAPTURE_COMPILE_SHADER:
+        glCompileShader(map_name(NAME_SHADER, reader.word()));
+        break;
+    case CAPTURE_CREATE_PROGRAM:
+        names[NAME_PROGRAM][reader.word()] = glCreateProgram();
+        break;
+    case CAPTURE_DELETE_PROGRAM:
+    {
+        std::uint32_t name = reader.word();
+        glDeleteProgram(map_name(NAME_PROGRAM, name));
+        names[NAME_PROGRAM].erase(name);
+        break;
+    }
+    case CAPTURE_ATTACH_SHADER:
+    {
+        GLuint program = map_name(NAME_PROGRAM, reader.word());
+        glAttachShader(program, map_name(NAME_SHADER, reader.word()));
+        break;
+    }
+    case CAPTURE_LINK_PROGRAM:
+        glLinkProgram(map_name(NAME_PROGRAM, reader.word()));
+        break;
+    case CAPTURE_GET_UNIFORM_LOCATION:
+    {
+        std::uint32_t program  = reader.word();
+        GLint         location = reader.integer();
+        const char*   name     = (const char*) reader.rest(blob_size);
+        if (location >= 0)
+        {
+            std::uint64_t key      = ((std::uint64_t) program << 32) | (std::uint32_t) location;
+            uniform_locations[key] = glGetUniformLocation(map_name(NAME_PROGRAM, program),
+                                                          std::string(name, strnlen(name, blob_size)).c_str());
+        }
+        break;
+    }
+
+    case CAPTURE_BIND_BUFFER:
+    {
+        GLenum target = reader.word();
+        glBindBuffer(target, map_name(NAME_BUFFER, reader.word()));
+        break;
+    }
+    case CAPTURE_BIND_BUFFER_RANGE:
+    {
+        GLenum   target = reader.word();
+        GLuint   index  = reader.word();
+        GLuint   buffer = map_name(NAME_BUFFER, reader.word());
+        GLintptr offset = (GLintptr) reader.u64();
+        glBindBufferRange(target, index, buffer, offset, (GLsizeiptr) reader.u64());
+        break;
+    }
+    case CAPTURE_BIND_TEXTURE:
+    {
+        GLenum target = reader.word();
+        glBindTexture(target, map_name(NAME_TEXTURE, reader.word()));
+        break;
+    }
+    case CAPTURE_BIND_VERTEX_ARRAY:
+        glBindVertexArray(map_name(NAME_VERTEX_ARRAY, reader.word()));
+        break;
+    case CAPTURE_BIND_FRAMEBUFFER:
+    {
+        GLenum target = reader.word();
+        glBindFramebuffer(target, map_name(NAME_FRAMEBUFFER, reader.word()));
+        break;
+    }
+    case CAPTURE_BIND_RENDERBUFFER:
+    {
+        GLenum target = reader.word();
+        glBindRenderbuffer(target, map_name(NAME_RENDERBUFFER, reader.word()));
+        break;
+    }
+    case CAPTURE_ACTIVE_TEXTURE:
+        glActiveTexture(reader.word());
+        break;
+    case CAPTURE_USE_PROGRAM:
+        current_program = reader.word();
+        glUseProgram(map_name(NAME_PROGRAM, current_program));
+        break;
+    case CAPTURE_ENABLE:
+        glEnable(reader.word());
+        break;
+    case CAPTURE_DISABLE:
+        glDisable(reader.word());
+        break;
+    case CAPTURE_DEPTH_FUNC:
+        glDepthFunc(reader.word());
+        break;
+    case CAPTURE_DEPTH_MASK:
+        glDepthMask((GLboolean) reader.word());
+        break;
+    case CAPTURE_COLOR_MASK:
+    {
+        GLboolean red   = (GLboolean) reader.word();
+        GLboolean green = (GLboolean) reader.word();
+        GLboolean blue  = (GLboolean) reader.word();
+        glColorMask(red, green, blue, (GLboolean) reader.word());
+        break;
+    }
+    case CAPTURE_CLEAR_COLOR:
+    {
+        GLfloat red   = reader.real();
+        GLfloat green = reader.real();
+        GLfloat blue  = reader.real();
+        glClearColor(red, green, blue, reader.real());
+        break;
+    }
+    case CAPTURE_VIEWPORT:
+    {
+        GLint x = reader.integer();
+        GLint y = reader.integer();
+        GLint w = reader.integer();
+        glViewport(x, y, w, reader.integer());
+        break;
+    }
+    case CAPTURE_SCISSOR:
+    {
+        GLint x = reader.integer();
+        GLint y = reader.integer();
+        GLint w = reader.integer();
+        glScissor(x, y, w, reader.integer());
+        break;
+    }
+    case CAPTURE_BLEND_FUNC:
+    {
+        GLenum source = reader.word();
+        glBlendFunc(source, reader.word());
+        break;
+    }
+    case CAPTURE_CULL_FACE:
+        glCullFace(reader.word());
+        break;
+    case CAPTURE_PIXEL_STORE:
+    {
+        GLenum name = reader.word();
+        glPixelStorei(name, reader.integer());
+        break;
+    }
+    case CAPTURE_STENCIL_FUNC:
+    {
+        GLenum func = reader.word();
+        GLint  ref  = reader.integer();
+        glStencilFunc(func, ref, reader.word());
+        break;
+    }
+    case CAPTURE_STENCIL_OP:
+    {
+        GLenum fail  = reader.word();
+        GLenum zfail = reader.word();
+        glStencilOp(fail, zfail, reader.word());
+        break;
+    }
+    case CAPTURE_STENCIL_MASK:
+        glStencilMask(reader.word());
+        break;
+
+    case CAPTURE_BUFFER_DATA:
+    {
+        GLenum        target   = reader.word();
+        GLenum        usage    = reader.word();
+        std::uint64_t size     = reader.u64();
+        bool          has_data = reader.word() != 0;
+        const void*   data     = reader.rest(blob_size);
+        if (has_data && blob_size < size)
+        {
+            return false;
+        }
+        glBufferData(target, (GLsizeiptr) size, has_data ? data : NULL, usage);
+        break;
+    }
+    case CAPTURE_BUFFER_SUB_DATA:
+    {
+        GLenum        target = reader.word();
+        std::uint64_t offset = reader.u64();
+        std::uint64_t size   = reader.u64();
+        const void*   data   = reader.rest(blob_size);
+        if (blob_size < size)
+        {
+            return false;
+        }
+        glBufferSubData(target, (GLintptr) offset, (GLsizeiptr) size, data);
+        break;
+    }
+    case CAPTURE_TEX_IMAGE_2D:
+    {
+        GLenum      target          = reader.word();
+        GLint       level           = reader.integer();
+        GLint       internal_format = reader.integer();
+        GLsizei     width           = reader.integer();
+        GLsizei     height          = reader.integer();
+        GLenum      format          = reader.word();
+        GLenum      type            = reader.word();
+        bool        has_pixels      = reader.word() != 0;
+        const void* pixels          = reader.rest(blob_size);
+        glTexImage2D(target, level, internal_format, width, height, 0, format, type, has_pixels ? pixels : NULL);
+        break;
+    }
+    case CAPTURE_TEX_IMAGE_3D:
+    {
+        GLenum      target          = reader.word();
+        GLint       level           = reader.integer();
+        GLint       internal_format = reader.integer();
+        GLsizei     width           = reader.integer();
+        GLsizei     height          = reader.integer();
+        GLsizei     depth           = reader.integer();
+        GLenum      format          = reader.word();
+        GLenum      type            = reader.word();
+        bool        has_pixels      = reader.word() != 0;
+        const void* pixels          = reader.rest(blob_size);
+        glTexImage3D(target, level, internal_format, width, height, depth, 0, format, type,
+                     has_pixels ? pixels : NULL);
+        break;
+    }
+    case CAPTURE_TEX_SUB_IMAGE_2D:
+    {
+        GLenum  target = reader.word();
+        GLint   level  = reader.integer();
+        GLint   x      = reader.integer();
+        GLint   y      = reader.integer();
+        GLsizei width  = reader.integer();
+        GLsizei height = reader.integer();
+        GLenum  format = reader.word();
+        GLenum  type   = reader.word();
+        glTexSubImage2D(target, level, x, y, width, height, format, type, reader.rest(blob_size));
+        break;
+    }
+    case CAPTURE_TEX_PARAMETER_I:
+    {
+        GLenum target = reader.word();
+        GLenum name   = reader.word();
+        glTexParameteri(target, name, reader.integer());
+        break;
+    }
+    case CAPTURE_GENERATE_MIPMAP:
+        glGenerateMipmap(reader.word());
+        break;
+    case CAPTURE_TEX_BUFFER:
+    {
+        GLenum target          = reader.word();
+        GLenum internal_format = reader.word();
+        glTexBuffer(target, internal_format, map_name(NAME_BUFFER, reader.word()));
+        break;
+    }
+    case CAPTURE_VERTEX_ATTRIB_POINTER:
+    {
+        GLuint    index      = reader.word();
+        GLint     size       = reader.integer();
+        GLenum    type       = reader.word();
+        GLboolean normalized = (GLboolean) reader.word();
+        GLsizei   stride     = reader.integer();
+        glVertexAttribPointer(index, size, type, normalized, stride, reader.offset());
+        break;
+    }
+    case CAPTURE_VERTEX_ATTRIB_I_POINTER:
+    {
+        GLuint  index  = reader.word();
+        GLint   size   = reader.integer();
+        GLenum  type   = reader.word();
+        GLsizei stride = reader.integer();
+        glVertexAttribIPointer(index, size, type, stride, reader.offset());
+        break;
+    }
+    case CAPTURE_VERTEX_ATTRIB_DIVISOR:
+    {
+        GLuint index = reader.word();
+        glVertexAttribDivisor(index, reader.word());
+        break;
+    }
+    case CAPTURE_ENABLE_VERTEX_ATTRIB_ARRAY:
+        glEnableVertexAttribArray(reader.word());
+        break;
+    case CAPTURE_DISABLE_VERTEX_ATTRIB_ARRAY:
+        glDisableVertexAttribArray(reader.word());
+        break;
+    case CAPTURE_FRAMEBUFFER_TEXTURE_2D:
+    {
+        GLenum target         = reader.word();
+        GLenum attachment     = reader.word();
+        GLenum texture_target = reader.word();
+        GLuint texture        = map_name(NAME_TEXTURE, reader.word());
+        glFramebufferTexture2D(target, attachment, texture_target, texture, reader.integer());
+        break;
+    }
+    case CAPTURE_FRAMEBUFFER_RENDERBUFFER:
+    {
+        GLenum target              = reader.word();
+        GLenum attachment          = reader.word();
+        GLenum renderbuffer_target = reader.word();
+        glFramebufferRenderbuffer(target, attachment, renderbuffer_target,
+                                  map_name(NAME_RENDERBUFFER, reader.word()));
+        break;
+    }
+    case CAPTURE_RENDERBUFFER_STORAGE:
+    {
+        GLenum  target          = reader.word();
+        GLenum  internal_format = reader.word();
+        GLsizei width           = reader.integer();
+        glRenderbufferStorage(target, internal_format, width, reader.integer());
+        break;
+    }
+
+    case CAPTURE_UNIFORM_1I:
+    {
+        GLint location = map_location(reader.integer());
+        glUniform1i(location, reader.integer());
+        break;
+    }
+    case CAPTURE_UNIFORM_1F:
+    {
+        GLint location = map_location(reader.integer());
+        glUniform1f(location, reader.real());
+        break;
+    }
+    case CAPTURE_UNIFORM_2FV:
+    case CAPTURE_UNIFORM_3FV:
+    case CAPTURE_UNIFORM_4FV:
+    {
+        GLint          location = map_location(reader.integer());
+        GLsizei        count    = reader.integer();
+        const GLfloat* values   = (const GLfloat*) reader.rest(blob_size);
+        std::size_t    floats   = p_command.opcode - CAPTURE_UNIFORM_2FV + 2;
+        if (blob_size < count * floats * sizeof(GLfloat))
+        {
+            return false;
+        }
+
+        if (p_command.opcode == CAPTURE_UNIFORM_2FV)
+        {
+            glUniform2fv(location, count, values);
+        }
+        else if (p_command.opcode == CAPTURE_UNIFORM_3FV)
+        {
+            glUniform3fv(location, count, values);
+        }
+        else
+        {
+            glUniform4fv(location, count, values);
+        }
+        break;
+    }
+    case CAPTURE_UNIFORM_MATRIX_3FV:
+    case CAPTURE_UNIFORM_MATRIX_4FV:
+    {
+        GLint          location  = map_location(reader.integer());
+        GLsizei        count     = reader.integer();
+        GLboolean      transpose = (GLboolean) reader.word();
+        const GLfloat* values    = (const GLfloat*) reader.rest(blob_size);
+        std::size_t    floats    = p_command.opcode == CAPTURE_UNIFORM_MATRIX_3FV ? 9 : 16;
+        if (blob_size < count * floats * sizeof(GLfloat))
+        {
+            return false;
+        }
+
+        if (p_command.opcode == CAPTURE_UNIFORM_MATRIX_3FV)
+        {
+            glUniformMatrix3fv(location, count, transpose, values);
+        }
+        else
+        {
+            glUniformMatrix4fv(location, count, transpose, values);
+        }
+        break;
+    }
+    case CAPTURE_UNIFORM_BLOCK_BINDING:
+    {
+        GLuint      program = map_name(NAME_PROGRAM, reader.word());
+        GLuint      binding = reader.word();
+        const char* name    = (const char*) reader.rest(blob_size);
+        GLuint      block   = glGetUniformBlockIndex(program, std::string(name, strnlen(name, blob_size)).c_str());
+        if (block != GL_INVALID_INDEX)
+        {
+            glUniformBlockBinding(program, block, binding);
+        }
+        break;
+    }
+
+    case CAPTURE_CLEAR:
+        glClear(reader.word());
+        break;
+    case CAPTURE_DRAW_ARRAYS:
+    {
+        GLenum mode  = reader.word();
+        GLint  first = reader.integer();
+        glDrawArrays(mode, first, reader.integer());
+        break;
+    }
+    case CAPTURE_DRAW_ELEMENTS:
+    {
+        GLenum  mode  = reader.word();
+        GLsizei count = reader.integer();
+        GLenum  type  = reader.word();
+        glDrawElements(mode, count, type, reader.offset());
+        break;
+    }
+    case CAPTURE_DRAW_ARRAYS_INSTANCED:
+    {
+        GLenum  mode  = reader.word();
+        GLint   first = reader.integer();
+        GLsizei count = reader.integer();
+        glDrawArraysInstanced(mode, first, count, reader.integer());
+        break;
+    }
+    case CAPTURE_DRAW_ELEMENTS_INSTANCED:
+    {
+        GLenum      mode    = reader.word();
+        GLsizei     count   = reader.integer();
+        GLenum      type    = reader.word();
+        const void* indices = reader.offset();
+        glDrawElementsInstanced(mode, count, type, indices, reader.integer());
+        break;
+    }
+    case CAPTURE_MULTI_DRAW_ELEMENTS:
+    {
+        GLenum  mode       = reader.word();
+        GLenum  type       = reader.word();
+        GLsizei draw_count = reader.integer();
+        // A count and an offset per draw.
+        if (draw_count < 0 || reader.remaining() < (std::size_t) draw_count * 12)
+        {
+            return false;
+        }
+
+        std::vector<GLsizei>     counts(draw_count);
+        std::vector<const void*> offsets(draw_count);
+        for (GLsizei i = 0; i < draw_count; i++)
+        {
+            counts[i]  = reader.integer();
+            offsets[i] = reader.offset();
+        }
+        glMultiDrawElements(mode, counts.data(), type, offsets.data(), draw_count);
+        break;
+    }
+
+    default:
+        return false;
+    }
+
+    bool is_draw = (p_command.opcode >= CAPTURE_DRAW_ARRAYS && p_command.opcode <= CAPTURE_DRAW_ELEMENTS_INSTANCED) ||
+                   p_command.opcode == CAPTURE_MULTI_DRAW_ELEMENTS;
+    if (timing && is_draw && current_pass >= 0)
+    {
+        passes[current_pass].draws++;
+    }
+
+    return reader.is_valid();
+}
+
+bool read_commands(const MappedFile& p_file, GlCaptureHeader& p_header, std::vector<ReplayCommand>& p_commands)
+{
+    if (p_file.size() < sizeof(GlCaptureHeader))
+    {
+        std::cout << "ERROR::GL_REPLAY::FILE_TOO_SMALL" << std::endl;
+        return false;
+    }
+
+    std::memcpy(&p_header, p_file.data(), sizeof(p_header));
+    if (std::memcmp(p_header.magic, GL_CAPTURE_MAGIC, sizeof(p_header.magic)) != 0 ||
+        p_header.version != GL_CAPTURE_VERSION || p_header.command_bytes > p_file.size() - sizeof(p_header))
+    {
+        std::cout << "ERROR::GL_REPLAY::INVALID_HEADER" << std::endl;
+        return false;
+    }
+
+    const unsigned char* data     = p_file.data() + sizeof(p_header);
+    std::size_t          position = 0;
+    while (position < p_header.command_bytes)
+    {
+        GlCaptureCommand command;
+        if (p_header.command_bytes - position < sizeof(command))
+        {
+            std::cout << "ERROR::GL_REPLAY::TRUNCATED_COMMAND at " << position << std::endl;
+            return false;
+        }
+        std::memcpy(&command, data + position, sizeof(command));
+        position += sizeof(command);
+
+        if (command.opcode >= CAPTURE_OPCODE_COUNT || p_header.command_bytes - position < command.size)
+        {
+            std::cout << "ERROR::GL_REPLAY::INVALID_COMMAND at " << position << std::endl;
+            return false;
+        }
+
+        p_commands.push_back({(GlCaptureOpcode) command.opcode, data + position, command.size});
+        position += command.size;
+    }
+
+    return true;
+}
+
+std::uint64_t hash_pixels(const std::vector<unsigned char>& p_pixels)
+{
+    // FNV-1a
+    std::uint64_t hash = 14695981039346656037ull;
+    for (unsigned char byte : p_pixels)
+    {
+        hash = (hash ^ byte) * 1099511628211ull;
+    }
+    return hash;
+}
+
+void print_pass_table(const std::vector<PassTiming>& p_passes, std::size_t p_frames)
+{
+    std::cout << "                pass   draws/frame   gpu_avg_ms   gpu_min_ms   gpu_max_ms" << std::endl;
+    for (const PassTiming& pass : p_passes)
+    {
+        if (pass.gpu_milliseconds.empty())
+        {
+            continue;
+        }
+
+        double total = 0.0;
+        for (double milliseconds : pass.gpu_milliseconds)
+        {
+            total += milliseconds;
+        }
+
+        std::cout << std::setw(20) << pass.name << std::setw(14) << std::fixed << std::setprecision(1)
+                  << (double) pass.draws / p_frames << std::setw(13) << std::setprecision(3)
+                  << total / pass.gpu_milliseconds.size() << std::setw(13)
+                  << *std::min_element(pass.gpu_milliseconds.begin(), pass.gpu_milliseconds.end()) << std::setw(13)
+                  << *std::max_element(pass.gpu_milliseconds.begin(), pass.gpu_milliseconds.end()) << std::endl;
+    }
+}
+} // namespace
+
+int run_replay(const std::string& p_path, unsigned int p_repeats)
+{
+    MappedFile file;
+    if (!file.open(p_path))
+    {
+        std::cout << "ERROR::GL_REPLAY::FILE_NOT_FOUND\n" << p_path << std::endl;
+        return 1;
+    }
+
+    GlCaptureHeader            header;
+    std::vector<ReplayCommand> commands;
+    if (!read_commands(file, header, commands))
+    {
+        return 1;
+    }
+
+    // The range starts at the first recorded frame marker inside it, everything before only builds state.
+    std::size_t range_start = commands.size();
+    int         width       = 1;
+    int         height      = 1;
+    for (std::size_t i = 0; i < commands.size(); i++)
+    {
+        if (commands[i].opcode != CAPTURE_FRAME_BEGIN)
+        {
+            continue;
+        }
+
+        PayloadReader reader(commands[i]);
+        std::uint32_t frame = reader.word();
+        if (frame < header.first_frame)
+        {
+            continue;
+        }
+
+        range_start = std::min(range_start, i);
+        width       = std::max(width, reader.integer());
+        height      = std::max(height, reader.integer());
+    }
+
+    if (range_start == commands.size())
+    {
+        std::cout << "ERROR::GL_REPLAY::NO_CAPTURED_FRAMES\n" << p_path << std::endl;
+        return 1;
+    }
+
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    GLFWwindow* window = glfwCreateWindow(width, height, "Replay", NULL, NULL);
+    if (window == NULL)
+    {
+        std::cout << "Failed to create GLFW window" << std::endl;
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+
+    if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress))
+    {
+        std::cout << "Failed to initiate GLAD" << std::endl;
+        glfwTerminate();
+        return 1;
+    }
+
+    // Stands in for the default framebuffer, so window size and swap behaviour cannot change results.
+    GLuint framebuffer, renderbuffers[2];
+    glGenFramebuffers(1, &framebuffer);
+    glGenRenderbuffers(2, renderbuffers);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "ERROR::GL_REPLAY::FRAMEBUFFER_INCOMPLETE" << std::endl;
+        glfwTerminate();
+        return 1;
+    }
+    glViewport(0, 0, width, height);
+
+    std::cout << "Replaying " << p_path << ": frames " << header.first_frame << " to "
+              << header.first_frame + header.frame_count - 1 << ", " << p_repeats << " repeats, " << width << "x"
+              << height << " offscreen on " << glGetString(GL_RENDERER) << std::endl;
+
+    int exit_code = 0;
+    {
+        Replayer replayer(framebuffer);
+
+        double setup_start = glfwGetTime();
+        for (std::size_t i = 0; i < range_start && exit_code == 0; i++)
+        {
+            if (!replayer.execute(commands[i]))
+            {
+                std::cout << "ERROR::GL_REPLAY::INVALID_COMMAND " << commands[i].opcode << std::endl;
+                exit_code = 1;
+            }
+        }
+        glFinish();
+        std::cout << "State rebuilt from " << range_start << " commands in " << (glfwGetTime() - setup_start) * 1000.0
+                  << " ms" << std::endl;
+
+        replayer.set_timing(true);
+        for (unsigned int r = 0; r < p_repeats && exit_code == 0; r++)
+        {
+            for (std::size_t i = range_start; i < commands.size() && exit_code == 0; i++)
+            {
+                if (!replayer.execute(commands[i]))
+                {
+                    std::cout << "ERROR::GL_REPLAY::INVALID_COMMAND " << commands[i].opcode << std::endl;
+                    exit_code = 1;
+                }
+            }
+        }
+
+        const std::vector<double>& frames = replayer.get_frame_milliseconds();
+        if (exit_code == 0 && !frames.empty())
+        {
+            print_pass_table(replayer.get_passes(), frames.size());
+
+            double total = 0.0;
+            for (double milliseconds : frames)
+            {
+                total += milliseconds;
+            }
+            std::cout << "Frame wall time over " << frames.size() << " frames: avg " << total / frames.size()
+                      << " ms, min " << *std::min_element(frames.begin(), frames.end()) << " ms, max "
+                      << *std::max_element(frames.begin(), frames.end()) << " ms" << std::endl;
+        }
+    }
+
+    if (exit_code == 0)
+    {
+        std::vector<unsigned char> pixels((std::size_t) width * height * 4);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        std::cout << "Final image hash " << std::hex << std::setw(16) << std::setfill('0') << hash_pixels(pixels)
+                  << std::dec << std::setfill(' ') << std::endl;
+    }
+
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(2, renderbuffers);
+    glfwTerminate();
+    return exit_code;
+}
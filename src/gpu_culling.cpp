@@ -0,0 +1,221 @@
+#include "learn_opengl/gpu_culling.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "glm/ext/matrix_float4x4.hpp"
+#include "glm/ext/vector_float3.hpp"
+#include "learn_opengl/frustum.hpp"
+#include "learn_opengl/gl_extensions.hpp"
+#include "learn_opengl/material.hpp"
+#include "learn_opengl/mesh.hpp"
+#include "learn_opengl/resource_registry.hpp"
+#include "learn_opengl/simd_math.hpp"
+
+GpuCulling::GpuCulling(Model& p_model) : model(p_model), cull_shader("shaders/cull_compute.glsl", ShaderDefines())
+{
+    instance_count = 0;
+    item_count     = 0;
+
+    const std::vector<Mesh>& meshes = model.get_meshes();
+
+    // Meshes sharing a material become neighbouring commands, so each material is one indirect draw.
+    command_meshes.resize(meshes.size());
+    for (unsigned int i = 0; i < meshes.size(); i++)
+    {
+        command_meshes[i] = i;
+    }
+    std::stable_sort(command_meshes.begin(), command_meshes.end(), [&meshes](unsigned int a, unsigned int b)
+                     { return meshes[a].material < meshes[b].material; });
+
+    std::size_t vertex_total = 0;
+    std::size_t index_total  = 0;
+    for (const Mesh& mesh : meshes)
+    {
+        vertex_total += mesh.get_vertex_count();
+        index_total += mesh.get_index_count();
+    }
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(BUFFER_COUNT, buffers);
+    for (unsigned int i = 0; i < BUFFER_COUNT; i++)
+    {
+        // Tracked with a size once uploaded.
+        ResourceRegistry::get_instance().track(RESOURCE_BUFFER, buffers[i], 0, "gpu_culling");
+    }
+    ResourceRegistry::get_instance().track(RESOURCE_VERTEX_ARRAY, vao, 0, "gpu_culling");
+
+    upload(VERTEX_BUFFER, GL_COPY_WRITE_BUFFER, NULL, vertex_total * sizeof(Vertex));
+    upload(INDEX_BUFFER, GL_COPY_WRITE_BUFFER, NULL, index_total * sizeof(unsigned int));
+
+    // Copied on the GPU, so this also works for meshes that already dropped their CPU geometry.
+    std::size_t first_vertex = 0;
+    std::size_t first_index  = 0;
+    commands.resize(meshes.size());
+    for (unsigned int c = 0; c < command_meshes.size(); c++)
+    {
+        const Mesh& mesh = meshes[command_meshes[c]];
+
+        glBindBuffer(GL_COPY_READ_BUFFER, mesh.get_vertex_buffer());
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[VERTEX_BUFFER]);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, first_vertex * sizeof(Vertex),
+                            mesh.get_vertex_count() * sizeof(Vertex));
+
+        glBindBuffer(GL_COPY_READ_BUFFER, mesh.get_index_buffer());
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[INDEX_BUFFER]);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, first_index * sizeof(unsigned int),
+                            mesh.get_index_count() * sizeof(unsigned int));
+
+        commands[c] = {mesh.get_index_count(), 0, (std::uint32_t) first_index, (std::int32_t) first_vertex, 0};
+        first_vertex += mesh.get_vertex_count();
+        first_index += mesh.get_index_count();
+
+        if (batches.empty() || batches.back().material != mesh.material)
+        {
+            batches.push_back({mesh.material, c, 0});
+        }
+        batches.back().command_count++;
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers[VERTEX_BUFFER]);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[INDEX_BUFFER]);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*) 0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*) offsetof(Vertex, normal));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*) offsetof(Vertex, tex_coords));
+
+    // The culling output as a per-instance attribute: base_instance of each command offsets into it,
+    // so instance i of a command reads the index of its i-th surviving item.
+    upload(VISIBLE_BUFFER, GL_ARRAY_BUFFER, NULL, sizeof(std::uint32_t));
+    glEnableVertexAttribArray(3);
+    glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, sizeof(std::uint32_t), (void*) 0);
+    glVertexAttribDivisor(3, 1);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+GpuCulling::~GpuCulling()
+{
+    ResourceRegistry& registry = ResourceRegistry::get_instance();
+    for (unsigned int i = 0; i < BUFFER_COUNT; i++)
+    {
+        registry.untrack(RESOURCE_BUFFER, buffers[i]);
+    }
+    registry.untrack(RESOURCE_VERTEX_ARRAY, vao);
+
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(BUFFER_COUNT, buffers);
+    glDeleteProgram(cull_shader.ID);
+}
+
+void GpuCulling::upload(unsigned int p_buffer, unsigned int p_target, const void* p_data, std::size_t p_bytes)
+{
+    ResourceRegistry& registry = ResourceRegistry::get_instance();
+    registry.untrack(RESOURCE_BUFFER, buffers[p_buffer]);
+    registry.track(RESOURCE_BUFFER, buffers[p_buffer], p_bytes, "gpu_culling");
+
+    glBindBuffer(p_target, buffers[p_buffer]);
+    glBufferData(p_target, p_bytes, p_data, p_buffer == COMMAND_BUFFER ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+}
+
+void GpuCulling::set_instances(const std::vector<glm::mat4>& p_instances)
+{
+    const std::vector<Mesh>& meshes = model.get_meshes();
+
+    instance_count = (unsigned int) p_instances.size();
+    item_count     = instance_count * (unsigned int) command_meshes.size();
+
+    // Items are grouped by command, so each command's survivors land in its own slice of the output.
+    std::vector<glm::mat4> transforms(item_count);
+    std::vector<CullItem>  items(item_count);
+    for (unsigned int c = 0; c < command_meshes.size(); c++)
+    {
+        const Mesh& mesh        = meshes[command_meshes[c]];
+        glm::mat4   mesh_matrix = model.get_mesh_matrix(command_meshes[c]);
+
+        commands[c].base_instance = c * instance_count;
+        for (unsigned int i = 0; i < instance_count; i++)
+        {
+            unsigned int item = c * instance_count + i;
+            mat4_multiply(p_instances[i], mesh_matrix, transforms[item]);
+
+            glm::vec3 center;
+            float     radius;
+            get_bounding_sphere(transforms[item], mesh.bounds_min, mesh.bounds_max, center, radius);
+            items[item] = {{center.x, center.y, center.z, radius}, c, {0, 0, 0}};
+        }
+    }
+
+    upload(TRANSFORM_BUFFER, GL_SHADER_STORAGE_BUFFER, transforms.data(), transforms.size() * sizeof(glm::mat4));
+    upload(ITEM_BUFFER, GL_SHADER_STORAGE_BUFFER, items.data(), items.size() * sizeof(CullItem));
+    upload(COMMAND_BUFFER, GL_SHADER_STORAGE_BUFFER, commands.data(), commands.size() * sizeof(DrawCommand));
+    upload(VISIBLE_BUFFER, GL_SHADER_STORAGE_BUFFER, NULL, std::max(item_count, 1u) * sizeof(std::uint32_t));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void GpuCulling::draw(Shader& p_shader, const glm::mat4& p_view, const glm::mat4& p_projection)
+{
+    if (item_count == 0)
+    {
+        return;
+    }
+
+    const GlExtensions& gl = get_gl_extensions();
+
+    // Instance counts back to zero. A few bytes per mesh, whatever the instance count.
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[COMMAND_BUFFER]);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, commands.size() * sizeof(DrawCommand), commands.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    Frustum frustum = make_frustum(p_projection * p_view);
+    cull_shader.use();
+    glUniform4fv(glGetUniformLocation(cull_shader.ID, "planes"), 6, &frustum.planes[0].x);
+    glUniform1ui(glGetUniformLocation(cull_shader.ID, "item_count"), item_count);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, buffers[ITEM_BUFFER]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, buffers[COMMAND_BUFFER]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, buffers[VISIBLE_BUFFER]);
+    gl.dispatch_compute((item_count + GPU_CULLING_GROUP_SIZE - 1) / GPU_CULLING_GROUP_SIZE, 1, 1);
+
+    // The commands are read as indirect arguments and the survivors as a vertex attribute.
+    gl.memory_barrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+
+    p_shader.use();
+    p_shader.setMat4("view", p_view);
+    p_shader.setMat4("projection", p_projection);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, buffers[TRANSFORM_BUFFER]);
+
+    glBindVertexArray(vao);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffers[COMMAND_BUFFER]);
+    MaterialTable& materials = model.get_materials();
+    materials.prepare(p_shader);
+    materials.reset_bindings();
+    for (const MaterialBatch& batch : batches)
+    {
+        materials.bind(batch.material);
+        gl.multi_draw_elements_indirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                                        (const void*) (batch.first_command * sizeof(DrawCommand)),
+                                        batch.command_count, sizeof(DrawCommand));
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+GpuCullingStats GpuCulling::get_stats() const
+{
+    GpuCullingStats stats;
+    stats.instance_count = instance_count;
+    stats.item_count     = item_count;
+    stats.command_count  = (unsigned int) commands.size();
+    stats.draw_calls     = (unsigned int) batches.size();
+    return stats;
+}
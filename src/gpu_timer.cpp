@@ -0,0 +1,57 @@
+#include "learn_opengl/gpu_timer.hpp"
+
+#include <glad/glad.h>
+
+GpuTimer::GpuTimer()
+{
+    glGenQueries(GPU_TIMER_LATENCY, queries);
+    for (unsigned int i = 0; i < GPU_TIMER_LATENCY; i++)
+    {
+        pending[i] = false;
+    }
+    current           = 0;
+    last_milliseconds = 0.0;
+    result_count      = 0;
+}
+
+GpuTimer::~GpuTimer()
+{
+    glDeleteQueries(GPU_TIMER_LATENCY, queries);
+}
+
+void GpuTimer::begin()
+{
+    // The slot about to be reused holds the oldest query, collect it first if the GPU is done.
+    if (pending[current])
+    {
+        GLint available = 0;
+        glGetQueryObjectiv(queries[current], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available)
+        {
+            GLuint64 nanoseconds = 0;
+            glGetQueryObjectui64v(queries[current], GL_QUERY_RESULT, &nanoseconds);
+            last_milliseconds = nanoseconds / 1000000.0;
+            result_count++;
+        }
+        pending[current] = false;
+    }
+
+    glBeginQuery(GL_TIME_ELAPSED, queries[current]);
+}
+
+void GpuTimer::end()
+{
+    glEndQuery(GL_TIME_ELAPSED);
+    pending[current] = true;
+    current          = (current + 1) % GPU_TIMER_LATENCY;
+}
+
+double GpuTimer::get_milliseconds() const
+{
+    return last_milliseconds;
+}
+
+unsigned int GpuTimer::get_result_count() const
+{
+    return result_count;
+}
@@ -0,0 +1,62 @@
+#include "learn_opengl/input.hpp"
+
+#include <mutex>
+
+InputState::InputState(int p_framebuffer_width, int p_framebuffer_height)
+{
+    pending = {};
+    pending.framebuffer_width = p_framebuffer_width;
+    pending.framebuffer_height = p_framebuffer_height;
+}
+
+void InputState::set_movement(CameraMovement p_direction, bool p_pressed)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.movement[p_direction] = p_pressed;
+}
+
+void InputState::add_mouse_movement(float p_x_offset, float p_y_offset)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.mouse_x_offset += p_x_offset;
+    pending.mouse_y_offset += p_y_offset;
+}
+
+void InputState::add_mouse_scroll(float p_y_offset)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.scroll_y_offset += p_y_offset;
+}
+
+void InputState::request_fov_reset()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.reset_fov = true;
+}
+
+void InputState::set_framebuffer_size(int p_width, int p_height)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.framebuffer_width = p_width;
+    pending.framebuffer_height = p_height;
+}
+
+InputSnapshot InputState::consume()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    InputSnapshot snapshot = pending;
+
+    // Held keys and the framebuffer size are states, the rest are deltas.
+    pending.mouse_x_offset = 0.0f;
+    pending.mouse_y_offset = 0.0f;
+    pending.scroll_y_offset = 0.0f;
+    pending.reset_fov = false;
+
+    return snapshot;
+}
+
+InputSnapshot InputState::peek()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return pending;
+}
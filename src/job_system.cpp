@@ -0,0 +1,340 @@
+#include "learn_opengl/job_system.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+// Which scheduler the current thread works for, and its queue index in it.
+thread_local const JobSystem* tls_job_system = nullptr;
+thread_local int              tls_worker_index = -1;
+
+JobSystem& JobSystem::get_instance()
+{
+    // The first call decides which thread is the main thread, so make it from main().
+    static JobSystem instance(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return instance;
+}
+
+JobSystem::JobSystem(unsigned int p_worker_count)
+{
+    main_thread_id = std::this_thread::get_id();
+    next_queue = 0;
+    stopping = false;
+    pending_jobs = 0;
+    reset_counters();
+
+    // Even with no workers there is one queue, drained by whoever calls wait().
+    unsigned int queue_count = std::max(1u, p_worker_count);
+    for (unsigned int i = 0; i < queue_count; i++)
+    {
+        queues.push_back(std::make_unique<WorkQueue>());
+    }
+
+    for (unsigned int i = 0; i < p_worker_count; i++)
+    {
+        workers.emplace_back(&JobSystem::worker_loop, this, i);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        stopping = true;
+    }
+    wake_up.notify_all();
+
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+JobHandle JobSystem::create_job(std::function<void()> p_function, const JobHandle& p_parent, JobAffinity p_affinity)
+{
+    JobHandle job = std::make_shared<Job>();
+    job->function = std::move(p_function);
+    job->parent = p_parent;
+    job->affinity = p_affinity;
+    job->unfinished = 1;
+
+    if (p_parent)
+    {
+        p_parent->unfinished++;
+    }
+
+    return job;
+}
+
+void JobSystem::run(const JobHandle& p_job)
+{
+    if (p_job->affinity == JOB_MAIN_THREAD)
+    {
+        std::unique_lock<std::mutex> lock(main_queue.mutex, std::defer_lock);
+        lock_queue(lock);
+        main_queue.jobs.push_back(p_job);
+        return;
+    }
+
+    // Workers push to their own queue, outside threads spread their jobs round robin.
+    int index = current_worker_index();
+    if (index < 0)
+    {
+        index = (int) (next_queue++ % queues.size());
+    }
+
+    // Counted before it is visible, a thief popping it first would otherwise take the count below zero.
+    pending_jobs++;
+    {
+        std::unique_lock<std::mutex> lock(queues[index]->mutex, std::defer_lock);
+        lock_queue(lock);
+        queues[index]->jobs.push_back(p_job);
+    }
+
+    // Taking the sleep mutex closes the gap between a worker checking pending_jobs and going to sleep.
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+    }
+    wake_up.notify_one();
+}
+
+void JobSystem::wait(const JobHandle& p_job)
+{
+    while (!is_finished(p_job))
+    {
+        JobHandle job = find_job();
+        if (job)
+        {
+            execute(job);
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+bool JobSystem::is_finished(const JobHandle& p_job) const
+{
+    return p_job->unfinished.load() == 0;
+}
+
+void JobSystem::parallel_for(std::size_t p_begin, std::size_t p_end, std::size_t p_grain_size,
+                             const std::function<void(std::size_t begin, std::size_t end)>& p_body)
+{
+    if (p_end <= p_begin)
+    {
+        return;
+    }
+
+    std::size_t grain_size = std::max<std::size_t>(1, p_grain_size);
+    JobHandle   parent = create_job(nullptr);
+
+    for (std::size_t begin = p_begin; begin < p_end; begin += grain_size)
+    {
+        std::size_t end = std::min(p_end, begin + grain_size);
+        run(create_job([&p_body, begin, end] { p_body(begin, end); }, parent));
+    }
+
+    // The parent has no work of its own, it only exists to be waited on.
+    finish(parent);
+    wait(parent);
+}
+
+void JobSystem::run_main_thread_jobs()
+{
+    while (JobHandle job = pop_main_thread_job())
+    {
+        execute(job);
+    }
+}
+
+unsigned int JobSystem::get_worker_count() const
+{
+    return (unsigned int) workers.size();
+}
+
+JobCounters JobSystem::get_counters() const
+{
+    JobCounters counters;
+    counters.jobs_executed = jobs_executed;
+    counters.main_thread_jobs_executed = main_thread_jobs_executed;
+    counters.steal_attempts = steal_attempts;
+    counters.steals = steals;
+    counters.lock_contentions = lock_contentions;
+
+    return counters;
+}
+
+void JobSystem::reset_counters()
+{
+    jobs_executed = 0;
+    main_thread_jobs_executed = 0;
+    steal_attempts = 0;
+    steals = 0;
+    lock_contentions = 0;
+}
+
+void JobSystem::worker_loop(unsigned int p_index)
+{
+    tls_job_system = this;
+    tls_worker_index = (int) p_index;
+
+    while (!stopping)
+    {
+        JobHandle job = pop_local((int) p_index);
+        if (!job)
+        {
+            job = steal((int) p_index);
+        }
+
+        if (job)
+        {
+            execute(job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        wake_up.wait(lock, [this] { return stopping || pending_jobs > 0; });
+    }
+}
+
+int JobSystem::current_worker_index() const
+{
+    return tls_job_system == this ? tls_worker_index : -1;
+}
+
+JobHandle JobSystem::pop_local(int p_worker_index)
+{
+    WorkQueue&                   queue = *queues[p_worker_index];
+    std::unique_lock<std::mutex> lock(queue.mutex, std::defer_lock);
+    lock_queue(lock);
+
+    if (queue.jobs.empty())
+    {
+        return nullptr;
+    }
+
+    // Newest first: its data is most likely still in this core's cache.
+    JobHandle job = std::move(queue.jobs.back());
+    queue.jobs.pop_back();
+    pending_jobs--;
+
+    return job;
+}
+
+JobHandle JobSystem::steal(int p_thief_index)
+{
+    std::size_t queue_count = queues.size();
+    std::size_t start = p_thief_index < 0 ? next_queue.load() : (std::size_t) p_thief_index + 1;
+
+    for (std::size_t i = 0; i < queue_count; i++)
+    {
+        std::size_t victim = (start + i) % queue_count;
+        if ((int) victim == p_thief_index)
+        {
+            continue;
+        }
+
+        steal_attempts++;
+
+        WorkQueue&                   queue = *queues[victim];
+        std::unique_lock<std::mutex> lock(queue.mutex, std::defer_lock);
+        lock_queue(lock);
+
+        if (queue.jobs.empty())
+        {
+            continue;
+        }
+
+        // Oldest first: usually the biggest remaining chunk, and the owner is working the other end.
+        JobHandle job = std::move(queue.jobs.front());
+        queue.jobs.pop_front();
+        pending_jobs--;
+        steals++;
+
+        return job;
+    }
+
+    return nullptr;
+}
+
+JobHandle JobSystem::pop_main_thread_job()
+{
+    if (std::this_thread::get_id() != main_thread_id)
+    {
+        return nullptr;
+    }
+
+    std::unique_lock<std::mutex> lock(main_queue.mutex, std::defer_lock);
+    lock_queue(lock);
+
+    if (main_queue.jobs.empty())
+    {
+        return nullptr;
+    }
+
+    JobHandle job = std::move(main_queue.jobs.front());
+    main_queue.jobs.pop_front();
+
+    return job;
+}
+
+JobHandle JobSystem::find_job()
+{
+    JobHandle job = pop_main_thread_job();
+    if (job)
+    {
+        return job;
+    }
+
+    int index = current_worker_index();
+    if (index >= 0)
+    {
+        job = pop_local(index);
+    }
+
+    if (!job)
+    {
+        job = steal(index);
+    }
+
+    return job;
+}
+
+void JobSystem::execute(const JobHandle& p_job)
+{
+    if (p_job->function)
+    {
+        p_job->function();
+    }
+
+    jobs_executed++;
+    if (p_job->affinity == JOB_MAIN_THREAD)
+    {
+        main_thread_jobs_executed++;
+    }
+
+    finish(p_job);
+}
+
+void JobSystem::finish(const JobHandle& p_job)
+{
+    if (--p_job->unfinished == 0 && p_job->parent)
+    {
+        finish(p_job->parent);
+    }
+}
+
+void JobSystem::lock_queue(std::unique_lock<std::mutex>& p_lock)
+{
+    if (!p_lock.try_lock())
+    {
+        lock_contentions++;
+        p_lock.lock();
+    }
+}
@@ -1,8 +1,14 @@
 #include <filesystem>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
+#include <deque>
 #include <glm/geometric.hpp>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -10,6 +16,7 @@
 #include <glm/trigonometric.hpp>
 #include <iostream>
 #include <ostream>
+#include <random>
 #include <stb_image.h>
 #include <string>
 #include <vector>
@@ -18,9 +25,37 @@
 #include "glm/ext/matrix_float4x4.hpp"
 #include "glm/ext/vector_float3.hpp"
 #include "glm/fwd.hpp"
+#include "learn_opengl/animation.hpp"
+#include "learn_opengl/benchmark.hpp"
 #include "learn_opengl/camera.hpp"
+#include "learn_opengl/clustered_lighting.hpp"
+#include "learn_opengl/dynamic_resolution.hpp"
+#include "learn_opengl/entity_registry.hpp"
 #include "learn_opengl/file_system.hpp"
+#include "learn_opengl/frame_pacer.hpp"
+#include "learn_opengl/frame_pipeline.hpp"
+#include "learn_opengl/frame_readback.hpp"
+#include "learn_opengl/frustum.hpp"
+#include "learn_opengl/gl_capture.hpp"
+#include "learn_opengl/gl_extensions.hpp"
+#include "learn_opengl/gl_replay.hpp"
+#include "learn_opengl/gpu_culling.hpp"
+#include "learn_opengl/gpu_timer.hpp"
+#include "learn_opengl/input.hpp"
+#include "learn_opengl/job_system.hpp"
+#include "learn_opengl/material.hpp"
+#include "learn_opengl/memory_stats.hpp"
+#include "learn_opengl/mirror.hpp"
+#include "learn_opengl/model.hpp"
+#include "learn_opengl/resource_registry.hpp"
+#include "learn_opengl/selection_outline.hpp"
 #include "learn_opengl/shader.hpp"
+#include "learn_opengl/shader_cache.hpp"
+#include "learn_opengl/simulation.hpp"
+#include "learn_opengl/terrain.hpp"
+#include "learn_opengl/texture_array.hpp"
+#include "learn_opengl/vegetation.hpp"
+#include "learn_opengl/virtual_texture.hpp"
 
 const int   W_WIDTH  = 640;
 const int   W_HEIGHT = 480;
@@ -31,24 +66,291 @@ float last_mouse_X  = (float) W_WIDTH / 2;
 float last_mouse_Y  = (float) W_HEIGHT / 2;
 bool  mouse_entered = false;
 
-// DELTA TIME
-float delta_time = 0.0f;
-float last_frame = 0.0f;
+// How many packets the simulation may build ahead of the renderer
+const unsigned int MAX_FRAMES_AHEAD = 1;
+
+// RESOURCE REPORTS (F1 summary, F2 JSON dump, F3 toggles a once-per-second line)
+bool print_resources_requested = false;
+bool dump_resources_requested  = false;
+bool resource_line_enabled     = false;
+
+// LIGHTING
+const unsigned int DEFAULT_LIGHT_COUNT = 64;
+const float        AMBIENT_STRENGTH    = 0.25f;
+
+// CAPTURE (--capture records this many frames starting at this frame unless --capture-frames says otherwise)
+const unsigned int DEFAULT_CAPTURE_FIRST_FRAME = 100;
+const unsigned int DEFAULT_CAPTURE_FRAME_COUNT = 1;
+const unsigned int DEFAULT_REPLAY_REPEATS      = 100;
+
+// DYNAMIC RESOLUTION (--dynamic-resolution <target ms> renders the scene scaled, see DynamicResolution)
+const char* DEFAULT_RESOLUTION_LOG = "dynamic_resolution.csv";
+
+// MODEL INSTANCES (--model-instances N lays out N copies on a grid starting at the original spot)
+const glm::vec3 MODEL_POSITION         = glm::vec3(0.0f, 0.5f, -4.0f);
+const float     MODEL_INSTANCE_SPACING = 3.0f;
+
+// MIRRORS (--mirrors N stands N mirrors in a ring around the cubes, facing them)
+const float MIRROR_RING_RADIUS = 4.5f;
+
+// TERRAIN (--terrain <dir> replaces the plane with chunks streamed from <dir>, generated where it has none)
+
+// VEGETATION (--grass N scatters N grass billboards over the plane, or over the terrain around the origin)
+const float PLANE_SIZE = 10.0f;
+
+// READBACK (--readback-png <dir>, --readback-raw <file> and --golden <dir> read every frame back, see FrameReadback)
 
 void         framebuffer_size_callback(GLFWwindow* window, int w, int h);
-void         processInput(GLFWwindow* window, Camera* camera);
+void         processInput(GLFWwindow* window, InputState* input);
 void         mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void         scroll_callback(GLFWwindow* window, double xpos, double ypos);
 void         mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
+void         key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
 unsigned int load_texture(const char* path);
-void         initialize_plane_VAO(unsigned int& vao);
-void         initialize_cube_VAO(unsigned int& vao);
+void         initialize_plane_VAO(unsigned int& vao, unsigned int& vbo);
+void         initialize_cube_VAO(unsigned int& vao, unsigned int& vbo);
 void         draw_stuff(unsigned int& vao, Shader& shader, glm::mat4& transform_matrix, unsigned int vertices_count,
                         unsigned int texture_id, GLenum texture_target);
-unsigned int load_cubemap(std::vector<std::filesystem::path> faces);
-
-int main()
+unsigned int load_cubemap(const std::vector<std::string>& faces);
+std::vector<Light> create_scene_lights(unsigned int count);
+std::vector<glm::mat4> create_model_instances(unsigned int count);
+std::vector<Mirror>    create_scene_mirrors(unsigned int count, float resolution_scale);
+void print_latency_line(const LatencyHistory& input_latency, const LatencyHistory& pacing_waits,
+                        unsigned int frames_in_flight, bool late_latch);
+std::uint64_t print_resolution_line(const ResolutionController& controller, std::uint64_t since_frame);
+
+int main(int argc, char** argv)
 {
+    bool         fixed_timestep    = false;
+    bool         gpu_only_meshes   = false;
+    const char*  model_path        = NULL;
+    const char*  pack_path         = NULL;
+    unsigned int light_count       = DEFAULT_LIGHT_COUNT;
+    const char*  capture_path      = NULL;
+    unsigned int capture_first     = DEFAULT_CAPTURE_FIRST_FRAME;
+    unsigned int capture_count     = DEFAULT_CAPTURE_FRAME_COUNT;
+    const char*  replay_path       = NULL;
+    unsigned int replay_repeats    = DEFAULT_REPLAY_REPEATS;
+    unsigned int model_instances   = 1;
+    bool         gpu_culling       = false;
+    bool         texture_arrays    = true;
+    unsigned int frames_in_flight  = DEFAULT_FRAMES_IN_FLIGHT;
+    bool         late_latch        = false;
+    double       resolution_target = 0.0;
+    bool         sharpen_upscale   = false;
+    const char*  resolution_log    = DEFAULT_RESOLUTION_LOG;
+    float        outline_width     = 0.0f;
+    unsigned int mirror_count      = 0;
+    float        mirror_scale      = DEFAULT_MIRROR_RESOLUTION_SCALE;
+    const char*  readback_png      = NULL;
+    const char*  readback_raw      = NULL;
+    const char*  golden_directory  = NULL;
+    int          golden_tolerance  = DEFAULT_GOLDEN_TOLERANCE;
+    unsigned int readback_latency  = DEFAULT_READBACK_LATENCY;
+    bool         readback_depth    = false;
+    const char*  terrain_directory = NULL;
+    float        terrain_radius    = DEFAULT_TERRAIN_RADIUS;
+    unsigned int terrain_loaders   = DEFAULT_TERRAIN_LOADERS;
+    unsigned int grass_count       = 0;
+    float        grass_area        = 0.0f;
+    bool         grass_prepass     = true;
+    bool         virtual_texturing = false;
+    unsigned int vt_pages          = DEFAULT_VT_PAGES_PER_SIDE;
+    bool         meshlet_culling   = false;
+    bool         animate           = false;
+    bool         cpu_skinning      = false;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--fixed-timestep") == 0)
+        {
+            fixed_timestep = true;
+        }
+        else if (std::strcmp(argv[i], "--gpu-only-meshes") == 0)
+        {
+            gpu_only_meshes = true;
+        }
+        else if (std::strcmp(argv[i], "--model") == 0 && i + 1 < argc)
+        {
+            model_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--model-instances") == 0 && i + 1 < argc)
+        {
+            model_instances = (unsigned int) std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--gpu-culling") == 0)
+        {
+            gpu_culling = true;
+        }
+        else if (std::strcmp(argv[i], "--no-texture-arrays") == 0)
+        {
+            texture_arrays = false;
+        }
+        else if (std::strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc)
+        {
+            frames_in_flight = (unsigned int) std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--late-latch") == 0)
+        {
+            late_latch = true;
+        }
+        else if (std::strcmp(argv[i], "--dynamic-resolution") == 0 && i + 1 < argc)
+        {
+            resolution_target = std::atof(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--upscale") == 0 && i + 1 < argc)
+        {
+            sharpen_upscale = std::strcmp(argv[++i], "sharpen") == 0;
+        }
+        else if (std::strcmp(argv[i], "--resolution-log") == 0 && i + 1 < argc)
+        {
+            resolution_log = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--outline") == 0 && i + 1 < argc)
+        {
+            outline_width = (float) std::atof(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--mirrors") == 0 && i + 1 < argc)
+        {
+            mirror_count = (unsigned int) std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--mirror-scale") == 0 && i + 1 < argc)
+        {
+            mirror_scale = (float) std::atof(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--readback-png") == 0 && i + 1 < argc)
+        {
+            readback_png = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--readback-raw") == 0 && i + 1 < argc)
+        {
+            readback_raw = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--golden") == 0 && i + 1 < argc)
+        {
+            golden_directory = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--golden-tolerance") == 0 && i + 1 < argc)
+        {
+            golden_tolerance = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--readback-latency") == 0 && i + 1 < argc)
+        {
+            readback_latency = (unsigned int) std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--readback-depth") == 0)
+        {
+            readback_depth = true;
+        }
+        else if (std::strcmp(argv[i], "--terrain") == 0 && i + 1 < argc)
+        {
+            terrain_directory = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--terrain-radius") == 0 && i + 1 < argc)
+        {
+            terrain_radius = (float) std::atof(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--terrain-loaders") == 0 && i + 1 < argc)
+        {
+            terrain_loaders = (unsigned int) std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--build-terrain") == 0 && i + 2 < argc)
+        {
+            const char* directory = argv[++i];
+            return write_terrain_chunks(directory, std::atoi(argv[++i])) ? 0 : -1;
+        }
+        else if (std::strcmp(argv[i], "--grass") == 0 && i + 1 < argc)
+        {
+            grass_count = (unsigned int) std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--grass-area") == 0 && i + 1 < argc)
+        {
+            grass_area = (float) std::atof(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--no-grass-prepass") == 0)
+        {
+            grass_prepass = false;
+        }
+        else if (std::strcmp(argv[i], "--virtual-textures") == 0)
+        {
+            virtual_texturing = true;
+        }
+        else if (std::strcmp(argv[i], "--vt-pages") == 0 && i + 1 < argc)
+        {
+            vt_pages = (unsigned int) std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--meshlets") == 0)
+        {
+            meshlet_culling = true;
+        }
+        else if (std::strcmp(argv[i], "--animate") == 0)
+        {
+            animate = true;
+        }
+        else if (std::strcmp(argv[i], "--skinning") == 0 && i + 1 < argc)
+        {
+            cpu_skinning = std::strcmp(argv[++i], "cpu") == 0;
+        }
+        else if (std::strcmp(argv[i], "--cook-vt") == 0 && i + 2 < argc)
+        {
+            // Flipped like every texture the renderer loads, so the tiles match the model's UVs.
+            FileSystem::get_instance().set_root_marker("vcpkg.json");
+            stbi_set_flip_vertically_on_load(true);
+            const char* image = argv[++i];
+            return cook_virtual_texture_file(image, argv[++i]) ? 0 : -1;
+        }
+        else if (std::strcmp(argv[i], "--lights") == 0 && i + 1 < argc)
+        {
+            light_count = (unsigned int) std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--texture-budget-mb") == 0 && i + 1 < argc)
+        {
+            ResourceRegistry::get_instance().set_budget(RESOURCE_TEXTURE, std::atoi(argv[++i]) * 1024ull * 1024ull);
+        }
+        else if (std::strcmp(argv[i], "--buffer-budget-mb") == 0 && i + 1 < argc)
+        {
+            ResourceRegistry::get_instance().set_budget(RESOURCE_BUFFER, std::atoi(argv[++i]) * 1024ull * 1024ull);
+        }
+        else if (std::strcmp(argv[i], "--pack") == 0 && i + 1 < argc)
+        {
+            pack_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--build-pack") == 0 && i + 1 < argc)
+        {
+            FileSystem& file_system = FileSystem::get_instance();
+            file_system.set_root_marker("vcpkg.json");
+            return FileSystem::build_pack(file_system.get_root_path(), {"shaders", "resources"}, argv[++i]) ? 0 : -1;
+        }
+        else if (std::strcmp(argv[i], "--capture") == 0 && i + 1 < argc)
+        {
+            capture_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--capture-frames") == 0 && i + 2 < argc)
+        {
+            capture_first = (unsigned int) std::atoi(argv[++i]);
+            capture_count = (unsigned int) std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+        {
+            replay_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--replay-repeats") == 0 && i + 1 < argc)
+        {
+            replay_repeats = (unsigned int) std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--bench") == 0)
+        {
+            return run_benchmark(i + 1 < argc ? argv[i + 1] : "all");
+        }
+    }
+
+    if (replay_path)
+    {
+        return run_replay(replay_path, replay_repeats);
+    }
+
+    // Constructed first so the job system knows which thread owns the GL context.
+    JobSystem::get_instance();
+
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -69,13 +371,15 @@ int main()
     camera->camera_height   = (float) W_HEIGHT;
     camera->camera_position = glm::vec3(0.0f, 0.0f, 3.0f);
 
-    glfwSetWindowUserPointer(window, camera);
+    InputState input(W_WIDTH, W_HEIGHT);
+    glfwSetWindowUserPointer(window, &input);
 
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
     glfwSetCursorPosCallback(window, mouse_callback);
     glfwSetScrollCallback(window, scroll_callback);
     glfwSetMouseButtonCallback(window, mouse_button_callback);
+    glfwSetKeyCallback(window, key_callback);
 
     if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress))
     {
@@ -83,6 +387,17 @@ int main()
         return -1;
     }
 
+    // Compute and indirect drawing are only used when the driver gave us 4.3 or later.
+    bool has_gl43 = load_gl_extensions((GLADloadproc) glfwGetProcAddress);
+    std::cout << "OpenGL " << get_gl_extensions().major_version << "." << get_gl_extensions().minor_version
+              << std::endl;
+
+    // Hooked before anything else touches GL, so the capture can rebuild every object.
+    if (capture_path)
+    {
+        GlCapture::get_instance().start(capture_path, capture_first, capture_count);
+    }
+
     stbi_set_flip_vertically_on_load(true);
 
     glEnable(GL_DEPTH_TEST);
@@ -90,143 +405,807 @@ int main()
 
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 
-    FileSystem file_system = FileSystem::get_instance();
+    FileSystem& file_system = FileSystem::get_instance();
     file_system.set_root_marker("vcpkg.json");
+    if (pack_path && !file_system.mount_pack(pack_path))
+    {
+        std::cout << "Falling back to loose files" << std::endl;
+    }
 
-    std::filesystem::path vertex_shader_path   = file_system.get_path("shaders/vertex.glsl");
-    std::filesystem::path fragment_shader_path = file_system.get_path("shaders/fragment.glsl");
-    Shader                shader(vertex_shader_path.c_str(), fragment_shader_path.c_str());
-
-    std::filesystem::path skybox_vertex_shader_path   = file_system.get_path("shaders/skybox_vertex.glsl");
-    std::filesystem::path skybox_fragment_shader_path = file_system.get_path("shaders/skybox_fragment.glsl");
-    Shader                skybox_shader(skybox_vertex_shader_path.c_str(), skybox_fragment_shader_path.c_str());
+    double load_start = glfwGetTime();
+
+    ShaderCache& shaders = ShaderCache::get_instance();
+    shaders.register_program("textured", "shaders/vertex.glsl", "shaders/fragment.glsl");
+    shaders.register_program("skybox", "shaders/skybox_vertex.glsl", "shaders/skybox_fragment.glsl");
+    shaders.register_program("model", "shaders/model_vertex.glsl", "shaders/model_fragment.glsl");
+    shaders.register_program("model_indirect", "shaders/model_indirect_vertex.glsl", "shaders/model_fragment.glsl");
+    shaders.register_program("quad", "shaders/quad_vertex.glsl", "shaders/quad_fragment.glsl");
+    shaders.register_program("mirror", "shaders/mirror_vertex.glsl", "shaders/mirror_fragment.glsl");
+    shaders.register_program("terrain", "shaders/terrain_vertex.glsl", "shaders/terrain_fragment.glsl");
+    shaders.register_program("vegetation", "shaders/vegetation_vertex.glsl", "shaders/vegetation_fragment.glsl");
+
+    // Without lights the scene keeps the plain unlit permutation.
+    ShaderDefines scene_defines = light_count > 0 ? ClusteredLighting::get_shader_defines() : ShaderDefines();
+    if (texture_arrays)
+    {
+        scene_defines.push_back({"TEXTURE_ARRAYS", ""});
+    }
+    Shader& shader = *shaders.get("textured", scene_defines);
+    Shader& skybox_shader = *shaders.get("skybox");
 
     shader.use();
     shader.setInt("texture1", 0);
+    shader.setFloat("ambient_strength", AMBIENT_STRENGTH);
 
     skybox_shader.use();
     skybox_shader.setInt("skybox_texture", 0);
 
-    unsigned int plane_VAO, cube_VAO;
-    initialize_plane_VAO(plane_VAO);
-    initialize_cube_VAO(cube_VAO);
-
-    std::filesystem::path              cube_texture_path  = file_system.get_path("resources/textures/container.jpg");
-    std::filesystem::path              plane_texture_path = file_system.get_path("resources/textures/metal.png");
-    std::vector<std::filesystem::path> skybox_textures    = {
-            file_system.get_path("resources/textures/skybox/right.jpg"),
-            file_system.get_path("resources/textures/skybox/left.jpg"),
-            file_system.get_path("resources/textures/skybox/top.jpg"),
-            file_system.get_path("resources/textures/skybox/bottom.jpg"),
-            file_system.get_path("resources/textures/skybox/front.jpg"),
-            file_system.get_path("resources/textures/skybox/back.jpg"),
+    // Imported models often carry cut-out foliage, so they get the alpha-tested permutation.
+    ShaderDefines model_defines = {{"ALPHA_TEST", ""}};
+    if (virtual_texturing)
+    {
+        model_defines.push_back({"VIRTUAL_TEXTURES", ""});
+    }
+    // Both skinning paths draw with it, the CPU one passes a negative bone_offset like unskinned meshes.
+    if (animate)
+    {
+        model_defines.push_back({"SKINNING", ""});
+    }
+    Shader& model_shader = *shaders.get("model", model_defines);
+    if (animate)
+    {
+        // The palette sampler points at its own unit even unused, two sampler types may not share unit 0.
+        model_shader.use();
+        model_shader.setInt("bone_offset", -1);
+        model_shader.setInt("bone_palette", BONE_PALETTE_UNIT);
+    }
+
+    // Timer results arrive GPU_TIMER_LATENCY frames late, so the controller waits that long after each change.
+    DynamicResolution* dynamic_resolution = NULL;
+    Shader*            upscale_shader     = NULL;
+    if (resolution_target > 0.0)
+    {
+        dynamic_resolution = new DynamicResolution(resolution_target, GPU_TIMER_LATENCY);
+        upscale_shader     = sharpen_upscale ? shaders.get("quad", {{"SHARPEN", ""}}) : shaders.get("quad");
+        std::cout << "Dynamic resolution: " << resolution_target << " ms target, "
+                  << (sharpen_upscale ? "sharpened" : "bilinear") << " upscale" << std::endl;
+    }
+
+    // The model's diffuse maps stream through a fixed set of pages, sized here, whatever their size.
+    VirtualTextureSystem* virtual_textures = NULL;
+    Shader*               feedback_shader  = NULL;
+    if (model_path && virtual_texturing)
+    {
+        virtual_textures = new VirtualTextureSystem(vt_pages);
+        feedback_shader  = shaders.get("model", {{"VIRTUAL_TEXTURE_FEEDBACK", ""}});
+    }
+
+    Model* model = NULL;
+    if (model_path)
+    {
+        MemoryUsage before = get_memory_usage();
+        model              = new Model(model_path, gpu_only_meshes, virtual_textures);
+        MemoryUsage after  = get_memory_usage();
+
+        std::cout << "Loaded " << model_path << (gpu_only_meshes ? " (GPU-only)" : "") << "\n"
+                  << "  RSS before: " << format_bytes(before.resident_bytes)
+                  << ", after: " << format_bytes(after.resident_bytes)
+                  << ", peak: " << format_bytes(after.peak_resident_bytes) << "\n"
+                  << "  CPU geometry kept: " << format_bytes(model->get_cpu_geometry_bytes()) << std::endl;
+
+        const ModelImportStats& import = model->get_import_stats();
+        std::cout << "  " << import.mesh_count << " meshes, " << import.vertex_count << " vertices converted in "
+                  << import.convert_milliseconds << " ms on " << import.threads << " threads, uploaded in "
+                  << import.upload_milliseconds << " ms" << std::endl;
+        std::cout << "  " << import.meshlet_count << " meshlets built in " << import.meshlet_milliseconds << " ms"
+                  << std::endl;
+    }
+
+    // Every instance plays its own clip from its own start, posed on the job system each frame.
+    AnimationPlayer* animation    = NULL;
+    BonePalette*     bone_palette = NULL;
+    if (model && animate && !model->is_animated())
+    {
+        std::cout << "The model has no skinned meshes or no clips, drawing it in its bind pose" << std::endl;
+    }
+    else if (model && animate)
+    {
+        if (cpu_skinning && gpu_only_meshes)
+        {
+            std::cout << "ERROR::ANIMATION::NO_CPU_GEOMETRY\n"
+                      << "CPU skinning needs the vertices --gpu-only-meshes drops, skinning on the GPU" << std::endl;
+            cpu_skinning = false;
+        }
+        animation = new AnimationPlayer(model->get_skeleton(), model->get_clips());
+        animation->set_instance_count(model_instances);
+        bone_palette = cpu_skinning ? NULL : new BonePalette();
+        std::cout << "Animation: " << model->get_clips().size() << " clips, " << animation->get_bone_count()
+                  << " bones, skinned on the " << (cpu_skinning ? "CPU" : "GPU") << std::endl;
+        if (meshlet_culling)
+        {
+            std::cout << "Meshlets are built from the bind pose, culling the animated model per mesh" << std::endl;
+        }
+    }
+
+    std::vector<glm::mat4> model_transforms = create_model_instances(model_instances);
+    GpuCulling*            model_culling    = NULL;
+    Shader*                indirect_shader  = NULL;
+    if (model && gpu_culling && animation)
+    {
+        std::cout << "GPU culling draws the bind pose, culling the animated model on the CPU" << std::endl;
+    }
+    else if (model && gpu_culling && !has_gl43)
+    {
+        std::cout << "GPU culling needs OpenGL 4.3, culling the model on the CPU" << std::endl;
+    }
+    else if (model && gpu_culling && virtual_textures)
+    {
+        std::cout << "GPU culling binds whole textures per batch, culling the model on the CPU" << std::endl;
+    }
+    else if (model && gpu_culling && capture_path)
+    {
+        // Compute dispatches, barriers and indirect draws are not hooked, the replay would never draw the model.
+        std::cout << "GPU culling cannot be captured, culling the model on the CPU" << std::endl;
+    }
+    else if (model && gpu_culling)
+    {
+        indirect_shader = shaders.get("model_indirect", {{"ALPHA_TEST", ""}});
+        model_culling   = new GpuCulling(*model);
+        model_culling->set_instances(model_transforms);
+    }
+
+    unsigned int plane_VAO, cube_VAO, plane_VBO, cube_VBO;
+    initialize_plane_VAO(plane_VAO, plane_VBO);
+    initialize_cube_VAO(cube_VAO, cube_VBO);
+
+    std::vector<std::string> skybox_textures = {
+            "resources/textures/skybox/right.jpg",  "resources/textures/skybox/left.jpg",
+            "resources/textures/skybox/top.jpg",    "resources/textures/skybox/bottom.jpg",
+            "resources/textures/skybox/front.jpg",  "resources/textures/skybox/back.jpg",
     };
 
-    unsigned int cube_texture   = load_texture(cube_texture_path.c_str());
-    unsigned int plane_texture  = load_texture(plane_texture_path.c_str());
+    // With texture arrays every scene material is a slot of a shared array, so the scene pass binds
+    // once per array instead of once per draw.
+    TextureArraySet*    scene_textures = NULL;
+    RenderableComponent plane_renderable, cube_renderable, marble_cube_renderable;
+    if (texture_arrays)
+    {
+        scene_textures           = new TextureArraySet();
+        unsigned int cube_slot   = scene_textures->add_file("resources/textures/container.jpg");
+        unsigned int plane_slot  = scene_textures->add_file("resources/textures/metal.png");
+        unsigned int marble_slot = scene_textures->add_file("resources/textures/marble.jpg");
+        scene_textures->upload();
+
+        auto make_renderable = [scene_textures](unsigned int vao, unsigned int vertices_count, unsigned int slot)
+        {
+            unsigned int texture = 0;
+            if (slot != TEXTURE_SLOT_NONE)
+            {
+                texture = scene_textures->get_array_texture(scene_textures->get_slot(slot).array);
+            }
+            return RenderableComponent{vao, vertices_count, texture, GL_TEXTURE_2D_ARRAY, slot};
+        };
+        plane_renderable       = make_renderable(plane_VAO, 6, plane_slot);
+        cube_renderable        = make_renderable(cube_VAO, 36, cube_slot);
+        marble_cube_renderable = make_renderable(cube_VAO, 36, marble_slot);
+
+        std::cout << "Texture arrays: " << scene_textures->get_slot_count() << " textures in "
+                  << scene_textures->get_array_count() << " arrays, " << scene_textures->get_atlas_page_count()
+                  << " atlas pages" << std::endl;
+    }
+    else
+    {
+        plane_renderable       = {plane_VAO, 6, load_texture("resources/textures/metal.png"), GL_TEXTURE_2D,
+                                  TEXTURE_SLOT_NONE};
+        cube_renderable        = {cube_VAO, 36, load_texture("resources/textures/container.jpg"), GL_TEXTURE_2D,
+                                  TEXTURE_SLOT_NONE};
+        marble_cube_renderable = {cube_VAO, 36, load_texture("resources/textures/marble.jpg"), GL_TEXTURE_2D,
+                                  TEXTURE_SLOT_NONE};
+    }
     unsigned int skybox_texture = load_cubemap(skybox_textures);
 
+    std::cout << "Assets loaded in " << (glfwGetTime() - load_start) * 1000.0 << " ms, "
+              << file_system.get_files_opened() << " files opened" << (pack_path ? " (pack)" : "") << std::endl;
+    shaders.print_stats(std::cout);
+
+    EntityRegistry registry;
+
+    // The terrain is level around the origin at the plane's height, so the cubes stand on it instead.
+    TerrainStreamer* terrain_streamer = NULL;
+    TerrainRenderer* terrain          = NULL;
+    Shader*          terrain_shader   = NULL;
+    if (terrain_directory)
+    {
+        terrain_streamer = new TerrainStreamer(terrain_directory, terrain_radius, terrain_loaders);
+        terrain          = new TerrainRenderer(*terrain_streamer);
+        terrain_shader   = shaders.get("terrain");
+    }
+    else
+    {
+        registry.create_render_object(glm::mat4(1.0f), plane_renderable, glm::vec3(0.0f, -0.5f, 0.0f), 7.1f);
+    }
+    Entity container_cube = registry.create_render_object(
+            glm::translate(glm::mat4(1.0f), glm::vec3(-1.0f, 0.0f, -1.0f)), cube_renderable, glm::vec3(0.0f), 0.87f);
+    Entity marble_cube = registry.create_render_object(glm::translate(glm::mat4(1.0f), glm::vec3(2.0f, 0.0f, 0.0f)),
+                                                       marble_cube_renderable, glm::vec3(0.0f), 0.87f);
+
+    // Only what the plane or the generated terrain covers, the terrain's files are not read here.
+    VegetationField     vegetation;
+    VegetationRenderer* vegetation_renderer = NULL;
+    Shader*             vegetation_shader   = NULL;
+    Shader*             vegetation_prepass  = NULL;
+    unsigned int        grass_texture       = 0;
+    if (grass_count > 0)
+    {
+        if (terrain)
+        {
+            vegetation.scatter(grass_count, glm::vec3(0.0f), grass_area > 0.0f ? grass_area : DEFAULT_VEGETATION_AREA,
+                               get_generated_terrain_height);
+        }
+        else
+        {
+            vegetation.scatter(grass_count, glm::vec3(0.0f), grass_area > 0.0f ? grass_area : PLANE_SIZE,
+                               [](float, float) { return -0.5f; });
+        }
+        VegetationStats stats = vegetation.get_stats();
+        std::cout << "Vegetation: " << stats.instance_count << " instances in " << stats.cell_count
+                  << " cells, scattered in " << stats.scatter_milliseconds << " ms" << std::endl;
+
+        grass_texture       = load_texture("resources/textures/grass.png");
+        vegetation_renderer = new VegetationRenderer(vegetation, grass_texture);
+        vegetation_prepass  = shaders.get("vegetation", {{"ALPHA_TEST", ""}});
+        vegetation_shader   = grass_prepass ? shaders.get("vegetation") : vegetation_prepass;
+    }
+
+    // --outline selects both cubes, as two separate shapes.
+    SelectionOutline* selection_outline = NULL;
+    if (outline_width > 0.0f)
+    {
+        registry.selections.add(container_cube, {1});
+        registry.selections.add(marble_cube, {2});
+        selection_outline = new SelectionOutline();
+        selection_outline->set_width(outline_width);
+    }
+
+    // Reflections skip lighting, they are small and often reused for many frames.
+    MirrorSystem    mirrors;
+    MirrorRenderer* mirror_renderer   = NULL;
+    Shader*         mirror_shader     = NULL;
+    Shader*         reflection_shader = NULL;
+    if (mirror_count > 0)
+    {
+        for (const Mirror& mirror : create_scene_mirrors(mirror_count, mirror_scale))
+        {
+            mirrors.add(mirror);
+        }
+        mirror_renderer   = new MirrorRenderer();
+        mirror_shader     = shaders.get("mirror");
+        reflection_shader = texture_arrays ? shaders.get("textured", {{"TEXTURE_ARRAYS", ""}})
+                                           : shaders.get("textured");
+        reflection_shader->use();
+        reflection_shader->setInt("texture1", 0);
+    }
+
+    // The worker encodes and compares on its own thread, the render thread only starts the copies.
+    ReadbackWorker* readback_worker = NULL;
+    FrameReadback*  readback        = NULL;
+    if (readback_png || readback_raw || golden_directory)
+    {
+        readback_worker = new ReadbackWorker();
+        readback_worker->set_png_directory(readback_png ? readback_png : "");
+        readback_worker->set_raw_video(readback_raw ? readback_raw : "");
+        readback_worker->set_golden_directory(golden_directory ? golden_directory : "", golden_tolerance);
+        readback = new FrameReadback(*readback_worker, readback_latency, readback_depth);
+    }
+
+    // Runs on the simulation thread, so it may only record GL object names, never call GL.
+    FramePipeline pipeline(MAX_FRAMES_AHEAD);
+    Simulation    simulation(*camera, input, pipeline);
+    simulation.set_fixed_timestep(fixed_timestep);
+    simulation.set_scene_builder(
+            [&registry, &mirrors](FramePacket& packet, Camera&)
+            {
+                update_transforms(registry);
+                cull_entities(registry, make_frustum(packet.projection * packet.view));
+                submit_renderables(registry, packet);
+                submit_selections(registry, packet);
+                // Last, its instance transforms must not split those of the draws above.
+                mirrors.submit(registry, packet);
+            });
+    simulation.start();
+
+    std::vector<Light> lights = create_scene_lights(light_count);
+    ClusteredLighting* lighting = light_count > 0 ? new ClusteredLighting() : NULL;
+    GpuTimer           scene_timer;
+
+    ResourceRegistry& resources             = ResourceRegistry::get_instance();
+    double            last_resource_line    = 0.0;
+    GlCapture&        capture               = GlCapture::get_instance();
+    unsigned int      model_draws           = 0;
+    unsigned int      scene_draws           = 0;
+    unsigned int      texture_binds         = 0;
+    FramePacer        pacer(frames_in_flight);
+    LatencyHistory    input_latency;
+    LatencyHistory    pacing_waits;
+    unsigned int      last_timer_result     = 0;
+    std::uint64_t     last_resolution_frame = 0;
+
     while (!glfwWindowShouldClose(window))
     {
-        float current_frame = glfwGetTime();
-        delta_time          = current_frame - last_frame;
-        last_frame          = current_frame;
-        processInput(window, camera);
+        glfwPollEvents();
+        processInput(window, &input);
+
+        const FramePacket* packet = pipeline.acquire();
+        if (!packet)
+        {
+            break;
+        }
+
+        // Waiting here, before the frame's first GL command, keeps at most frames_in_flight frames queued.
+        pacer.wait_for_slot();
+        pacing_waits.add(pacer.get_last_wait_milliseconds());
+
+        // Sampled after the wait, so the view is as fresh as it can be when the GPU gets it.
+        glm::mat4                             view       = packet->view;
+        std::chrono::steady_clock::time_point input_time = packet->input_time;
+        if (late_latch)
+        {
+            view       = get_late_latched_view(*packet, input);
+            input_time = std::chrono::steady_clock::now();
+        }
+
+        capture.begin_frame(view, packet->projection, packet->camera_position, packet->viewport_width,
+                            packet->viewport_height);
+
+        // Slots of one array only change uniforms, so the texture is rebound only when the array changes.
+        // Without arrays every draw binds its own texture, as draw_stuff() does.
+        auto draw_commands = [&](Shader& draw_shader, const DrawCommand* draws, std::size_t draw_count)
+        {
+            unsigned int bound_texture = 0;
+            GLenum       bound_target  = GL_NONE;
+            glActiveTexture(GL_TEXTURE0);
+            for (std::size_t d = 0; d < draw_count; d++)
+            {
+                const DrawCommand& draw = draws[d];
+                if (draw.texture_slot != TEXTURE_SLOT_NONE)
+                {
+                    const TextureSlot& slot = scene_textures->get_slot(draw.texture_slot);
+                    draw_shader.setFloat("texture_layer", (float) slot.layer);
+                    draw_shader.setVec4("texture_rect", slot.uv_rect);
+                }
+
+                glBindVertexArray(draw.vao);
+                for (unsigned int i = 0; i < draw.instance_count; i++)
+                {
+                    if (!scene_textures || draw.texture_id != bound_texture || draw.texture_target != bound_target)
+                    {
+                        glBindTexture(draw.texture_target, draw.texture_id);
+                        bound_texture = draw.texture_id;
+                        bound_target  = draw.texture_target;
+                        texture_binds++;
+                    }
+                    draw_shader.setMat4("model", packet->instance_transforms[draw.first_instance + i]);
+                    glDrawArrays(GL_TRIANGLES, 0, draw.vertices_count);
+                    scene_draws++;
+                }
+            }
+        };
+
+        // Before the scene's target is bound, each changed reflection into its own pooled target.
+        if (mirror_renderer)
+        {
+            capture.mark_pass("mirrors");
+            glEnable(GL_DEPTH_TEST);
+            reflection_shader->use();
+            mirror_renderer->update(*packet,
+                                    [&](const MirrorView& mirror_view)
+                                    {
+                                        reflection_shader->setMat4("view", mirror_view.view);
+                                        reflection_shader->setMat4("projection", mirror_view.projection);
+                                        draw_commands(*reflection_shader,
+                                                      packet->mirror_draws.data() + mirror_view.first_draw,
+                                                      mirror_view.draw_count);
+                                    });
+        }
+
+        // Also before the scene's target: which tiles the model's pixels want, read back a few frames later.
+        if (virtual_textures)
+        {
+            capture.mark_pass("virtual_texture_feedback");
+            glEnable(GL_DEPTH_TEST);
+            virtual_textures->begin_feedback(packet->viewport_width, packet->viewport_height);
+            feedback_shader->use();
+            feedback_shader->setMat4("view", view);
+            feedback_shader->setMat4("projection", packet->projection);
+            model->draw_instances(*feedback_shader, model_transforms, make_frustum(packet->projection * view));
+            virtual_textures->end_feedback();
+            virtual_textures->update();
+        }
+
+        int render_width  = packet->viewport_width;
+        int render_height = packet->viewport_height;
+        if (dynamic_resolution)
+        {
+            dynamic_resolution->begin(packet->viewport_width, packet->viewport_height);
+            render_width  = dynamic_resolution->get_render_width();
+            render_height = dynamic_resolution->get_render_height();
+        }
 
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-        glViewport(0, 0, camera->camera_width, camera->camera_height);
+        glViewport(0, 0, render_width, render_height);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         glEnable(GL_DEPTH_TEST);
 
-        glm::mat4 view       = camera->get_view_matrix();
-        glm::mat4 projection = camera->get_projection_matrix();
+        capture.mark_pass("scene");
+        scene_timer.begin();
 
         shader.use();
         shader.setMat4("view", view);
-        shader.setMat4("projection", projection);
+        shader.setMat4("projection", packet->projection);
+
+        // Binned against the matrices actually drawn with so the clusters match.
+        if (lighting)
+        {
+            lighting->update(lights, view, packet->projection);
+            lighting->bind(shader, render_width, render_height, 1);
+        }
+
+        scene_draws   = 0;
+        texture_binds = 0;
+        draw_commands(shader, packet->draws.data(), packet->draws.size());
 
-        glm::mat4 plane_model_matrix = glm::mat4(1.0f);
-        draw_stuff(plane_VAO, shader, plane_model_matrix, 6, plane_texture, GL_TEXTURE_2D);
+        if (terrain)
+        {
+            capture.mark_pass("terrain");
+            terrain->update(packet->camera_position);
+            terrain->draw(*terrain_shader, view, packet->projection, packet->camera_position);
+        }
 
-        glm::mat4 cube_model_matrix = glm::mat4(1.0f);
-        cube_model_matrix           = glm::translate(cube_model_matrix, glm::vec3(-1.0f, 0.0f, -1.0f));
-        draw_stuff(cube_VAO, shader, cube_model_matrix, 36, cube_texture, GL_TEXTURE_2D);
+        // After the opaque geometry, so the prepass only lays down grass that is not hidden.
+        if (vegetation_renderer)
+        {
+            capture.mark_pass("vegetation");
+            vegetation_renderer->draw(*vegetation_shader, vegetation_prepass, grass_prepass, view, packet->projection,
+                                      packet->camera_position);
+        }
 
-        cube_model_matrix = glm::mat4(1.0f);
-        cube_model_matrix = glm::translate(cube_model_matrix, glm::vec3(2.0f, 0.0f, 0.0f));
-        draw_stuff(cube_VAO, shader, cube_model_matrix, 36, cube_texture, GL_TEXTURE_2D);
+        if (model)
+        {
+            capture.mark_pass("model");
+            if (model_culling)
+            {
+                model_culling->draw(*indirect_shader, view, packet->projection);
+            }
+            else
+            {
+                model_shader.use();
+                model_shader.setMat4("view", view);
+                model_shader.setMat4("projection", packet->projection);
+                Frustum frustum = make_frustum(packet->projection * view);
+                if (animation)
+                {
+                    animation->update(packet->simulation_time, &JobSystem::get_instance());
+                    if (bone_palette)
+                    {
+                        bone_palette->upload(animation->get_palettes());
+                    }
+                    model_draws = model->draw_animated(model_shader, model_transforms, frustum, *animation,
+                                                       bone_palette);
+                }
+                else if (meshlet_culling)
+                {
+                    // The cone test only drops back faces, which the GPU then has to be told to drop too.
+                    glEnable(GL_CULL_FACE);
+                    model_draws = model->draw_meshlets(model_shader, model_transforms, frustum,
+                                                       packet->camera_position);
+                    glDisable(GL_CULL_FACE);
+                }
+                else
+                {
+                    model_draws = model->draw_instances(model_shader, model_transforms, frustum);
+                }
+            }
+        }
 
+        if (mirror_renderer)
+        {
+            capture.mark_pass("mirror_quads");
+            mirror_renderer->draw(*packet, *mirror_shader, view);
+        }
+
+        scene_timer.end();
+
+        capture.mark_pass("skybox");
         glDepthMask(false);
         skybox_shader.use();
         glm::mat4 skybox_view = glm::mat4(glm::mat3(view));
         skybox_shader.setMat4("view", skybox_view);
-        skybox_shader.setMat4("projection", projection);
+        skybox_shader.setMat4("projection", packet->projection);
         glm::mat4 skybox_model_matrix = glm::mat4(1.0f);
         draw_stuff(cube_VAO, skybox_shader, skybox_model_matrix, 36, skybox_texture, GL_TEXTURE_CUBE_MAP);
         glDepthMask(true);
 
+        if (dynamic_resolution)
+        {
+            capture.mark_pass("upscale");
+            dynamic_resolution->end(*upscale_shader);
+
+            // The scene timer covers the passes whose cost follows the resolution, the skybox is noise.
+            if (scene_timer.get_result_count() != last_timer_result)
+            {
+                last_timer_result = scene_timer.get_result_count();
+                dynamic_resolution->update(packet->frame_index, scene_timer.get_milliseconds());
+            }
+        }
+
+        // After the upscale, so the width is in window pixels.
+        if (selection_outline)
+        {
+            capture.mark_pass("outline");
+            selection_outline->draw(packet->selection_draws, view, packet->projection, packet->viewport_width,
+                                    packet->viewport_height);
+        }
+
         glBindVertexArray(0);
 
+        // Last, so the copy holds everything that reaches the screen.
+        if (readback)
+        {
+            capture.mark_pass("readback");
+            readback->capture(packet->frame_index, packet->viewport_width, packet->viewport_height);
+        }
+
+        pipeline.release();
         glfwSwapBuffers(window);
-        glfwPollEvents();
-    }
+        pacer.end_frame();
+        capture.end_frame();
 
-    glfwTerminate();
-    delete camera;
-    return 0;
-}
+        // Input-to-photon as far as the CPU can see it: from the input sample to the swap returning.
+        input_latency.add(
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - input_time).count());
 
-void framebuffer_size_callback(GLFWwindow* window, int w, int h)
-{
-    glViewport(0, 0, w, h);
-}
+        if (print_resources_requested)
+        {
+            print_resources_requested = false;
+            resources.print_summary(std::cout);
+            shaders.print_stats(std::cout);
+        }
 
-void processInput(GLFWwindow* window, Camera* camera)
-{
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
-    {
-        glfwSetWindowShouldClose(window, true);
+        if (dump_resources_requested)
+        {
+            dump_resources_requested = false;
+            if (resources.dump_json("resources.json"))
+            {
+                std::cout << "Wrote resources.json" << std::endl;
+            }
+        }
+
+        if (resource_line_enabled && glfwGetTime() - last_resource_line >= 1.0)
+        {
+            last_resource_line = glfwGetTime();
+            resources.print_frame_line(std::cout);
+            if (lighting)
+            {
+                LightBinningStats stats = lighting->get_stats();
+                std::cout << "Lighting: " << stats.light_count << " lights, bin " << stats.bin_milliseconds
+                          << " ms, " << stats.index_count << " indices, max " << stats.max_cluster_lights
+                          << " per cluster, scene pass " << scene_timer.get_milliseconds() << " ms GPU" << std::endl;
+            }
+            print_latency_line(input_latency, pacing_waits, pacer.get_frames_in_flight(), late_latch);
+            if (dynamic_resolution)
+            {
+                last_resolution_frame =
+                        print_resolution_line(dynamic_resolution->get_controller(), last_resolution_frame);
+            }
+            if (selection_outline)
+            {
+                SelectionOutlineStats stats = selection_outline->get_stats();
+                std::cout << "Outline: " << stats.selected_draws << " selected draws, " << stats.flood_passes
+                          << " flood passes, " << stats.gpu_milliseconds << " ms GPU" << std::endl;
+            }
+            if (mirror_renderer)
+            {
+                MirrorStats stats = mirror_renderer->get_stats();
+                std::cout << "Mirrors: " << stats.mirror_count << " mirrors, " << stats.rendered << " rendered, "
+                          << stats.reused << " reused, " << stats.skipped << " skipped, " << stats.pool_targets
+                          << " pooled targets (" << format_bytes(stats.pool_bytes) << ")" << std::endl;
+            }
+            if (readback)
+            {
+                FrameReadbackStats  stats        = readback->get_stats();
+                ReadbackWorkerStats worker_stats = readback_worker->get_stats();
+                std::cout << "Readback: " << stats.frames_copied << " copied, " << stats.frames_delivered
+                          << " delivered, " << stats.stalls << " stalls, " << stats.last_milliseconds << " ms (max "
+                          << stats.max_milliseconds << "), " << worker_stats.images_written << " written, "
+                          << worker_stats.images_dropped << " dropped, " << worker_stats.golden_failed << "/"
+                          << worker_stats.golden_compared << " golden failures" << std::endl;
+            }
+            if (terrain)
+            {
+                TerrainStats         stats          = terrain->get_stats();
+                TerrainStreamerStats streamer_stats = terrain_streamer->get_stats();
+                std::cout << "Terrain: " << stats.visible_chunks << "/" << stats.gpu_chunks << " chunks drawn, "
+                          << stats.triangles << " triangles, levels " << stats.lod_chunks[0];
+                for (int lod = 1; lod < TERRAIN_LOD_COUNT; lod++)
+                {
+                    std::cout << "/" << stats.lod_chunks[lod];
+                }
+                std::cout << ", " << streamer_stats.queued << " queued, load " << streamer_stats.mean_load_milliseconds
+                          << " ms mean, " << streamer_stats.max_load_milliseconds << " ms max, "
+                          << format_bytes(stats.gpu_bytes) << " on the GPU" << std::endl;
+            }
+            if (vegetation_renderer)
+            {
+                VegetationStats stats = vegetation.get_stats();
+                std::cout << "Vegetation: " << stats.drawn_instances << "/" << stats.instance_count << " instances in "
+                          << stats.visible_cells << "/" << stats.cell_count << " cells, "
+                          << vegetation_renderer->get_draw_calls() << " draws"
+                          << (grass_prepass ? " with depth prepass" : " alpha-tested") << ", select "
+                          << stats.select_milliseconds << " ms" << std::endl;
+            }
+            if (virtual_textures)
+            {
+                VirtualTextureStats stats = virtual_textures->get_cache().get_stats();
+                std::cout << "Virtual textures: " << stats.texture_count << " textures ("
+                          << format_bytes(stats.virtual_bytes) << "), " << stats.resident_pages << "/"
+                          << stats.page_count << " pages (" << format_bytes(stats.physical_bytes) << "), "
+                          << stats.requested_tiles << " tiles wanted, " << stats.missing_tiles << " missing, "
+                          << stats.loaded_tiles << " loaded, " << stats.evicted_tiles << " evicted, "
+                          << stats.cache_full << " dropped on a full cache" << std::endl;
+            }
+            std::cout << "Textures: " << texture_binds << " binds for " << scene_draws << " scene draws"
+                      << (scene_textures ? " (texture arrays)" : " (one texture per draw)") << std::endl;
+            if (model_culling)
+            {
+                GpuCullingStats stats = model_culling->get_stats();
+                std::cout << "Model: " << stats.instance_count << " instances, " << stats.item_count
+                          << " items culled on the GPU, " << stats.draw_calls << " indirect draws" << std::endl;
+            }
+            else if (model)
+            {
+                MaterialBindStats stats = model->get_materials().get_stats();
+                std::cout << "Model: " << model_transforms.size() << " instances, " << model_draws
+                          << " draws after CPU culling, " << stats.material_binds << " material binds ("
+                          << stats.skipped_binds << " skipped), " << stats.texture_binds << " texture binds"
+                          << std::endl;
+                if (animation)
+                {
+                    AnimationStats animation_stats = animation->get_stats();
+                    std::cout << "Animation: " << animation_stats.instance_count << " instances of "
+                              << animation_stats.bone_count << " bones posed in "
+                              << animation_stats.evaluate_milliseconds << " ms, "
+                              << animation_stats.key_hits << " of " << animation_stats.key_searches
+                              << " key lookups cached, skinned on the " << (bone_palette ? "GPU" : "CPU")
+                              << std::endl;
+                }
+                else if (meshlet_culling)
+                {
+                    const MeshletCullStats& meshlets = model->get_meshlet_stats();
+                    std::cout << "Meshlets: " << meshlets.triangles_submitted << " of " << meshlets.mesh_triangles
+                              << " triangles submitted, " << meshlets.meshlets_tested << " tested, "
+                              << meshlets.frustum_culled << " outside the frustum, " << meshlets.cone_culled
+                              << " facing away" << std::endl;
+                }
+            }
+        }
     }
 
-    if (glfwGetKey(window, GLFW_KEY_CAPS_LOCK) == GLFW_PRESS)
+    simulation.stop();
+
+    std::cout << "Frame pacing summary:" << std::endl;
+    print_latency_line(input_latency, pacing_waits, pacer.get_frames_in_flight(), late_latch);
+
+    // Drained before anything else goes, golden failures make the exit code.
+    bool golden_failed = false;
+    if (readback)
     {
-        glfwSetWindowShouldClose(window, true);
+        readback->finish();
+        readback_worker->flush();
+        FrameReadbackStats  stats        = readback->get_stats();
+        ReadbackWorkerStats worker_stats = readback_worker->get_stats();
+        std::cout << "Readback summary: " << stats.frames_delivered << " frames delivered, " << stats.stalls
+                  << " stalls, max " << stats.max_milliseconds << " ms, " << worker_stats.images_written
+                  << " PNGs written, " << worker_stats.images_dropped << " dropped" << std::endl;
+        if (readback_raw && readback_worker->get_raw_width() > 0)
+        {
+            std::cout << "Convert " << readback_raw << " with: ffmpeg -f rawvideo -pixel_format rgba -video_size "
+                      << readback_worker->get_raw_width() << "x" << readback_worker->get_raw_height() << " -i "
+                      << readback_raw << " out.mp4" << std::endl;
+        }
+        if (golden_directory)
+        {
+            std::cout << "Golden images: " << worker_stats.golden_compared << " compared, "
+                      << worker_stats.golden_failed << " failed (tolerance " << golden_tolerance << ")" << std::endl;
+            golden_failed = worker_stats.golden_failed > 0;
+        }
     }
-
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+    delete readback;
+    delete readback_worker;
+
+    delete model_culling;
+    delete bone_palette;
+    delete animation;
+    delete model;
+    delete virtual_textures;
+    delete lighting;
+    if (dynamic_resolution && dynamic_resolution->get_controller().write_csv(resolution_log))
     {
-        camera->process_keyboard(FORWARD, delta_time);
+        std::cout << "Wrote " << resolution_log << std::endl;
     }
-
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+    delete dynamic_resolution;
+    delete selection_outline;
+    delete mirror_renderer;
+    delete terrain;
+    delete vegetation_renderer;
+    if (grass_texture)
     {
-        camera->process_keyboard(BACKWARD, delta_time);
+        resources.untrack(RESOURCE_TEXTURE, grass_texture);
+        glDeleteTextures(1, &grass_texture);
     }
-
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+    delete terrain_streamer;
+    delete scene_textures;
+
+    resources.untrack(RESOURCE_VERTEX_ARRAY, plane_VAO);
+    resources.untrack(RESOURCE_VERTEX_ARRAY, cube_VAO);
+    resources.untrack(RESOURCE_BUFFER, plane_VBO);
+    resources.untrack(RESOURCE_BUFFER, cube_VBO);
+    glDeleteVertexArrays(1, &plane_VAO);
+    glDeleteVertexArrays(1, &cube_VAO);
+    glDeleteBuffers(1, &plane_VBO);
+    glDeleteBuffers(1, &cube_VBO);
+
+    // Array textures belong to scene_textures, which deleted them above.
+    std::vector<unsigned int> textures = {skybox_texture};
+    if (!texture_arrays)
     {
-        camera->process_keyboard(LEFT, delta_time);
+        textures.push_back(plane_renderable.texture_id);
+        textures.push_back(cube_renderable.texture_id);
+        textures.push_back(marble_cube_renderable.texture_id);
     }
-
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+    for (unsigned int texture : textures)
     {
-        camera->process_keyboard(RIGHT, delta_time);
+        resources.untrack(RESOURCE_TEXTURE, texture);
     }
+    glDeleteTextures((GLsizei) textures.size(), textures.data());
+
+    shaders.clear();
+
+    resources.report_leaks(std::cout);
 
-    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
+    glfwTerminate();
+    delete camera;
+    return golden_failed ? 1 : 0;
+}
+
+void framebuffer_size_callback(GLFWwindow* window, int w, int h)
+{
+    InputState* input = static_cast<InputState*>(glfwGetWindowUserPointer(window));
+    input->set_framebuffer_size(w, h);
+}
+
+void processInput(GLFWwindow* window, InputState* input)
+{
+    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
     {
-        camera->process_keyboard(UP, delta_time);
+        glfwSetWindowShouldClose(window, true);
     }
 
-    if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
+    if (glfwGetKey(window, GLFW_KEY_CAPS_LOCK) == GLFW_PRESS)
     {
-        camera->process_keyboard(DOWN, delta_time);
+        glfwSetWindowShouldClose(window, true);
     }
+
+    input->set_movement(FORWARD, glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS);
+    input->set_movement(BACKWARD, glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS);
+    input->set_movement(LEFT, glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS);
+    input->set_movement(RIGHT, glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS);
+    input->set_movement(UP, glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS);
+    input->set_movement(DOWN, glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS);
 }
 
 void mouse_callback(GLFWwindow* window, double xpos, double ypos)
 {
-    Camera* camera = static_cast<Camera*>(glfwGetWindowUserPointer(window));
+    InputState* input = static_cast<InputState*>(glfwGetWindowUserPointer(window));
 
     if (!mouse_entered)
     {
@@ -241,21 +1220,42 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos)
     last_mouse_X = xpos;
     last_mouse_Y = ypos;
 
-    camera->process_mouse_movement(x_offset, y_offset);
+    input->add_mouse_movement(x_offset, y_offset);
 }
 
 void scroll_callback(GLFWwindow* window, double x_offset, double y_offset)
 {
-    Camera* camera = static_cast<Camera*>(glfwGetWindowUserPointer(window));
-    camera->process_mouse_scroll(y_offset);
+    InputState* input = static_cast<InputState*>(glfwGetWindowUserPointer(window));
+    input->add_mouse_scroll(y_offset);
 }
 
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
 {
     if (button == GLFW_MOUSE_BUTTON_3 && action == GLFW_PRESS)
     {
-        Camera* camera = static_cast<Camera*>(glfwGetWindowUserPointer(window));
-        camera->reset_fov();
+        InputState* input = static_cast<InputState*>(glfwGetWindowUserPointer(window));
+        input->request_fov_reset();
+    }
+}
+
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+    if (action != GLFW_PRESS)
+    {
+        return;
+    }
+
+    if (key == GLFW_KEY_F1)
+    {
+        print_resources_requested = true;
+    }
+    else if (key == GLFW_KEY_F2)
+    {
+        dump_resources_requested = true;
+    }
+    else if (key == GLFW_KEY_F3)
+    {
+        resource_line_enabled = !resource_line_enabled;
     }
 }
 
@@ -264,8 +1264,13 @@ unsigned int load_texture(const char* path)
     unsigned int texture_id;
     glGenTextures(1, &texture_id);
 
+    FileView       file = FileSystem::get_instance().read_file(path);
     int            width, height, nrComponents;
-    unsigned char* data = stbi_load(path, &width, &height, &nrComponents, 0);
+    unsigned char* data = NULL;
+    if (file.is_valid())
+    {
+        data = stbi_load_from_memory(file.data(), (int) file.size(), &width, &height, &nrComponents, 0);
+    }
 
     if (data)
     {
@@ -293,6 +1298,9 @@ unsigned int load_texture(const char* path)
         glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
         glGenerateMipmap(GL_TEXTURE_2D);
 
+        ResourceRegistry::get_instance().track(RESOURCE_TEXTURE, texture_id,
+                                               get_texture_bytes(width, height, nrComponents, true), path);
+
         int wrapping_mode = GL_REPEAT;
         if (format == GL_RGBA)
         {
@@ -315,20 +1323,21 @@ unsigned int load_texture(const char* path)
     return texture_id;
 }
 
-void initialize_plane_VAO(unsigned int& vao)
+void initialize_plane_VAO(unsigned int& vao, unsigned int& vbo)
 {
     float plane_vertices[] = {
             5.0f,  -0.5001f, 5.0f,  2.0f, 0.0f, 5.0f,  -0.5001f, -5.0f, 2.0f, 2.0f, -5.0f, -0.5001f, -5.0f, 0.0f, 2.0f,
             -5.0f, -0.5001f, -5.0f, 0.0f, 2.0f, -5.0f, -0.5001f, 5.0f,  0.0f, 0.0f, 5.0f,  -0.5001f, 5.0f,  2.0f, 0.0f,
     };
 
-    unsigned int vbo;
-
     glGenVertexArrays(1, &vao);
     glGenBuffers(1, &vbo);
     glBindVertexArray(vao);
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
     glBufferData(GL_ARRAY_BUFFER, sizeof(plane_vertices), &plane_vertices, GL_STATIC_DRAW);
+
+    ResourceRegistry::get_instance().track(RESOURCE_VERTEX_ARRAY, vao, 0, "plane_vertices");
+    ResourceRegistry::get_instance().track(RESOURCE_BUFFER, vbo, sizeof(plane_vertices), "plane_vertices");
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*) 0);
     glEnableVertexAttribArray(1);
@@ -336,7 +1345,7 @@ void initialize_plane_VAO(unsigned int& vao)
     glBindVertexArray(0);
 }
 
-void initialize_cube_VAO(unsigned int& vao)
+void initialize_cube_VAO(unsigned int& vao, unsigned int& vbo)
 {
     float cube_vertices[] = {
             // back face
@@ -383,13 +1392,14 @@ void initialize_cube_VAO(unsigned int& vao)
             -0.5f, 0.5f, 0.5f, 0.0f, 0.0f   // bottom-left
     };
 
-    unsigned int vbo;
-
     glGenVertexArrays(1, &vao);
     glGenBuffers(1, &vbo);
     glBindVertexArray(vao);
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
     glBufferData(GL_ARRAY_BUFFER, sizeof(cube_vertices), &cube_vertices, GL_STATIC_DRAW);
+
+    ResourceRegistry::get_instance().track(RESOURCE_VERTEX_ARRAY, vao, 0, "cube_vertices");
+    ResourceRegistry::get_instance().track(RESOURCE_BUFFER, vbo, sizeof(cube_vertices), "cube_vertices");
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*) 0);
     glEnableVertexAttribArray(1);
@@ -407,29 +1417,58 @@ void draw_stuff(unsigned int& vao, Shader& shader, glm::mat4& transform_matrix,
     glDrawArrays(GL_TRIANGLES, 0, vertices_count);
 }
 
-unsigned int load_cubemap(std::vector<std::filesystem::path> faces)
+unsigned int load_cubemap(const std::vector<std::string>& faces)
 {
-    stbi_set_flip_vertically_on_load(false);
+    struct DecodedFace
+    {
+        unsigned char* data;
+        int            width;
+        int            height;
+        int            nr_channels;
+    };
+
+    // Decode every face on the job system, only the upload below needs the GL thread.
+    std::vector<DecodedFace> decoded(faces.size());
+    JobSystem::get_instance().parallel_for(0, faces.size(), 1,
+                                           [&](std::size_t begin, std::size_t end)
+                                           {
+                                               stbi_set_flip_vertically_on_load_thread(false);
+                                               for (std::size_t i = begin; i < end; i++)
+                                               {
+                                                   DecodedFace& face = decoded[i];
+                                                   FileView     file = FileSystem::get_instance().read_file(faces[i]);
+                                                   face.data         = NULL;
+                                                   if (file.is_valid())
+                                                   {
+                                                       face.data = stbi_load_from_memory(
+                                                               file.data(), (int) file.size(), &face.width,
+                                                               &face.height, &face.nr_channels, 0);
+                                                   }
+                                               }
+                                               // The main thread may run a chunk too, hand it back flipping.
+                                               stbi_set_flip_vertically_on_load_thread(true);
+                                           });
 
     unsigned int texture_id;
     glGenTextures(1, &texture_id);
     glBindTexture(GL_TEXTURE_CUBE_MAP, texture_id);
 
-    int width, height, nr_channels;
+    std::size_t texture_bytes = 0;
     for (unsigned int i = 0; i < faces.size(); i++)
     {
-        unsigned char* data = stbi_load(faces[i].c_str(), &width, &height, &nr_channels, 0);
+        DecodedFace& face = decoded[i];
 
-        if (data)
+        if (face.data)
         {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE,
-                         data);
-            stbi_image_free(data);
+            texture_bytes += get_texture_bytes(face.width, face.height, 3, false);
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, face.width, face.height, 0, GL_RGB,
+                         GL_UNSIGNED_BYTE, face.data);
+            stbi_image_free(face.data);
         }
         else
         {
-            std::cout << "Failed to load cubemap at path: " << faces[i].string() << std::endl;
-            stbi_image_free(data);
+            std::cout << "Failed to load cubemap at path: " << faces[i] << std::endl;
+            stbi_image_free(face.data);
         }
     }
 
@@ -439,6 +1478,115 @@ unsigned int load_cubemap(std::vector<std::filesystem::path> faces)
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 
-    stbi_set_flip_vertically_on_load(true);
+    ResourceRegistry::get_instance().track(RESOURCE_TEXTURE, texture_id, texture_bytes,
+                                           faces.empty() ? "" : std::filesystem::path(faces[0]).parent_path().string());
+
     return texture_id;
 }
+
+std::vector<Light> create_scene_lights(unsigned int count)
+{
+    // Scattered above the floor, every fourth one a spot pointing down. Dimmer as there are more of
+    // them so a stress test does not wash out to white.
+    std::vector<Light>                    lights(count);
+    std::mt19937                          random(7);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    float                                 intensity = std::min(1.5f, 96.0f / std::max(count, 1u));
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        Light& light         = lights[i];
+        light.type           = i % 4 == 3 ? LIGHT_SPOT : LIGHT_POINT;
+        light.position       = glm::vec3(-5.0f + 10.0f * unit(random), 0.2f + 1.5f * unit(random),
+                                         -5.0f + 10.0f * unit(random));
+        light.radius         = 1.5f + 1.5f * unit(random);
+        light.color          = glm::vec3(0.25f) + 0.75f * glm::vec3(unit(random), unit(random), unit(random));
+        light.intensity      = intensity;
+        light.direction      = glm::vec3(0.0f, -1.0f, 0.0f);
+        light.spot_cos_inner = glm::cos(glm::radians(25.0f));
+        light.spot_cos_outer = glm::cos(glm::radians(35.0f));
+    }
+
+    return lights;
+}
+
+std::vector<Mirror> create_scene_mirrors(unsigned int count, float resolution_scale)
+{
+    // Evenly spaced on the ring, standing on the floor and turned towards its center.
+    std::vector<Mirror> mirrors(count);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        float     angle     = glm::radians(360.0f) * i / count;
+        glm::vec3 direction = glm::vec3(glm::sin(angle), 0.0f, -glm::cos(angle));
+
+        Mirror& mirror          = mirrors[i];
+        mirror.center           = glm::vec3(0.0f, 0.5f, 0.0f) + direction * MIRROR_RING_RADIUS;
+        mirror.normal           = -direction;
+        mirror.up               = glm::vec3(0.0f, 1.0f, 0.0f);
+        mirror.half_width       = 1.5f;
+        mirror.half_height      = 1.0f;
+        mirror.resolution_scale = resolution_scale;
+    }
+
+    return mirrors;
+}
+
+std::vector<glm::mat4> create_model_instances(unsigned int count)
+{
+    // Square grid receding from the camera, the first instance where the single model used to be.
+    std::vector<glm::mat4> instances(count);
+    unsigned int           columns = (unsigned int) std::ceil(std::sqrt((float) count));
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        float x      = ((float) (i % columns) - (float) (columns / 2)) * MODEL_INSTANCE_SPACING;
+        float z      = -(float) (i / columns) * MODEL_INSTANCE_SPACING;
+        instances[i] = glm::translate(glm::mat4(1.0f), MODEL_POSITION + glm::vec3(x, 0.0f, z));
+    }
+
+    return instances;
+}
+
+void print_latency_line(const LatencyHistory& input_latency, const LatencyHistory& pacing_waits,
+                        unsigned int frames_in_flight, bool late_latch)
+{
+    LatencyPercentiles latency = input_latency.get_percentiles();
+    LatencyPercentiles waits   = pacing_waits.get_percentiles();
+    std::cout << "Latency: input to swap p50 " << latency.p50 << " ms, p90 " << latency.p90 << " ms, p99 "
+              << latency.p99 << " ms, max " << latency.max << " ms over " << latency.sample_count << " frames ("
+              << frames_in_flight << " in flight" << (late_latch ? ", late latched" : "") << "), fence wait p50 "
+              << waits.p50 << " ms, p99 " << waits.p99 << " ms" << std::endl;
+}
+
+// Summarizes the measurements taken after since_frame and returns the frame of the newest one.
+std::uint64_t print_resolution_line(const ResolutionController& controller, std::uint64_t since_frame)
+{
+    const std::deque<ResolutionSample>& history = controller.get_history();
+    if (history.empty())
+    {
+        return since_frame;
+    }
+
+    unsigned int samples   = 0;
+    unsigned int changes   = 0;
+    float        min_scale = controller.get_scale();
+    float        max_scale = controller.get_scale();
+    float        previous  = history.front().scale;
+    for (const ResolutionSample& sample : history)
+    {
+        if (sample.frame_index > since_frame)
+        {
+            samples++;
+            changes += sample.scale != previous ? 1 : 0;
+            min_scale = std::min(min_scale, sample.scale);
+            max_scale = std::max(max_scale, sample.scale);
+        }
+        previous = sample.scale;
+    }
+
+    std::cout << "Resolution: scale " << controller.get_scale() << " (" << min_scale << " to " << max_scale
+              << " over " << samples << " measurements, " << changes << " changes), GPU "
+              << history.back().gpu_milliseconds << " ms for a " << controller.get_target_milliseconds()
+              << " ms target" << std::endl;
+    return history.back().frame_index;
+}
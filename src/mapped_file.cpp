@@ -0,0 +1,146 @@
+#include "learn_opengl/mapped_file.hpp"
+
+#include <cstddef>
+#include <filesystem>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+    mapped_data = nullptr;
+    mapped_size = 0;
+    opened = false;
+#if defined(_WIN32)
+    file_handle = INVALID_HANDLE_VALUE;
+    mapping_handle = NULL;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const std::filesystem::path& p_path)
+{
+    close();
+
+#if defined(_WIN32)
+    file_handle = CreateFileW(p_path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file_handle == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER file_size;
+    GetFileSizeEx(file_handle, &file_size);
+    mapped_size = (std::size_t) file_size.QuadPart;
+    opened = true;
+
+    // Zero-length files cannot be mapped but are still valid files.
+    if (mapped_size == 0)
+    {
+        return true;
+    }
+
+    mapping_handle = CreateFileMappingW(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping_handle == NULL)
+    {
+        close();
+        return false;
+    }
+
+    mapped_data = (const unsigned char*) MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+    if (!mapped_data)
+    {
+        close();
+        return false;
+    }
+#else
+    int descriptor = ::open(p_path.c_str(), O_RDONLY);
+    if (descriptor < 0)
+    {
+        return false;
+    }
+
+    struct stat file_stat;
+    if (fstat(descriptor, &file_stat) != 0)
+    {
+        ::close(descriptor);
+        return false;
+    }
+
+    mapped_size = (std::size_t) file_stat.st_size;
+    opened = true;
+
+    if (mapped_size > 0)
+    {
+        void* address = mmap(nullptr, mapped_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (address == MAP_FAILED)
+        {
+            ::close(descriptor);
+            close();
+            return false;
+        }
+
+        mapped_data = (const unsigned char*) address;
+    }
+
+    // The mapping keeps its own reference to the file.
+    ::close(descriptor);
+#endif
+
+    return true;
+}
+
+void MappedFile::close()
+{
+#if defined(_WIN32)
+    if (mapped_data)
+    {
+        UnmapViewOfFile(mapped_data);
+    }
+    if (mapping_handle != NULL)
+    {
+        CloseHandle(mapping_handle);
+        mapping_handle = NULL;
+    }
+    if (file_handle != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(file_handle);
+        file_handle = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (mapped_data)
+    {
+        munmap((void*) mapped_data, mapped_size);
+    }
+#endif
+
+    mapped_data = nullptr;
+    mapped_size = 0;
+    opened = false;
+}
+
+bool MappedFile::is_open() const
+{
+    return opened;
+}
+
+const unsigned char* MappedFile::data() const
+{
+    return mapped_data;
+}
+
+std::size_t MappedFile::size() const
+{
+    return mapped_size;
+}
@@ -0,0 +1,151 @@
+#include "learn_opengl/material.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "learn_opengl/resource_registry.hpp"
+#include "learn_opengl/shader.hpp"
+
+namespace
+{
+// Uniform name of each MaterialSampler.
+const char* const SAMPLER_NAMES[MATERIAL_SAMPLER_COUNT] = {"material.texture_diffuse1", "material.texture_specular1"};
+} // namespace
+
+static_assert(sizeof(MaterialParameters) == 48, "MaterialParameters must match the std140 MaterialBlock");
+
+MaterialTable::MaterialTable()
+{
+    buffer = 0;
+    stride = 0;
+    reset_bindings();
+}
+
+MaterialTable::~MaterialTable()
+{
+    if (buffer)
+    {
+        ResourceRegistry::get_instance().untrack(RESOURCE_BUFFER, buffer);
+        glDeleteBuffers(1, &buffer);
+    }
+}
+
+unsigned int MaterialTable::add(const Material& p_material)
+{
+    materials.push_back(p_material);
+    return (unsigned int) materials.size() - 1;
+}
+
+void MaterialTable::upload()
+{
+    if (materials.empty())
+    {
+        return;
+    }
+
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    alignment = std::max(alignment, 1);
+    stride    = (sizeof(MaterialParameters) + alignment - 1) / alignment * alignment;
+
+    std::vector<unsigned char> data(stride * materials.size(), 0);
+    for (std::size_t i = 0; i < materials.size(); i++)
+    {
+        std::memcpy(data.data() + i * stride, &materials[i].parameters, sizeof(MaterialParameters));
+    }
+
+    if (!buffer)
+    {
+        glGenBuffers(1, &buffer);
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferData(GL_UNIFORM_BUFFER, data.size(), data.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    ResourceRegistry& registry = ResourceRegistry::get_instance();
+    registry.untrack(RESOURCE_BUFFER, buffer);
+    registry.track(RESOURCE_BUFFER, buffer, data.size(), "materials");
+}
+
+const Material& MaterialTable::get(unsigned int p_material) const
+{
+    return materials[p_material];
+}
+
+unsigned int MaterialTable::get_count() const
+{
+    return (unsigned int) materials.size();
+}
+
+void MaterialTable::prepare(Shader& p_shader)
+{
+    if (std::find(prepared_programs.begin(), prepared_programs.end(), p_shader.ID) != prepared_programs.end())
+    {
+        return;
+    }
+    prepared_programs.push_back(p_shader.ID);
+
+    // Samplers are set through glUniform1i, on the program in use.
+    p_shader.use();
+    for (unsigned int i = 0; i < MATERIAL_SAMPLER_COUNT; i++)
+    {
+        glUniform1i(glGetUniformLocation(p_shader.ID, SAMPLER_NAMES[i]), (GLint) i);
+    }
+
+    // Permutations that never read a parameter drop the block.
+    unsigned int block = glGetUniformBlockIndex(p_shader.ID, "MaterialBlock");
+    if (block != GL_INVALID_INDEX)
+    {
+        glUniformBlockBinding(p_shader.ID, block, MATERIAL_BLOCK_BINDING);
+    }
+}
+
+void MaterialTable::reset_bindings()
+{
+    bound_material = MATERIAL_NONE;
+    for (unsigned int i = 0; i < MATERIAL_SAMPLER_COUNT; i++)
+    {
+        bound_textures[i] = 0;
+    }
+    stats = MaterialBindStats();
+}
+
+bool MaterialTable::bind(unsigned int p_material)
+{
+    if (p_material == bound_material || p_material >= materials.size())
+    {
+        stats.skipped_binds++;
+        return false;
+    }
+
+    // Units of missing maps keep whatever they hold, the flags in the block keep the shader off them.
+    const Material& material = materials[p_material];
+    for (unsigned int i = 0; i < MATERIAL_SAMPLER_COUNT; i++)
+    {
+        if (material.textures[i] == 0 || material.textures[i] == bound_textures[i])
+        {
+            continue;
+        }
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D, material.textures[i]);
+        bound_textures[i] = material.textures[i];
+        stats.texture_binds++;
+    }
+    glActiveTexture(GL_TEXTURE0);
+
+    glBindBufferRange(GL_UNIFORM_BUFFER, MATERIAL_BLOCK_BINDING, buffer, p_material * stride,
+                      sizeof(MaterialParameters));
+
+    bound_material = p_material;
+    stats.material_binds++;
+    return true;
+}
+
+MaterialBindStats MaterialTable::get_stats() const
+{
+    return stats;
+}
@@ -0,0 +1,63 @@
+#include "learn_opengl/memory_stats.hpp"
+
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+MemoryUsage get_memory_usage()
+{
+    MemoryUsage usage = {0, 0};
+
+#if defined(__linux__)
+    std::ifstream status("/proc/self/status");
+    std::string   line;
+
+    while (std::getline(status, line))
+    {
+        std::istringstream fields(line);
+        std::string        key;
+        std::size_t        kilobytes = 0;
+        fields >> key >> kilobytes;
+
+        if (key == "VmRSS:")
+        {
+            usage.resident_bytes = kilobytes * 1024;
+        }
+        else if (key == "VmHWM:")
+        {
+            usage.peak_resident_bytes = kilobytes * 1024;
+        }
+    }
+#elif defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        usage.resident_bytes = counters.WorkingSetSize;
+        usage.peak_resident_bytes = counters.PeakWorkingSetSize;
+    }
+#endif
+
+    return usage;
+}
+
+std::string format_bytes(std::size_t p_bytes)
+{
+    char buffer[32];
+    if (p_bytes >= 1024 * 1024)
+    {
+        std::snprintf(buffer, sizeof(buffer), "%.2f MB", (double) p_bytes / (1024.0 * 1024.0));
+    }
+    else
+    {
+        std::snprintf(buffer, sizeof(buffer), "%.2f KB", (double) p_bytes / 1024.0);
+    }
+
+    return buffer;
+}
@@ -1,18 +1,105 @@
 #include "learn_opengl/mesh.hpp"
-#include "learn_opengl/shader.hpp"
+#include "learn_opengl/resource_registry.hpp"
 #include <cstddef>
-#include <string>
+#include <utility>
 #include <vector>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
-Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures)
+Mesh::Mesh(std::vector<Vertex>&& vertices, std::vector<unsigned int>&& indices, unsigned int p_material,
+           bool gpu_only)
 {
-    this->vertices = vertices;
-    this->indices = indices;
-    this->textures = textures;
+    this->vertices = std::move(vertices);
+    this->indices = std::move(indices);
+    material = p_material;
+    weight_buffer = 0;
+    stream_VAO = 0;
+    stream_VBO = 0;
+    index_count = (unsigned int) this->indices.size();
+    vertex_count = (unsigned int) this->vertices.size();
 
+    compute_bounds();
     setup_mesh();
+
+    if (gpu_only)
+    {
+        release_cpu_geometry();
+    }
+}
+
+unsigned int Mesh::get_index_count() const
+{
+    return index_count;
+}
+
+unsigned int Mesh::get_vertex_count() const
+{
+    return vertex_count;
+}
+
+unsigned int Mesh::get_vertex_buffer() const
+{
+    return VBO;
+}
+
+unsigned int Mesh::get_index_buffer() const
+{
+    return EBO;
+}
+
+void Mesh::release_cpu_geometry()
+{
+    // clear() keeps the capacity, swapping with an empty vector actually frees it.
+    std::vector<Vertex>().swap(vertices);
+    std::vector<unsigned int>().swap(indices);
+    std::vector<SkinWeights>().swap(skin_weights);
+
+    ResourceRegistry::get_instance().untrack(RESOURCE_CPU_GEOMETRY, VAO);
+}
+
+void Mesh::destroy()
+{
+    ResourceRegistry& resources = ResourceRegistry::get_instance();
+    resources.untrack(RESOURCE_VERTEX_ARRAY, VAO);
+    resources.untrack(RESOURCE_BUFFER, VBO);
+    resources.untrack(RESOURCE_BUFFER, EBO);
+    resources.untrack(RESOURCE_CPU_GEOMETRY, VAO);
+
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+
+    if (weight_buffer)
+    {
+        resources.untrack(RESOURCE_BUFFER, weight_buffer);
+        glDeleteBuffers(1, &weight_buffer);
+    }
+    if (stream_VAO)
+    {
+        resources.untrack(RESOURCE_VERTEX_ARRAY, stream_VAO);
+        resources.untrack(RESOURCE_BUFFER, stream_VBO);
+        glDeleteVertexArrays(1, &stream_VAO);
+        glDeleteBuffers(1, &stream_VBO);
+    }
+}
+
+void Mesh::compute_bounds()
+{
+    if (vertices.empty())
+    {
+        bounds_min = glm::vec3(0.0f);
+        bounds_max = glm::vec3(0.0f);
+        return;
+    }
+
+    bounds_min = vertices[0].position;
+    bounds_max = vertices[0].position;
+
+    for (const Vertex& vertex : vertices)
+    {
+        bounds_min = glm::min(bounds_min, vertex.position);
+        bounds_max = glm::max(bounds_max, vertex.position);
+    }
 }
 
 void Mesh::setup_mesh()
@@ -28,6 +115,21 @@ void Mesh::setup_mesh()
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
 
+    std::size_t vertex_bytes = vertices.size() * sizeof(Vertex);
+    std::size_t index_bytes = indices.size() * sizeof(unsigned int);
+
+    ResourceRegistry& resources = ResourceRegistry::get_instance();
+    resources.track(RESOURCE_VERTEX_ARRAY, VAO, 0);
+    resources.track(RESOURCE_BUFFER, VBO, vertex_bytes);
+    resources.track(RESOURCE_BUFFER, EBO, index_bytes);
+    resources.track(RESOURCE_CPU_GEOMETRY, VAO, vertex_bytes + index_bytes);
+
+    setup_vertex_attributes();
+}
+
+// Layout of Vertex, for whichever array buffer is bound.
+void Mesh::setup_vertex_attributes()
+{
     // Vertex position
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*) 0);
@@ -41,33 +143,80 @@ void Mesh::setup_mesh()
     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*) offsetof(Vertex, tex_coords));
 }
 
-void Mesh::draw(Shader& shader)
+void Mesh::draw()
 {
-    unsigned int diffuseNr = 1;
-    unsigned int specularNr = 1;
+    glBindVertexArray(VAO);
+    glDrawElements(GL_TRIANGLES, index_count, GL_UNSIGNED_INT, 0);
+    glBindVertexArray(0);
+}
+
+void Mesh::draw_ranges(const MeshletDrawList& p_draws)
+{
+    if (p_draws.counts.empty())
+    {
+        return;
+    }
+
+    glBindVertexArray(VAO);
+    glMultiDrawElements(GL_TRIANGLES, p_draws.counts.data(), GL_UNSIGNED_INT, p_draws.offsets.data(),
+                        (GLsizei) p_draws.counts.size());
+    glBindVertexArray(0);
+}
 
-    for (unsigned int i = 0; i < textures.size(); i++)
+void Mesh::draw_streamed(const std::vector<Vertex>& p_vertices)
+{
+    if (!stream_VAO)
     {
-        glActiveTexture(GL_TEXTURE0 + i);
-        std::string number;
-        std::string name = textures[i].type;
-
-        if (name == "texture_diffuse")
-        {
-            number = std::to_string(diffuseNr++);
-        }
-        else if (name == "texture_specular")
-        {
-            number = std::to_string(specularNr++);
-        }
-
-        shader.setFloat(("material." + name + number).c_str(), i);
-        glBindTexture(GL_TEXTURE_2D, textures[i].id);
+        glGenVertexArrays(1, &stream_VAO);
+        glGenBuffers(1, &stream_VBO);
+        glBindVertexArray(stream_VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, stream_VBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        setup_vertex_attributes();
+
+        ResourceRegistry& resources = ResourceRegistry::get_instance();
+        resources.track(RESOURCE_VERTEX_ARRAY, stream_VAO, 0);
+        resources.track(RESOURCE_BUFFER, stream_VBO, vertex_count * sizeof(Vertex));
     }
 
-    glActiveTexture(GL_TEXTURE0);
+    // Orphaned every draw, so the driver never waits for the previous draw to finish reading.
+    glBindBuffer(GL_ARRAY_BUFFER, stream_VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertex_count * sizeof(Vertex), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, p_vertices.size() * sizeof(Vertex), p_vertices.data());
 
+    glBindVertexArray(stream_VAO);
+    glDrawElements(GL_TRIANGLES, index_count, GL_UNSIGNED_INT, 0);
+    glBindVertexArray(0);
+}
+
+void Mesh::set_skin_weights(std::vector<SkinWeights>&& p_weights)
+{
+    if (p_weights.empty())
+    {
+        return;
+    }
+
+    glGenBuffers(1, &weight_buffer);
     glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, weight_buffer);
+    glBufferData(GL_ARRAY_BUFFER, p_weights.size() * sizeof(SkinWeights), p_weights.data(), GL_STATIC_DRAW);
+    ResourceRegistry::get_instance().track(RESOURCE_BUFFER, weight_buffer, p_weights.size() * sizeof(SkinWeights));
+
+    glEnableVertexAttribArray(3);
+    glVertexAttribIPointer(3, MAX_BONE_INFLUENCES, GL_UNSIGNED_BYTE, sizeof(SkinWeights), (void*) 0);
+    glEnableVertexAttribArray(4);
+    glVertexAttribPointer(4, MAX_BONE_INFLUENCES, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(SkinWeights),
+                          (void*) offsetof(SkinWeights, weights));
     glBindVertexArray(0);
+
+    // The CPU skinning path reads the bind pose, which GPU-only meshes no longer have.
+    if (!vertices.empty())
+    {
+        skin_weights = std::move(p_weights);
+    }
+}
+
+bool Mesh::is_skinned() const
+{
+    return weight_buffer != 0;
 }
@@ -0,0 +1,228 @@
+#include "learn_opengl/meshlet.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "glm/ext/matrix_float4x4.hpp"
+#include "glm/ext/vector_float3.hpp"
+#include "glm/ext/vector_float4.hpp"
+#include "glm/geometric.hpp"
+#include "glm/matrix.hpp"
+#include "learn_opengl/frustum.hpp"
+#include "learn_opengl/mesh.hpp"
+
+namespace
+{
+// Bits per axis of the quantized centroids, three axes and the facing below fit in 32 bits.
+const unsigned int MORTON_BITS = 9;
+
+// Spreads the low MORTON_BITS bits of p_value over every third bit.
+std::uint32_t spread_bits(std::uint32_t p_value)
+{
+    std::uint32_t v = p_value & ((1u << MORTON_BITS) - 1);
+    v               = (v | (v << 16)) & 0x030000FF;
+    v               = (v | (v << 8)) & 0x0300F00F;
+    v               = (v | (v << 4)) & 0x030C30C3;
+    v               = (v | (v << 2)) & 0x09249249;
+    return v;
+}
+
+// 0 to 5: the axis the normal leans to most, twice, plus one when it points down that axis.
+std::uint32_t get_facing(const glm::vec3& p_normal)
+{
+    glm::vec3     magnitude = glm::abs(p_normal);
+    std::uint32_t axis      = magnitude.x >= magnitude.y && magnitude.x >= magnitude.z ? 0
+                              : magnitude.y >= magnitude.z                             ? 1
+                                                                                       : 2;
+    return axis * 2 + (p_normal[axis] < 0.0f ? 1 : 0);
+}
+
+void compute_bounds(const Vertex* p_vertices, const unsigned int* p_indices, const glm::vec3* p_normals,
+                    std::size_t p_triangle_count, Meshlet& p_meshlet)
+{
+    glm::vec3 min(FLT_MAX);
+    glm::vec3 max(-FLT_MAX);
+    glm::vec3 normal_sum(0.0f);
+    for (std::size_t i = 0; i < p_triangle_count * 3; i++)
+    {
+        min = glm::min(min, p_vertices[p_indices[i]].position);
+        max = glm::max(max, p_vertices[p_indices[i]].position);
+    }
+    for (std::size_t t = 0; t < p_triangle_count; t++)
+    {
+        normal_sum += p_normals[t];
+    }
+
+    p_meshlet.center = (min + max) * 0.5f;
+    p_meshlet.radius = 0.0f;
+    for (std::size_t i = 0; i < p_triangle_count * 3; i++)
+    {
+        glm::vec3 offset = p_vertices[p_indices[i]].position - p_meshlet.center;
+        p_meshlet.radius = std::max(p_meshlet.radius, glm::length(offset));
+    }
+
+    // Degenerate triangles have a zero normal and never limit the cone.
+    p_meshlet.cone_axis   = glm::vec3(0.0f, 0.0f, 1.0f);
+    p_meshlet.cone_cutoff = 1.0f;
+    float length          = glm::length(normal_sum);
+    if (length < 1e-6f)
+    {
+        return;
+    }
+
+    glm::vec3 axis    = normal_sum / length;
+    float     min_dot = 1.0f;
+    for (std::size_t t = 0; t < p_triangle_count; t++)
+    {
+        if (p_normals[t] != glm::vec3(0.0f))
+        {
+            min_dot = std::min(min_dot, glm::dot(p_normals[t], axis));
+        }
+    }
+
+    p_meshlet.cone_axis = axis;
+    if (min_dot > MESHLET_MIN_CONE_DOT)
+    {
+        // The normals lie within acos(min_dot) of the axis. Every triangle faces away when the meshlet is
+        // seen from within 90 degrees minus that of the axis, whose cosine is this sine.
+        p_meshlet.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+    }
+}
+} // namespace
+
+void build_meshlets(const Vertex* p_vertices, std::vector<unsigned int>& p_indices, std::vector<Meshlet>& p_meshlets)
+{
+    p_meshlets.clear();
+    std::size_t triangle_count = p_indices.size() / 3;
+    if (triangle_count == 0)
+    {
+        return;
+    }
+
+    std::vector<glm::vec3> centroids(triangle_count);
+    std::vector<glm::vec3> normals(triangle_count);
+    glm::vec3              min(FLT_MAX);
+    glm::vec3              max(-FLT_MAX);
+    for (std::size_t t = 0; t < triangle_count; t++)
+    {
+        const glm::vec3& a = p_vertices[p_indices[t * 3 + 0]].position;
+        const glm::vec3& b = p_vertices[p_indices[t * 3 + 1]].position;
+        const glm::vec3& c = p_vertices[p_indices[t * 3 + 2]].position;
+
+        // From the winding, as GL_CULL_FACE sees it, not from the vertex normals.
+        glm::vec3 normal = glm::cross(b - a, c - a);
+        float     length = glm::length(normal);
+        normals[t]       = length > 0.0f ? normal / length : glm::vec3(0.0f);
+        centroids[t]     = (a + b + c) / 3.0f;
+        min              = glm::min(min, centroids[t]);
+        max              = glm::max(max, centroids[t]);
+    }
+
+    // Facing in the top bits, then the Morton code, then the triangle so the sort is stable.
+    float                      scale = (float) ((1u << MORTON_BITS) - 1);
+    glm::vec3                  range = glm::max(max - min, glm::vec3(1e-20f));
+    std::vector<std::uint64_t> order(triangle_count);
+    for (std::size_t t = 0; t < triangle_count; t++)
+    {
+        glm::vec3     cell = (centroids[t] - min) / range * scale;
+        std::uint32_t key  = get_facing(normals[t]) << (3 * MORTON_BITS) | spread_bits((std::uint32_t) cell.x) |
+                            spread_bits((std::uint32_t) cell.y) << 1 | spread_bits((std::uint32_t) cell.z) << 2;
+        order[t] = (std::uint64_t) key << 32 | t;
+    }
+    std::sort(order.begin(), order.end());
+
+    std::vector<unsigned int> indices(p_indices.size());
+    std::vector<glm::vec3>    sorted_normals(triangle_count);
+    for (std::size_t i = 0; i < triangle_count; i++)
+    {
+        std::size_t t = (std::size_t) (order[i] & 0xFFFFFFFF);
+
+        indices[i * 3 + 0] = p_indices[t * 3 + 0];
+        indices[i * 3 + 1] = p_indices[t * 3 + 1];
+        indices[i * 3 + 2] = p_indices[t * 3 + 2];
+        sorted_normals[i]  = normals[t];
+    }
+    p_indices.swap(indices);
+
+    // Each run of one facing splits into equal meshlets, so a run of 129 gives two of about 65, not 128
+    // and 1.
+    std::size_t run_begin = 0;
+    while (run_begin < triangle_count)
+    {
+        std::uint64_t facing  = order[run_begin] >> (32 + 3 * MORTON_BITS);
+        std::size_t   run_end = run_begin + 1;
+        while (run_end < triangle_count && order[run_end] >> (32 + 3 * MORTON_BITS) == facing)
+        {
+            run_end++;
+        }
+
+        std::size_t run_length = run_end - run_begin;
+        std::size_t count      = (run_length + MESHLET_MAX_TRIANGLES - 1) / MESHLET_MAX_TRIANGLES;
+        for (std::size_t m = 0; m < count; m++)
+        {
+            std::size_t first = run_begin + run_length * m / count;
+            std::size_t last  = run_begin + run_length * (m + 1) / count;
+
+            Meshlet meshlet;
+            meshlet.first_index = (unsigned int) (first * 3);
+            meshlet.index_count = (unsigned int) ((last - first) * 3);
+            compute_bounds(p_vertices, &p_indices[first * 3], &sorted_normals[first], last - first, meshlet);
+            p_meshlets.push_back(meshlet);
+        }
+
+        run_begin = run_end;
+    }
+}
+
+void cull_meshlets(const std::vector<Meshlet>& p_meshlets, const glm::mat4& p_model_matrix, const Frustum& p_frustum,
+                   const glm::vec3& p_camera_position, MeshletDrawList& p_draws, MeshletCullStats& p_stats)
+{
+    glm::vec3 x_axis(p_model_matrix[0]);
+    glm::vec3 y_axis(p_model_matrix[1]);
+    glm::vec3 z_axis(p_model_matrix[2]);
+    float     scale = std::max(glm::length(x_axis), std::max(glm::length(y_axis), glm::length(z_axis)));
+
+    // Whether a triangle faces a point does not change under the model matrix, so the cones stay in
+    // object space and the camera comes to them. A mirroring matrix flips the winding, skip the test.
+    glm::vec3 camera     = glm::vec3(glm::inverse(p_model_matrix) * glm::vec4(p_camera_position, 1.0f));
+    bool      cone_tests = glm::dot(glm::cross(x_axis, y_axis), z_axis) > 0.0f;
+
+    for (const Meshlet& meshlet : p_meshlets)
+    {
+        p_stats.meshlets_tested++;
+
+        glm::vec3 center = glm::vec3(p_model_matrix * glm::vec4(meshlet.center, 1.0f));
+        if (!sphere_in_frustum(p_frustum, center, meshlet.radius * scale))
+        {
+            p_stats.frustum_culled++;
+            continue;
+        }
+
+        glm::vec3 to_center = meshlet.center - camera;
+        if (cone_tests &&
+            glm::dot(to_center, meshlet.cone_axis) >= meshlet.cone_cutoff * glm::length(to_center) + meshlet.radius)
+        {
+            p_stats.cone_culled++;
+            continue;
+        }
+
+        p_stats.triangles_submitted += meshlet.index_count / 3;
+
+        // Meshlets are stored in index order, so survivors next to each other make one range.
+        std::uintptr_t offset = (std::uintptr_t) meshlet.first_index * sizeof(unsigned int);
+        if (!p_draws.counts.empty() &&
+            (std::uintptr_t) p_draws.offsets.back() + p_draws.counts.back() * sizeof(unsigned int) == offset)
+        {
+            p_draws.counts.back() += (int) meshlet.index_count;
+        }
+        else
+        {
+            p_draws.counts.push_back((int) meshlet.index_count);
+            p_draws.offsets.push_back((const void*) offset);
+        }
+    }
+}
@@ -0,0 +1,485 @@
+#include "learn_opengl/mirror.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+#include <glad/glad.h>
+
+#include "glm/geometric.hpp"
+#include "glm/matrix.hpp"
+#include "learn_opengl/resource_registry.hpp"
+
+namespace
+{
+    // FNV-1a, only compared against the same mirror's previous frame.
+    const std::uint64_t SIGNATURE_OFFSET = 14695981039346656037ull;
+    const std::uint64_t SIGNATURE_PRIME  = 1099511628211ull;
+
+    void sign(std::uint64_t& p_signature, const void* p_data, std::size_t p_size)
+    {
+        const unsigned char* bytes = (const unsigned char*) p_data;
+        for (std::size_t i = 0; i < p_size; i++)
+        {
+            p_signature = (p_signature ^ bytes[i]) * SIGNATURE_PRIME;
+        }
+    }
+
+    // Reflection through the plane dot(n, x) + d = 0.
+    glm::mat4 make_reflection(const glm::vec3& p_normal, float p_distance)
+    {
+        glm::mat4 reflection(1.0f);
+        for (int column = 0; column < 3; column++)
+        {
+            for (int row = 0; row < 3; row++)
+            {
+                reflection[column][row] -= 2.0f * p_normal[row] * p_normal[column];
+            }
+        }
+        reflection[3] = glm::vec4(-2.0f * p_distance * p_normal, 1.0f);
+        return reflection;
+    }
+
+    // Far distance of a glm::perspective matrix.
+    float get_far_distance(const glm::mat4& p_projection)
+    {
+        return p_projection[3][2] / (p_projection[2][2] + 1.0f);
+    }
+} // namespace
+
+Frustum make_mirror_frustum(const glm::vec3& p_mirrored_eye, const glm::vec3 p_corners[4],
+                            const glm::vec4& p_mirror_plane, float p_far_distance)
+{
+    glm::vec3 center = (p_corners[0] + p_corners[1] + p_corners[2] + p_corners[3]) * 0.25f;
+    // On the ray from the eye through the mirror's center, so inside every side plane.
+    glm::vec3 inside = center + (center - p_mirrored_eye);
+
+    Frustum   frustum;
+    const int sides[4] = {FRUSTUM_LEFT, FRUSTUM_BOTTOM, FRUSTUM_RIGHT, FRUSTUM_TOP};
+    for (int i = 0; i < 4; i++)
+    {
+        const glm::vec3& a      = p_corners[i];
+        const glm::vec3& b      = p_corners[(i + 1) % 4];
+        glm::vec3        normal = glm::normalize(glm::cross(a - p_mirrored_eye, b - p_mirrored_eye));
+        glm::vec4        plane(normal, -glm::dot(normal, p_mirrored_eye));
+        if (glm::dot(glm::vec3(plane), inside) + plane.w < 0.0f)
+        {
+            plane = -plane;
+        }
+        frustum.planes[sides[i]] = plane;
+    }
+
+    // Only what is in front of the mirror can be reflected in it.
+    frustum.planes[FRUSTUM_NEAR] = p_mirror_plane;
+
+    glm::vec3 forward           = glm::normalize(center - p_mirrored_eye);
+    frustum.planes[FRUSTUM_FAR] = glm::vec4(-forward, glm::dot(forward, p_mirrored_eye) + p_far_distance);
+    return frustum;
+}
+
+glm::mat4 make_oblique_projection(const glm::mat4& p_projection, const glm::vec4& p_view_plane)
+{
+    // The clip-space corner opposite the plane, pulled back into view space.
+    glm::vec4 corner;
+    corner.x = ((p_view_plane.x > 0.0f ? 1.0f : -1.0f) + p_projection[2][0]) / p_projection[0][0];
+    corner.y = ((p_view_plane.y > 0.0f ? 1.0f : -1.0f) + p_projection[2][1]) / p_projection[1][1];
+    corner.z = -1.0f;
+    corner.w = (1.0f + p_projection[2][2]) / p_projection[3][2];
+
+    glm::vec4 scaled_plane = p_view_plane * (2.0f / glm::dot(p_view_plane, corner));
+
+    // Replaces the third row, the one that produces clip z.
+    glm::mat4 oblique = p_projection;
+    for (int column = 0; column < 4; column++)
+    {
+        oblique[column][2] = scaled_plane[column] - p_projection[column][3];
+    }
+    return oblique;
+}
+
+MirrorSystem::MirrorSystem()
+{
+    min_screen_pixels = DEFAULT_MIRROR_MIN_SCREEN_PIXELS;
+}
+
+unsigned int MirrorSystem::add(const Mirror& p_mirror)
+{
+    mirrors.push_back(p_mirror);
+    return (unsigned int) mirrors.size() - 1;
+}
+
+void MirrorSystem::set_min_screen_pixels(float p_pixels)
+{
+    min_screen_pixels = p_pixels;
+}
+
+void MirrorSystem::submit(const EntityRegistry& p_registry, FramePacket& p_packet) const
+{
+    glm::mat4 view_projection = p_packet.projection * p_packet.view;
+    Frustum   camera_frustum  = make_frustum(view_projection);
+    float     far_distance    = get_far_distance(p_packet.projection);
+    float     viewport_width  = (float) p_packet.viewport_width;
+    float     viewport_height = (float) p_packet.viewport_height;
+
+    for (unsigned int m = 0; m < mirrors.size(); m++)
+    {
+        const Mirror& mirror = mirrors[m];
+
+        MirrorView mirror_view;
+        mirror_view.mirror     = m;
+        mirror_view.visible    = false;
+        mirror_view.signature  = 0;
+        mirror_view.first_draw = (unsigned int) p_packet.mirror_draws.size();
+        mirror_view.draw_count = 0;
+
+        glm::vec3 normal = glm::normalize(mirror.normal);
+        glm::vec3 up     = glm::normalize(mirror.up - normal * glm::dot(mirror.up, normal));
+        glm::vec3 right  = glm::cross(up, normal);
+
+        mirror_view.model_matrix    = glm::mat4(1.0f);
+        mirror_view.model_matrix[0] = glm::vec4(right * mirror.half_width, 0.0f);
+        mirror_view.model_matrix[1] = glm::vec4(up * mirror.half_height, 0.0f);
+        mirror_view.model_matrix[2] = glm::vec4(normal, 0.0f);
+        mirror_view.model_matrix[3] = glm::vec4(mirror.center, 1.0f);
+
+        glm::vec3 corners[4] = {
+                mirror.center - right * mirror.half_width - up * mirror.half_height,
+                mirror.center + right * mirror.half_width - up * mirror.half_height,
+                mirror.center + right * mirror.half_width + up * mirror.half_height,
+                mirror.center - right * mirror.half_width + up * mirror.half_height,
+        };
+
+        // Seen from behind, or not on screen at all.
+        float radius = std::sqrt(mirror.half_width * mirror.half_width + mirror.half_height * mirror.half_height);
+        if (glm::dot(normal, p_packet.camera_position - mirror.center) <= 0.0f ||
+            !sphere_in_frustum(camera_frustum, mirror.center, radius))
+        {
+            p_packet.mirror_views.push_back(mirror_view);
+            continue;
+        }
+
+        // Screen rectangle of the corners. A corner behind the eye makes the projection meaningless,
+        // the mirror is then close enough to take the whole screen.
+        float min_x = viewport_width, min_y = viewport_height, max_x = 0.0f, max_y = 0.0f;
+        bool  behind_eye = false;
+        for (const glm::vec3& corner : corners)
+        {
+            glm::vec4 clip = view_projection * glm::vec4(corner, 1.0f);
+            if (clip.w <= 1e-4f)
+            {
+                behind_eye = true;
+                break;
+            }
+            float x = (clip.x / clip.w * 0.5f + 0.5f) * viewport_width;
+            float y = (clip.y / clip.w * 0.5f + 0.5f) * viewport_height;
+            min_x   = std::min(min_x, x);
+            min_y   = std::min(min_y, y);
+            max_x   = std::max(max_x, x);
+            max_y   = std::max(max_y, y);
+        }
+        if (behind_eye)
+        {
+            min_x = 0.0f;
+            min_y = 0.0f;
+            max_x = viewport_width;
+            max_y = viewport_height;
+        }
+        min_x = std::max(min_x, 0.0f);
+        min_y = std::max(min_y, 0.0f);
+        max_x = std::min(max_x, viewport_width);
+        max_y = std::min(max_y, viewport_height);
+        if (max_x <= min_x || max_y <= min_y || (max_x - min_x) * (max_y - min_y) < min_screen_pixels)
+        {
+            p_packet.mirror_views.push_back(mirror_view);
+            continue;
+        }
+        mirror_view.visible = true;
+
+        float scale               = std::clamp(mirror.resolution_scale, MIRROR_MIN_RESOLUTION_SCALE, 1.0f);
+        mirror_view.target_width  = std::max((int) std::lround(viewport_width * scale), 1);
+        mirror_view.target_height = std::max((int) std::lround(viewport_height * scale), 1);
+
+        int target_width          = mirror_view.target_width;
+        int target_height         = mirror_view.target_height;
+        int x0                    = std::max((int) std::floor(min_x * scale) - MIRROR_SCISSOR_MARGIN, 0);
+        int y0                    = std::max((int) std::floor(min_y * scale) - MIRROR_SCISSOR_MARGIN, 0);
+        int x1                    = std::min((int) std::ceil(max_x * scale) + MIRROR_SCISSOR_MARGIN, target_width);
+        int y1                    = std::min((int) std::ceil(max_y * scale) + MIRROR_SCISSOR_MARGIN, target_height);
+        mirror_view.scissor[0]    = x0;
+        mirror_view.scissor[1]    = y0;
+        mirror_view.scissor[2]    = x1 - x0;
+        mirror_view.scissor[3]    = y1 - y0;
+
+        glm::vec4 plane(normal, -glm::dot(normal, mirror.center));
+        glm::mat4 reflection   = make_reflection(normal, plane.w);
+        glm::vec3 mirrored_eye = glm::vec3(reflection * glm::vec4(p_packet.camera_position, 1.0f));
+        mirror_view.view       = p_packet.view * reflection;
+        glm::vec4 view_plane   = glm::transpose(glm::inverse(mirror_view.view)) * plane;
+        mirror_view.projection = make_oblique_projection(p_packet.projection, view_plane);
+        Frustum mirror_frustum = make_mirror_frustum(mirrored_eye, corners, plane, far_distance);
+
+        // Same walk as submit_renderables, against the mirror's frustum instead of the camera's.
+        const Entity*              entities    = p_registry.renderables.entities();
+        const RenderableComponent* renderables = p_registry.renderables.components();
+        for (std::size_t i = 0; i < p_registry.renderables.size(); i++)
+        {
+            Entity entity = entities[i];
+            if (!p_registry.transforms.has(entity))
+            {
+                continue;
+            }
+            if (p_registry.visibility.has(entity) && !p_registry.visibility.get(entity).enabled)
+            {
+                continue;
+            }
+            if (p_registry.bounds.has(entity))
+            {
+                const BoundsComponent& bounds = p_registry.bounds.get(entity);
+                if (!sphere_in_frustum(mirror_frustum, bounds.world_center, bounds.world_radius))
+                {
+                    continue;
+                }
+            }
+
+            const RenderableComponent& renderable = renderables[i];
+            const glm::mat4& world = p_registry.scene_graph.get_world_matrix(p_registry.transforms.get(entity).node);
+
+            if (mirror_view.draw_count > 0)
+            {
+                DrawCommand& last = p_packet.mirror_draws.back();
+                if (last.vao == renderable.vao && last.vertices_count == renderable.vertices_count &&
+                    last.texture_id == renderable.texture_id && last.texture_target == renderable.texture_target &&
+                    last.texture_slot == renderable.texture_slot)
+                {
+                    last.instance_count++;
+                    p_packet.instance_transforms.push_back(world);
+                    continue;
+                }
+            }
+
+            DrawCommand draw;
+            draw.vao            = renderable.vao;
+            draw.vertices_count = renderable.vertices_count;
+            draw.texture_id     = renderable.texture_id;
+            draw.texture_target = renderable.texture_target;
+            draw.texture_slot   = renderable.texture_slot;
+            draw.first_instance = (unsigned int) p_packet.instance_transforms.size();
+            draw.instance_count = 1;
+            p_packet.mirror_draws.push_back(draw);
+            p_packet.instance_transforms.push_back(world);
+            mirror_view.draw_count++;
+        }
+
+        // Everything that ends up in the target. A still camera over a still scene keeps the signature.
+        std::uint64_t signature = SIGNATURE_OFFSET;
+        sign(signature, &mirror_view.view, sizeof(glm::mat4));
+        sign(signature, &mirror_view.projection, sizeof(glm::mat4));
+        sign(signature, &mirror_view.target_width, sizeof(int));
+        sign(signature, &mirror_view.target_height, sizeof(int));
+        sign(signature, mirror_view.scissor, sizeof(mirror_view.scissor));
+        for (unsigned int d = 0; d < mirror_view.draw_count; d++)
+        {
+            const DrawCommand& draw = p_packet.mirror_draws[mirror_view.first_draw + d];
+            sign(signature, &draw.vao, sizeof(draw.vao));
+            sign(signature, &draw.vertices_count, sizeof(draw.vertices_count));
+            sign(signature, &draw.texture_id, sizeof(draw.texture_id));
+            sign(signature, &draw.texture_slot, sizeof(draw.texture_slot));
+            sign(signature, &draw.instance_count, sizeof(draw.instance_count));
+            sign(signature, &p_packet.instance_transforms[draw.first_instance],
+                 sizeof(glm::mat4) * draw.instance_count);
+        }
+        mirror_view.signature = signature;
+
+        p_packet.mirror_views.push_back(mirror_view);
+    }
+}
+
+const std::vector<Mirror>& MirrorSystem::get_mirrors() const
+{
+    return mirrors;
+}
+
+MirrorRenderer::MirrorRenderer()
+{
+    stats = MirrorStats();
+}
+
+MirrorRenderer::~MirrorRenderer()
+{
+    ResourceRegistry& registry = ResourceRegistry::get_instance();
+    for (RenderTarget& target : pool)
+    {
+        registry.untrack(RESOURCE_FRAMEBUFFER, target.framebuffer);
+        registry.untrack(RESOURCE_TEXTURE, target.color_texture);
+        registry.untrack(RESOURCE_RENDERBUFFER, target.depth_renderbuffer);
+
+        glDeleteFramebuffers(1, &target.framebuffer);
+        glDeleteTextures(1, &target.color_texture);
+        glDeleteRenderbuffers(1, &target.depth_renderbuffer);
+    }
+}
+
+int MirrorRenderer::acquire_target(int p_width, int p_height)
+{
+    for (std::size_t i = 0; i < pool.size(); i++)
+    {
+        if (!pool[i].in_use && pool[i].width == p_width && pool[i].height == p_height)
+        {
+            pool[i].in_use = true;
+            return (int) i;
+        }
+    }
+
+    RenderTarget target;
+    target.width  = p_width;
+    target.height = p_height;
+    target.in_use = true;
+
+    glGenFramebuffers(1, &target.framebuffer);
+    glGenTextures(1, &target.color_texture);
+    glGenRenderbuffers(1, &target.depth_renderbuffer);
+
+    glBindTexture(GL_TEXTURE_2D, target.color_texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, p_width, p_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glBindRenderbuffer(GL_RENDERBUFFER, target.depth_renderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, p_width, p_height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.color_texture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER,
+                              target.depth_renderbuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "ERROR::MIRROR::FRAMEBUFFER_INCOMPLETE" << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    ResourceRegistry& registry = ResourceRegistry::get_instance();
+    registry.track(RESOURCE_FRAMEBUFFER, target.framebuffer, 0, "mirrors");
+    registry.track(RESOURCE_TEXTURE, target.color_texture, get_texture_bytes(p_width, p_height, 4, false),
+                   "mirrors");
+    registry.track(RESOURCE_RENDERBUFFER, target.depth_renderbuffer, (std::size_t) p_width * p_height * 4,
+                   "mirrors");
+
+    pool.push_back(target);
+    return (int) pool.size() - 1;
+}
+
+void MirrorRenderer::release_target(MirrorState& p_state)
+{
+    if (p_state.target >= 0)
+    {
+        pool[p_state.target].in_use = false;
+    }
+    p_state.target = -1;
+    p_state.valid  = false;
+}
+
+void MirrorRenderer::update(const FramePacket& p_packet, const MirrorSceneDrawer& p_draw_scene)
+{
+    stats              = MirrorStats();
+    stats.mirror_count = (unsigned int) p_packet.mirror_views.size();
+
+    // Hidden mirrors go first, so their targets are free for the visible ones below.
+    for (const MirrorView& mirror_view : p_packet.mirror_views)
+    {
+        if (mirror_view.mirror >= states.size())
+        {
+            states.resize(mirror_view.mirror + 1, MirrorState{-1, 0, false});
+        }
+
+        MirrorState& state = states[mirror_view.mirror];
+        if (!mirror_view.visible)
+        {
+            release_target(state);
+            stats.skipped++;
+        }
+        else if (state.target >= 0 && (pool[state.target].width != mirror_view.target_width ||
+                                       pool[state.target].height != mirror_view.target_height))
+        {
+            release_target(state);
+        }
+    }
+
+    for (const MirrorView& mirror_view : p_packet.mirror_views)
+    {
+        if (!mirror_view.visible)
+        {
+            continue;
+        }
+
+        MirrorState& state = states[mirror_view.mirror];
+        if (state.target < 0)
+        {
+            state.target = acquire_target(mirror_view.target_width, mirror_view.target_height);
+            state.valid  = false;
+        }
+        if (state.valid && state.signature == mirror_view.signature)
+        {
+            stats.reused++;
+            continue;
+        }
+
+        // Only the part of the target the mirror covers is ever sampled.
+        const RenderTarget& target = pool[state.target];
+        glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+        glViewport(0, 0, target.width, target.height);
+        glEnable(GL_SCISSOR_TEST);
+        glScissor(mirror_view.scissor[0], mirror_view.scissor[1], mirror_view.scissor[2], mirror_view.scissor[3]);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        p_draw_scene(mirror_view);
+        glDisable(GL_SCISSOR_TEST);
+
+        state.signature = mirror_view.signature;
+        state.valid     = true;
+        stats.rendered++;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    for (const RenderTarget& target : pool)
+    {
+        stats.pool_bytes += get_texture_bytes(target.width, target.height, 4, false) +
+                            (std::size_t) target.width * target.height * 4;
+    }
+    stats.pool_targets = (unsigned int) pool.size();
+}
+
+void MirrorRenderer::draw(const FramePacket& p_packet, Shader& p_shader, const glm::mat4& p_view)
+{
+    p_shader.use();
+    p_shader.setInt("screen_texture", 0);
+    p_shader.setMat4("view", p_view);
+    p_shader.setMat4("projection", p_packet.projection);
+    glActiveTexture(GL_TEXTURE0);
+
+    for (const MirrorView& mirror_view : p_packet.mirror_views)
+    {
+        if (!mirror_view.visible || states[mirror_view.mirror].target < 0)
+        {
+            continue;
+        }
+
+        // The target holds the reflection as seen from the packet's camera, so it is looked up with
+        // the reflected matrices rather than the quad's own texture coordinates.
+        p_shader.setMat4("model", mirror_view.model_matrix);
+        p_shader.setMat4("reflection_view_projection", p_packet.projection * mirror_view.view);
+        glBindTexture(GL_TEXTURE_2D, pool[states[mirror_view.mirror].target].color_texture);
+        quad.draw();
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+MirrorStats MirrorRenderer::get_stats() const
+{
+    return stats;
+}
@@ -1,39 +1,521 @@
 #include "learn_opengl/model.hpp"
+#include "learn_opengl/animation.hpp"
+#include "learn_opengl/file_system.hpp"
+#include "learn_opengl/frustum.hpp"
+#include "learn_opengl/job_system.hpp"
+#include "learn_opengl/material.hpp"
 #include "learn_opengl/mesh.hpp"
+#include "learn_opengl/meshlet.hpp"
+#include "learn_opengl/resource_registry.hpp"
+#include "learn_opengl/scene_graph.hpp"
 #include "learn_opengl/shader.hpp"
+#include "learn_opengl/simd_math.hpp"
+#include "learn_opengl/virtual_texture.hpp"
 #include "stb_image.h"
 #include <assimp/types.h>
 #include <assimp/scene.h>
 #include <assimp/mesh.h>
 #include <assimp/material.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <cstring>
+#include <functional>
 #include <glm/ext/vector_float3.hpp>
 #include <glm/ext/vector_float2.hpp>
 #include <assimp/Importer.hpp>
+#include <assimp/IOStream.hpp>
+#include <assimp/IOSystem.hpp>
 #include <assimp/postprocess.h>
 #include <iostream>
 #include <string>
+#include <utility>
 #include <vector>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
-Model::Model(const char* path)
+// Lets Assimp read the model and the files it references (.mtl etc.) through the virtual file system.
+class VfsIOStream : public Assimp::IOStream
 {
+  public:
+    explicit VfsIOStream(FileView p_file) : file(std::move(p_file)), position(0)
+    {
+    }
+
+    std::size_t Read(void* p_buffer, std::size_t p_size, std::size_t p_count) override
+    {
+        if (p_size == 0)
+        {
+            return 0;
+        }
+
+        std::size_t count = std::min(p_count, (file.size() - position) / p_size);
+        std::memcpy(p_buffer, file.data() + position, count * p_size);
+        position += count * p_size;
+
+        return count;
+    }
+
+    std::size_t Write(const void*, std::size_t, std::size_t) override
+    {
+        return 0;
+    }
+
+    aiReturn Seek(std::size_t p_offset, aiOrigin p_origin) override
+    {
+        std::size_t target = p_offset;
+        if (p_origin == aiOrigin_CUR)
+        {
+            target = position + p_offset;
+        }
+        else if (p_origin == aiOrigin_END)
+        {
+            target = file.size() - p_offset;
+        }
+
+        if (target > file.size())
+        {
+            return aiReturn_FAILURE;
+        }
+
+        position = target;
+        return aiReturn_SUCCESS;
+    }
+
+    std::size_t Tell() const override
+    {
+        return position;
+    }
+
+    std::size_t FileSize() const override
+    {
+        return file.size();
+    }
+
+    void Flush() override
+    {
+    }
+
+  private:
+    FileView    file;
+    std::size_t position;
+};
+
+class VfsIOSystem : public Assimp::IOSystem
+{
+  public:
+    bool Exists(const char* p_file) const override
+    {
+        return FileSystem::get_instance().exists(p_file);
+    }
+
+    char getOsSeparator() const override
+    {
+        return '/';
+    }
+
+    Assimp::IOStream* Open(const char* p_file, const char* p_mode) override
+    {
+        if (std::strchr(p_mode, 'w') || std::strchr(p_mode, 'a'))
+        {
+            return nullptr;
+        }
+
+        FileView file = FileSystem::get_instance().read_file(p_file);
+        return file.is_valid() ? new VfsIOStream(std::move(file)) : nullptr;
+    }
+
+    void Close(Assimp::IOStream* p_stream) override
+    {
+        delete p_stream;
+    }
+};
+
+// Assimp matrices are row-major, glm is column-major.
+static glm::mat4 to_glm(const aiMatrix4x4& t)
+{
+    return glm::mat4(t.a1, t.b1, t.c1, t.d1, t.a2, t.b2, t.c2, t.d2, t.a3, t.b3, t.c3, t.d3, t.a4, t.b4, t.c4, t.d4);
+}
+
+static_assert(sizeof(Vertex) == 8 * sizeof(float), "convert_vertices writes a Vertex as two 4-float stores");
+
+// Vertices [p_begin, p_end) of p_mesh into p_out, missing normals and texture coordinates as zeros.
+static void convert_vertices(const aiMesh* p_mesh, unsigned int p_begin, unsigned int p_end, Vertex* p_out)
+{
+    const aiVector3D* positions  = p_mesh->mVertices;
+    const aiVector3D* normals    = p_mesh->mNormals;
+    const aiVector3D* tex_coords = p_mesh->mTextureCoords[0];
+    unsigned int      i          = p_begin;
+
+#if defined(LEARN_OPENGL_SSE) && !defined(ASSIMP_DOUBLE_PRECISION)
+    // Each 4-float load also reads the next vertex's x, so the mesh's last vertex is left to the loop below.
+    unsigned int simd_end = std::min(p_end, p_mesh->mNumVertices - 1);
+    for (; i < simd_end; i++)
+    {
+        __m128 position  = _mm_loadu_ps(&positions[i].x);
+        __m128 normal    = normals ? _mm_loadu_ps(&normals[i].x) : _mm_setzero_ps();
+        __m128 tex_coord = tex_coords ? _mm_loadu_ps(&tex_coords[i].x) : _mm_setzero_ps();
+
+        // {px py pz nx} {ny nz u v}
+        __m128 z_and_nx = _mm_shuffle_ps(position, normal, _MM_SHUFFLE(0, 0, 2, 2));
+        float* out      = &p_out[i].position.x;
+        _mm_storeu_ps(out, _mm_shuffle_ps(position, z_and_nx, _MM_SHUFFLE(2, 0, 1, 0)));
+        _mm_storeu_ps(out + 4, _mm_shuffle_ps(normal, tex_coord, _MM_SHUFFLE(1, 0, 2, 1)));
+    }
+#endif
+
+    for (; i < p_end; i++)
+    {
+        Vertex& vertex    = p_out[i];
+        vertex.position   = glm::vec3(positions[i].x, positions[i].y, positions[i].z);
+        vertex.normal     = normals ? glm::vec3(normals[i].x, normals[i].y, normals[i].z) : glm::vec3(0.0f);
+        vertex.tex_coords = tex_coords ? glm::vec2(tex_coords[i].x, tex_coords[i].y) : glm::vec2(0.0f);
+    }
+}
+
+// Sizes both arrays and fills the indices. Triangulated meshes copy three indices per face.
+static void convert_indices(const aiMesh* p_mesh, MeshData& p_out)
+{
+    std::size_t index_count = 0;
+    for (unsigned int i = 0; i < p_mesh->mNumFaces; i++)
+    {
+        index_count += p_mesh->mFaces[i].mNumIndices;
+    }
+
+    p_out.vertices.resize(p_mesh->mNumVertices);
+    p_out.indices.resize(index_count);
+
+    unsigned int* out = p_out.indices.data();
+    for (unsigned int i = 0; i < p_mesh->mNumFaces; i++)
+    {
+        const aiFace& face = p_mesh->mFaces[i];
+        std::memcpy(out, face.mIndices, face.mNumIndices * sizeof(unsigned int));
+        out += face.mNumIndices;
+    }
+}
+
+void convert_meshes(aiMesh* const* p_scene_meshes, std::vector<MeshData>& p_meshes, JobSystem* p_jobs)
+{
+    auto for_range = [p_jobs](std::size_t p_count, const std::function<void(std::size_t, std::size_t)>& p_body)
+    {
+        if (p_jobs)
+        {
+            p_jobs->parallel_for(0, p_count, 1, p_body);
+        }
+        else
+        {
+            p_body(0, p_count);
+        }
+    };
+
+    // Every array is sized before any vertex job starts, so the jobs only ever write.
+    for_range(p_meshes.size(),
+              [p_scene_meshes, &p_meshes](std::size_t p_begin, std::size_t p_end)
+              {
+                  for (std::size_t m = p_begin; m < p_end; m++)
+                  {
+                      convert_indices(p_scene_meshes[p_meshes[m].source_mesh], p_meshes[m]);
+                  }
+              });
+
+    struct VertexChunk
+    {
+        unsigned int mesh;
+        unsigned int begin;
+        unsigned int end;
+    };
+
+    std::vector<VertexChunk> chunks;
+    for (unsigned int m = 0; m < p_meshes.size(); m++)
+    {
+        unsigned int vertex_count = p_scene_meshes[p_meshes[m].source_mesh]->mNumVertices;
+        for (unsigned int begin = 0; begin < vertex_count; begin += MESH_IMPORT_VERTEX_GRAIN)
+        {
+            chunks.push_back({m, begin, std::min(begin + MESH_IMPORT_VERTEX_GRAIN, vertex_count)});
+        }
+    }
+
+    for_range(chunks.size(),
+              [p_scene_meshes, &p_meshes, &chunks](std::size_t p_begin, std::size_t p_end)
+              {
+                  for (std::size_t c = p_begin; c < p_end; c++)
+                  {
+                      MeshData& data = p_meshes[chunks[c].mesh];
+                      convert_vertices(p_scene_meshes[data.source_mesh], chunks[c].begin, chunks[c].end,
+                                       data.vertices.data());
+                  }
+              });
+}
+
+Model::Model(const char* path, bool p_gpu_only, VirtualTextureSystem* p_virtual_textures)
+{
+    gpu_only         = p_gpu_only;
+    virtual_textures = p_virtual_textures;
+    import_stats     = ModelImportStats();
     load_model(path);
 }
 
-void Model::draw(Shader& shader)
+void Model::draw(Shader& shader, const glm::mat4& p_model_matrix)
 {
-    for (unsigned int i = 0; i < meshes.size(); i++)
+    nodes.update_world_transforms();
+    begin_draw(shader);
+
+    // Looked up once, the per-mesh path does no string work.
+    int model_location = glGetUniformLocation(shader.ID, "model");
+    for (unsigned int i : draw_order)
+    {
+        glm::mat4 model_matrix;
+        mat4_multiply(p_model_matrix, nodes.get_world_matrix(mesh_nodes[i]), model_matrix);
+        glUniformMatrix4fv(model_location, 1, GL_FALSE, &model_matrix[0][0]);
+
+        bind_material(shader, meshes[i].material);
+        meshes[i].draw();
+    }
+}
+
+unsigned int Model::draw_instances(Shader& shader, const std::vector<glm::mat4>& p_instances, const Frustum& p_frustum)
+{
+    nodes.update_world_transforms();
+    begin_draw(shader);
+
+    int          model_location = glGetUniformLocation(shader.ID, "model");
+    unsigned int draws          = 0;
+    for (unsigned int i : draw_order)
+    {
+        const glm::mat4& mesh_matrix = nodes.get_world_matrix(mesh_nodes[i]);
+        for (const glm::mat4& instance : p_instances)
+        {
+            glm::mat4 model_matrix;
+            mat4_multiply(instance, mesh_matrix, model_matrix);
+
+            glm::vec3 center;
+            float     radius;
+            get_bounding_sphere(model_matrix, meshes[i].bounds_min, meshes[i].bounds_max, center, radius);
+            if (!sphere_in_frustum(p_frustum, center, radius))
+            {
+                continue;
+            }
+
+            glUniformMatrix4fv(model_location, 1, GL_FALSE, &model_matrix[0][0]);
+            bind_material(shader, meshes[i].material);
+            meshes[i].draw();
+            draws++;
+        }
+    }
+
+    return draws;
+}
+
+unsigned int Model::draw_meshlets(Shader& shader, const std::vector<glm::mat4>& p_instances, const Frustum& p_frustum,
+                                  const glm::vec3& p_camera_position)
+{
+    nodes.update_world_transforms();
+    begin_draw(shader);
+    meshlet_stats = MeshletCullStats();
+
+    int model_location = glGetUniformLocation(shader.ID, "model");
+    for (unsigned int i : draw_order)
+    {
+        const glm::mat4& mesh_matrix = nodes.get_world_matrix(mesh_nodes[i]);
+        for (const glm::mat4& instance : p_instances)
+        {
+            glm::mat4 model_matrix;
+            mat4_multiply(instance, mesh_matrix, model_matrix);
+
+            glm::vec3 center;
+            float     radius;
+            get_bounding_sphere(model_matrix, meshes[i].bounds_min, meshes[i].bounds_max, center, radius);
+            if (!sphere_in_frustum(p_frustum, center, radius))
+            {
+                continue;
+            }
+
+            meshlet_stats.mesh_triangles += meshes[i].get_index_count() / 3;
+            meshlet_draws.counts.clear();
+            meshlet_draws.offsets.clear();
+            cull_meshlets(meshes[i].meshlets, model_matrix, p_frustum, p_camera_position, meshlet_draws,
+                          meshlet_stats);
+            if (meshlet_draws.counts.empty())
+            {
+                continue;
+            }
+
+            glUniformMatrix4fv(model_location, 1, GL_FALSE, &model_matrix[0][0]);
+            bind_material(shader, meshes[i].material);
+            meshes[i].draw_ranges(meshlet_draws);
+            meshlet_stats.draw_calls++;
+        }
+    }
+
+    return meshlet_stats.draw_calls;
+}
+
+unsigned int Model::draw_animated(Shader& shader, const std::vector<glm::mat4>& p_instances, const Frustum& p_frustum,
+                                  const AnimationPlayer& p_player, const BonePalette* p_palette)
+{
+    nodes.update_world_transforms();
+    begin_draw(shader);
+    if (p_palette)
+    {
+        p_palette->bind(shader);
+    }
+
+    int          model_location       = glGetUniformLocation(shader.ID, "model");
+    int          bone_offset_location = glGetUniformLocation(shader.ID, "bone_offset");
+    unsigned int bone_count           = p_player.get_bone_count();
+    std::size_t  instance_count       = std::min(p_instances.size(), (std::size_t) p_player.get_instance_count());
+    unsigned int draws                = 0;
+    for (unsigned int i : draw_order)
+    {
+        Mesh&            mesh        = meshes[i];
+        const glm::mat4& mesh_matrix = nodes.get_world_matrix(mesh_nodes[i]);
+        bool             skinned     = mesh.is_skinned();
+
+        // Skinned vertices can leave the bind pose bounds, the sphere is grown around their center.
+        float     scale    = skinned ? SKINNED_BOUNDS_SCALE : 1.0f;
+        glm::vec3 center   = (mesh.bounds_min + mesh.bounds_max) * 0.5f;
+        glm::vec3 extent   = (mesh.bounds_max - mesh.bounds_min) * (0.5f * scale);
+        glm::vec3 cull_min = center - extent;
+        glm::vec3 cull_max = center + extent;
+        for (std::size_t n = 0; n < instance_count; n++)
+        {
+            glm::mat4 model_matrix;
+            mat4_multiply(p_instances[n], mesh_matrix, model_matrix);
+
+            glm::vec3 sphere_center;
+            float     radius;
+            get_bounding_sphere(model_matrix, cull_min, cull_max, sphere_center, radius);
+            if (!sphere_in_frustum(p_frustum, sphere_center, radius))
+            {
+                continue;
+            }
+
+            const glm::mat4& placement = skinned ? p_instances[n] : model_matrix;
+            glUniformMatrix4fv(model_location, 1, GL_FALSE, &placement[0][0]);
+            bind_material(shader, mesh.material);
+
+            if (skinned && p_palette)
+            {
+                glUniform1i(bone_offset_location, (int) (n * bone_count * BONE_PALETTE_TEXELS));
+                mesh.draw();
+            }
+            else if (skinned && !mesh.skin_weights.empty())
+            {
+                skinned_vertices.resize(mesh.vertices.size());
+                skin_vertices(mesh.vertices.data(), mesh.skin_weights.data(), mesh.vertices.size(),
+                              &p_player.get_palettes()[n * bone_count], skinned_vertices.data());
+                glUniform1i(bone_offset_location, -1);
+                mesh.draw_streamed(skinned_vertices);
+            }
+            else
+            {
+                // Without its CPU geometry a skinned mesh has nothing to skin on this path, it stays in
+                // the bind pose.
+                glUniform1i(bone_offset_location, -1);
+                mesh.draw();
+            }
+            draws++;
+        }
+    }
+
+    return draws;
+}
+
+Model::~Model()
+{
+    for (Mesh& mesh : meshes)
     {
-        meshes[i].draw(shader);
+        mesh.destroy();
+    }
+
+    for (const Texture& texture : textures_loaded)
+    {
+        // Virtual textures belong to the VirtualTextureSystem.
+        if (texture.type == "texture_virtual")
+        {
+            continue;
+        }
+        ResourceRegistry::get_instance().untrack(RESOURCE_TEXTURE, texture.id);
+        glDeleteTextures(1, &texture.id);
     }
 }
 
+void Model::begin_draw(Shader& shader)
+{
+    materials.prepare(shader);
+    materials.reset_bindings();
+}
+
+void Model::bind_material(Shader& shader, unsigned int p_material)
+{
+    if (materials.bind(p_material) && virtual_textures)
+    {
+        virtual_textures->bind(shader, materials.get(p_material).virtual_texture);
+    }
+}
+
+std::size_t Model::get_cpu_geometry_bytes() const
+{
+    std::size_t bytes = 0;
+    for (const Mesh& mesh : meshes)
+    {
+        bytes += mesh.vertices.capacity() * sizeof(Vertex) + mesh.indices.capacity() * sizeof(unsigned int) +
+                 mesh.skin_weights.capacity() * sizeof(SkinWeights);
+    }
+
+    return bytes;
+}
+
+const std::vector<Mesh>& Model::get_meshes() const
+{
+    return meshes;
+}
+
+MaterialTable& Model::get_materials()
+{
+    return materials;
+}
+
+glm::mat4 Model::get_mesh_matrix(unsigned int p_mesh)
+{
+    nodes.update_world_transforms();
+    return nodes.get_world_matrix(mesh_nodes[p_mesh]);
+}
+
+const ModelImportStats& Model::get_import_stats() const
+{
+    return import_stats;
+}
+
+const MeshletCullStats& Model::get_meshlet_stats() const
+{
+    return meshlet_stats;
+}
+
+const Skeleton& Model::get_skeleton() const
+{
+    return skeleton;
+}
+
+const std::vector<AnimationClip>& Model::get_clips() const
+{
+    return clips;
+}
+
+bool Model::is_animated() const
+{
+    return !skeleton.bone_joints.empty() && !clips.empty();
+}
+
 void Model::load_model(std::string path)
 {
     Assimp::Importer import;
-    const aiScene*   scene = import.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
+    import.SetIOHandler(new VfsIOSystem()); // The importer owns and deletes it
+    // At most four bones per vertex, which is what SkinWeights holds.
+    const aiScene* scene =
+            import.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_LimitBoneWeights);
 
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
     {
@@ -42,81 +524,304 @@ void Model::load_model(std::string path)
     }
 
     directory = path.substr(0, path.find_last_of('/'));
-    process_node(scene->mRootNode, scene);
+    scene_materials.assign(scene->mNumMaterials, MATERIAL_NONE);
+
+    std::vector<MeshData> mesh_data;
+    mesh_data.reserve(scene->mNumMeshes);
+    process_node(scene->mRootNode, SCENE_NODE_NONE, mesh_data);
+
+    // Geometry on every core, then textures and buffers in node order on this (the GL) thread.
+    JobSystem& jobs  = JobSystem::get_instance();
+    auto       start = std::chrono::steady_clock::now();
+    convert_meshes(scene->mMeshes, mesh_data, &jobs);
+    auto converted = std::chrono::steady_clock::now();
+
+    // Reorders the indices, so before anything is uploaded.
+    jobs.parallel_for(0, mesh_data.size(), 1,
+                      [&mesh_data](std::size_t p_begin, std::size_t p_end)
+                      {
+                          for (std::size_t m = p_begin; m < p_end; m++)
+                          {
+                              build_meshlets(mesh_data[m].vertices.data(), mesh_data[m].indices,
+                                             mesh_data[m].meshlets);
+                          }
+                      });
+    auto clustered = std::chrono::steady_clock::now();
+
+    // Buffers created while importing are charged to this model.
+    ResourceOwnerScope owner(path);
+    meshes.reserve(mesh_data.size());
+    mesh_nodes.reserve(mesh_data.size());
+    for (MeshData& data : mesh_data)
+    {
+        import_stats.vertex_count += data.vertices.size();
+        import_stats.meshlet_count += data.meshlets.size();
+        meshes.emplace_back(process_mesh(data, scene));
+        mesh_nodes.push_back(data.node);
+    }
+
+    materials.upload();
+    load_animations(scene);
+
+    draw_order.resize(meshes.size());
+    for (unsigned int i = 0; i < meshes.size(); i++)
+    {
+        draw_order[i] = i;
+    }
+    std::stable_sort(draw_order.begin(), draw_order.end(),
+                     [this](unsigned int a, unsigned int b) { return meshes[a].material < meshes[b].material; });
+
+    import_stats.mesh_count = (unsigned int) meshes.size();
+    import_stats.threads    = jobs.get_worker_count() + 1;
+    import_stats.convert_milliseconds = std::chrono::duration<double, std::milli>(converted - start).count();
+    import_stats.meshlet_milliseconds = std::chrono::duration<double, std::milli>(clustered - converted).count();
+    import_stats.upload_milliseconds =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - clustered).count();
 }
 
-void Model::process_node(aiNode* node, const aiScene* scene)
+void Model::process_node(aiNode* node, unsigned int parent_node, std::vector<MeshData>& p_meshes)
 {
+    glm::mat4    local_matrix = to_glm(node->mTransformation);
+    unsigned int scene_node   = nodes.add_node(parent_node, local_matrix);
+
+    // Every node is a joint, bones and channels find theirs by name.
+    joint_names.emplace(node->mName.C_Str(), scene_node);
+    skeleton.parents.push_back(parent_node == SCENE_NODE_NONE ? -1 : (int) parent_node);
+    skeleton.bind_locals.push_back(local_matrix);
+
     for (unsigned int i = 0; i < node->mNumMeshes; i++)
     {
-        aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-        meshes.push_back(process_mesh(mesh, scene));
+        MeshData data;
+        data.source_mesh = node->mMeshes[i];
+        data.node        = scene_node;
+        p_meshes.push_back(std::move(data));
     }
 
     for (unsigned int i = 0; i < node->mNumChildren; i++)
     {
-        process_node(node->mChildren[i], scene);
+        process_node(node->mChildren[i], scene_node, p_meshes);
     }
 }
 
-Mesh Model::process_mesh(aiMesh* mesh, const aiScene* scene)
+Mesh Model::process_mesh(MeshData& p_data, const aiScene* scene)
 {
-    std::vector<Vertex>       vertices;
-    std::vector<unsigned int> indices;
-    std::vector<Texture>      textures;
+    const aiMesh* mesh     = scene->mMeshes[p_data.source_mesh];
+    unsigned int  material = load_material(scene, mesh->mMaterialIndex);
 
-    for (unsigned int i = 0; i < mesh->mNumVertices; i++)
+    Mesh result(std::move(p_data.vertices), std::move(p_data.indices), material, gpu_only);
+    result.meshlets = std::move(p_data.meshlets);
+    result.set_skin_weights(load_bones(mesh, p_data.node));
+    return result;
+}
+
+std::vector<SkinWeights> Model::load_bones(const aiMesh* mesh, unsigned int p_mesh_node)
+{
+    std::vector<SkinWeights> result;
+    if (mesh->mNumBones == 0)
     {
-        Vertex vertex;
+        return result;
+    }
 
-        glm::vec3 vector;
-        vector.x = mesh->mVertices[i].x;
-        vector.y = mesh->mVertices[i].y;
-        vector.z = mesh->mVertices[i].z;
-        vertex.position = vector;
+    struct Influences
+    {
+        unsigned int bones[MAX_BONE_INFLUENCES];
+        float        weights[MAX_BONE_INFLUENCES];
+    };
 
-        vector.x = mesh->mNormals[i].x;
-        vector.y = mesh->mNormals[i].y;
-        vector.z = mesh->mNormals[i].z;
-        vertex.normal = vector;
+    // Past four, an influence replaces the weakest one when it is stronger.
+    std::vector<Influences> influences(mesh->mNumVertices, Influences());
+    for (unsigned int b = 0; b < mesh->mNumBones; b++)
+    {
+        const aiBone* bone  = mesh->mBones[b];
+        auto          joint = joint_names.find(bone->mName.C_Str());
+        if (joint == joint_names.end())
+        {
+            std::cout << "ERROR::MODEL::UNKNOWN_BONE\n" << bone->mName.C_Str() << std::endl;
+            continue;
+        }
 
-        if (mesh->mTextureCoords[0])
+        unsigned int index = add_bone(joint->second, to_glm(bone->mOffsetMatrix));
+        if (index == MAX_SKELETON_BONES)
         {
-            glm::vec2 vector2;
-            vector2.x = mesh->mTextureCoords[0][i].x;
-            vector2.y = mesh->mTextureCoords[0][i].y;
-            vertex.tex_coords = vector2;
+            std::cout << "ERROR::MODEL::TOO_MANY_BONES\n" << mesh->mName.C_Str() << std::endl;
+            return result;
         }
-        else
+
+        for (unsigned int w = 0; w < bone->mNumWeights; w++)
         {
-            vertex.tex_coords = glm::vec2(0.0f, 0.0f);
+            Influences& vertex  = influences[bone->mWeights[w].mVertexId];
+            float*      weakest = std::min_element(vertex.weights, vertex.weights + MAX_BONE_INFLUENCES);
+            if (bone->mWeights[w].mWeight > *weakest)
+            {
+                *weakest                               = (float) bone->mWeights[w].mWeight;
+                vertex.bones[weakest - vertex.weights] = index;
+            }
         }
+    }
 
-        vertices.push_back(vertex);
+    // Vertices no bone holds follow the mesh's node, as an unskinned mesh would.
+    unsigned int node_bone = add_bone(p_mesh_node, glm::mat4(1.0f));
+    if (node_bone == MAX_SKELETON_BONES)
+    {
+        std::cout << "ERROR::MODEL::TOO_MANY_BONES\n" << mesh->mName.C_Str() << std::endl;
+        return result;
     }
 
-    for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+    result.resize(mesh->mNumVertices);
+    for (unsigned int v = 0; v < mesh->mNumVertices; v++)
     {
-        aiFace face = mesh->mFaces[i];
-        for (unsigned int j = 0; j < face.mNumIndices; j++)
+        const Influences& vertex = influences[v];
+        SkinWeights&      out    = result[v];
+        float             total  = 0.0f;
+        for (unsigned int k = 0; k < MAX_BONE_INFLUENCES; k++)
         {
-            indices.push_back(face.mIndices[j]);
+            total += vertex.weights[k];
         }
+
+        if (total <= 0.0f)
+        {
+            out            = SkinWeights();
+            out.bones[0]   = (std::uint8_t) node_bone;
+            out.weights[0] = 255;
+            continue;
+        }
+
+        // Renormalized over the four kept, the rounding error goes to the strongest so they sum to 255.
+        int sum       = 0;
+        int strongest = 0;
+        for (unsigned int k = 0; k < MAX_BONE_INFLUENCES; k++)
+        {
+            int weight     = (int) std::lround(vertex.weights[k] / total * 255.0f);
+            out.bones[k]   = (std::uint8_t) vertex.bones[k];
+            out.weights[k] = (std::uint8_t) weight;
+            sum += weight;
+            strongest = vertex.weights[k] > vertex.weights[strongest] ? (int) k : strongest;
+        }
+        out.weights[strongest] = (std::uint8_t) (out.weights[strongest] + 255 - sum);
     }
 
-    if (mesh->mMaterialIndex >= 0)
+    return result;
+}
+
+unsigned int Model::add_bone(unsigned int p_joint, const glm::mat4& p_offset)
+{
+    // Meshes sharing a skeleton list the same bones, they share the palette entries too.
+    for (unsigned int b = 0; b < skeleton.bone_joints.size(); b++)
     {
-        aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+        if (skeleton.bone_joints[b] == p_joint && skeleton.bone_offsets[b] == p_offset)
+        {
+            return b;
+        }
+    }
 
-        std::vector<Texture> diffuse_maps = load_material_textures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-        textures.insert(textures.end(), diffuse_maps.begin(), diffuse_maps.end());
+    if (skeleton.bone_joints.size() == MAX_SKELETON_BONES)
+    {
+        return MAX_SKELETON_BONES;
+    }
+
+    skeleton.bone_joints.push_back(p_joint);
+    skeleton.bone_offsets.push_back(p_offset);
+    return (unsigned int) skeleton.bone_joints.size() - 1;
+}
+
+void Model::load_animations(const aiScene* scene)
+{
+    for (unsigned int a = 0; a < scene->mNumAnimations; a++)
+    {
+        const aiAnimation* animation        = scene->mAnimations[a];
+        double             ticks_per_second = animation->mTicksPerSecond;
+        if (ticks_per_second <= 0.0)
+        {
+            ticks_per_second = DEFAULT_TICKS_PER_SECOND;
+        }
 
-        std::vector<Texture> specular_maps =
-                load_material_textures(material, aiTextureType_SPECULAR, "texture_specular");
-        textures.insert(textures.end(), specular_maps.begin(), specular_maps.end());
+        AnimationClip clip;
+        clip.name     = animation->mName.C_Str();
+        clip.duration = (float) (animation->mDuration / ticks_per_second);
+
+        for (unsigned int c = 0; c < animation->mNumChannels; c++)
+        {
+            const aiNodeAnim* source = animation->mChannels[c];
+            auto              joint  = joint_names.find(source->mNodeName.C_Str());
+            if (joint == joint_names.end() || source->mNumPositionKeys == 0 || source->mNumRotationKeys == 0 ||
+                source->mNumScalingKeys == 0)
+            {
+                continue;
+            }
+
+            AnimationChannel channel;
+            channel.joint = joint->second;
+            for (unsigned int k = 0; k < source->mNumPositionKeys; k++)
+            {
+                const aiVectorKey& key = source->mPositionKeys[k];
+                channel.position_times.push_back((float) (key.mTime / ticks_per_second));
+                channel.positions.push_back(glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z));
+            }
+            for (unsigned int k = 0; k < source->mNumRotationKeys; k++)
+            {
+                const aiQuatKey& key = source->mRotationKeys[k];
+                channel.rotation_times.push_back((float) (key.mTime / ticks_per_second));
+                channel.rotations.push_back(glm::vec4(key.mValue.x, key.mValue.y, key.mValue.z, key.mValue.w));
+            }
+            for (unsigned int k = 0; k < source->mNumScalingKeys; k++)
+            {
+                const aiVectorKey& key = source->mScalingKeys[k];
+                channel.scale_times.push_back((float) (key.mTime / ticks_per_second));
+                channel.scales.push_back(glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z));
+            }
+            clip.channels.push_back(std::move(channel));
+        }
+
+        clips.push_back(std::move(clip));
+    }
+}
+
+unsigned int Model::load_material(const aiScene* scene, unsigned int p_scene_material)
+{
+    if (scene_materials[p_scene_material] != MATERIAL_NONE)
+    {
+        return scene_materials[p_scene_material];
     }
 
-    return Mesh(vertices, indices, textures);
+    aiMaterial* source = scene->mMaterials[p_scene_material];
+
+    Material material        = Material();
+    material.virtual_texture = VIRTUAL_TEXTURE_NONE;
+
+    // The shaders sample the first map of each kind.
+    std::vector<Texture> diffuse_maps  = load_material_textures(source, aiTextureType_DIFFUSE, "texture_diffuse");
+    std::vector<Texture> specular_maps = load_material_textures(source, aiTextureType_SPECULAR, "texture_specular");
+    if (!diffuse_maps.empty() && diffuse_maps[0].type == "texture_virtual")
+    {
+        material.virtual_texture = diffuse_maps[0].id;
+    }
+    else if (!diffuse_maps.empty())
+    {
+        material.textures[MATERIAL_SAMPLER_DIFFUSE] = diffuse_maps[0].id;
+    }
+    if (!specular_maps.empty())
+    {
+        material.textures[MATERIAL_SAMPLER_SPECULAR] = specular_maps[0].id;
+    }
+
+    // Absent keys leave the defaults: white, opaque, no specular.
+    aiColor3D diffuse(1.0f, 1.0f, 1.0f);
+    aiColor3D specular(0.0f, 0.0f, 0.0f);
+    float     opacity   = 1.0f;
+    float     shininess = 0.0f;
+    source->Get(AI_MATKEY_COLOR_DIFFUSE, diffuse);
+    source->Get(AI_MATKEY_COLOR_SPECULAR, specular);
+    source->Get(AI_MATKEY_OPACITY, opacity);
+    source->Get(AI_MATKEY_SHININESS, shininess);
+
+    MaterialParameters& parameters = material.parameters;
+    parameters.diffuse_color       = glm::vec4(diffuse.r, diffuse.g, diffuse.b, opacity);
+    parameters.specular_color      = glm::vec4(specular.r, specular.g, specular.b, shininess);
+    parameters.has_diffuse_map     = material.textures[MATERIAL_SAMPLER_DIFFUSE] != 0;
+    parameters.has_specular_map    = material.textures[MATERIAL_SAMPLER_SPECULAR] != 0;
+
+    scene_materials[p_scene_material] = materials.add(material);
+    return scene_materials[p_scene_material];
 }
 
 std::vector<Texture> Model::load_material_textures(aiMaterial* mat, aiTextureType type, std::string type_name)
@@ -141,9 +846,20 @@ std::vector<Texture> Model::load_material_textures(aiMaterial* mat, aiTextureTyp
         if (!is_texture_loaded)
         {
             Texture texture;
-            texture.id = texture_from_file(str.C_Str(), directory);
+            texture.id = VIRTUAL_TEXTURE_NONE;
             texture.type = type_name;
             texture.path = str.C_Str();
+            if (virtual_textures && type_name == "texture_diffuse")
+            {
+                texture.id = virtual_textures->add(directory + '/' + str.C_Str());
+                texture.type = "texture_virtual";
+            }
+            // Loaded whole when it could not be cooked or the cache has no page left for it.
+            if (texture.id == VIRTUAL_TEXTURE_NONE)
+            {
+                texture.id = texture_from_file(str.C_Str(), directory);
+                texture.type = type_name;
+            }
 
             textures.push_back(texture);
             textures_loaded.push_back(texture);
@@ -161,8 +877,9 @@ unsigned int Model::texture_from_file(const char* path, const std::string& p_dir
     unsigned int texture_id;
     glGenTextures(1, &texture_id);
 
+    FileView       file = FileSystem::get_instance().read_file(filename);
     int            width, height, nrComponents;
-    unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
+    unsigned char* data = stbi_load_from_memory(file.data(), (int) file.size(), &width, &height, &nrComponents, 0);
     if (data)
     {
         GLenum format = GL_RED;
@@ -183,6 +900,9 @@ unsigned int Model::texture_from_file(const char* path, const std::string& p_dir
         glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
         glGenerateMipmap(GL_TEXTURE_2D);
 
+        ResourceRegistry::get_instance().track(RESOURCE_TEXTURE, texture_id,
+                                               get_texture_bytes(width, height, nrComponents, true), filename);
+
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
@@ -0,0 +1,316 @@
+#include "learn_opengl/resource_registry.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "learn_opengl/memory_stats.hpp"
+
+thread_local std::string tls_current_owner;
+
+static std::uint64_t make_key(ResourceCategory p_category, unsigned int p_gl_name)
+{
+    // GL names are only unique per object type.
+    return ((std::uint64_t) p_category << 32) | p_gl_name;
+}
+
+static std::string escape_json(const std::string& p_text)
+{
+    std::string escaped;
+    for (char c : p_text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            escaped += '\\';
+            escaped += c;
+        }
+        else if ((unsigned char) c < 0x20)
+        {
+            escaped += ' ';
+        }
+        else
+        {
+            escaped += c;
+        }
+    }
+
+    return escaped;
+}
+
+ResourceRegistry& ResourceRegistry::get_instance()
+{
+    static ResourceRegistry instance;
+    return instance;
+}
+
+ResourceRegistry::ResourceRegistry()
+{
+    for (int i = 0; i < RESOURCE_CATEGORY_COUNT; i++)
+    {
+        category_bytes[i] = 0;
+        budgets[i] = 0;
+        budget_warned[i] = false;
+    }
+}
+
+void ResourceRegistry::track(ResourceCategory p_category, unsigned int p_gl_name, std::size_t p_bytes,
+                             const std::string& p_owner)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Re-tracking an existing object (e.g. glBufferData on it again) replaces its size.
+    ResourceRecord& record = records[make_key(p_category, p_gl_name)];
+    category_bytes[p_category] -= record.bytes;
+
+    record.category = p_category;
+    record.gl_name = p_gl_name;
+    record.bytes = p_bytes;
+    record.owner = p_owner;
+    category_bytes[p_category] += p_bytes;
+
+    if (budgets[p_category] != 0 && category_bytes[p_category] > budgets[p_category] && !budget_warned[p_category])
+    {
+        budget_warned[p_category] = true;
+        std::cout << "WARNING::RESOURCES::BUDGET_EXCEEDED\n"
+                  << get_resource_category_name(p_category) << ": " << format_bytes(category_bytes[p_category])
+                  << " of " << format_bytes(budgets[p_category]) << " (last: " << p_owner << ")" << std::endl;
+    }
+}
+
+void ResourceRegistry::track(ResourceCategory p_category, unsigned int p_gl_name, std::size_t p_bytes)
+{
+    track(p_category, p_gl_name, p_bytes, tls_current_owner);
+}
+
+void ResourceRegistry::untrack(ResourceCategory p_category, unsigned int p_gl_name)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = records.find(make_key(p_category, p_gl_name));
+    if (it == records.end())
+    {
+        return;
+    }
+
+    category_bytes[p_category] -= it->second.bytes;
+    records.erase(it);
+}
+
+std::size_t ResourceRegistry::get_total_bytes() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::size_t total = 0;
+    for (int i = 0; i < RESOURCE_CATEGORY_COUNT; i++)
+    {
+        if (i != RESOURCE_CPU_GEOMETRY)
+        {
+            total += category_bytes[i];
+        }
+    }
+
+    return total;
+}
+
+std::size_t ResourceRegistry::get_category_bytes(ResourceCategory p_category) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return category_bytes[p_category];
+}
+
+std::size_t ResourceRegistry::get_owner_bytes(const std::string& p_owner) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::size_t total = 0;
+    for (const auto& [key, record] : records)
+    {
+        if (record.owner == p_owner)
+        {
+            total += record.bytes;
+        }
+    }
+
+    return total;
+}
+
+std::size_t ResourceRegistry::get_resource_count() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return records.size();
+}
+
+void ResourceRegistry::set_budget(ResourceCategory p_category, std::size_t p_bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    budgets[p_category] = p_bytes;
+    budget_warned[p_category] = false;
+}
+
+void ResourceRegistry::print_summary(std::ostream& p_out) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::size_t category_counts[RESOURCE_CATEGORY_COUNT] = {};
+    std::map<std::string, std::size_t> owner_bytes;
+
+    for (const auto& [key, record] : records)
+    {
+        category_counts[record.category]++;
+        owner_bytes[record.owner.empty() ? "<unowned>" : record.owner] += record.bytes;
+    }
+
+    p_out << "---- GPU/CPU resources ----" << std::endl;
+    for (int i = 0; i < RESOURCE_CATEGORY_COUNT; i++)
+    {
+        p_out << std::left << std::setw(16) << get_resource_category_name((ResourceCategory) i) << std::right
+              << std::setw(6) << category_counts[i] << std::setw(14) << format_bytes(category_bytes[i]);
+        if (budgets[i] != 0)
+        {
+            p_out << "  budget " << format_bytes(budgets[i]);
+        }
+        p_out << std::endl;
+    }
+
+    // Largest owners first.
+    std::vector<std::pair<std::string, std::size_t>> owners(owner_bytes.begin(), owner_bytes.end());
+    std::sort(owners.begin(), owners.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+
+    p_out << "by owner:" << std::endl;
+    for (const auto& [owner, bytes] : owners)
+    {
+        p_out << "  " << std::setw(12) << format_bytes(bytes) << "  " << owner << std::endl;
+    }
+}
+
+void ResourceRegistry::print_frame_line(std::ostream& p_out) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    p_out << "resources: " << records.size() << " objects, buffers "
+          << format_bytes(category_bytes[RESOURCE_BUFFER]) << ", textures "
+          << format_bytes(category_bytes[RESOURCE_TEXTURE]) << ", renderbuffers "
+          << format_bytes(category_bytes[RESOURCE_RENDERBUFFER]) << ", cpu geometry "
+          << format_bytes(category_bytes[RESOURCE_CPU_GEOMETRY]) << std::endl;
+}
+
+bool ResourceRegistry::dump_json(const std::string& p_path) const
+{
+    std::ofstream out(p_path);
+    if (!out)
+    {
+        std::cout << "ERROR::RESOURCES::JSON_WRITE_FAILED\n" << p_path << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    out << "{\n  \"categories\": {";
+    for (int i = 0; i < RESOURCE_CATEGORY_COUNT; i++)
+    {
+        out << (i == 0 ? "\n" : ",\n") << "    \"" << get_resource_category_name((ResourceCategory) i)
+            << "\": {\"bytes\": " << category_bytes[i] << ", \"budget\": " << budgets[i] << "}";
+    }
+    out << "\n  },\n  \"resources\": [";
+
+    bool first = true;
+    for (const auto& [key, record] : records)
+    {
+        out << (first ? "\n" : ",\n") << "    {\"category\": \"" << get_resource_category_name(record.category)
+            << "\", \"name\": " << record.gl_name << ", \"bytes\": " << record.bytes << ", \"owner\": \""
+            << escape_json(record.owner) << "\"}";
+        first = false;
+    }
+    out << "\n  ]\n}\n";
+
+    return true;
+}
+
+void ResourceRegistry::report_leaks(std::ostream& p_out) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (records.empty())
+    {
+        return;
+    }
+
+    p_out << "WARNING::RESOURCES::LEAKED_OBJECTS\n" << records.size() << " objects still alive" << std::endl;
+    for (const auto& [key, record] : records)
+    {
+        p_out << "  " << get_resource_category_name(record.category) << " " << record.gl_name << " "
+              << format_bytes(record.bytes) << " " << record.owner << std::endl;
+    }
+}
+
+void ResourceRegistry::set_current_owner(const std::string& p_owner)
+{
+    tls_current_owner = p_owner;
+}
+
+std::string ResourceRegistry::get_current_owner()
+{
+    return tls_current_owner;
+}
+
+ResourceOwnerScope::ResourceOwnerScope(const std::string& p_owner)
+{
+    previous_owner = ResourceRegistry::get_current_owner();
+    ResourceRegistry::set_current_owner(p_owner);
+}
+
+ResourceOwnerScope::~ResourceOwnerScope()
+{
+    ResourceRegistry::set_current_owner(previous_owner);
+}
+
+const char* get_resource_category_name(ResourceCategory p_category)
+{
+    switch (p_category)
+    {
+    case RESOURCE_BUFFER:
+        return "buffer";
+    case RESOURCE_TEXTURE:
+        return "texture";
+    case RESOURCE_RENDERBUFFER:
+        return "renderbuffer";
+    case RESOURCE_FRAMEBUFFER:
+        return "framebuffer";
+    case RESOURCE_VERTEX_ARRAY:
+        return "vertex_array";
+    case RESOURCE_CPU_GEOMETRY:
+        return "cpu_geometry";
+    default:
+        return "unknown";
+    }
+}
+
+std::size_t get_texture_bytes(int p_width, int p_height, int p_channels, bool p_mipmapped)
+{
+    std::size_t bytes_per_texel = p_channels == 3 ? 4 : (std::size_t) p_channels;
+    std::size_t bytes = 0;
+
+    int width = p_width;
+    int height = p_height;
+    while (true)
+    {
+        bytes += (std::size_t) width * (std::size_t) height * bytes_per_texel;
+        if (!p_mipmapped || (width == 1 && height == 1))
+        {
+            break;
+        }
+
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+
+    return bytes;
+}
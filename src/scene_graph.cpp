@@ -0,0 +1,240 @@
+#include "learn_opengl/scene_graph.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "glm/ext/matrix_float3x3.hpp"
+#include "glm/ext/matrix_float4x4.hpp"
+#include "glm/ext/vector_float3.hpp"
+#include "glm/geometric.hpp"
+#include "glm/gtc/quaternion.hpp"
+#include "learn_opengl/simd_math.hpp"
+
+SceneGraph::SceneGraph()
+{
+    update_pass = 0;
+}
+
+unsigned int SceneGraph::add_node(unsigned int p_parent, const glm::vec3& p_position, const glm::quat& p_rotation,
+                                  const glm::vec3& p_scale)
+{
+    unsigned int node = (unsigned int) parent.size();
+
+    parent.push_back(p_parent);
+    first_child.push_back(SCENE_NODE_NONE);
+    next_sibling.push_back(SCENE_NODE_NONE);
+
+    if (p_parent != SCENE_NODE_NONE)
+    {
+        next_sibling[node] = first_child[p_parent];
+        first_child[p_parent] = node;
+    }
+
+    local_position.push_back(p_position);
+    local_rotation.push_back(p_rotation);
+    local_scale.push_back(p_scale);
+    local_matrix.push_back(glm::mat4(1.0f));
+    world_matrix.push_back(glm::mat4(1.0f));
+    local_dirty.push_back(0);
+    updated_in_pass.push_back(0);
+
+    mark_dirty(node);
+    return node;
+}
+
+unsigned int SceneGraph::add_node(unsigned int p_parent, const glm::mat4& p_local_matrix)
+{
+    // Imported transforms are plain TRS, so split the matrix back up (shear is not supported).
+    glm::vec3 position = glm::vec3(p_local_matrix[3]);
+    glm::vec3 scale = glm::vec3(glm::length(glm::vec3(p_local_matrix[0])), glm::length(glm::vec3(p_local_matrix[1])),
+                                glm::length(glm::vec3(p_local_matrix[2])));
+
+    // A collapsed axis keeps scale 0 and gets a direction perpendicular to the others, so nothing divides
+    // by zero and the rebuilt matrix still collapses it.
+    glm::mat3 rotation_matrix(1.0f);
+    bool      has_axis[3];
+    int       axis_count = 0;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        has_axis[axis] = scale[axis] != 0.0f;
+        if (has_axis[axis])
+        {
+            rotation_matrix[axis] = glm::vec3(p_local_matrix[axis]) / scale[axis];
+            axis_count++;
+        }
+    }
+
+    if (axis_count == 1)
+    {
+        int       axis   = has_axis[0] ? 0 : (has_axis[1] ? 1 : 2);
+        glm::vec3 kept   = rotation_matrix[axis];
+        glm::vec3 helper = std::abs(kept.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        rotation_matrix[(axis + 1) % 3] = glm::normalize(glm::cross(kept, helper));
+        has_axis[(axis + 1) % 3]        = true;
+        axis_count++;
+    }
+    if (axis_count == 2)
+    {
+        int axis = !has_axis[0] ? 0 : (!has_axis[1] ? 1 : 2);
+        rotation_matrix[axis] =
+            glm::normalize(glm::cross(rotation_matrix[(axis + 1) % 3], rotation_matrix[(axis + 2) % 3]));
+    }
+
+    return add_node(p_parent, position, glm::normalize(glm::quat_cast(rotation_matrix)), scale);
+}
+
+void SceneGraph::reserve(unsigned int p_node_count)
+{
+    parent.reserve(p_node_count);
+    first_child.reserve(p_node_count);
+    next_sibling.reserve(p_node_count);
+    local_position.reserve(p_node_count);
+    local_rotation.reserve(p_node_count);
+    local_scale.reserve(p_node_count);
+    local_matrix.reserve(p_node_count);
+    world_matrix.reserve(p_node_count);
+    local_dirty.reserve(p_node_count);
+    updated_in_pass.reserve(p_node_count);
+}
+
+void SceneGraph::clear()
+{
+    parent.clear();
+    first_child.clear();
+    next_sibling.clear();
+    local_position.clear();
+    local_rotation.clear();
+    local_scale.clear();
+    local_matrix.clear();
+    world_matrix.clear();
+    local_dirty.clear();
+    updated_in_pass.clear();
+    dirty_nodes.clear();
+}
+
+void SceneGraph::set_local_position(unsigned int p_node, const glm::vec3& p_position)
+{
+    local_position[p_node] = p_position;
+    mark_dirty(p_node);
+}
+
+void SceneGraph::set_local_rotation(unsigned int p_node, const glm::quat& p_rotation)
+{
+    local_rotation[p_node] = p_rotation;
+    mark_dirty(p_node);
+}
+
+void SceneGraph::set_local_scale(unsigned int p_node, const glm::vec3& p_scale)
+{
+    local_scale[p_node] = p_scale;
+    mark_dirty(p_node);
+}
+
+unsigned int SceneGraph::update_world_transforms()
+{
+    if (dirty_nodes.empty())
+    {
+        return 0;
+    }
+
+    // Parents have lower indices, so after sorting every dirty ancestor is handled before its
+    // descendants and they can be skipped once their subtree has been refreshed.
+    std::sort(dirty_nodes.begin(), dirty_nodes.end());
+    update_pass++;
+
+    unsigned int updated = 0;
+    for (unsigned int node : dirty_nodes)
+    {
+        if (updated_in_pass[node] != update_pass)
+        {
+            updated += update_subtree(node);
+        }
+    }
+
+    dirty_nodes.clear();
+    return updated;
+}
+
+unsigned int SceneGraph::get_node_count() const
+{
+    return (unsigned int) parent.size();
+}
+
+unsigned int SceneGraph::get_parent(unsigned int p_node) const
+{
+    return parent[p_node];
+}
+
+const glm::vec3& SceneGraph::get_local_position(unsigned int p_node) const
+{
+    return local_position[p_node];
+}
+
+const glm::quat& SceneGraph::get_local_rotation(unsigned int p_node) const
+{
+    return local_rotation[p_node];
+}
+
+const glm::vec3& SceneGraph::get_local_scale(unsigned int p_node) const
+{
+    return local_scale[p_node];
+}
+
+const glm::mat4& SceneGraph::get_world_matrix(unsigned int p_node) const
+{
+    return world_matrix[p_node];
+}
+
+void SceneGraph::mark_dirty(unsigned int p_node)
+{
+    if (!local_dirty[p_node])
+    {
+        local_dirty[p_node] = 1;
+        dirty_nodes.push_back(p_node);
+    }
+}
+
+unsigned int SceneGraph::update_subtree(unsigned int p_root)
+{
+    unsigned int updated = 0;
+
+    traversal_stack.clear();
+    traversal_stack.push_back(p_root);
+
+    while (!traversal_stack.empty())
+    {
+        unsigned int node = traversal_stack.back();
+        traversal_stack.pop_back();
+
+        if (local_dirty[node])
+        {
+            glm::mat4 local = glm::mat4_cast(local_rotation[node]);
+            local[0] *= local_scale[node].x;
+            local[1] *= local_scale[node].y;
+            local[2] *= local_scale[node].z;
+            local[3] = glm::vec4(local_position[node], 1.0f);
+
+            local_matrix[node] = local;
+            local_dirty[node] = 0;
+        }
+
+        if (parent[node] == SCENE_NODE_NONE)
+        {
+            world_matrix[node] = local_matrix[node];
+        }
+        else
+        {
+            mat4_multiply(world_matrix[parent[node]], local_matrix[node], world_matrix[node]);
+        }
+
+        updated_in_pass[node] = update_pass;
+        updated++;
+
+        for (unsigned int child = first_child[node]; child != SCENE_NODE_NONE; child = next_sibling[child])
+        {
+            traversal_stack.push_back(child);
+        }
+    }
+
+    return updated;
+}
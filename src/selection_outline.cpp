@@ -0,0 +1,199 @@
+#include "learn_opengl/selection_outline.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "glm/ext/matrix_float4x4.hpp"
+#include "glm/ext/vector_float4.hpp"
+#include "learn_opengl/resource_registry.hpp"
+
+SelectionOutline::SelectionOutline() :
+    mask_shader("shaders/outline_vertex.glsl", "shaders/outline_fragment.glsl", ShaderDefines()),
+    seed_shader("shaders/quad_vertex.glsl", "shaders/outline_flood_fragment.glsl", {{"OUTLINE_SEED", ""}}),
+    flood_shader("shaders/quad_vertex.glsl", "shaders/outline_flood_fragment.glsl", ShaderDefines()),
+    composite_shader("shaders/quad_vertex.glsl", "shaders/outline_composite_fragment.glsl", ShaderDefines())
+{
+    width             = 0;
+    height            = 0;
+    outline_width     = DEFAULT_OUTLINE_WIDTH;
+    outline_color     = glm::vec4(1.0f, 0.6f, 0.1f, 1.0f);
+    last_draws        = 0;
+    last_flood_passes = 0;
+
+    glGenFramebuffers(1, &mask_framebuffer);
+    glGenFramebuffers(2, seed_framebuffers);
+    glGenTextures(1, &mask_texture);
+    glGenTextures(2, seed_textures);
+
+    ResourceRegistry& registry = ResourceRegistry::get_instance();
+    registry.track(RESOURCE_FRAMEBUFFER, mask_framebuffer, 0, "selection_outline");
+    registry.track(RESOURCE_FRAMEBUFFER, seed_framebuffers[0], 0, "selection_outline");
+    registry.track(RESOURCE_FRAMEBUFFER, seed_framebuffers[1], 0, "selection_outline");
+}
+
+SelectionOutline::~SelectionOutline()
+{
+    ResourceRegistry& registry = ResourceRegistry::get_instance();
+    registry.untrack(RESOURCE_FRAMEBUFFER, mask_framebuffer);
+    registry.untrack(RESOURCE_TEXTURE, mask_texture);
+    for (unsigned int i = 0; i < 2; i++)
+    {
+        registry.untrack(RESOURCE_FRAMEBUFFER, seed_framebuffers[i]);
+        registry.untrack(RESOURCE_TEXTURE, seed_textures[i]);
+    }
+
+    glDeleteFramebuffers(1, &mask_framebuffer);
+    glDeleteFramebuffers(2, seed_framebuffers);
+    glDeleteTextures(1, &mask_texture);
+    glDeleteTextures(2, seed_textures);
+    glDeleteProgram(mask_shader.ID);
+    glDeleteProgram(seed_shader.ID);
+    glDeleteProgram(flood_shader.ID);
+    glDeleteProgram(composite_shader.ID);
+}
+
+void SelectionOutline::set_width(float p_width)
+{
+    outline_width = std::clamp(p_width, 0.0f, MAX_OUTLINE_WIDTH);
+}
+
+void SelectionOutline::set_color(const glm::vec4& p_color)
+{
+    outline_color = p_color;
+}
+
+void SelectionOutline::resize(int p_width, int p_height)
+{
+    width  = p_width;
+    height = p_height;
+
+    ResourceRegistry& registry = ResourceRegistry::get_instance();
+
+    // Texel-exact lookups only, no filtering anywhere.
+    auto allocate = [&registry, p_width, p_height](unsigned int p_texture, unsigned int p_framebuffer,
+                                                   GLint p_internal_format, GLenum p_format, GLenum p_type,
+                                                   int p_texel_bytes)
+    {
+        registry.untrack(RESOURCE_TEXTURE, p_texture);
+
+        glBindTexture(GL_TEXTURE_2D, p_texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, p_internal_format, p_width, p_height, 0, p_format, p_type, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, p_framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, p_texture, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+            std::cout << "ERROR::SELECTION_OUTLINE::FRAMEBUFFER_INCOMPLETE" << std::endl;
+        }
+
+        registry.track(RESOURCE_TEXTURE, p_texture, (std::size_t) p_width * p_height * p_texel_bytes,
+                       "selection_outline");
+    };
+
+    allocate(mask_texture, mask_framebuffer, GL_R8, GL_RED, GL_UNSIGNED_BYTE, 1);
+    for (unsigned int i = 0; i < 2; i++)
+    {
+        allocate(seed_textures[i], seed_framebuffers[i], GL_RG16UI, GL_RG_INTEGER, GL_UNSIGNED_SHORT, 4);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void SelectionOutline::draw(const std::vector<SelectionDraw>& p_draws, const glm::mat4& p_view,
+                            const glm::mat4& p_projection, int p_width, int p_height)
+{
+    last_draws        = (unsigned int) p_draws.size();
+    last_flood_passes = 0;
+    if (p_draws.empty() || p_width <= 0 || p_height <= 0 || outline_width <= 0.0f)
+    {
+        return;
+    }
+    if (p_width != width || p_height != height)
+    {
+        resize(p_width, p_height);
+    }
+
+    timer.begin();
+    glDisable(GL_DEPTH_TEST);
+    glViewport(0, 0, width, height);
+
+    // Ids only: no depth, no textures, no lighting.
+    glBindFramebuffer(GL_FRAMEBUFFER, mask_framebuffer);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    mask_shader.use();
+    mask_shader.setMat4("view", p_view);
+    mask_shader.setMat4("projection", p_projection);
+    for (const SelectionDraw& draw : p_draws)
+    {
+        mask_shader.setMat4("model", draw.model_matrix);
+        mask_shader.setFloat("selection_id", (float) std::min(draw.selection_id, SELECTION_MAX_ID));
+        glBindVertexArray(draw.vao);
+        glDrawArrays(GL_TRIANGLES, 0, draw.vertices_count);
+    }
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, mask_texture);
+    glBindFramebuffer(GL_FRAMEBUFFER, seed_framebuffers[0]);
+    seed_shader.use();
+    seed_shader.setInt("selection_mask", 0);
+    quad.draw();
+
+    // Distances past the width are never used, so the flood starts at the width instead of the screen size.
+    int step = 1;
+    while (step < (int) std::ceil(outline_width))
+    {
+        step *= 2;
+    }
+
+    unsigned int source = 0;
+    flood_shader.use();
+    flood_shader.setInt("seeds", 0);
+    for (; step >= 1; step /= 2)
+    {
+        glBindTexture(GL_TEXTURE_2D, seed_textures[source]);
+        glBindFramebuffer(GL_FRAMEBUFFER, seed_framebuffers[1 - source]);
+        flood_shader.setInt("step_size", step);
+        quad.draw();
+
+        source = 1 - source;
+        last_flood_passes++;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    composite_shader.use();
+    composite_shader.setInt("selection_mask", 0);
+    composite_shader.setInt("seeds", 1);
+    composite_shader.setFloat("outline_width", outline_width);
+    composite_shader.setVec4("outline_color", outline_color);
+    glBindTexture(GL_TEXTURE_2D, mask_texture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, seed_textures[source]);
+    quad.draw();
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glDisable(GL_BLEND);
+    glEnable(GL_DEPTH_TEST);
+    timer.end();
+}
+
+SelectionOutlineStats SelectionOutline::get_stats() const
+{
+    SelectionOutlineStats stats;
+    stats.selected_draws   = last_draws;
+    stats.flood_passes     = last_flood_passes;
+    stats.gpu_milliseconds = timer.get_milliseconds();
+    return stats;
+}
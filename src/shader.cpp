@@ -1,55 +1,62 @@
 #include <learn_opengl/shader.hpp>
 
+#include <atomic>
+#include <chrono>
 #include <cstddef>
-#include <fstream>
 #include <glad/glad.h>
 #include <iostream>
 #include <ostream>
-#include <sstream>
 #include <string>
 
 #include "glm/ext/matrix_float3x3.hpp"
 #include "glm/ext/matrix_float4x4.hpp"
+#include "glm/ext/vector_float2.hpp"
 #include "glm/ext/vector_float3.hpp"
 #include "glm/gtc/type_ptr.hpp"
+#include "learn_opengl/gl_extensions.hpp"
+#include "learn_opengl/shader_preprocessor.hpp"
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath)
+namespace
 {
-    std::string vertexCode;
-    std::string fragmentCode;
-    std::ifstream vShaderFile;
-    std::ifstream fShaderFile;
-    vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    try
+std::atomic<unsigned int> programs_compiled(0);
+std::atomic<long long>    compile_nanoseconds(0);
+
+void print_source_files(const PreprocessedShader& p_shader)
+{
+    for (std::size_t i = 0; i < p_shader.files.size(); i++)
     {
-        vShaderFile.open(vertexPath);
-        fShaderFile.open(fragmentPath);
+        std::cout << "  " << i << ": " << p_shader.files[i] << "\n";
+    }
+}
+} // namespace
 
-        std::stringstream vShaderStream, fShaderStream;
-        vShaderStream << vShaderFile.rdbuf();
-        fShaderStream << fShaderFile.rdbuf();
+Shader::Shader(const char* vertexPath, const char* fragmentPath) : Shader(vertexPath, fragmentPath, ShaderDefines())
+{
+}
 
-        vShaderFile.close();
-        fShaderFile.close();
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const ShaderDefines& defines)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
-        vertexCode = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
-    }
-    catch (std::ifstream::failure e)
+    PreprocessedShader vertex_source   = preprocess_shader(vertexPath, defines);
+    PreprocessedShader fragment_source = preprocess_shader(fragmentPath, defines);
+    if (!vertex_source.success || !fragment_source.success)
     {
-        std::cout << "ERROR::SHADER::FILE_READ_FAILED" << e.what() << std::endl;
+        std::cout << "ERROR::SHADER::PREPROCESS_FAILED " << (vertex_source.success ? fragmentPath : vertexPath)
+                  << std::endl;
     }
 
-    const char* vShaderCode = vertexCode.c_str();
-    const char* fShaderCode = fragmentCode.c_str();
+    const char* vShaderCode   = vertex_source.source.c_str();
+    const char* fShaderCode   = fragment_source.source.c_str();
+    GLint       vShaderLength = (GLint) vertex_source.source.size();
+    GLint       fShaderLength = (GLint) fragment_source.source.size();
 
     unsigned int vertex, fragment;
     int success;
     char infoLog[512];
 
     vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vShaderCode, NULL);
+    glShaderSource(vertex, 1, &vShaderCode, &vShaderLength);
     glCompileShader(vertex);
 
     glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
@@ -57,10 +64,11 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
     {
         glGetShaderInfoLog(vertex, 512, NULL, infoLog);
         std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+        print_source_files(vertex_source);
     }
 
     fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fShaderCode, NULL);
+    glShaderSource(fragment, 1, &fShaderCode, &fShaderLength);
     glCompileShader(fragment);
 
     glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
@@ -68,6 +76,7 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
     {
         glGetShaderInfoLog(fragment, 512, NULL, infoLog);
         std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+        print_source_files(fragment_source);
     }
 
     ID = glCreateProgram();
@@ -75,6 +84,7 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
     glAttachShader(ID, fragment);
     glLinkProgram(ID);
 
+    // Querying the link status waits for the driver, so the timing below covers the whole build.
     glGetProgramiv(ID, GL_LINK_STATUS, &success);
     if (!success)
     {
@@ -84,6 +94,57 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
 
     glDeleteShader(vertex);
     glDeleteShader(fragment);
+
+    programs_compiled++;
+    std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start;
+    compile_nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+}
+
+Shader::Shader(const char* computePath, const ShaderDefines& defines)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    PreprocessedShader compute_source = preprocess_shader(computePath, defines);
+    if (!compute_source.success)
+    {
+        std::cout << "ERROR::SHADER::PREPROCESS_FAILED " << computePath << std::endl;
+    }
+
+    const char* cShaderCode   = compute_source.source.c_str();
+    GLint       cShaderLength = (GLint) compute_source.source.size();
+
+    unsigned int compute;
+    int success;
+    char infoLog[512];
+
+    compute = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(compute, 1, &cShaderCode, &cShaderLength);
+    glCompileShader(compute);
+
+    glGetShaderiv(compute, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        glGetShaderInfoLog(compute, 512, NULL, infoLog);
+        std::cout << "ERROR::SHADER::COMPUTE::COMPILATION_FAILED\n" << infoLog << std::endl;
+        print_source_files(compute_source);
+    }
+
+    ID = glCreateProgram();
+    glAttachShader(ID, compute);
+    glLinkProgram(ID);
+
+    glGetProgramiv(ID, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        glGetProgramInfoLog(ID, 512, NULL, infoLog);
+        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+    }
+
+    glDeleteShader(compute);
+
+    programs_compiled++;
+    std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start;
+    compile_nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
 }
 
 void Shader::use()
@@ -106,12 +167,24 @@ void Shader::setFloat(const std::string& name, float value) const
     glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
 }
 
+void Shader::setVec2(const std::string& name, glm::vec2 value) const
+{
+    int uniformLoc = glGetUniformLocation(ID, name.c_str());
+    glUniform2fv(uniformLoc, 1, glm::value_ptr(value));
+}
+
 void Shader::setVec3(const std::string& name, glm::vec3 value) const
 {
     int uniformLoc = glGetUniformLocation(ID, name.c_str());
     glUniform3fv(uniformLoc, 1, glm::value_ptr(value));
 }
 
+void Shader::setVec4(const std::string& name, glm::vec4 value) const
+{
+    int uniformLoc = glGetUniformLocation(ID, name.c_str());
+    glUniform4fv(uniformLoc, 1, glm::value_ptr(value));
+}
+
 void Shader::setMat3(const std::string& name, glm::mat3 value) const
 {
     int uniformLoc = glGetUniformLocation(ID, name.c_str());
@@ -123,3 +196,13 @@ void Shader::setMat4(const std::string& name, glm::mat4 value) const
     int uniformLoc = glGetUniformLocation(ID, name.c_str());
     glUniformMatrix4fv(uniformLoc, 1, GL_FALSE, glm::value_ptr(value));
 }
+
+unsigned int Shader::get_programs_compiled()
+{
+    return programs_compiled.load();
+}
+
+double Shader::get_compile_milliseconds()
+{
+    return compile_nanoseconds.load() / 1000000.0;
+}
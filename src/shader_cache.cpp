@@ -0,0 +1,72 @@
+#include "learn_opengl/shader_cache.hpp"
+
+#include <glad/glad.h>
+#include <iostream>
+#include <memory>
+#include <ostream>
+#include <string>
+
+ShaderCache& ShaderCache::get_instance()
+{
+    static ShaderCache instance;
+    return instance;
+}
+
+ShaderCache::ShaderCache()
+{
+    cache_hits = 0;
+}
+
+void ShaderCache::register_program(const std::string& p_name, const std::string& p_vertex_path,
+                                   const std::string& p_fragment_path)
+{
+    programs[p_name] = {p_vertex_path, p_fragment_path};
+}
+
+Shader* ShaderCache::get(const std::string& p_name, const ShaderDefines& p_defines)
+{
+    std::string key = p_name + "|" + get_shader_defines_key(p_defines);
+
+    auto cached = permutations.find(key);
+    if (cached != permutations.end())
+    {
+        cache_hits++;
+        return cached->second.get();
+    }
+
+    auto program = programs.find(p_name);
+    if (program == programs.end())
+    {
+        std::cout << "ERROR::SHADER_CACHE::UNKNOWN_PROGRAM " << p_name << std::endl;
+        return NULL;
+    }
+
+    Shader* shader = new Shader(program->second.vertex_path.c_str(), program->second.fragment_path.c_str(), p_defines);
+    permutations[key] = std::unique_ptr<Shader>(shader);
+    return shader;
+}
+
+unsigned int ShaderCache::get_permutation_count() const
+{
+    return permutations.size();
+}
+
+void ShaderCache::print_stats(std::ostream& p_out) const
+{
+    p_out << "Shaders: " << Shader::get_programs_compiled() << " programs compiled in "
+          << Shader::get_compile_milliseconds() << " ms, " << permutations.size() << " cached permutations, "
+          << cache_hits << " cache hits\n";
+    for (const auto& [key, shader] : permutations)
+    {
+        p_out << "  " << key << "\n";
+    }
+}
+
+void ShaderCache::clear()
+{
+    for (const auto& [key, shader] : permutations)
+    {
+        glDeleteProgram(shader->ID);
+    }
+    permutations.clear();
+}
@@ -0,0 +1,238 @@
+#include "learn_opengl/shader_preprocessor.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "learn_opengl/file_system.hpp"
+
+namespace
+{
+std::string_view trim_left(std::string_view p_line)
+{
+    std::size_t start = 0;
+    while (start < p_line.size() && (p_line[start] == ' ' || p_line[start] == '\t'))
+    {
+        start++;
+    }
+    return p_line.substr(start);
+}
+
+bool starts_with_directive(std::string_view p_line, std::string_view p_directive)
+{
+    p_line = trim_left(p_line);
+    if (p_line.empty() || p_line[0] != '#')
+    {
+        return false;
+    }
+    p_line = trim_left(p_line.substr(1));
+    return p_line.substr(0, p_directive.size()) == p_directive;
+}
+
+// Pulls the name out of `#include "name"` or `#include <name>`.
+bool parse_include(std::string_view p_line, std::string& p_name)
+{
+    std::size_t open = p_line.find_first_of("\"<");
+    if (open == std::string_view::npos)
+    {
+        return false;
+    }
+
+    char        closing = p_line[open] == '"' ? '"' : '>';
+    std::size_t close   = p_line.find(closing, open + 1);
+    if (close == std::string_view::npos)
+    {
+        return false;
+    }
+
+    p_name = std::string(p_line.substr(open + 1, close - open - 1));
+    return !p_name.empty();
+}
+
+std::string resolve_include(const std::string& p_including_file, const std::string& p_name)
+{
+    FileSystem& file_system = FileSystem::get_instance();
+
+    std::string relative =
+            (std::filesystem::path(p_including_file).parent_path() / p_name).lexically_normal().generic_string();
+    if (file_system.exists(relative))
+    {
+        return relative;
+    }
+
+    std::string shared = (std::filesystem::path("shaders") / p_name).lexically_normal().generic_string();
+    if (file_system.exists(shared))
+    {
+        return shared;
+    }
+
+    return "";
+}
+
+// GLSL before 3.30 numbers the line after "#line N" as N + 1, so directives are emitted one lower there.
+std::size_t get_line_bias(std::string_view p_version_line)
+{
+    // No #version means 110.
+    int         version = 110;
+    std::size_t digits  = p_version_line.find_first_of("0123456789");
+    if (digits != std::string_view::npos)
+    {
+        version = std::atoi(std::string(p_version_line.substr(digits)).c_str());
+    }
+    return version < 330 ? 1 : 0;
+}
+
+// Makes the next line report as p_line of source string p_file.
+void append_line_directive(std::string& p_source, std::size_t p_line, std::size_t p_file, std::size_t p_bias)
+{
+    p_source += "#line " + std::to_string(p_line - p_bias) + " " + std::to_string(p_file) + "\n";
+}
+
+void append_defines(std::string& p_source, const ShaderDefines& p_defines)
+{
+    for (const ShaderDefine& define : p_defines)
+    {
+        p_source += "#define " + define.name;
+        if (!define.value.empty())
+        {
+            p_source += " " + define.value;
+        }
+        p_source += "\n";
+    }
+}
+
+bool append_file(const std::string& p_path, const ShaderDefines& p_defines, PreprocessedShader& p_result,
+                 std::vector<std::string>& p_include_stack, bool& p_defines_emitted, std::size_t& p_line_bias)
+{
+    FileView file = FileSystem::get_instance().read_file(p_path);
+    if (!file.is_valid())
+    {
+        std::cout << "ERROR::SHADER::FILE_READ_FAILED " << p_path << std::endl;
+        return false;
+    }
+
+    std::size_t file_index = p_result.files.size();
+    p_result.files.push_back(p_path);
+    p_include_stack.push_back(p_path);
+
+    std::string_view text        = file.text();
+    std::size_t      line_number = 0;
+    std::size_t      position    = 0;
+    while (position < text.size())
+    {
+        std::size_t      end  = text.find('\n', position);
+        std::string_view line = text.substr(position, end == std::string_view::npos ? end : end - position);
+        position              = end == std::string_view::npos ? text.size() : end + 1;
+        line_number++;
+
+        if (starts_with_directive(line, "version"))
+        {
+            // Only the top-level file decides the version, it must stay the first line.
+            if (file_index == 0)
+            {
+                p_result.source += line;
+                p_result.source += "\n";
+                append_defines(p_result.source, p_defines);
+                p_line_bias = get_line_bias(line);
+                append_line_directive(p_result.source, line_number + 1, file_index, p_line_bias);
+                p_defines_emitted = true;
+            }
+            continue;
+        }
+
+        if (!starts_with_directive(line, "include"))
+        {
+            p_result.source += line;
+            p_result.source += "\n";
+            continue;
+        }
+
+        std::string name;
+        if (!parse_include(line, name))
+        {
+            std::cout << "ERROR::SHADER::INVALID_INCLUDE " << p_path << ":" << line_number << std::endl;
+            return false;
+        }
+
+        std::string include_path = resolve_include(p_path, name);
+        if (include_path.empty())
+        {
+            std::cout << "ERROR::SHADER::INCLUDE_NOT_FOUND " << name << " in " << p_path << ":" << line_number
+                      << std::endl;
+            return false;
+        }
+
+        if (std::find(p_include_stack.begin(), p_include_stack.end(), include_path) != p_include_stack.end())
+        {
+            std::cout << "ERROR::SHADER::RECURSIVE_INCLUDE " << include_path << " in " << p_path << std::endl;
+            return false;
+        }
+
+        if (std::find(p_result.files.begin(), p_result.files.end(), include_path) == p_result.files.end())
+        {
+            append_line_directive(p_result.source, 1, p_result.files.size(), p_line_bias);
+            if (!append_file(include_path, p_defines, p_result, p_include_stack, p_defines_emitted, p_line_bias))
+            {
+                return false;
+            }
+        }
+        append_line_directive(p_result.source, line_number + 1, file_index, p_line_bias);
+    }
+
+    p_include_stack.pop_back();
+    return true;
+}
+} // namespace
+
+PreprocessedShader preprocess_shader(const std::string& p_path, const ShaderDefines& p_defines)
+{
+    PreprocessedShader result;
+    result.success = false;
+
+    std::vector<std::string> include_stack;
+    bool                     defines_emitted = false;
+    std::size_t              line_bias       = get_line_bias("");
+    if (!append_file(p_path, p_defines, result, include_stack, defines_emitted, line_bias))
+    {
+        return result;
+    }
+
+    // Without a #version line the defines simply go first.
+    if (!defines_emitted && !p_defines.empty())
+    {
+        std::string prefix;
+        append_defines(prefix, p_defines);
+        append_line_directive(prefix, 1, 0, line_bias);
+        result.source.insert(0, prefix);
+    }
+
+    result.success = true;
+    return result;
+}
+
+std::string get_shader_defines_key(const ShaderDefines& p_defines)
+{
+    std::vector<std::string> entries;
+    entries.reserve(p_defines.size());
+    for (const ShaderDefine& define : p_defines)
+    {
+        entries.push_back(define.value.empty() ? define.name : define.name + "=" + define.value);
+    }
+    std::sort(entries.begin(), entries.end());
+
+    std::string key;
+    for (const std::string& entry : entries)
+    {
+        if (!key.empty())
+        {
+            key += ";";
+        }
+        key += entry;
+    }
+    return key;
+}
@@ -0,0 +1,189 @@
+#include "learn_opengl/simulation.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+#include "glm/ext/matrix_float4x4.hpp"
+#include "learn_opengl/camera.hpp"
+#include "learn_opengl/frame_pipeline.hpp"
+#include "learn_opengl/input.hpp"
+
+// Most ticks run to catch up after a stall (debugger, window drag, slow load). The rest of the gap is
+// dropped, otherwise ticking through it makes the next frame late too and the loop never recovers.
+const int MAX_CATCH_UP_TICKS = 5;
+
+Simulation::Simulation(Camera& p_camera, InputState& p_input, FramePipeline& p_pipeline) :
+    camera(p_camera), input(p_input), pipeline(p_pipeline)
+{
+    fixed_timestep = false;
+    tick_seconds = 1.0 / 60.0;
+    running = false;
+}
+
+Simulation::~Simulation()
+{
+    stop();
+}
+
+void Simulation::set_scene_builder(SceneBuilder p_builder)
+{
+    scene_builder = std::move(p_builder);
+}
+
+void Simulation::set_fixed_timestep(bool p_enabled, double p_tick_seconds)
+{
+    fixed_timestep = p_enabled;
+    tick_seconds = p_tick_seconds;
+}
+
+void Simulation::start()
+{
+    running = true;
+    thread = std::thread(&Simulation::run, this);
+}
+
+void Simulation::stop()
+{
+    running = false;
+    pipeline.stop();
+
+    if (thread.joinable())
+    {
+        thread.join();
+    }
+}
+
+void Simulation::run()
+{
+    using clock = std::chrono::steady_clock;
+
+    clock::time_point start_time = clock::now();
+    clock::time_point last_time = start_time;
+    double            accumulator = 0.0;
+    double            simulation_time = 0.0;
+    CameraState       previous_state = camera.get_state();
+
+    while (running)
+    {
+        clock::time_point now = clock::now();
+        double            delta_time = std::chrono::duration<double>(now - last_time).count();
+        last_time = now;
+
+        CameraState render_state;
+
+        if (fixed_timestep)
+        {
+            accumulator = std::min(accumulator + delta_time, MAX_CATCH_UP_TICKS * tick_seconds);
+
+            // Deltas (mouse, scroll) are only consumed when a tick is going to run so none are lost.
+            if (accumulator >= tick_seconds)
+            {
+                InputSnapshot snapshot = input.consume();
+                bool          first_tick = true;
+
+                while (accumulator >= tick_seconds)
+                {
+                    previous_state = camera.get_state();
+                    apply_input(snapshot, (float) tick_seconds, first_tick);
+
+                    first_tick = false;
+                    accumulator -= tick_seconds;
+                    simulation_time += tick_seconds;
+                }
+            }
+
+            float alpha = (float) (accumulator / tick_seconds);
+            render_state = interpolate_camera_state(previous_state, camera.get_state(), alpha);
+        }
+        else
+        {
+            apply_input(input.consume(), (float) delta_time, true);
+            simulation_time = std::chrono::duration<double>(now - start_time).count();
+            render_state = camera.get_state();
+        }
+
+        // Blocks while the renderer is max_frames_ahead packets behind.
+        FramePacket* packet = pipeline.begin_build();
+        if (!packet)
+        {
+            break;
+        }
+
+        build_packet(*packet, render_state, simulation_time, now);
+        pipeline.submit();
+    }
+}
+
+void Simulation::apply_input(const InputSnapshot& p_input, float p_delta_time, bool p_apply_deltas)
+{
+    // A minimized window reports a 0x0 framebuffer, keep the last usable aspect ratio.
+    if (p_input.framebuffer_width > 0 && p_input.framebuffer_height > 0)
+    {
+        camera.camera_width = (float) p_input.framebuffer_width;
+        camera.camera_height = (float) p_input.framebuffer_height;
+    }
+
+    for (int i = 0; i < CAMERA_MOVEMENT_COUNT; i++)
+    {
+        if (p_input.movement[i])
+        {
+            camera.process_keyboard((CameraMovement) i, p_delta_time);
+        }
+    }
+
+    if (!p_apply_deltas)
+    {
+        return;
+    }
+
+    if (p_input.mouse_x_offset != 0.0f || p_input.mouse_y_offset != 0.0f)
+    {
+        camera.process_mouse_movement(p_input.mouse_x_offset, p_input.mouse_y_offset);
+    }
+
+    if (p_input.scroll_y_offset != 0.0f)
+    {
+        camera.process_mouse_scroll(p_input.scroll_y_offset);
+    }
+
+    if (p_input.reset_fov)
+    {
+        camera.reset_fov();
+    }
+}
+
+void Simulation::build_packet(FramePacket& p_packet, const CameraState& p_state, double p_time,
+                              std::chrono::steady_clock::time_point p_input_time)
+{
+    // Build from a copy so the interpolated state never leaks back into the simulated camera.
+    Camera view_camera = camera;
+    view_camera.set_state(p_state);
+
+    p_packet.simulation_time = p_time;
+    p_packet.view = view_camera.get_view_matrix();
+    p_packet.projection = view_camera.get_projection_matrix();
+    p_packet.camera_position = view_camera.camera_position;
+    p_packet.viewport_width = (int) view_camera.camera_width;
+    p_packet.viewport_height = (int) view_camera.camera_height;
+    p_packet.camera = view_camera;
+    p_packet.input_time = p_input_time;
+
+    if (scene_builder)
+    {
+        scene_builder(p_packet, view_camera);
+    }
+}
+
+glm::mat4 get_late_latched_view(const FramePacket& p_packet, InputState& p_input)
+{
+    InputSnapshot pending = p_input.peek();
+    Camera        camera = p_packet.camera;
+
+    if (pending.mouse_x_offset != 0.0f || pending.mouse_y_offset != 0.0f)
+    {
+        camera.process_mouse_movement(pending.mouse_x_offset, pending.mouse_y_offset);
+    }
+
+    return camera.get_view_matrix();
+}
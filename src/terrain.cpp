@@ -0,0 +1,641 @@
+#include "learn_opengl/terrain.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "glm/common.hpp"
+#include "glm/geometric.hpp"
+#include "learn_opengl/mapped_file.hpp"
+#include "learn_opengl/resource_registry.hpp"
+
+const float       TERRAIN_QUAD_SIZE     = TERRAIN_CHUNK_SIZE / TERRAIN_CHUNK_QUADS;
+// Generated terrain stays level this close to the origin, where the scene stands, and reaches its
+// full height at three times the distance.
+const float       TERRAIN_FLAT_RADIUS   = 12.0f;
+// Lattice spacing of the coarsest noise octave, in world units.
+const float       TERRAIN_NOISE_SCALE   = 40.0f;
+const int         TERRAIN_NOISE_OCTAVES = 4;
+// Chunk objects kept for reuse beyond what the loaders and one frame's uploads need are freed.
+const std::size_t TERRAIN_SPARE_CHUNKS  = 8;
+
+static float lattice_value(int p_x, int p_z)
+{
+    std::uint32_t hash = (std::uint32_t) p_x * 0x8DA6B343u ^ (std::uint32_t) p_z * 0xD8163841u;
+    hash               = (hash ^ (hash >> 15)) * 0x2C1B3C6Du;
+    hash               = (hash ^ (hash >> 12)) * 0x297A2D39u;
+    hash ^= hash >> 15;
+    return (float) (hash & 0xFFFFFF) / (float) 0xFFFFFF;
+}
+
+static float value_noise(float p_x, float p_z)
+{
+    float x0 = std::floor(p_x);
+    float z0 = std::floor(p_z);
+    float tx = p_x - x0;
+    float tz = p_z - z0;
+    tx       = tx * tx * (3.0f - 2.0f * tx);
+    tz       = tz * tz * (3.0f - 2.0f * tz);
+
+    int   ix = (int) x0;
+    int   iz = (int) z0;
+    float a  = lattice_value(ix, iz) + (lattice_value(ix + 1, iz) - lattice_value(ix, iz)) * tx;
+    float b  = lattice_value(ix, iz + 1) + (lattice_value(ix + 1, iz + 1) - lattice_value(ix, iz + 1)) * tx;
+    return a + (b - a) * tz;
+}
+
+// In [0, 1].
+static float terrain_height_fraction(float p_x, float p_z)
+{
+    float height    = 0.0f;
+    float amplitude = 0.5f;
+    float frequency = 1.0f / TERRAIN_NOISE_SCALE;
+    float total     = 0.0f;
+    for (int octave = 0; octave < TERRAIN_NOISE_OCTAVES; octave++)
+    {
+        height += value_noise(p_x * frequency, p_z * frequency) * amplitude;
+        total += amplitude;
+        amplitude *= 0.5f;
+        frequency *= 2.0f;
+    }
+
+    float distance = std::sqrt(p_x * p_x + p_z * p_z);
+    float rise     = std::clamp((distance - TERRAIN_FLAT_RADIUS) / (2.0f * TERRAIN_FLAT_RADIUS), 0.0f, 1.0f);
+    return height / total * rise * rise * (3.0f - 2.0f * rise);
+}
+
+std::int64_t get_terrain_chunk_key(int p_x, int p_z)
+{
+    return (std::int64_t) ((std::uint64_t) (std::uint32_t) p_x << 32 | (std::uint32_t) p_z);
+}
+
+std::string get_terrain_chunk_name(int p_x, int p_z)
+{
+    char name[48];
+    std::snprintf(name, sizeof(name), "chunk_%d_%d.r16", p_x, p_z);
+    return name;
+}
+
+void generate_terrain_heights(int p_x, int p_z, std::vector<std::uint16_t>& p_heights)
+{
+    p_heights.resize((std::size_t) TERRAIN_CHUNK_SAMPLES * TERRAIN_CHUNK_SAMPLES);
+    for (int j = 0; j < TERRAIN_CHUNK_SAMPLES; j++)
+    {
+        for (int i = 0; i < TERRAIN_CHUNK_SAMPLES; i++)
+        {
+            // Sample 0 is the border, one quad outside the chunk.
+            float x = p_x * TERRAIN_CHUNK_SIZE + (i - 1) * TERRAIN_QUAD_SIZE;
+            float z = p_z * TERRAIN_CHUNK_SIZE + (j - 1) * TERRAIN_QUAD_SIZE;
+            p_heights[(std::size_t) j * TERRAIN_CHUNK_SAMPLES + i] =
+                    (std::uint16_t) std::lround(terrain_height_fraction(x, z) * 65535.0f);
+        }
+    }
+}
+
+float get_generated_terrain_height(float p_x, float p_z)
+{
+    float x  = p_x / TERRAIN_QUAD_SIZE;
+    float z  = p_z / TERRAIN_QUAD_SIZE;
+    float x0 = std::floor(x);
+    float z0 = std::floor(z);
+
+    // The same quantized samples the chunks are built from.
+    auto sample = [](float grid_x, float grid_z)
+    {
+        float fraction = terrain_height_fraction(grid_x * TERRAIN_QUAD_SIZE, grid_z * TERRAIN_QUAD_SIZE);
+        fraction       = std::lround(fraction * 65535.0f) / 65535.0f;
+        return TERRAIN_BASE_HEIGHT + fraction * TERRAIN_HEIGHT_RANGE;
+    };
+    float a = sample(x0, z0) + (sample(x0 + 1.0f, z0) - sample(x0, z0)) * (x - x0);
+    float b = sample(x0, z0 + 1.0f) + (sample(x0 + 1.0f, z0 + 1.0f) - sample(x0, z0 + 1.0f)) * (x - x0);
+    return a + (b - a) * (z - z0);
+}
+
+bool write_terrain_chunks(const std::filesystem::path& p_directory, int p_chunk_radius)
+{
+    std::error_code error;
+    std::filesystem::create_directories(p_directory, error);
+
+    std::vector<std::uint16_t> heights;
+    unsigned int               written = 0;
+    for (int z = -p_chunk_radius; z <= p_chunk_radius; z++)
+    {
+        for (int x = -p_chunk_radius; x <= p_chunk_radius; x++)
+        {
+            generate_terrain_heights(x, z, heights);
+            std::filesystem::path path = p_directory / get_terrain_chunk_name(x, z);
+            std::ofstream         file(path, std::ios::binary);
+            file.write((const char*) heights.data(), (std::streamsize) (heights.size() * sizeof(std::uint16_t)));
+            if (!file)
+            {
+                std::cout << "ERROR::TERRAIN::CANNOT_WRITE " << path.string() << std::endl;
+                return false;
+            }
+            written++;
+        }
+    }
+
+    std::cout << "Wrote " << written << " terrain chunks to " << p_directory.string() << std::endl;
+    return true;
+}
+
+void build_terrain_indices(std::vector<std::uint16_t>& p_indices, std::size_t p_first_index[TERRAIN_LOD_COUNT],
+                           std::size_t p_index_count[TERRAIN_LOD_COUNT])
+{
+    const int      row   = TERRAIN_CHUNK_QUADS + 1;
+    const unsigned skirt = (unsigned) (row * row);
+    auto           grid  = [row](int i, int j) { return (std::uint16_t) (j * row + i); };
+    // Skirt vertices follow the grid: bottom edge (j = 0), top edge, left edge (i = 0), right edge.
+    auto below = [row, skirt](unsigned edge, int k) { return (std::uint16_t) (skirt + edge * row + k); };
+
+    p_indices.clear();
+    for (int lod = 0; lod < TERRAIN_LOD_COUNT; lod++)
+    {
+        p_first_index[lod] = p_indices.size();
+        int step           = 1 << lod;
+
+        // Counter-clockwise seen from above, and seen from outside for the skirts.
+        for (int j = 0; j < TERRAIN_CHUNK_QUADS; j += step)
+        {
+            for (int i = 0; i < TERRAIN_CHUNK_QUADS; i += step)
+            {
+                p_indices.insert(p_indices.end(), {grid(i, j), grid(i, j + step), grid(i + step, j)});
+                p_indices.insert(p_indices.end(), {grid(i + step, j), grid(i, j + step), grid(i + step, j + step)});
+            }
+        }
+        for (int k = 0; k < TERRAIN_CHUNK_QUADS; k += step)
+        {
+            int n    = k + step;
+            int last = TERRAIN_CHUNK_QUADS;
+            p_indices.insert(p_indices.end(), {grid(k, 0), grid(n, 0), below(0, k)});
+            p_indices.insert(p_indices.end(), {grid(n, 0), below(0, n), below(0, k)});
+            p_indices.insert(p_indices.end(), {grid(k, last), below(1, k), grid(n, last)});
+            p_indices.insert(p_indices.end(), {grid(n, last), below(1, k), below(1, n)});
+            p_indices.insert(p_indices.end(), {grid(0, k), below(2, k), grid(0, n)});
+            p_indices.insert(p_indices.end(), {grid(0, n), below(2, k), below(2, n)});
+            p_indices.insert(p_indices.end(), {grid(last, k), grid(last, n), below(3, k)});
+            p_indices.insert(p_indices.end(), {grid(last, n), below(3, n), below(3, k)});
+        }
+        p_index_count[lod] = p_indices.size() - p_first_index[lod];
+    }
+}
+
+int select_terrain_lod(const glm::vec3& p_camera_position, const glm::vec3& p_min, const glm::vec3& p_max)
+{
+    glm::vec3 closest  = glm::clamp(p_camera_position, p_min, p_max);
+    float     distance = glm::length(p_camera_position - closest);
+    return std::min(TERRAIN_LOD_COUNT - 1, (int) (distance / TERRAIN_LOD_DISTANCE));
+}
+
+std::size_t get_terrain_lod_triangles(int p_lod)
+{
+    std::size_t quads = (std::size_t) (TERRAIN_CHUNK_QUADS >> p_lod);
+    return 2 * quads * quads + 8 * quads;
+}
+
+TerrainStreamer::TerrainStreamer(const std::filesystem::path& p_directory, float p_radius,
+                                 unsigned int p_loader_count)
+{
+    directory               = p_directory;
+    radius                  = p_radius;
+    position                = glm::vec3(0.0f);
+    loading                 = 0;
+    total_load_milliseconds = 0.0;
+    stopping                = false;
+    stats                   = TerrainStreamerStats();
+
+    for (unsigned int i = 0; i < std::max(1u, p_loader_count); i++)
+    {
+        loaders.emplace_back(&TerrainStreamer::run, this);
+    }
+}
+
+TerrainStreamer::~TerrainStreamer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    for (std::thread& loader : loaders)
+    {
+        loader.join();
+    }
+}
+
+void TerrainStreamer::update(const glm::vec3& p_position, std::vector<std::int64_t>& p_evicted)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    position = p_position;
+
+    auto center_distance = [this](int x, int z)
+    {
+        float dx = (x + 0.5f) * TERRAIN_CHUNK_SIZE - position.x;
+        float dz = (z + 0.5f) * TERRAIN_CHUNK_SIZE - position.z;
+        return std::sqrt(dx * dx + dz * dz);
+    };
+
+    // Everything past the margin goes, whatever state it is in. A chunk still loading is dropped by
+    // its loader when it finds the entry gone.
+    bool dropped_queued = false;
+    for (auto chunk = chunks.begin(); chunk != chunks.end();)
+    {
+        int x = (int) (chunk->first >> 32);
+        int z = (int) (std::uint32_t) chunk->first;
+        if (center_distance(x, z) <= radius + TERRAIN_EVICTION_MARGIN)
+        {
+            ++chunk;
+            continue;
+        }
+
+        switch (chunk->second)
+        {
+        case CHUNK_QUEUED:
+            dropped_queued = true;
+            stats.cancelled++;
+            break;
+        case CHUNK_LOADING:
+            break;
+        case CHUNK_LOADED:
+            for (std::size_t i = 0; i < loaded.size(); i++)
+            {
+                if (loaded[i].x == x && loaded[i].z == z)
+                {
+                    free_chunks.push_back(std::move(loaded[i]));
+                    loaded.erase(loaded.begin() + i);
+                    break;
+                }
+            }
+            stats.cancelled++;
+            break;
+        case CHUNK_RESIDENT:
+            p_evicted.push_back(chunk->first);
+            stats.evicted++;
+            stats.resident--;
+            break;
+        }
+        chunk = chunks.erase(chunk);
+    }
+    if (dropped_queued)
+    {
+        queue.erase(std::remove_if(queue.begin(), queue.end(),
+                                   [this](const Request& request)
+                                   {
+                                       auto chunk = chunks.find(get_terrain_chunk_key(request.x, request.z));
+                                       return chunk == chunks.end() || chunk->second != CHUNK_QUEUED;
+                                   }),
+                    queue.end());
+    }
+
+    std::chrono::steady_clock::time_point now       = std::chrono::steady_clock::now();
+    int                                   reach     = (int) std::ceil(radius / TERRAIN_CHUNK_SIZE) + 1;
+    int                                   center_x  = (int) std::floor(position.x / TERRAIN_CHUNK_SIZE);
+    int                                   center_z  = (int) std::floor(position.z / TERRAIN_CHUNK_SIZE);
+    bool                                  requested = false;
+    for (int z = center_z - reach; z <= center_z + reach; z++)
+    {
+        for (int x = center_x - reach; x <= center_x + reach; x++)
+        {
+            if (center_distance(x, z) > radius || !chunks.emplace(get_terrain_chunk_key(x, z), CHUNK_QUEUED).second)
+            {
+                continue;
+            }
+            queue.push_back({x, z, now});
+            stats.requested++;
+            requested = true;
+        }
+    }
+
+    // Nearest first, against where the camera is now rather than where it was when they were queued.
+    if (requested || dropped_queued)
+    {
+        std::sort(queue.begin(), queue.end(),
+                  [&center_distance](const Request& a, const Request& b)
+                  { return center_distance(a.x, a.z) < center_distance(b.x, b.z); });
+    }
+    stats.queued = queue.size();
+    lock.unlock();
+
+    if (requested)
+    {
+        changed.notify_all();
+    }
+}
+
+void TerrainStreamer::take_loaded(std::vector<TerrainChunk>& p_chunks, std::size_t p_max_chunks)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::size_t                 count = std::min(p_max_chunks, loaded.size());
+    for (std::size_t i = 0; i < count; i++)
+    {
+        chunks[get_terrain_chunk_key(loaded[i].x, loaded[i].z)] = CHUNK_RESIDENT;
+        p_chunks.push_back(std::move(loaded[i]));
+    }
+    loaded.erase(loaded.begin(), loaded.begin() + count);
+
+    stats.resident += count;
+    stats.max_resident = std::max(stats.max_resident, stats.resident);
+}
+
+void TerrainStreamer::recycle(TerrainChunk&& p_chunk)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (free_chunks.size() < loaders.size() + TERRAIN_SPARE_CHUNKS)
+    {
+        free_chunks.push_back(std::move(p_chunk));
+    }
+}
+
+bool TerrainStreamer::is_idle()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return queue.empty() && loading == 0 && loaded.empty();
+}
+
+float TerrainStreamer::get_radius() const
+{
+    return radius;
+}
+
+TerrainStreamerStats TerrainStreamer::get_stats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void TerrainStreamer::run()
+{
+    std::vector<std::uint16_t> heights;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        changed.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (stopping)
+        {
+            return;
+        }
+
+        Request request = queue.front();
+        queue.pop_front();
+        std::int64_t key = get_terrain_chunk_key(request.x, request.z);
+        chunks[key]      = CHUNK_LOADING;
+        loading++;
+
+        TerrainChunk chunk;
+        if (!free_chunks.empty())
+        {
+            chunk = std::move(free_chunks.back());
+            free_chunks.pop_back();
+        }
+
+        lock.unlock();
+        load(request, chunk, heights);
+        lock.lock();
+        loading--;
+
+        // Evicted, and maybe requested again, while it was loading.
+        auto entry = chunks.find(key);
+        if (entry == chunks.end() || entry->second != CHUNK_LOADING)
+        {
+            stats.cancelled++;
+            free_chunks.push_back(std::move(chunk));
+            continue;
+        }
+
+        entry->second           = CHUNK_LOADED;
+        chunk.load_milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                                                                            request.requested)
+                                          .count();
+        chunk.from_disk ? stats.loaded_from_disk++ : stats.generated++;
+        total_load_milliseconds += chunk.load_milliseconds;
+        stats.last_load_milliseconds = chunk.load_milliseconds;
+        stats.max_load_milliseconds  = std::max(stats.max_load_milliseconds, chunk.load_milliseconds);
+        stats.mean_load_milliseconds = total_load_milliseconds / (double) (stats.loaded_from_disk + stats.generated);
+        loaded.push_back(std::move(chunk));
+    }
+}
+
+void TerrainStreamer::load(const Request& p_request, TerrainChunk& p_chunk, std::vector<std::uint16_t>& p_heights) const
+{
+    const std::size_t sample_count = (std::size_t) TERRAIN_CHUNK_SAMPLES * TERRAIN_CHUNK_SAMPLES;
+
+    p_chunk.x         = p_request.x;
+    p_chunk.z         = p_request.z;
+    p_chunk.from_disk = false;
+    if (!directory.empty())
+    {
+        MappedFile file;
+        if (file.open(directory / get_terrain_chunk_name(p_request.x, p_request.z)))
+        {
+            if (file.size() == sample_count * sizeof(std::uint16_t))
+            {
+                p_heights.resize(sample_count);
+                std::memcpy(p_heights.data(), file.data(), file.size());
+                p_chunk.from_disk = true;
+            }
+            else
+            {
+                std::cout << "ERROR::TERRAIN::BAD_CHUNK_SIZE " << get_terrain_chunk_name(p_request.x, p_request.z)
+                          << std::endl;
+            }
+        }
+    }
+    if (!p_chunk.from_disk)
+    {
+        generate_terrain_heights(p_request.x, p_request.z, p_heights);
+    }
+
+    auto height = [&p_heights](int i, int j)
+    {
+        return TERRAIN_BASE_HEIGHT +
+               p_heights[(std::size_t) j * TERRAIN_CHUNK_SAMPLES + i] * (TERRAIN_HEIGHT_RANGE / 65535.0f);
+    };
+
+    const int row = TERRAIN_CHUNK_QUADS + 1;
+    p_chunk.vertices.resize(TERRAIN_CHUNK_VERTICES);
+    p_chunk.min_height = TERRAIN_BASE_HEIGHT + TERRAIN_HEIGHT_RANGE;
+    p_chunk.max_height = TERRAIN_BASE_HEIGHT;
+    for (int j = 0; j < row; j++)
+    {
+        for (int i = 0; i < row; i++)
+        {
+            // Grid vertex (i, j) is sample (i + 1, j + 1), the border only feeds the normals.
+            float          y      = height(i + 1, j + 1);
+            TerrainVertex& vertex = p_chunk.vertices[(std::size_t) j * row + i];
+            vertex.position       = glm::vec3(p_request.x * TERRAIN_CHUNK_SIZE + i * TERRAIN_QUAD_SIZE, y,
+                                              p_request.z * TERRAIN_CHUNK_SIZE + j * TERRAIN_QUAD_SIZE);
+            vertex.normal         = glm::normalize(glm::vec3(height(i, j + 1) - height(i + 2, j + 1),
+                                                             2.0f * TERRAIN_QUAD_SIZE,
+                                                             height(i + 1, j) - height(i + 1, j + 2)));
+            p_chunk.min_height    = std::min(p_chunk.min_height, y);
+            p_chunk.max_height    = std::max(p_chunk.max_height, y);
+        }
+    }
+
+    // Same order as build_terrain_indices() expects: bottom, top, left and right edges.
+    TerrainVertex* skirt = &p_chunk.vertices[(std::size_t) row * row];
+    for (int k = 0; k < row; k++)
+    {
+        skirt[k]           = p_chunk.vertices[k];
+        skirt[row + k]     = p_chunk.vertices[(std::size_t) (row - 1) * row + k];
+        skirt[2 * row + k] = p_chunk.vertices[(std::size_t) k * row];
+        skirt[3 * row + k] = p_chunk.vertices[(std::size_t) k * row + row - 1];
+    }
+    for (int k = 0; k < 4 * row; k++)
+    {
+        skirt[k].position.y -= TERRAIN_SKIRT_DEPTH;
+    }
+    p_chunk.min_height -= TERRAIN_SKIRT_DEPTH;
+}
+
+TerrainRenderer::TerrainRenderer(TerrainStreamer& p_streamer) :
+    streamer(p_streamer)
+{
+    stats = TerrainStats();
+
+    std::vector<std::uint16_t> indices;
+    build_terrain_indices(indices, first_index, index_count);
+
+    // Uploaded through GL_ARRAY_BUFFER, the element binding belongs to whichever vertex array is bound.
+    glGenBuffers(1, &index_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, index_buffer);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) (indices.size() * sizeof(std::uint16_t)), indices.data(),
+                 GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    ResourceRegistry::get_instance().track(RESOURCE_BUFFER, index_buffer, indices.size() * sizeof(std::uint16_t),
+                                           "terrain_indices");
+}
+
+TerrainRenderer::~TerrainRenderer()
+{
+    ResourceRegistry& registry = ResourceRegistry::get_instance();
+    for (auto& entry : gpu_chunks)
+    {
+        pool.push_back(entry.second);
+    }
+    for (GpuChunk& chunk : pool)
+    {
+        registry.untrack(RESOURCE_VERTEX_ARRAY, chunk.vao);
+        registry.untrack(RESOURCE_BUFFER, chunk.vbo);
+        glDeleteVertexArrays(1, &chunk.vao);
+        glDeleteBuffers(1, &chunk.vbo);
+    }
+    registry.untrack(RESOURCE_BUFFER, index_buffer);
+    glDeleteBuffers(1, &index_buffer);
+}
+
+TerrainRenderer::GpuChunk TerrainRenderer::create_chunk()
+{
+    if (!pool.empty())
+    {
+        GpuChunk chunk = pool.back();
+        pool.pop_back();
+        return chunk;
+    }
+
+    GpuChunk chunk;
+    glGenVertexArrays(1, &chunk.vao);
+    glGenBuffers(1, &chunk.vbo);
+    glBindVertexArray(chunk.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, chunk.vbo);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) (TERRAIN_CHUNK_VERTICES * sizeof(TerrainVertex)), NULL, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(TerrainVertex), (void*) offsetof(TerrainVertex, position));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(TerrainVertex), (void*) offsetof(TerrainVertex, normal));
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+    glBindVertexArray(0);
+
+    ResourceRegistry& registry = ResourceRegistry::get_instance();
+    registry.track(RESOURCE_VERTEX_ARRAY, chunk.vao, 0, "terrain");
+    registry.track(RESOURCE_BUFFER, chunk.vbo, TERRAIN_CHUNK_VERTICES * sizeof(TerrainVertex), "terrain");
+    return chunk;
+}
+
+void TerrainRenderer::update(const glm::vec3& p_camera_position)
+{
+    evicted.clear();
+    streamer.update(p_camera_position, evicted);
+    for (std::int64_t key : evicted)
+    {
+        auto chunk = gpu_chunks.find(key);
+        if (chunk != gpu_chunks.end())
+        {
+            pool.push_back(chunk->second);
+            gpu_chunks.erase(chunk);
+        }
+    }
+
+    // A few per frame, so a burst of loads does not turn into one long frame.
+    uploads.clear();
+    streamer.take_loaded(uploads, TERRAIN_MAX_UPLOADS_PER_FRAME);
+    for (TerrainChunk& upload : uploads)
+    {
+        GpuChunk chunk = create_chunk();
+        // Respecifying the whole store lets the driver rename a pooled buffer the GPU may still read.
+        glBindBuffer(GL_ARRAY_BUFFER, chunk.vbo);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) (upload.vertices.size() * sizeof(TerrainVertex)),
+                     upload.vertices.data(), GL_STATIC_DRAW);
+        chunk.min = glm::vec3(upload.x, 0.0f, upload.z) * TERRAIN_CHUNK_SIZE;
+        chunk.max = glm::vec3(upload.x + 1, 0.0f, upload.z + 1) * TERRAIN_CHUNK_SIZE;
+        chunk.min.y = upload.min_height;
+        chunk.max.y = upload.max_height;
+        gpu_chunks[get_terrain_chunk_key(upload.x, upload.z)] = chunk;
+        streamer.recycle(std::move(upload));
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    std::size_t index_total = first_index[TERRAIN_LOD_COUNT - 1] + index_count[TERRAIN_LOD_COUNT - 1];
+    stats.gpu_chunks        = gpu_chunks.size();
+    stats.pooled_chunks     = pool.size();
+    stats.gpu_bytes = (gpu_chunks.size() + pool.size()) * TERRAIN_CHUNK_VERTICES * sizeof(TerrainVertex) +
+                      index_total * sizeof(std::uint16_t);
+}
+
+void TerrainRenderer::draw(Shader& p_shader, const glm::mat4& p_view, const glm::mat4& p_projection,
+                           const glm::vec3& p_camera_position)
+{
+    p_shader.use();
+    p_shader.setMat4("model", glm::mat4(1.0f));
+    p_shader.setMat4("view", p_view);
+    p_shader.setMat4("projection", p_projection);
+
+    Frustum frustum      = make_frustum(p_projection * p_view);
+    stats.visible_chunks = 0;
+    stats.triangles      = 0;
+    std::fill(stats.lod_chunks, stats.lod_chunks + TERRAIN_LOD_COUNT, 0);
+    for (const auto& entry : gpu_chunks)
+    {
+        const GpuChunk& chunk = entry.second;
+        if (!aabb_in_frustum(frustum, chunk.min, chunk.max))
+        {
+            continue;
+        }
+
+        int lod = select_terrain_lod(p_camera_position, chunk.min, chunk.max);
+        glBindVertexArray(chunk.vao);
+        glDrawElements(GL_TRIANGLES, (GLsizei) index_count[lod], GL_UNSIGNED_SHORT,
+                       (void*) (first_index[lod] * sizeof(std::uint16_t)));
+        stats.visible_chunks++;
+        stats.triangles += index_count[lod] / 3;
+        stats.lod_chunks[lod]++;
+    }
+    glBindVertexArray(0);
+}
+
+TerrainStats TerrainRenderer::get_stats() const
+{
+    return stats;
+}
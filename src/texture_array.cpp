@@ -0,0 +1,285 @@
+#include "learn_opengl/texture_array.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include "glm/ext/vector_float4.hpp"
+#include "learn_opengl/file_system.hpp"
+#include "learn_opengl/resource_registry.hpp"
+
+TextureArrayPacker::TextureArrayPacker()
+{
+    atlas_pages = 0;
+}
+
+unsigned int TextureArrayPacker::add(int p_width, int p_height, std::vector<unsigned char>&& p_rgba)
+{
+    images.push_back({p_width, p_height, std::move(p_rgba)});
+    return (unsigned int) images.size() - 1;
+}
+
+unsigned int TextureArrayPacker::find_or_add_array(int p_width, int p_height)
+{
+    for (unsigned int i = 0; i < arrays.size(); i++)
+    {
+        if (arrays[i].width == p_width && arrays[i].height == p_height)
+        {
+            return i;
+        }
+    }
+
+    arrays.push_back({p_width, p_height, 0, {}});
+    return (unsigned int) arrays.size() - 1;
+}
+
+void TextureArrayPacker::pack()
+{
+    const int atlas_size = (int) TEXTURE_ATLAS_SIZE;
+    const int gutter     = (int) TEXTURE_ATLAS_GUTTER;
+
+    arrays.clear();
+    slots.assign(images.size(), {0, 0, glm::vec4(0.0f, 0.0f, 1.0f, 1.0f)});
+    atlas_pages = 0;
+
+    // Shelf packing, tallest first so each shelf wastes little height.
+    std::vector<unsigned int> small;
+    for (unsigned int i = 0; i < images.size(); i++)
+    {
+        if (images[i].width <= (int) TEXTURE_ATLAS_MAX_SIZE && images[i].height <= (int) TEXTURE_ATLAS_MAX_SIZE)
+        {
+            small.push_back(i);
+        }
+    }
+    std::stable_sort(small.begin(), small.end(),
+                     [this](unsigned int a, unsigned int b) { return images[a].height > images[b].height; });
+
+    std::vector<AtlasPlacement> placements(images.size());
+    unsigned int                page         = 0;
+    int                         shelf_x      = 0;
+    int                         shelf_y      = 0;
+    int                         shelf_height = 0;
+    for (unsigned int i : small)
+    {
+        int cell_width  = images[i].width + 2 * gutter;
+        int cell_height = images[i].height + 2 * gutter;
+
+        if (shelf_x + cell_width > atlas_size)
+        {
+            shelf_y += shelf_height;
+            shelf_x      = 0;
+            shelf_height = 0;
+        }
+        if (shelf_y + cell_height > atlas_size)
+        {
+            page++;
+            shelf_x      = 0;
+            shelf_y      = 0;
+            shelf_height = 0;
+        }
+
+        placements[i] = {page, shelf_x + gutter, shelf_y + gutter};
+        shelf_x += cell_width;
+        shelf_height = std::max(shelf_height, cell_height);
+    }
+    atlas_pages = small.empty() ? 0 : page + 1;
+
+    // Every other image is a whole layer of the array matching its size.
+    for (unsigned int i = 0; i < images.size(); i++)
+    {
+        if (images[i].width <= (int) TEXTURE_ATLAS_MAX_SIZE && images[i].height <= (int) TEXTURE_ATLAS_MAX_SIZE)
+        {
+            continue;
+        }
+
+        unsigned int array = find_or_add_array(images[i].width, images[i].height);
+        slots[i].array     = array;
+        slots[i].layer     = (unsigned int) arrays[array].layers++;
+    }
+
+    // Atlas pages go after them, in the array of the page size.
+    if (atlas_pages > 0)
+    {
+        unsigned int array      = find_or_add_array(atlas_size, atlas_size);
+        unsigned int first_page = (unsigned int) arrays[array].layers;
+        arrays[array].layers += (int) atlas_pages;
+
+        for (unsigned int i : small)
+        {
+            const AtlasPlacement& placement = placements[i];
+            slots[i].array                  = array;
+            slots[i].layer                  = first_page + placement.page;
+            slots[i].uv_rect = glm::vec4((float) placement.x / atlas_size, (float) placement.y / atlas_size,
+                                         (float) images[i].width / atlas_size, (float) images[i].height / atlas_size);
+        }
+    }
+
+    for (TextureArrayImage& array : arrays)
+    {
+        array.pixels.assign((std::size_t) array.width * array.height * 4 * array.layers, 0);
+    }
+
+    for (unsigned int i = 0; i < images.size(); i++)
+    {
+        TextureArrayImage& array       = arrays[slots[i].array];
+        std::size_t        layer_bytes = (std::size_t) array.width * array.height * 4;
+        unsigned char*     layer       = array.pixels.data() + layer_bytes * slots[i].layer;
+
+        if (slots[i].uv_rect == glm::vec4(0.0f, 0.0f, 1.0f, 1.0f) && images[i].width == array.width &&
+            images[i].height == array.height)
+        {
+            std::memcpy(layer, images[i].rgba.data(), layer_bytes);
+        }
+        else
+        {
+            copy_with_gutter(images[i], layer, array.width, placements[i].x, placements[i].y, gutter);
+        }
+    }
+}
+
+void TextureArrayPacker::copy_with_gutter(const SourceImage& p_image, unsigned char* p_layer, int p_layer_width,
+                                          int p_x, int p_y, int p_gutter) const
+{
+    for (int y = -p_gutter; y < p_image.height + p_gutter; y++)
+    {
+        int                  source_y   = std::clamp(y, 0, p_image.height - 1);
+        const unsigned char* source_row = p_image.rgba.data() + (std::size_t) source_y * p_image.width * 4;
+        unsigned char*       target_row = p_layer + ((std::size_t) (p_y + y) * p_layer_width + p_x) * 4;
+
+        for (int x = -p_gutter; x < p_image.width + p_gutter; x++)
+        {
+            int source_x = std::clamp(x, 0, p_image.width - 1);
+            std::memcpy(target_row + x * 4, source_row + source_x * 4, 4);
+        }
+    }
+}
+
+void TextureArrayPacker::clear_pixels()
+{
+    std::vector<SourceImage>().swap(images);
+    for (TextureArrayImage& array : arrays)
+    {
+        std::vector<unsigned char>().swap(array.pixels);
+    }
+}
+
+const std::vector<TextureSlot>& TextureArrayPacker::get_slots() const
+{
+    return slots;
+}
+
+const std::vector<TextureArrayImage>& TextureArrayPacker::get_arrays() const
+{
+    return arrays;
+}
+
+unsigned int TextureArrayPacker::get_atlas_page_count() const
+{
+    return atlas_pages;
+}
+
+TextureArraySet::TextureArraySet()
+{
+}
+
+TextureArraySet::~TextureArraySet()
+{
+    for (unsigned int texture : textures)
+    {
+        ResourceRegistry::get_instance().untrack(RESOURCE_TEXTURE, texture);
+    }
+    if (!textures.empty())
+    {
+        glDeleteTextures((GLsizei) textures.size(), textures.data());
+    }
+}
+
+unsigned int TextureArraySet::add_file(const std::string& p_path)
+{
+    FileView       file = FileSystem::get_instance().read_file(p_path);
+    int            width, height, components;
+    unsigned char* data = NULL;
+    if (file.is_valid())
+    {
+        // Everything is expanded to RGBA8 so textures of one size can always share an array.
+        data = stbi_load_from_memory(file.data(), (int) file.size(), &width, &height, &components, 4);
+    }
+
+    if (!data)
+    {
+        std::cout << "Failed to load texture: " << p_path << std::endl;
+        return TEXTURE_SLOT_NONE;
+    }
+
+    std::vector<unsigned char> rgba(data, data + (std::size_t) width * height * 4);
+    stbi_image_free(data);
+
+    return packer.add(width, height, std::move(rgba));
+}
+
+void TextureArraySet::upload()
+{
+    packer.pack();
+
+    const std::vector<TextureArrayImage>& arrays = packer.get_arrays();
+    textures.resize(arrays.size());
+    if (!textures.empty())
+    {
+        glGenTextures((GLsizei) textures.size(), textures.data());
+    }
+
+    for (unsigned int i = 0; i < arrays.size(); i++)
+    {
+        const TextureArrayImage& array = arrays[i];
+
+        glBindTexture(GL_TEXTURE_2D_ARRAY, textures[i]);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, array.width, array.height, array.layers, 0, GL_RGBA,
+                     GL_UNSIGNED_BYTE, array.pixels.data());
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+
+        // Wrapping happens in the shader, inside each slot's rectangle.
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        ResourceRegistry::get_instance().track(RESOURCE_TEXTURE, textures[i],
+                                               get_texture_bytes(array.width, array.height, 4, true) * array.layers,
+                                               "texture_arrays");
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    packer.clear_pixels();
+}
+
+const TextureSlot& TextureArraySet::get_slot(unsigned int p_slot) const
+{
+    return packer.get_slots()[p_slot];
+}
+
+unsigned int TextureArraySet::get_array_texture(unsigned int p_array) const
+{
+    return textures[p_array];
+}
+
+unsigned int TextureArraySet::get_array_count() const
+{
+    return (unsigned int) textures.size();
+}
+
+unsigned int TextureArraySet::get_slot_count() const
+{
+    return (unsigned int) packer.get_slots().size();
+}
+
+unsigned int TextureArraySet::get_atlas_page_count() const
+{
+    return packer.get_atlas_page_count();
+}
@@ -0,0 +1,257 @@
+#include "learn_opengl/vegetation.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "glm/common.hpp"
+#include "glm/geometric.hpp"
+#include "learn_opengl/resource_registry.hpp"
+
+VegetationField::VegetationField()
+{
+    stats = VegetationStats();
+}
+
+void VegetationField::scatter(unsigned int p_count, const glm::vec3& p_center, float p_size,
+                              const VegetationSurface& p_surface, std::uint32_t p_seed)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    std::mt19937                          random(p_seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    int       cells_per_side = std::max(1, (int) std::ceil(p_size / VEGETATION_CELL_SIZE));
+    glm::vec3 origin         = p_center - glm::vec3(p_size * 0.5f, 0.0f, p_size * 0.5f);
+
+    // Generated in random order and binned with a stable counting sort, which keeps each cell's
+    // instances in that random order.
+    std::vector<GrassInstance> scattered(p_count);
+    std::vector<std::uint32_t> cell_of(p_count);
+    cells.assign((std::size_t) cells_per_side * cells_per_side, VegetationCell());
+    for (unsigned int i = 0; i < p_count; i++)
+    {
+        float x = origin.x + unit(random) * p_size;
+        float z = origin.z + unit(random) * p_size;
+
+        GrassInstance& instance = scattered[i];
+        instance.position       = glm::vec3(x, p_surface(x, z), z);
+        instance.height         = 0.35f + 0.3f * unit(random);
+        instance.width          = instance.height * (0.8f + 0.4f * unit(random));
+        instance.tint           = 0.75f + 0.25f * unit(random);
+
+        int cell_x = std::min(cells_per_side - 1, (int) ((x - origin.x) / VEGETATION_CELL_SIZE));
+        int cell_z = std::min(cells_per_side - 1, (int) ((z - origin.z) / VEGETATION_CELL_SIZE));
+        cell_of[i] = (std::uint32_t) (cell_z * cells_per_side + cell_x);
+        cells[cell_of[i]].instance_count++;
+    }
+
+    std::uint32_t first = 0;
+    for (std::size_t c = 0; c < cells.size(); c++)
+    {
+        VegetationCell& cell = cells[c];
+        int             x    = (int) (c % cells_per_side);
+        int             z    = (int) (c / cells_per_side);
+        cell.first_instance  = first;
+        cell.min             = origin + glm::vec3(x * VEGETATION_CELL_SIZE, 0.0f, z * VEGETATION_CELL_SIZE);
+        cell.max             = cell.min + glm::vec3(VEGETATION_CELL_SIZE, 0.0f, VEGETATION_CELL_SIZE);
+        cell.min.y           = INFINITY;
+        cell.max.y           = -INFINITY;
+        first += cell.instance_count;
+        cell.instance_count = 0;
+    }
+
+    instances.resize(p_count);
+    for (unsigned int i = 0; i < p_count; i++)
+    {
+        VegetationCell&      cell     = cells[cell_of[i]];
+        const GrassInstance& instance = scattered[i];
+        cell.min.y = std::min(cell.min.y, instance.position.y);
+        cell.max.y = std::max(cell.max.y, instance.position.y + instance.height);
+        instances[cell.first_instance + cell.instance_count++] = instance;
+    }
+
+    // Empty cells would only cost a test every frame.
+    cells.erase(std::remove_if(cells.begin(), cells.end(),
+                               [](const VegetationCell& cell) { return cell.instance_count == 0; }),
+                cells.end());
+
+    stats                      = VegetationStats();
+    stats.instance_count       = instances.size();
+    stats.cell_count           = cells.size();
+    stats.scatter_milliseconds =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void VegetationField::select(const Frustum& p_frustum, const glm::vec3& p_camera_position,
+                             std::vector<VegetationDraw>& p_draws)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    visible.clear();
+    for (const VegetationCell& cell : cells)
+    {
+        float distance = glm::length(p_camera_position - glm::clamp(p_camera_position, cell.min, cell.max));
+        if (distance >= VEGETATION_FADE_END_DISTANCE || !aabb_in_frustum(p_frustum, cell.min, cell.max))
+        {
+            continue;
+        }
+
+        float share = 1.0f - std::clamp((distance - VEGETATION_FULL_DENSITY_DISTANCE) /
+                                                (VEGETATION_FADE_END_DISTANCE - VEGETATION_FULL_DENSITY_DISTANCE),
+                                        0.0f, 1.0f);
+        std::uint32_t count = (std::uint32_t) std::ceil(cell.instance_count * share);
+        if (count > 0)
+        {
+            visible.push_back({distance, {cell.first_instance, count}});
+        }
+    }
+    std::sort(visible.begin(), visible.end(),
+              [](const std::pair<float, VegetationDraw>& a, const std::pair<float, VegetationDraw>& b)
+              { return a.first < b.first; });
+
+    p_draws.clear();
+    stats.drawn_instances = 0;
+    for (const auto& entry : visible)
+    {
+        p_draws.push_back(entry.second);
+        stats.drawn_instances += entry.second.instance_count;
+    }
+    stats.visible_cells = p_draws.size();
+    stats.select_milliseconds =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+const std::vector<GrassInstance>& VegetationField::get_instances() const
+{
+    return instances;
+}
+
+const std::vector<VegetationCell>& VegetationField::get_cells() const
+{
+    return cells;
+}
+
+VegetationStats VegetationField::get_stats() const
+{
+    return stats;
+}
+
+VegetationRenderer::VegetationRenderer(VegetationField& p_field, unsigned int p_texture) :
+    field(p_field)
+{
+    texture    = p_texture;
+    draw_calls = 0;
+
+    // Corners of a billboard standing on its base, drawn as a strip.
+    const float corners[] = {-0.5f, 0.0f, 0.5f, 0.0f, -0.5f, 1.0f, 0.5f, 1.0f};
+
+    const std::vector<GrassInstance>& instances = field.get_instances();
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &quad_buffer);
+    glGenBuffers(1, &instance_buffer);
+    glBindVertexArray(vao);
+
+    glBindBuffer(GL_ARRAY_BUFFER, quad_buffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*) 0);
+
+    // The instance attributes are pointed at each cell's range when it is drawn.
+    glBindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) (instances.size() * sizeof(GrassInstance)), instances.data(),
+                 GL_STATIC_DRAW);
+    glEnableVertexAttribArray(2);
+    glVertexAttribDivisor(2, 1);
+    glEnableVertexAttribArray(3);
+    glVertexAttribDivisor(3, 1);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    ResourceRegistry& registry = ResourceRegistry::get_instance();
+    registry.track(RESOURCE_VERTEX_ARRAY, vao, 0, "vegetation");
+    registry.track(RESOURCE_BUFFER, quad_buffer, sizeof(corners), "vegetation");
+    registry.track(RESOURCE_BUFFER, instance_buffer, instances.size() * sizeof(GrassInstance), "vegetation");
+}
+
+VegetationRenderer::~VegetationRenderer()
+{
+    ResourceRegistry& registry = ResourceRegistry::get_instance();
+    registry.untrack(RESOURCE_VERTEX_ARRAY, vao);
+    registry.untrack(RESOURCE_BUFFER, quad_buffer);
+    registry.untrack(RESOURCE_BUFFER, instance_buffer);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &quad_buffer);
+    glDeleteBuffers(1, &instance_buffer);
+}
+
+void VegetationRenderer::draw(Shader& p_shader, Shader* p_prepass_shader, bool p_depth_prepass,
+                              const glm::mat4& p_view, const glm::mat4& p_projection,
+                              const glm::vec3& p_camera_position)
+{
+    field.select(make_frustum(p_projection * p_view), p_camera_position, draws);
+    draw_calls = 0;
+    if (draws.empty())
+    {
+        return;
+    }
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+
+    if (p_depth_prepass && p_prepass_shader)
+    {
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        draw_cells(*p_prepass_shader, p_view, p_projection);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+        // Only the fragments that won the prepass are left, each shaded once.
+        glDepthFunc(GL_EQUAL);
+        glDepthMask(GL_FALSE);
+        draw_cells(p_shader, p_view, p_projection);
+        glDepthMask(GL_TRUE);
+        glDepthFunc(GL_LESS);
+    }
+    else
+    {
+        draw_cells(p_shader, p_view, p_projection);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+unsigned int VegetationRenderer::get_draw_calls() const
+{
+    return draw_calls;
+}
+
+void VegetationRenderer::draw_cells(Shader& p_shader, const glm::mat4& p_view, const glm::mat4& p_projection)
+{
+    p_shader.use();
+    p_shader.setMat4("model", glm::mat4(1.0f));
+    p_shader.setMat4("view", p_view);
+    p_shader.setMat4("projection", p_projection);
+    p_shader.setInt("texture1", 0);
+
+    for (const VegetationDraw& draw : draws)
+    {
+        std::size_t offset = draw.first_instance * sizeof(GrassInstance);
+        glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(GrassInstance),
+                              (void*) (offset + offsetof(GrassInstance, position)));
+        glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(GrassInstance),
+                              (void*) (offset + offsetof(GrassInstance, width)));
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei) draw.instance_count);
+        draw_calls++;
+    }
+}
@@ -0,0 +1,1001 @@
+#include "learn_opengl/virtual_texture.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <utility>
+
+#include "glm/ext/vector_float3.hpp"
+#include "glm/ext/vector_float4.hpp"
+#include "learn_opengl/file_system.hpp"
+#include "learn_opengl/memory_stats.hpp"
+#include "learn_opengl/resource_registry.hpp"
+#include "stb_image.h"
+
+const char          VT_MAGIC[4]      = {'V', 'T', 'X', '1'};
+const std::uint64_t VT_NO_TILE       = ~0ull;
+// Tile buffers kept for reuse beyond what one frame's uploads need are freed.
+const std::size_t   VT_SPARE_TILES   = 4;
+const int           VT_MAX_MIP_COUNT = 32;
+
+// Indirection entries are uploaded as RGBA8 straight from these words, so red is the low byte.
+static std::uint32_t pack_indirection_entry(unsigned int p_page_x, unsigned int p_page_y, int p_mip)
+{
+    return p_page_x | p_page_y << 8 | (std::uint32_t) p_mip << 16 | 0xFF000000u;
+}
+
+static int wrap_texel(int p_texel, int p_size)
+{
+    return (p_texel % p_size + p_size) % p_size;
+}
+
+static void split_virtual_tile_key(std::uint64_t p_key, unsigned int& p_texture, int& p_mip, int& p_x, int& p_y)
+{
+    p_texture = (unsigned int) (p_key >> 40);
+    p_mip     = (int) ((p_key >> 32) & 0xFF);
+    p_y       = (int) ((p_key >> 16) & 0xFFFF);
+    p_x       = (int) (p_key & 0xFFFF);
+}
+
+std::uint64_t make_virtual_tile_key(unsigned int p_texture, int p_mip, int p_x, int p_y)
+{
+    return (std::uint64_t) p_texture << 40 | (std::uint64_t) p_mip << 32 | (std::uint64_t) p_y << 16 |
+           (std::uint64_t) p_x;
+}
+
+bool get_virtual_texture_info(const VirtualTextureHeader& p_header, VirtualTextureInfo& p_info)
+{
+    if (std::memcmp(p_header.magic, VT_MAGIC, sizeof(VT_MAGIC)) != 0 || p_header.tile_size != VT_TILE_SIZE ||
+        p_header.tile_border != VT_TILE_BORDER || p_header.width == 0 || p_header.height == 0 ||
+        p_header.mip_count == 0 || p_header.mip_count > VT_MAX_MIP_COUNT)
+    {
+        return false;
+    }
+
+    p_info.width     = (int) p_header.width;
+    p_info.height    = (int) p_header.height;
+    p_info.mip_count = (int) p_header.mip_count;
+
+    std::size_t tiles = 0;
+    for (int mip = 0; mip < p_info.mip_count; mip++)
+    {
+        int width              = std::max(1, p_info.width >> mip);
+        int height             = std::max(1, p_info.height >> mip);
+        p_info.first_tile[mip] = tiles;
+        p_info.tiles_x[mip]    = (width + VT_TILE_SIZE - 1) / VT_TILE_SIZE;
+        p_info.tiles_y[mip]    = (height + VT_TILE_SIZE - 1) / VT_TILE_SIZE;
+        tiles += (std::size_t) p_info.tiles_x[mip] * p_info.tiles_y[mip];
+    }
+
+    int last = p_info.mip_count - 1;
+    if (p_info.tiles_x[0] > VT_MAX_TILES_PER_SIDE || p_info.tiles_y[0] > VT_MAX_TILES_PER_SIDE ||
+        p_info.tiles_x[last] != 1 || p_info.tiles_y[last] != 1)
+    {
+        return false;
+    }
+
+    p_info.tiles_side = 1;
+    while (p_info.tiles_side < std::max(p_info.tiles_x[0], p_info.tiles_y[0]))
+    {
+        p_info.tiles_side *= 2;
+    }
+    return true;
+}
+
+bool cook_virtual_texture(const std::uint8_t* p_pixels, int p_width, int p_height,
+                          const std::filesystem::path& p_output)
+{
+    int mip_count = 1;
+    while ((p_width >> (mip_count - 1)) > VT_TILE_SIZE || (p_height >> (mip_count - 1)) > VT_TILE_SIZE)
+    {
+        mip_count++;
+    }
+
+    VirtualTextureHeader header;
+    std::memcpy(header.magic, VT_MAGIC, sizeof(VT_MAGIC));
+    header.width       = (std::uint32_t) p_width;
+    header.height      = (std::uint32_t) p_height;
+    header.tile_size   = VT_TILE_SIZE;
+    header.tile_border = VT_TILE_BORDER;
+    header.mip_count   = (std::uint32_t) mip_count;
+
+    VirtualTextureInfo info;
+    if (p_width <= 0 || p_height <= 0 || !get_virtual_texture_info(header, info))
+    {
+        std::cout << "ERROR::VIRTUAL_TEXTURE::UNSUPPORTED_SIZE " << p_width << "x" << p_height << std::endl;
+        return false;
+    }
+
+    std::ofstream file(p_output, std::ios::binary);
+    file.write((const char*) &header, sizeof(header));
+
+    // Level 0 is read in place, each coarser level is a 2x2 box filter of the one before.
+    const std::uint8_t*       level  = p_pixels;
+    int                       width  = p_width;
+    int                       height = p_height;
+    std::vector<std::uint8_t> current, next, tile(VT_PAGE_BYTES);
+    std::vector<int>          columns(VT_PAGE_SIZE);
+    for (int mip = 0; mip < mip_count; mip++)
+    {
+        for (int tile_y = 0; tile_y < info.tiles_y[mip]; tile_y++)
+        {
+            for (int tile_x = 0; tile_x < info.tiles_x[mip]; tile_x++)
+            {
+                // The border and the part of the last tiles past the image wrap around, like GL_REPEAT.
+                for (int x = 0; x < VT_PAGE_SIZE; x++)
+                {
+                    columns[x] = wrap_texel(tile_x * VT_TILE_SIZE + x - VT_TILE_BORDER, width);
+                }
+                for (int y = 0; y < VT_PAGE_SIZE; y++)
+                {
+                    int                 row    = wrap_texel(tile_y * VT_TILE_SIZE + y - VT_TILE_BORDER, height);
+                    const std::uint8_t* source = level + (std::size_t) row * width * 4;
+                    std::uint8_t*       target = &tile[(std::size_t) y * VT_PAGE_SIZE * 4];
+                    for (int x = 0; x < VT_PAGE_SIZE; x++)
+                    {
+                        std::memcpy(target + x * 4, source + (std::size_t) columns[x] * 4, 4);
+                    }
+                }
+                file.write((const char*) tile.data(), (std::streamsize) tile.size());
+            }
+        }
+
+        if (mip + 1 == mip_count)
+        {
+            break;
+        }
+
+        int next_width  = std::max(1, width / 2);
+        int next_height = std::max(1, height / 2);
+        next.resize((std::size_t) next_width * next_height * 4);
+        for (int y = 0; y < next_height; y++)
+        {
+            const std::uint8_t* row0 = level + (std::size_t) std::min(2 * y, height - 1) * width * 4;
+            const std::uint8_t* row1 = level + (std::size_t) std::min(2 * y + 1, height - 1) * width * 4;
+            for (int x = 0; x < next_width; x++)
+            {
+                int x0 = std::min(2 * x, width - 1) * 4;
+                int x1 = std::min(2 * x + 1, width - 1) * 4;
+                for (int c = 0; c < 4; c++)
+                {
+                    next[((std::size_t) y * next_width + x) * 4 + c] =
+                            (std::uint8_t) ((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+                }
+            }
+        }
+        current.swap(next);
+        level  = current.data();
+        width  = next_width;
+        height = next_height;
+    }
+
+    if (!file)
+    {
+        std::cout << "ERROR::VIRTUAL_TEXTURE::CANNOT_WRITE " << p_output.string() << std::endl;
+        return false;
+    }
+
+    std::size_t tiles = info.first_tile[mip_count - 1] + 1;
+    std::cout << "Cooked " << p_output.string() << ": " << p_width << "x" << p_height << ", " << mip_count
+              << " mips, " << tiles << " tiles (" << format_bytes(sizeof(header) + tiles * VT_PAGE_BYTES) << ")"
+              << std::endl;
+    return true;
+}
+
+bool cook_virtual_texture_file(const std::filesystem::path& p_image, const std::filesystem::path& p_output)
+{
+    FileView       file = FileSystem::get_instance().read_file(p_image.string());
+    int            width, height, channels;
+    unsigned char* data = NULL;
+    if (file.is_valid())
+    {
+        data = stbi_load_from_memory(file.data(), (int) file.size(), &width, &height, &channels, 4);
+    }
+    if (!data)
+    {
+        std::cout << "ERROR::VIRTUAL_TEXTURE::CANNOT_LOAD " << p_image.string() << std::endl;
+        return false;
+    }
+
+    bool cooked = cook_virtual_texture(data, width, height, p_output);
+    stbi_image_free(data);
+    return cooked;
+}
+
+VirtualTextureCache::VirtualTextureCache(unsigned int p_pages_per_side)
+{
+    pages_per_side = std::clamp(p_pages_per_side, 1u, VT_MAX_PAGES_PER_SIDE);
+    lru_head       = -1;
+    lru_tail       = -1;
+    frame          = 1;
+    loading        = 0;
+    stopping       = false;
+    stats          = VirtualTextureStats();
+
+    unsigned int page_count = pages_per_side * pages_per_side;
+    page_keys.assign(page_count, VT_NO_TILE);
+    page_frames.assign(page_count, 0);
+    page_prev.assign(page_count, -1);
+    page_next.assign(page_count, -1);
+    page_pinned.assign(page_count, false);
+    for (unsigned int page = 0; page < page_count; page++)
+    {
+        touch_page((int) page);
+        page_frames[page] = 0;
+    }
+
+    stats.page_count     = page_count;
+    stats.physical_bytes = (std::uint64_t) page_count * VT_PAGE_BYTES;
+
+    loader = std::thread(&VirtualTextureCache::run, this);
+}
+
+VirtualTextureCache::~VirtualTextureCache()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    loader.join();
+}
+
+unsigned int VirtualTextureCache::add_texture(const std::filesystem::path& p_cooked_path)
+{
+    std::unique_ptr<MappedFile> file = std::make_unique<MappedFile>();
+    if (!file->open(p_cooked_path))
+    {
+        std::cout << "ERROR::VIRTUAL_TEXTURE::CANNOT_OPEN " << p_cooked_path.string() << std::endl;
+        return VIRTUAL_TEXTURE_NONE;
+    }
+
+    VirtualTextureHeader header;
+    VirtualTextureInfo   info;
+    if (file->size() < sizeof(header))
+    {
+        std::cout << "ERROR::VIRTUAL_TEXTURE::INVALID_FILE " << p_cooked_path.string() << std::endl;
+        return VIRTUAL_TEXTURE_NONE;
+    }
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (!get_virtual_texture_info(header, info) ||
+        file->size() != sizeof(header) + (info.first_tile[info.mip_count - 1] + 1) * VT_PAGE_BYTES)
+    {
+        std::cout << "ERROR::VIRTUAL_TEXTURE::INVALID_FILE " << p_cooked_path.string() << std::endl;
+        return VIRTUAL_TEXTURE_NONE;
+    }
+    if (textures.size() >= VT_MAX_TEXTURES)
+    {
+        std::cout << "ERROR::VIRTUAL_TEXTURE::TOO_MANY_TEXTURES " << p_cooked_path.string() << std::endl;
+        return VIRTUAL_TEXTURE_NONE;
+    }
+
+    // The coarsest tile never leaves its page, so each texture takes one page for good.
+    int page = allocate_page();
+    if (page < 0 || textures.size() + 1 >= page_keys.size())
+    {
+        std::cout << "ERROR::VIRTUAL_TEXTURE::NO_FREE_PAGE " << p_cooked_path.string() << std::endl;
+        return VIRTUAL_TEXTURE_NONE;
+    }
+
+    Texture texture;
+    texture.file = std::move(file);
+    texture.info = info;
+    for (int mip = 0; mip < info.mip_count; mip++)
+    {
+        int side = std::max(1, info.tiles_side >> mip);
+        texture.indirection.emplace_back((std::size_t) side * side, 0u);
+        texture.pages.emplace_back((std::size_t) info.tiles_x[mip] * info.tiles_y[mip], -1);
+        texture.dirty.push_back({0, 0, 0, 0});
+    }
+
+    unsigned int id = (unsigned int) textures.size();
+    {
+        // The loader reads the textures' mappings while this may reallocate.
+        std::lock_guard<std::mutex> lock(mutex);
+        textures.push_back(std::move(texture));
+
+        stats.texture_count++;
+        for (int mip = 0; mip < info.mip_count; mip++)
+        {
+            std::uint64_t texels = (std::uint64_t) std::max(1, info.width >> mip) * std::max(1, info.height >> mip);
+            stats.virtual_bytes += texels * 4;
+        }
+    }
+
+    VirtualTile tile;
+    tile.key  = make_virtual_tile_key(id, info.mip_count - 1, 0, 0);
+    tile.page = page;
+    const std::uint8_t* source = get_tile_data(tile.key);
+    tile.texels.assign(source, source + VT_PAGE_BYTES);
+
+    unlink_page(page);
+    page_pinned[page] = true;
+    assign_page(page, tile.key);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    pinned_uploads.push_back(std::move(tile));
+    return id;
+}
+
+const VirtualTextureInfo& VirtualTextureCache::get_info(unsigned int p_texture) const
+{
+    return textures[p_texture].info;
+}
+
+void VirtualTextureCache::process_feedback(const std::uint8_t* p_texels, std::size_t p_texel_count)
+{
+    // Neighbouring texels mostly ask for the same tile, so runs are skipped before the sort.
+    needed.clear();
+    std::uint32_t previous = 0;
+    for (std::size_t i = 0; i < p_texel_count; i++)
+    {
+        std::uint32_t texel;
+        std::memcpy(&texel, p_texels + i * 4, sizeof(texel));
+        if (texel == previous || (texel >> 24) == 0)
+        {
+            continue;
+        }
+        previous = texel;
+
+        unsigned int texture = (texel >> 24) - 1;
+        int          mip     = (int) ((texel >> 16) & 0xFF);
+        int          x       = (int) (texel & 0xFF);
+        int          y       = (int) ((texel >> 8) & 0xFF);
+        if (texture >= textures.size() || mip >= textures[texture].info.mip_count ||
+            x >= textures[texture].info.tiles_x[mip] || y >= textures[texture].info.tiles_y[mip])
+        {
+            continue;
+        }
+        needed.push_back(make_virtual_tile_key(texture, mip, x, y));
+    }
+    std::sort(needed.begin(), needed.end());
+    needed.erase(std::unique(needed.begin(), needed.end()), needed.end());
+
+    // Every coarser tile above a requested one too: they are what the lookup falls back to until it
+    // arrives, and loading coarsest first keeps the gaps blurry rather than far too blurry.
+    std::size_t requested = needed.size();
+    for (std::size_t i = 0; i < requested; i++)
+    {
+        unsigned int texture;
+        int          mip, x, y;
+        split_virtual_tile_key(needed[i], texture, mip, x, y);
+        while (++mip < textures[texture].info.mip_count)
+        {
+            x /= 2;
+            y /= 2;
+            needed.push_back(make_virtual_tile_key(texture, mip, x, y));
+        }
+    }
+    std::sort(needed.begin(), needed.end(),
+              [](std::uint64_t a, std::uint64_t b)
+              {
+                  std::uint64_t mip_a = (a >> 32) & 0xFF;
+                  std::uint64_t mip_b = (b >> 32) & 0xFF;
+                  return mip_a != mip_b ? mip_a > mip_b : a < b;
+              });
+    needed.erase(std::unique(needed.begin(), needed.end()), needed.end());
+
+    std::size_t missing = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (std::uint64_t key : queue)
+        {
+            pending.erase(key);
+        }
+        queue.clear();
+
+        for (std::uint64_t key : needed)
+        {
+            auto entry = resident.find(key);
+            if (entry != resident.end())
+            {
+                touch_page(entry->second);
+                continue;
+            }
+
+            missing++;
+            if (queue.size() < VT_MAX_QUEUED && pending.insert(key).second)
+            {
+                queue.push_back(key);
+            }
+        }
+
+        stats.requested_tiles = needed.size();
+        stats.missing_tiles   = missing;
+        stats.queued_tiles    = queue.size();
+    }
+
+    if (missing > 0)
+    {
+        changed.notify_all();
+    }
+}
+
+void VirtualTextureCache::take_loaded(std::vector<VirtualTile>& p_tiles, std::size_t p_max_tiles)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (VirtualTile& tile : pinned_uploads)
+    {
+        p_tiles.push_back(std::move(tile));
+    }
+    pinned_uploads.clear();
+
+    std::size_t taken = 0;
+    std::size_t count = 0;
+    for (; count < loaded.size() && taken < p_max_tiles; count++)
+    {
+        VirtualTile& tile = loaded[count];
+        pending.erase(tile.key);
+
+        // Every page holds a tile this frame needs. Dropped, the next feedback asks for it again.
+        int page = allocate_page();
+        if (page < 0)
+        {
+            stats.cache_full++;
+            free_tiles.push_back(std::move(tile));
+            continue;
+        }
+
+        assign_page(page, tile.key);
+        touch_page(page);
+        tile.page = page;
+        p_tiles.push_back(std::move(tile));
+        stats.loaded_tiles++;
+        taken++;
+    }
+    loaded.erase(loaded.begin(), loaded.begin() + count);
+}
+
+void VirtualTextureCache::recycle(VirtualTile&& p_tile)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (free_tiles.size() < VT_MAX_UPLOADS_PER_FRAME + VT_SPARE_TILES)
+    {
+        free_tiles.push_back(std::move(p_tile));
+    }
+}
+
+void VirtualTextureCache::end_frame()
+{
+    frame++;
+}
+
+const std::vector<std::uint32_t>& VirtualTextureCache::get_indirection(unsigned int p_texture, int p_mip) const
+{
+    return textures[p_texture].indirection[p_mip];
+}
+
+bool VirtualTextureCache::take_dirty_region(unsigned int p_texture, int p_mip, int p_region[4])
+{
+    std::array<int, 4>& dirty = textures[p_texture].dirty[p_mip];
+    if (dirty[2] == 0)
+    {
+        return false;
+    }
+
+    std::copy(dirty.begin(), dirty.end(), p_region);
+    dirty = {0, 0, 0, 0};
+    return true;
+}
+
+bool VirtualTextureCache::is_idle()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return queue.empty() && loading == 0 && loaded.empty() && pinned_uploads.empty();
+}
+
+unsigned int VirtualTextureCache::get_pages_per_side() const
+{
+    return pages_per_side;
+}
+
+VirtualTextureStats VirtualTextureCache::get_stats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    VirtualTextureStats result = stats;
+    result.resident_pages      = (unsigned int) resident.size();
+    return result;
+}
+
+void VirtualTextureCache::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        changed.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (stopping)
+        {
+            return;
+        }
+
+        std::uint64_t key = queue.front();
+        queue.pop_front();
+        loading++;
+
+        VirtualTile tile;
+        if (!free_tiles.empty())
+        {
+            tile = std::move(free_tiles.back());
+            free_tiles.pop_back();
+        }
+        const std::uint8_t* source = get_tile_data(key);
+
+        // Copying out of the mapping is where the file is actually read, so it happens unlocked.
+        lock.unlock();
+        tile.key  = key;
+        tile.page = -1;
+        tile.texels.assign(source, source + VT_PAGE_BYTES);
+        lock.lock();
+
+        loading--;
+        loaded.push_back(std::move(tile));
+    }
+}
+
+const std::uint8_t* VirtualTextureCache::get_tile_data(std::uint64_t p_key) const
+{
+    unsigned int texture;
+    int          mip, x, y;
+    split_virtual_tile_key(p_key, texture, mip, x, y);
+
+    const VirtualTextureInfo& info  = textures[texture].info;
+    std::size_t               index = info.first_tile[mip] + (std::size_t) y * info.tiles_x[mip] + x;
+    return textures[texture].file->data() + sizeof(VirtualTextureHeader) + index * VT_PAGE_BYTES;
+}
+
+int VirtualTextureCache::allocate_page()
+{
+    // Used pages move to the tail, so a head used this frame means every page was.
+    if (lru_head < 0 || page_frames[lru_head] == frame)
+    {
+        return -1;
+    }
+    return lru_head;
+}
+
+void VirtualTextureCache::assign_page(int p_page, std::uint64_t p_key)
+{
+    if (page_keys[p_page] != VT_NO_TILE)
+    {
+        set_resident(page_keys[p_page], -1);
+        stats.evicted_tiles++;
+    }
+    page_keys[p_page] = p_key;
+    set_resident(p_key, p_page);
+}
+
+void VirtualTextureCache::touch_page(int p_page)
+{
+    if (page_pinned[p_page])
+    {
+        return;
+    }
+
+    page_frames[p_page] = frame;
+    if (p_page == lru_tail)
+    {
+        return;
+    }
+
+    unlink_page(p_page);
+    page_prev[p_page] = lru_tail;
+    page_next[p_page] = -1;
+    if (lru_tail >= 0)
+    {
+        page_next[lru_tail] = p_page;
+    }
+    else
+    {
+        lru_head = p_page;
+    }
+    lru_tail = p_page;
+}
+
+void VirtualTextureCache::unlink_page(int p_page)
+{
+    int prev = page_prev[p_page];
+    int next = page_next[p_page];
+    if (prev >= 0)
+    {
+        page_next[prev] = next;
+    }
+    else if (lru_head == p_page)
+    {
+        lru_head = next;
+    }
+    if (next >= 0)
+    {
+        page_prev[next] = prev;
+    }
+    else if (lru_tail == p_page)
+    {
+        lru_tail = prev;
+    }
+    page_prev[p_page] = -1;
+    page_next[p_page] = -1;
+}
+
+void VirtualTextureCache::set_resident(std::uint64_t p_key, std::int32_t p_page)
+{
+    unsigned int texture;
+    int          mip, x, y;
+    split_virtual_tile_key(p_key, texture, mip, x, y);
+
+    textures[texture].pages[mip][(std::size_t) y * textures[texture].info.tiles_x[mip] + x] = p_page;
+    if (p_page >= 0)
+    {
+        resident[p_key] = p_page;
+    }
+    else
+    {
+        resident.erase(p_key);
+    }
+    update_indirection(texture, mip, x, y);
+}
+
+void VirtualTextureCache::update_indirection(unsigned int p_texture, int p_mip, int p_x, int p_y)
+{
+    Texture&                  texture = textures[p_texture];
+    const VirtualTextureInfo& info    = texture.info;
+    int                       side    = std::max(1, info.tiles_side >> p_mip);
+
+    // Entries past the image's tiles are never looked up, they only pass the coarser entry down.
+    std::int32_t page = -1;
+    if (p_x < info.tiles_x[p_mip] && p_y < info.tiles_y[p_mip])
+    {
+        page = texture.pages[p_mip][(std::size_t) p_y * info.tiles_x[p_mip] + p_x];
+    }
+
+    std::uint32_t entry = 0;
+    if (page >= 0)
+    {
+        entry = pack_indirection_entry(page % pages_per_side, page / pages_per_side, p_mip);
+    }
+    else if (p_mip + 1 < info.mip_count)
+    {
+        int parent_side = std::max(1, info.tiles_side >> (p_mip + 1));
+        entry           = texture.indirection[p_mip + 1][(std::size_t) (p_y / 2) * parent_side + p_x / 2];
+    }
+
+    std::uint32_t& current = texture.indirection[p_mip][(std::size_t) p_y * side + p_x];
+    if (current == entry)
+    {
+        return;
+    }
+    current = entry;
+
+    std::array<int, 4>& dirty = texture.dirty[p_mip];
+    if (dirty[2] == 0)
+    {
+        dirty = {p_x, p_y, p_x + 1, p_y + 1};
+    }
+    else
+    {
+        dirty = {std::min(dirty[0], p_x), std::min(dirty[1], p_y), std::max(dirty[2], p_x + 1),
+                 std::max(dirty[3], p_y + 1)};
+    }
+
+    if (p_mip > 0)
+    {
+        int child_side = std::max(1, info.tiles_side >> (p_mip - 1));
+        for (int y = 2 * p_y; y < std::min(2 * p_y + 2, child_side); y++)
+        {
+            for (int x = 2 * p_x; x < std::min(2 * p_x + 2, child_side); x++)
+            {
+                update_indirection(p_texture, p_mip - 1, x, y);
+            }
+        }
+    }
+}
+
+VirtualTextureSystem::VirtualTextureSystem(unsigned int p_pages_per_side) :
+    cache(p_pages_per_side)
+{
+    physical_size        = (int) cache.get_pages_per_side() * VT_PAGE_SIZE;
+    feedback_framebuffer = 0;
+    feedback_color       = 0;
+    feedback_depth       = 0;
+    feedback_width       = 0;
+    feedback_height      = 0;
+    feedback_active      = false;
+    next_feedback_slot   = 0;
+
+    // No mipmaps: each page is sampled at its own level, picked through the indirection.
+    glGenTextures(1, &physical_texture);
+    glBindTexture(GL_TEXTURE_2D, physical_texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, physical_size, physical_size, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    ResourceRegistry::get_instance().track(RESOURCE_TEXTURE, physical_texture,
+                                           get_texture_bytes(physical_size, physical_size, 4, false),
+                                           "virtual_textures");
+
+    feedback_slots.resize(VT_FEEDBACK_SLOTS);
+    for (FeedbackSlot& slot : feedback_slots)
+    {
+        glGenBuffers(1, &slot.buffer);
+        slot.fence    = NULL;
+        slot.width    = 0;
+        slot.height   = 0;
+        slot.capacity = 0;
+    }
+}
+
+VirtualTextureSystem::~VirtualTextureSystem()
+{
+    ResourceRegistry& registry = ResourceRegistry::get_instance();
+    for (FeedbackSlot& slot : feedback_slots)
+    {
+        if (slot.fence)
+        {
+            glDeleteSync(slot.fence);
+        }
+        registry.untrack(RESOURCE_BUFFER, slot.buffer);
+        glDeleteBuffers(1, &slot.buffer);
+    }
+
+    if (feedback_framebuffer)
+    {
+        registry.untrack(RESOURCE_FRAMEBUFFER, feedback_framebuffer);
+        registry.untrack(RESOURCE_RENDERBUFFER, feedback_color);
+        registry.untrack(RESOURCE_RENDERBUFFER, feedback_depth);
+        glDeleteFramebuffers(1, &feedback_framebuffer);
+        glDeleteRenderbuffers(1, &feedback_color);
+        glDeleteRenderbuffers(1, &feedback_depth);
+    }
+
+    for (unsigned int texture : indirection_textures)
+    {
+        registry.untrack(RESOURCE_TEXTURE, texture);
+    }
+    glDeleteTextures((GLsizei) indirection_textures.size(), indirection_textures.data());
+    registry.untrack(RESOURCE_TEXTURE, physical_texture);
+    glDeleteTextures(1, &physical_texture);
+}
+
+unsigned int VirtualTextureSystem::add(const std::string& p_path)
+{
+    FileSystem& file_system = FileSystem::get_instance();
+    std::string cooked_path = p_path + ".vtex";
+    if (!file_system.exists(cooked_path) && !cook_virtual_texture_file(p_path, file_system.get_path(cooked_path)))
+    {
+        return VIRTUAL_TEXTURE_NONE;
+    }
+
+    unsigned int id = cache.add_texture(file_system.get_path(cooked_path));
+    if (id == VIRTUAL_TEXTURE_NONE)
+    {
+        return id;
+    }
+
+    // Filled by the first update(), from the entries the pinned tile gave every level.
+    const VirtualTextureInfo& info = cache.get_info(id);
+    unsigned int              texture;
+    std::size_t               bytes = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    for (int mip = 0; mip < info.mip_count; mip++)
+    {
+        int side = std::max(1, info.tiles_side >> mip);
+        glTexImage2D(GL_TEXTURE_2D, mip, GL_RGBA8, side, side, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        bytes += (std::size_t) side * side * 4;
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, info.mip_count - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    ResourceRegistry::get_instance().track(RESOURCE_TEXTURE, texture, bytes, cooked_path);
+    indirection_textures.push_back(texture);
+
+    std::cout << "Virtual texture " << p_path << ": " << info.width << "x" << info.height << ", " << info.mip_count
+              << " mips, " << info.tiles_x[0] << "x" << info.tiles_y[0] << " tiles" << std::endl;
+    return id;
+}
+
+void VirtualTextureSystem::begin_feedback(int p_viewport_width, int p_viewport_height)
+{
+    int width  = std::max(1, p_viewport_width / VT_FEEDBACK_DIVISOR);
+    int height = std::max(1, p_viewport_height / VT_FEEDBACK_DIVISOR);
+    if (width != feedback_width || height != feedback_height)
+    {
+        ResourceRegistry& registry = ResourceRegistry::get_instance();
+        if (feedback_framebuffer)
+        {
+            registry.untrack(RESOURCE_FRAMEBUFFER, feedback_framebuffer);
+            registry.untrack(RESOURCE_RENDERBUFFER, feedback_color);
+            registry.untrack(RESOURCE_RENDERBUFFER, feedback_depth);
+            glDeleteFramebuffers(1, &feedback_framebuffer);
+            glDeleteRenderbuffers(1, &feedback_color);
+            glDeleteRenderbuffers(1, &feedback_depth);
+        }
+
+        glGenFramebuffers(1, &feedback_framebuffer);
+        glGenRenderbuffers(1, &feedback_color);
+        glGenRenderbuffers(1, &feedback_depth);
+
+        glBindRenderbuffer(GL_RENDERBUFFER, feedback_color);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, feedback_depth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, feedback_framebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, feedback_color);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, feedback_depth);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+            std::cout << "ERROR::VIRTUAL_TEXTURE::FRAMEBUFFER_INCOMPLETE" << std::endl;
+        }
+
+        registry.track(RESOURCE_FRAMEBUFFER, feedback_framebuffer, 0, "virtual_textures");
+        registry.track(RESOURCE_RENDERBUFFER, feedback_color, (std::size_t) width * height * 4, "virtual_textures");
+        registry.track(RESOURCE_RENDERBUFFER, feedback_depth, (std::size_t) width * height * 4, "virtual_textures");
+        feedback_width  = width;
+        feedback_height = height;
+    }
+
+    // Zero is no texture, so whatever nothing covers asks for nothing.
+    glBindFramebuffer(GL_FRAMEBUFFER, feedback_framebuffer);
+    glViewport(0, 0, feedback_width, feedback_height);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    feedback_active = true;
+}
+
+void VirtualTextureSystem::end_feedback()
+{
+    feedback_active = false;
+
+    // Still unread when the ring comes back means the GPU is behind. A newer copy follows anyway.
+    FeedbackSlot& slot = feedback_slots[next_feedback_slot];
+    if (slot.fence)
+    {
+        glDeleteSync(slot.fence);
+        slot.fence = NULL;
+    }
+
+    std::size_t bytes = (std::size_t) feedback_width * feedback_height * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    if (bytes > slot.capacity)
+    {
+        ResourceRegistry& registry = ResourceRegistry::get_instance();
+        registry.untrack(RESOURCE_BUFFER, slot.buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr) bytes, NULL, GL_STREAM_READ);
+        registry.track(RESOURCE_BUFFER, slot.buffer, bytes, "virtual_textures");
+        slot.capacity = bytes;
+    }
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, feedback_width, feedback_height, GL_RGBA, GL_UNSIGNED_BYTE, (void*) 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    slot.fence         = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.width         = feedback_width;
+    slot.height        = feedback_height;
+    next_feedback_slot = (next_feedback_slot + 1) % feedback_slots.size();
+}
+
+void VirtualTextureSystem::update()
+{
+    // Oldest first. Only the newest finished copy is used, the older ones are stale already.
+    FeedbackSlot* newest = NULL;
+    for (unsigned int i = 0; i < feedback_slots.size(); i++)
+    {
+        FeedbackSlot& slot = feedback_slots[(next_feedback_slot + i) % feedback_slots.size()];
+        if (!slot.fence)
+        {
+            continue;
+        }
+
+        GLenum result = glClientWaitSync(slot.fence, 0, 0);
+        if (result == GL_TIMEOUT_EXPIRED)
+        {
+            break;
+        }
+        glDeleteSync(slot.fence);
+        slot.fence = NULL;
+        if (result == GL_WAIT_FAILED)
+        {
+            std::cout << "ERROR::VIRTUAL_TEXTURE::WAIT_FAILED" << std::endl;
+            continue;
+        }
+        newest = &slot;
+    }
+
+    if (newest)
+    {
+        std::size_t texels = (std::size_t) newest->width * newest->height;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, newest->buffer);
+        void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr) texels * 4, GL_MAP_READ_BIT);
+        if (data)
+        {
+            feedback_texels.resize(texels * 4);
+            std::memcpy(feedback_texels.data(), data, texels * 4);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            cache.process_feedback(feedback_texels.data(), texels);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    cache.take_loaded(uploads, VT_MAX_UPLOADS_PER_FRAME);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    if (!uploads.empty())
+    {
+        unsigned int pages_per_side = cache.get_pages_per_side();
+        glBindTexture(GL_TEXTURE_2D, physical_texture);
+        for (VirtualTile& tile : uploads)
+        {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, (int) (tile.page % pages_per_side) * VT_PAGE_SIZE,
+                            (int) (tile.page / pages_per_side) * VT_PAGE_SIZE, VT_PAGE_SIZE, VT_PAGE_SIZE, GL_RGBA,
+                            GL_UNSIGNED_BYTE, tile.texels.data());
+            cache.recycle(std::move(tile));
+        }
+        uploads.clear();
+    }
+
+    // Only the changed rectangle of each level, read out of the whole level in place.
+    for (unsigned int texture = 0; texture < indirection_textures.size(); texture++)
+    {
+        const VirtualTextureInfo& info = cache.get_info(texture);
+        for (int mip = 0; mip < info.mip_count; mip++)
+        {
+            int region[4];
+            if (!cache.take_dirty_region(texture, mip, region))
+            {
+                continue;
+            }
+
+            glBindTexture(GL_TEXTURE_2D, indirection_textures[texture]);
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, std::max(1, info.tiles_side >> mip));
+            glPixelStorei(GL_UNPACK_SKIP_PIXELS, region[0]);
+            glPixelStorei(GL_UNPACK_SKIP_ROWS, region[1]);
+            glTexSubImage2D(GL_TEXTURE_2D, mip, region[0], region[1], region[2] - region[0], region[3] - region[1],
+                            GL_RGBA, GL_UNSIGNED_BYTE, cache.get_indirection(texture, mip).data());
+        }
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    cache.end_frame();
+}
+
+void VirtualTextureSystem::bind(Shader& p_shader, unsigned int p_texture) const
+{
+    if (p_texture == VIRTUAL_TEXTURE_NONE)
+    {
+        p_shader.setVec4("vt_texture", glm::vec4(0.0f));
+        return;
+    }
+
+    const VirtualTextureInfo& info = cache.get_info(p_texture);
+
+    glActiveTexture(GL_TEXTURE0 + VT_PHYSICAL_UNIT);
+    glBindTexture(GL_TEXTURE_2D, physical_texture);
+    glActiveTexture(GL_TEXTURE0 + VT_INDIRECTION_UNIT);
+    glBindTexture(GL_TEXTURE_2D, indirection_textures[p_texture]);
+    glActiveTexture(GL_TEXTURE0);
+
+    p_shader.setInt("vt_physical", VT_PHYSICAL_UNIT);
+    p_shader.setInt("vt_indirection", VT_INDIRECTION_UNIT);
+    p_shader.setVec4("vt_texture", glm::vec4((float) info.width, (float) info.height, (float) (info.mip_count - 1),
+                                             (float) p_texture));
+    p_shader.setVec3("vt_page", glm::vec3((float) VT_TILE_SIZE, (float) VT_TILE_BORDER, (float) physical_size));
+    // The feedback target is VT_FEEDBACK_DIVISOR times smaller, so its derivatives are that much larger.
+    p_shader.setFloat("vt_lod_bias", feedback_active ? -std::log2((float) VT_FEEDBACK_DIVISOR) : 0.0f);
+}
+
+VirtualTextureCache& VirtualTextureSystem::get_cache()
+{
+    return cache;
+}